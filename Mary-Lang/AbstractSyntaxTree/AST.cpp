@@ -0,0 +1,65 @@
+#include "AST.hpp"
+#include <iostream>
+
+// Semantic analysis is not written yet, so Analyze does nothing; Dump names a node and
+// where it starts. The FlatTree walker is the way to look at a whole tree.
+#define WIDE_STRING( str ) L ## str
+#define DEFINE_ANALYZE_DUMP( Node ) \
+	void Node::Analyze() const {} \
+	void Node::Dump() const { std::wcout << WIDE_STRING( #Node ) << L" @" << Offset() << std::endl; }
+
+namespace MaryLang
+{
+	namespace AbstractSyntaxTree
+	{
+		void Locatable::Print( Printer & ) const {}
+
+		void Expression::Dump() const { std::wcout << L"Expression @" << Offset() << std::endl; }
+		void Variable::Analyze() const {}
+
+		DEFINE_ANALYZE_DUMP( IllegalExpression )
+		DEFINE_ANALYZE_DUMP( ExpressionList )
+		DEFINE_ANALYZE_DUMP( Constant )
+		DEFINE_ANALYZE_DUMP( StringLiteralExpression )
+		DEFINE_ANALYZE_DUMP( StringInterpolExpression )
+		DEFINE_ANALYZE_DUMP( ConditionalExpression )
+		DEFINE_ANALYZE_DUMP( UnaryExpression )
+		DEFINE_ANALYZE_DUMP( BinaryExpression )
+		DEFINE_ANALYZE_DUMP( AssignmentExpression )
+		DEFINE_ANALYZE_DUMP( PostfixExpression )
+		DEFINE_ANALYZE_DUMP( SubscriptExpression )
+		DEFINE_ANALYZE_DUMP( DotExpression )
+		DEFINE_ANALYZE_DUMP( CallExpression )
+
+		DEFINE_ANALYZE_DUMP( IllegalStatement )
+		DEFINE_ANALYZE_DUMP( CaseOfStatement )
+		DEFINE_ANALYZE_DUMP( IfStatement )
+		DEFINE_ANALYZE_DUMP( IterativeStatement )
+		DEFINE_ANALYZE_DUMP( DoWhileStatement )
+		DEFINE_ANALYZE_DUMP( WhileStatement )
+		DEFINE_ANALYZE_DUMP( ForStatement )
+		DEFINE_ANALYZE_DUMP( ForInStatement )
+		DEFINE_ANALYZE_DUMP( LabelStatement )
+		DEFINE_ANALYZE_DUMP( ReturnStatement )
+		DEFINE_ANALYZE_DUMP( CheckAmongStatement )
+		DEFINE_ANALYZE_DUMP( ContinueStatement )
+		DEFINE_ANALYZE_DUMP( LeaveStatement )
+		DEFINE_ANALYZE_DUMP( CompoundStatement )
+		DEFINE_ANALYZE_DUMP( ExpressionStatement )
+		DEFINE_ANALYZE_DUMP( DeclarationStatement )
+
+		DEFINE_ANALYZE_DUMP( VariableDeclaration )
+		DEFINE_ANALYZE_DUMP( Identifier )
+		DEFINE_ANALYZE_DUMP( ParameterDeclaration )
+		DEFINE_ANALYZE_DUMP( FunctionDeclaration )
+		DEFINE_ANALYZE_DUMP( ClassDeclaration )
+		DEFINE_ANALYZE_DUMP( EnumDeclaration )
+		DEFINE_ANALYZE_DUMP( NamespaceDeclaration )
+
+		void ParameterlistDeclaration::Analyze() const {}
+		void ParameterlistDeclaration::Dump() const
+		{
+			std::wcout << L"ParameterlistDeclaration (" << Size() << L" parameters)" << std::endl;
+		}
+	} // namespace AbstractSyntaxTree
+} // namespace MaryLang
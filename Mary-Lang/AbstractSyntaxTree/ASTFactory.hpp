@@ -1,7 +1,11 @@
 #pragma once
 
+#include <memory>
+#include <vector>
 #include "AST.hpp"
-#include "../Utils/Memory.hpp"
+#include "FlatTree.hpp"
+#include "../Utils/Arena.hpp"
+#include "../Utils/Statistics.hpp"
 
 namespace MaryLang
 {
@@ -10,140 +14,385 @@ namespace MaryLang
 		using namespace Lexer;
 		using namespace Support;
 
+		// Builds nodes in the arena of the program being parsed. Nodes and child lists are
+		// bump-allocated and never destroyed one by one; the arena is freed as a whole.
+		// Given a FlatTree, every node is also appended to it as it is built, so the parser
+		// emits the flat form directly rather than having it converted afterwards.
 		struct ASTFactory
 		{
-			static std::unique_ptr<CompoundStatement> GetCompoundStatement( Token const & token )
+			explicit ASTFactory( Arena & arena, FlatTree * flat_tree = nullptr )
+				: arena( arena ), flat( flat_tree ), scratch(), stats( Statistics::Local() ) {}
+
+			// Copies `nodes' into a span in the arena. The parser gathers children in a
+			// reusable vector first, so a list costs one allocation however it grew.
+			template<typename T, typename U>
+			List<T> GetList( U * const * nodes, std::size_t count )
+			{
+				static_assert( std::is_base_of<T, U>::value, "list elements must be nodes of the list's type" );
+				if( count == 0 ) return List<T>();
+				T const ** elements = static_cast<T const **>( arena.Allocate( count * sizeof( T const * ), alignof( T const * ) ) );
+				for( std::size_t i = 0; i < count; ++i ) elements[i] = nodes[i];
+				return List<T>( elements, static_cast<typename List<T>::size_type>( count ) );
+			}
+			template<typename T, typename U>
+			List<T> GetList( std::vector<U *> const & nodes )
 			{
-				return make_unique<CompoundStatement>( token );
+				return GetList<T>( nodes.data(), nodes.size() );
 			}
 
-			static std::unique_ptr<CheckAmongStatement> GetCheckAmongStatement( Token const & token, 
-				std::unique_ptr<Expression> expr, std::unique_ptr<Statement> body )
+			// Starts or stops emitting flat nodes; returns the tree emitted to until now.
+			FlatTree * SetFlatTree( FlatTree * flat_tree )
 			{
-				return make_unique<CheckAmongStatement>( token, std::move( expr ), std::move( body ) );
+				FlatTree * const previous = flat;
+				flat = flat_tree;
+				return previous;
 			}
 
-			static std::unique_ptr<IfStatement> GetIfStatement( Token const & token, 
-				std::unique_ptr<Expression> conditional_expr,
-				std::unique_ptr<Expression> other_expr, 
-				std::unique_ptr<Statement> else_statement,
-				std::unique_ptr<Statement> body )
+			Token const * GetToken( Token const & token )
 			{
-				return make_unique<IfStatement>( token, std::move( conditional_expr ), std::move( other_expr ), 
-					std::move( else_statement ), std::move( body ) );
+				return arena.New<Token>( token );
 			}
-			static std::unique_ptr<WhileStatement> GetWhileStatement( Token const & token, std::unique_ptr<Expression> expression,
-				std::unique_ptr<Statement> statement )
+
+			// Makes the imports and the top-level statements the root of the flat tree.
+			void SetProgram( List<Statement> statements, List<Imports> imports = List<Imports>() )
 			{
-				return make_unique<WhileStatement>( token, std::move( expression ), std::move( statement ) );
+				if( flat == nullptr ) return;
+				scratch.clear();
+				for( Imports const * import : imports ) scratch.push_back( Index( import ) );
+				for( Statement const * statement : statements ) scratch.push_back( Index( statement ) );
+				flat->SetRoot( flat->Add( NodeKind::Program, 0, 0, scratch.data(), static_cast<std::uint32_t>( scratch.size() ) ) );
 			}
-			
-			static std::unique_ptr<DoWhileStatement> GetDoWhileStatement( Token const & token, 
-				std::unique_ptr<Expression> expression,
-				std::unique_ptr<Statement> statement )
+
+			Imports * GetImports( Token const & token, Token const & path )
 			{
-				return make_unique<DoWhileStatement>( token, std::move( expression ), std::move( statement ) );
+				return Flat( arena.New<Imports>( token, path ), NodeKind::ImportDeclaration, token, { Index( path ) } );
 			}
-			
-			static std::unique_ptr<ForInStatement> GetForInStatement( Token const & token, std::unique_ptr<Declaration> declaration, 
-				std::unique_ptr<Expression> init, std::unique_ptr<Expression> expression, 
-				std::unique_ptr<Statement> statement )
+
+			CompoundStatement * GetCompoundStatement( Token const & token, List<Statement> statements )
 			{
-				return make_unique<ForInStatement>( token, std::move( declaration ), std::move( expression ), 
-					std::move( init ), std::move( statement ) );
+				return Flat( arena.New<CompoundStatement>( token, statements ), NodeKind::CompoundStatement, token, statements );
 			}
-			static std::unique_ptr<ForStatement> GetForStatement( Token const & token, std::unique_ptr<Declaration> declaration, 
-				std::unique_ptr<Expression> initializer, std::unique_ptr<Expression> condition, 
-				std::unique_ptr<Expression> stepping, std::unique_ptr<Statement> statement )
+
+			CheckAmongStatement * GetCheckAmongStatement( Token const & token,
+				Expression const * expr, Statement const * body )
 			{
-				return make_unique<ForStatement>( token, std::move( declaration ), std::move( initializer ), 
-					std::move( condition ), std::move( stepping ), std::move( statement ) );
+				return Flat( arena.New<CheckAmongStatement>( token, expr, body ), NodeKind::CheckAmongStatement, token,
+					{ Index( expr ), Index( body ) } );
 			}
-			
-			static std::unique_ptr<Declaration> GetFunctionDeclaration( Token const & token, Token const & function_specifier, 
-				Token const & function_name, std::unique_ptr<ParameterlistDeclaration> param_list,
-				Token const & return_trailing_specifier, Token const & type_specifier, std::unique_ptr<Statement> body )
+
+			IfStatement * GetIfStatement( Token const & token,
+				Expression const * conditional_expr,
+				Declaration const * declaration,
+				Statement const * body,
+				Statement const * else_statement )
+			{
+				return Flat( arena.New<IfStatement>( token, conditional_expr, declaration, body, else_statement ),
+					NodeKind::IfStatement, token,
+					{ Index( conditional_expr ), Index( declaration ), Index( body ), Index( else_statement ) } );
+			}
+			WhileStatement * GetWhileStatement( Token const & token, Expression const * expression,
+				Statement const * statement )
 			{
-				return make_unique<FunctionDeclaration>( token, function_specifier, function_name, std::move( param_list ),
-					return_trailing_specifier, type_specifier, std::move( body ) );
+				return Flat( arena.New<WhileStatement>( token, expression, statement ), NodeKind::WhileStatement, token,
+					{ Index( expression ), Index( statement ) } );
 			}
 
-			static std::unique_ptr<EnumDeclaration> GetEnumDeclaration( Token const & token, std::unique_ptr<Token> enum_id )
+			DoWhileStatement * GetDoWhileStatement( Token const & token,
+				Expression const * expression,
+				Statement const * statement )
 			{
-				return make_unique<EnumDeclaration>( token, std::move( enum_id ) );
+				return Flat( arena.New<DoWhileStatement>( token, expression, statement ), NodeKind::DoWhileStatement, token,
+					{ Index( expression ), Index( statement ) } );
 			}
 
-			static std::unique_ptr<NamespaceDeclaration>GetNamespaceDeclaration( Token const & token, 
-				std::unique_ptr<Token> namespace_name, std::unique_ptr<Statement> namespace_body )
+			ForInStatement * GetForInStatement( Token const & token, Declaration const * declaration,
+				Expression const * init, Expression const * expression,
+				Statement const * statement )
 			{
-				return make_unique<NamespaceDeclaration>( token, std::move( namespace_name ), std::move( namespace_body ) );
+				return Flat( arena.New<ForInStatement>( token, declaration, expression, init, statement ),
+					NodeKind::ForInStatement, token,
+					{ Index( declaration ), Index( expression ), Index( init ), Index( statement ) } );
+			}
+			ForStatement * GetForStatement( Token const & token, Declaration const * declaration,
+				Expression const * initializer, Expression const * condition,
+				Expression const * stepping, Statement const * statement )
+			{
+				return Flat( arena.New<ForStatement>( token, declaration, initializer, condition, stepping, statement ),
+					NodeKind::ForStatement, token,
+					{ Index( declaration ), Index( initializer ), Index( condition ), Index( stepping ), Index( statement ) } );
 			}
 
-			static std::unique_ptr<ContinueStatement> GetContinueStatement( Token const & token )
+			// `body' is null when the body was skimmed; its range is recorded either way.
+			FunctionDeclaration * GetFunctionDeclaration( Token const & token, Token const & function_specifier,
+				Token const & function_name, ParameterlistDeclaration const * param_list,
+				Token const & return_trailing_specifier, Token const & type_specifier, Statement const * body,
+				std::uint32_t body_begin, std::uint32_t body_end )
 			{
-				return make_unique<ContinueStatement>( token );
+				return Flat( arena.New<FunctionDeclaration>( token, function_specifier, function_name, param_list,
+					return_trailing_specifier, type_specifier, body, body_begin, body_end ), NodeKind::FunctionDeclaration, token,
+					{ Index( function_specifier ), Index( function_name ), Index( param_list ),
+					Index( return_trailing_specifier ), Index( type_specifier ), Index( body ) } );
 			}
 
-			static std::unique_ptr<ReturnStatement> GetReturnStatement( Token const & token, std::unique_ptr<Expression> expr )
+			ParameterDeclaration * GetParameterDeclaration( Token const & name )
 			{
-				return make_unique<ReturnStatement>( token, std::move( expr ) );
+				// To-Do -> type specifiers
+				return Flat( arena.New<ParameterDeclaration>( name, arena.New<Identifier>( name ), nullptr ),
+					NodeKind::ParameterDeclaration, name, { Index( name ) } );
 			}
 
-			static std::unique_ptr<LeaveStatement> GetLeaveStatement( Token const & token )
+			ParameterlistDeclaration * GetParameterList( Token const & token, List<ParameterDeclaration> parameters )
 			{
-				return make_unique<LeaveStatement>( token );
+				return Flat( arena.New<ParameterlistDeclaration>( token, parameters ), NodeKind::ParameterList, token, parameters );
 			}
 
-			static std::unique_ptr<ExpressionStatement> GetExpressionStatement( Token const & token, 
-				std::unique_ptr<Expression> expression )
+			EnumDeclaration * GetEnumDeclaration( Token const & token, Token const * enum_id, List<Enumerator> enumerators )
 			{
-				return make_unique<ExpressionStatement>( token, std::move( expression ) );
+				// the name comes first, NoNode when the enum has none
+				EnumDeclaration * const node = arena.New<EnumDeclaration>( token, enum_id, enumerators );
+				Count( NodeKind::EnumDeclaration );
+				if( flat != nullptr ) node->SetFlatIndex( Flat( NodeKind::EnumDeclaration, token.Offset(), 0,
+					enumerators, { Index( enum_id ) } ) );
+				return node;
 			}
 
-			static std::unique_ptr<ClassDeclaration> GetClassDeclaration( Token const & token )
+			Enumerator * GetEnumerator( Token const & identifier, Token const * value )
 			{
-				return make_unique<ClassDeclaration>( token );
+				return Flat( arena.New<Enumerator>( identifier, value ), NodeKind::Enumerator, identifier,
+					{ Index( value ) } );
 			}
 
-			static std::unique_ptr<DeclarationStatement> GetDeclarationStatement( Token const & token,
-				std::unique_ptr<Declaration> declaration )
+			NamespaceDeclaration * GetNamespaceDeclaration( Token const & token,
+				Token const * namespace_name, Statement const * namespace_body )
 			{
-				return make_unique<DeclarationStatement>( token, std::move( declaration ) );
+				return Flat( arena.New<NamespaceDeclaration>( token, namespace_name, namespace_body ),
+					NodeKind::NamespaceDeclaration, token, { Index( namespace_name ), Index( namespace_body ) } );
 			}
-			static std::unique_ptr<LabelStatement> GetLabelStatement( Token const & token,
-				std::unique_ptr<Token> value )
+
+			ContinueStatement * GetContinueStatement( Token const & token )
 			{
-				return make_unique<LabelStatement>( token, std::move( value ) );
+				return Flat( arena.New<ContinueStatement>( token ), NodeKind::ContinueStatement, token, {} );
 			}
 
-			static std::unique_ptr<ExpressionList> GetExpressionList( Token const & token, 
-				std::vector<std::unique_ptr<Expression>> && expressions )
+			ReturnStatement * GetReturnStatement( Token const & token, Expression const * expr )
 			{
-				return make_unique<ExpressionList>( token, std::move( expressions ) );
+				return Flat( arena.New<ReturnStatement>( token, expr ), NodeKind::ReturnStatement, token, { Index( expr ) } );
 			}
 
-			static std::unique_ptr<AssignmentExpression> GetAssignmentExpression( Token const & token,
-				std::unique_ptr<Expression> lhs, std::unique_ptr<Expression> rhs )
+			LeaveStatement * GetLeaveStatement( Token const & token )
 			{
-				return make_unique<AssignmentExpression>( token, std::move( lhs ), std::move( rhs ) );
+				return Flat( arena.New<LeaveStatement>( token ), NodeKind::LeaveStatement, token, {} );
 			}
-		};
 
-		struct Imports
-		{
+			IllegalStatement * GetIllegalStatement( Token const & token )
+			{
+				return Flat( arena.New<IllegalStatement>( token ), NodeKind::IllegalStatement, token, {} );
+			}
+
+			ExpressionStatement * GetExpressionStatement( Token const & token,
+				Expression const * expression )
+			{
+				return Flat( arena.New<ExpressionStatement>( token, expression ), NodeKind::ExpressionStatement, token,
+					{ Index( expression ) } );
+			}
+
+			ClassDeclaration * GetClassDeclaration( Token const & token, Token const & name, List<Declaration> declarations )
+			{
+				ClassDeclaration * const node = arena.New<ClassDeclaration>( token, name, declarations );
+				Count( NodeKind::ClassDeclaration );
+				if( flat != nullptr ) node->SetFlatIndex( Flat( NodeKind::ClassDeclaration, token.Offset(), 0,
+					declarations, { Index( name ) } ) );
+				return node;
+			}
+
+			DeclarationStatement * GetDeclarationStatement( Token const & token,
+				Declaration const * declaration )
+			{
+				return Flat( arena.New<DeclarationStatement>( token, declaration ), NodeKind::DeclarationStatement, token,
+					{ Index( declaration ) } );
+			}
+			LabelStatement * GetLabelStatement( Token const & token,
+				Token const * value )
+			{
+				return Flat( arena.New<LabelStatement>( token, value ), NodeKind::LabelStatement, token, { Index( value ) } );
+			}
+
+			VariableDeclarator * GetVariableDeclarator( Token const & name, Token const * type, Expression const * init )
+			{
+				return Flat( arena.New<VariableDeclarator>( name, type, init ), NodeKind::VariableDeclarator, name,
+					{ Index( name ), Index( type ), Index( init ) } );
+			}
+
+			VariableDeclaration * GetVariableDeclaration( Token const & token, List<VariableDeclarator> variables )
+			{
+				return Flat( arena.New<VariableDeclaration>( token, variables ), NodeKind::VariableDeclaration, token, variables );
+			}
+
+			Variable * GetVariable( Token const & token )
+			{
+				return Leaf( arena.New<Variable>( token ), NodeKind::Variable, token );
+			}
+
+			Constant * GetConstant( Token const & token )
+			{
+				return Leaf( arena.New<Constant>( token ), NodeKind::Constant, token );
+			}
+
+			StringLiteralExpression * GetStringLiteral( Token const & token )
+			{
+				return Leaf( arena.New<StringLiteralExpression>( token ), NodeKind::StringLiteral, token );
+			}
+
+			StringInterpolExpression * GetStringInterpolation( Token const & token )
+			{
+				return Leaf( arena.New<StringInterpolExpression>( token ), NodeKind::StringInterpolation, token );
+			}
+
+			IllegalExpression * GetIllegalExpression( Token const & token )
+			{
+				return Leaf( arena.New<IllegalExpression>( token ), NodeKind::IllegalExpression, token );
+			}
 
+			UnaryExpression * GetUnaryExpression( Token const & token, Expression const * operand )
+			{
+				return Flat( arena.New<UnaryExpression>( token, operand ), NodeKind::UnaryExpression, token,
+					{ Index( operand ) }, static_cast<std::uint32_t>( token.Type() ) );
+			}
+
+			PostfixExpression * GetPostfixExpression( Token const & token, Expression const * operand )
+			{
+				return Flat( arena.New<PostfixExpression>( token, operand ), NodeKind::PostfixExpression, token,
+					{ Index( operand ) }, static_cast<std::uint32_t>( token.Type() ) );
+			}
+
+			BinaryExpression * GetBinaryExpression( Token const & token, Expression const * lhs, Expression const * rhs )
+			{
+				return Flat( arena.New<BinaryExpression>( token, lhs, rhs ), NodeKind::BinaryExpression, token,
+					{ Index( lhs ), Index( rhs ) }, static_cast<std::uint32_t>( token.Type() ) );
+			}
+
+			SubscriptExpression * GetSubscriptExpression( Token const & token, Expression const * expr, Expression const * index )
+			{
+				return Flat( arena.New<SubscriptExpression>( token, expr, index ), NodeKind::SubscriptExpression, token,
+					{ Index( expr ), Index( index ) } );
+			}
+
+			DotExpression * GetDotExpression( Token const & token, Expression const * expr, Token const & id )
+			{
+				return Flat( arena.New<DotExpression>( token, expr, id ), NodeKind::DotExpression, token,
+					{ Index( expr ), Index( id ) } );
+			}
+
+			CallExpression * GetCallExpression( Token const & token, Expression const * callee, List<Expression> arguments )
+			{
+				CallExpression * const node = arena.New<CallExpression>( token, callee, arguments );
+				Count( NodeKind::CallExpression );
+				if( flat != nullptr ) node->SetFlatIndex( Flat( NodeKind::CallExpression, token.Offset(), 0,
+					arguments, { Index( callee ) } ) );
+				return node;
+			}
+
+			ExpressionList * GetExpressionList( Token const & token, List<Expression> expressions )
+			{
+				return Flat( arena.New<ExpressionList>( token, expressions ), NodeKind::ExpressionList, token, expressions );
+			}
+
+			AssignmentExpression * GetAssignmentExpression( Token const & token,
+				Expression const * lhs, Expression const * rhs )
+			{
+				return Flat( arena.New<AssignmentExpression>( token, lhs, rhs ), NodeKind::AssignmentExpression, token,
+					{ Index( lhs ), Index( rhs ) }, static_cast<std::uint32_t>( token.Type() ) );
+			}
+
+			ConditionalExpression * GetConditionalExpression( Token const & token, Expression const * cond,
+				Expression const * lhs, Expression const * rhs )
+			{
+				return Flat( arena.New<ConditionalExpression>( token, cond, lhs, rhs ), NodeKind::ConditionalExpression, token,
+					{ Index( cond ), Index( lhs ), Index( rhs ) } );
+			}
+		private:
+			// Flat index of a child. Nodes got theirs when they were built; a bare token
+			// becomes a node of its own here, just before the node referring to it.
+			NodeIndex Index( FlatIndexed const * node ) const { return node != nullptr ? node->FlatIndex() : NoNode; }
+			NodeIndex Index( Token const * token ) { return flat != nullptr ? flat->AddToken( token ) : NoNode; }
+			NodeIndex Index( Token const & token ) { return token.Type() != TokenType::TK_INVALID ? Index( &token ) : NoNode; }
+
+			inline void Count( NodeKind kind )
+			{
+				if( stats != nullptr ) ++stats->nodes[static_cast<std::size_t>( kind )];
+			}
+
+			template<typename T>
+			T * Leaf( T * node, NodeKind kind, Token const & token )
+			{
+				Count( kind );
+				if( flat != nullptr ) node->SetFlatIndex( flat->AddLeaf( kind, token ) );
+				return node;
+			}
+
+			template<typename T>
+			T * Flat( T * node, NodeKind kind, Token const & token, std::initializer_list<NodeIndex> children,
+				std::uint32_t value = 0 )
+			{
+				Count( kind );
+				if( flat != nullptr ) node->SetFlatIndex( flat->Add( kind, token.Offset(), value, children ) );
+				return node;
+			}
+
+			template<typename T, typename U>
+			T * Flat( T * node, NodeKind kind, Token const & token, List<U> const & list )
+			{
+				Count( kind );
+				if( flat != nullptr ) node->SetFlatIndex( Flat( kind, token.Offset(), 0, list ) );
+				return node;
+			}
+
+			template<typename U>
+			NodeIndex Flat( NodeKind kind, std::uint32_t offset, std::uint32_t value, List<U> const & list,
+				std::initializer_list<NodeIndex> leading = {} )
+			{
+				scratch.assign( leading.begin(), leading.end() );
+				for( U const * item : list ) scratch.push_back( Index( item ) );
+				return flat->Add( kind, offset, value, scratch.data(), static_cast<std::uint32_t>( scratch.size() ) );
+			}
+
+			Arena &					arena;
+			FlatTree *				flat;
+			std::vector<NodeIndex>	scratch; // children of the list node being emitted
+			Statistics::Shard *		stats; // null unless counting
 		};
 
+		// Owns every node of one translation unit. Dropping the program, or calling Clear,
+		// frees them all at once instead of walking the tree.
 		struct ParsedProgram
 		{
-			ParsedProgram(): source_program(), source_imports() {}
-			~ParsedProgram() {}
+			ParsedProgram(): arena(), flat_tree(), source_program(), source_imports() {}
 
-			inline void Append( std::unique_ptr<Statement> s )	  { source_program.Append( std::move( s ) ); }
-			inline void Append( std::unique_ptr<Imports> import ) { source_imports.Append( std::move( import ) ); }
+			inline Support::Arena & Arena() { return arena; }
+			inline void SetSourceProgram( List<Statement> statements ) { source_program = statements; }
+			inline void SetSourceImports( List<Imports> imports ) { source_imports = imports; }
 			List<Statement> const & SourceProgram() const { return source_program; }
 			List<Imports>   const & SourceImports() const { return source_imports; }
+
+			// The same program as a FlatTree, if the parser was asked to emit one.
+			inline AbstractSyntaxTree::FlatTree * EnableFlatTree()
+			{
+				if( !flat_tree ) flat_tree.reset( new AbstractSyntaxTree::FlatTree );
+				return flat_tree.get();
+			}
+			inline AbstractSyntaxTree::FlatTree * FlatTree() { return flat_tree.get(); }
+			inline AbstractSyntaxTree::FlatTree const * FlatTree() const { return flat_tree.get(); }
+
+			void Clear()
+			{
+				source_program = List<Statement>();
+				source_imports = List<Imports>();
+				arena.Reset();
+				if( flat_tree ) flat_tree->Clear();
+			}
 		private:
+			Support::Arena	arena;
+			std::unique_ptr<AbstractSyntaxTree::FlatTree> flat_tree;
 			List<Statement> source_program;
 			List<Imports>   source_imports;
 		};
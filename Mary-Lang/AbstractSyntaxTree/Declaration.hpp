@@ -1,7 +1,6 @@
 #pragma once
 
 #include "Statement.hpp"
-#include "../Utils/Memory.hpp"
 
 #define ANALYZE_DUMP_DECL \
 	void Analyze() const; \
@@ -27,23 +26,37 @@ namespace MaryLang
 			Declaration( Lexer::Token const & token ): Statement( token )
 			{
 			}
-			virtual ~Declaration() {}
 			virtual void Analyze() const = 0;
 		};
 
+		// One name of a variable declaration: `name [: type] [= initializer]'.
+		struct VariableDeclarator: FlatIndexed
+		{
+			VariableDeclarator( Token const & name, Token const * type, Expression const * init )
+				: variable_name( name ), type_name( type ), initializer( init )
+			{
+			}
+		private:
+			Token				const variable_name;
+			Token const *		const type_name;
+			Expression const *	const initializer;
+		};
+
+		// `var a, b : int = 0' or `int a, b = 0'; the token is `var' or the leading type.
 		struct VariableDeclaration: Declaration
 		{
-			VariableDeclaration( Lexer::Token const & token )
-				: Declaration( token ), type_value( nullptr )
+			VariableDeclaration( Lexer::Token const & token, List<VariableDeclarator> variables )
+				: Declaration( token ), type_value( nullptr ), declarators( variables )
 			{}
+			ANALYZE_DUMP_DECL;
 		private:
 			ValueTag      const * const type_value; // what it points to
+			List<VariableDeclarator> const declarators;
 		};
 
 		struct Identifier: Locatable
 		{
 			Identifier( Lexer::Token const & token ): Locatable( token ){}
-			~Identifier() {}
 			ANALYZE_DUMP_DECL;
 		};
 
@@ -54,114 +67,130 @@ namespace MaryLang
 				:   Declaration( token ), id( identifier ), type_specifier( type )
 			{
 			}
-			~ParameterDeclaration(){}
 			ANALYZE_DUMP_DECL;
 		private:
 			Identifier      const * const id;
 			TypeSpecifier   const * const type_specifier;
 		};
 
-		struct ParameterlistDeclaration
+		struct ParameterlistDeclaration: FlatIndexed
 		{
-			ParameterlistDeclaration( Lexer::Token const & token ): list()
+			ParameterlistDeclaration( Lexer::Token const & token, List<ParameterDeclaration> parameters )
+				: list( parameters )
 			{
 			}
 			typedef List<ParameterDeclaration>::const_iterator const_iterator;
 			typedef List<ParameterDeclaration>::iterator		iterator;
 			typedef List<ParameterDeclaration>::size_type		size_type;
 
-			iterator begin() { return list.begin(); }
-			iterator end() { return list.end(); }
+			iterator begin() const { return list.begin(); }
+			iterator end() const { return list.end(); }
 			const_iterator cbegin() const { return list.cbegin(); }
 			const_iterator cend() const { return list.cend(); }
-			size_type Size() { return list.Size(); }
-			void Append( std::unique_ptr<ParameterDeclaration> declaration ) { list.Append( std::move( declaration )); }
+			size_type Size() const { return list.Size(); }
 		
-			~ParameterlistDeclaration() {}
 			ANALYZE_DUMP_DECL;
 		private:
-			List<ParameterDeclaration> list;
+			List<ParameterDeclaration> const list;
 		};
 
+		// The body spans [body_begin, body_end) of the source, braces included. A parser
+		// that skims function bodies leaves `body' null until Parser::ParseFunctionBody.
 		struct FunctionDeclaration: Declaration
 		{
 			FunctionDeclaration( Lexer::Token const & token, Lexer::Token const & specifier, 
-				Lexer::Token const & name, std::unique_ptr<ParameterlistDeclaration> param_list,
+				Lexer::Token const & name, ParameterlistDeclaration const * param_list,
 				Lexer::Token const & return_trailing_specifier, Lexer::Token const & type_specifier,
-				std::unique_ptr<Statement> body )
+				Statement const * body, std::uint32_t body_begin, std::uint32_t body_end )
 				:   Declaration( token ), function_specifier( specifier ), function_id( name ),
 				function_trailing_specifier( return_trailing_specifier ), function_type_specifier( type_specifier ),
-				parameter_list( std::move( param_list ) ), statement_body( std::move( body ) )
+				parameter_list( param_list ), body_begin( body_begin ), body_end( body_end ), statement_body( body )
 			{
 			}
-			~FunctionDeclaration() {}
 			ANALYZE_DUMP_DECL;
+
+			inline Token const &	Name() const { return function_id; }
+			inline Statement const * Body() const { return statement_body; }
+			inline std::uint32_t	BodyBegin() const { return body_begin; }
+			inline std::uint32_t	BodyEnd() const { return body_end; }
+			inline bool				IsBodySkimmed() const { return statement_body == nullptr; }
+			// Only the parser that skimmed the body fills it in, once.
+			inline void				SetBody( Statement const * body ) const { statement_body = body; }
 		private:
 			Token					 const function_specifier;
 			Token					 const function_id;
 			Token					 const function_trailing_specifier;
 			Token					 const function_type_specifier;
-			std::unique_ptr<ParameterlistDeclaration> const parameter_list;
-			std::unique_ptr<Statement> const statement_body;
+			ParameterlistDeclaration const * const parameter_list;
+			std::uint32_t			 const body_begin;
+			std::uint32_t			 const body_end;
+			mutable Statement const * statement_body; // parsed on demand when skimmed
 		};
 
 		struct ClassDeclaration: Declaration
 		{
-			ClassDeclaration( Lexer::Token const & token )
-				: Declaration( token )
-			{
-			}
-			void Append( std::unique_ptr<Token> access_specifier, std::unique_ptr<Declaration> declaration )
+			ClassDeclaration( Lexer::Token const & token, Lexer::Token const & name, List<Declaration> declarations )
+				: Declaration( token ), class_name( name ), class_declarations( declarations )
 			{
-				class_declarations.Append( std::move( declaration ) );
 			}
 			ANALYZE_DUMP_DECL;
 
 		private:
-			List<Declaration>  class_declarations;
+			Token			  const class_name;
+			List<Declaration> const class_declarations;
 		};
 
-		struct Enumerator
+		struct Enumerator: FlatIndexed
 		{
-			Enumerator( Token const & identifier, std::unique_ptr<Token> value = nullptr )
-				: enumerator_id( identifier ), enumerator_value( std::move( value ) )
+			Enumerator( Token const & identifier, Token const * value = nullptr )
+				: enumerator_id( identifier ), enumerator_value( value )
 			{
 			}
-			~Enumerator() {}
 		private:
 			Token					const enumerator_id;
-			std::unique_ptr<Token>	const enumerator_value;
+			Token const *	const enumerator_value;
 		};
 
 		struct EnumDeclaration: Declaration
 		{
-			EnumDeclaration( Token const & token, std::unique_ptr<Token> enum_id )
-				: Declaration( token ), enum_name( std::move( enum_id ) )
+			EnumDeclaration( Token const & token, Token const * enum_id, List<Enumerator> enumerators )
+				: Declaration( token ), enum_name( enum_id ), enumerator_list( enumerators )
 			{
 			}
-			void Append( Token const & id, std::unique_ptr<Token> value )
-			{
-				enumerator_list.Append( Support::make_unique<Enumerator>( id, std::move( value ) ) );
-			}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Token>	const	enum_name;
-			List<Enumerator>		enumerator_list;
+			Token const *	const	enum_name;
+			List<Enumerator> const	enumerator_list;
 		};
 
 		struct NamespaceDeclaration: Declaration
 		{
-			NamespaceDeclaration( Token const & token, std::unique_ptr<Token> namespace_name,
-				std::unique_ptr<Statement> namespace_body )
-				: Declaration( token ), name( std::move( namespace_name ) ),
-				body( std::move( namespace_body ) )
+			NamespaceDeclaration( Token const & token, Token const * namespace_name,
+				Statement const * namespace_body )
+				: Declaration( token ), name( namespace_name ),
+				body( namespace_body )
 			{
 			}
-			~NamespaceDeclaration() {}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Token>		const name;
-			std::unique_ptr<Statement>	const body;
+			Token const *		const name;
+			Statement const *	const body;
+		};
+
+		// `import "path";', at the top of a file; the path is relative to the importing file.
+		struct Imports: FlatIndexed
+		{
+			Imports( Token const & token, Token const & module_path )
+				: keyword( token ), path( module_path )
+			{
+			}
+
+			inline Token const &	Keyword() const { return keyword; }
+			// A string literal, quotes included.
+			inline Token const &	Path() const { return path; }
+		private:
+			Token	const keyword;
+			Token	const path;
 		};
 	} // namespace AbstractSyntaxTree
 } // namespace MaryLang
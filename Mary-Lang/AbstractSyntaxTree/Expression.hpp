@@ -20,7 +20,6 @@ namespace MaryLang
 				:Locatable( token )
 			{
 			}
-			virtual ~Expression() {}
 			virtual void Analyze() const = 0;
 			virtual void Dump() const;
 			bool is_lvalue;
@@ -32,147 +31,169 @@ namespace MaryLang
 				: Expression( token )
 			{
 			}
-			~IllegalExpression() {}
 			ANALYZE_DUMP_DECL;
 		};
 
 		struct ExpressionList: Expression
 		{
-			ExpressionList( Token const & token, std::vector<std::unique_ptr<Expression>> && expressions )
-				: Expression( token ), expressions( std::move( expressions ) )
+			ExpressionList( Token const & token, List<Expression> expressions )
+				: Expression( token ), expressions( expressions )
 			{
 			}
-			~ExpressionList() {}
 			ANALYZE_DUMP_DECL;
 
 		private:
 			List<Expression> expressions;
 		};
 
+		// Leaves keep their whole token: its payload names a variable, its range spells a literal.
 		struct Variable: Expression
 		{
-			Variable( Token const & token ): Expression( token )
+			Variable( Token const & token ): Expression( token ), token_value( token )
 			{
 			}
-			~Variable(){}
 			void Analyze() const;
+			inline Token const & Value() const { return token_value; }
+		private:
+			Token const token_value;
 		};
 
 		struct Constant: Expression
 		{
-			Constant( Token const & token ): Expression( token )
+			Constant( Token const & token ): Expression( token ), token_value( token )
 			{
 			}
-			~Constant(){}
 			ANALYZE_DUMP_DECL;
+			inline Token const & Value() const { return token_value; }
+		private:
+			Token const token_value;
 		};
 
 		struct StringLiteralExpression: Expression
 		{
-			StringLiteralExpression( Token const & token ): Expression( token )
+			StringLiteralExpression( Token const & token ): Expression( token ), token_value( token )
 			{
 			}
-			~StringLiteralExpression(){}
 			ANALYZE_DUMP_DECL;
+			inline Token const & Value() const { return token_value; }
+		private:
+			Token const token_value;
 		};
 
 		struct StringInterpolExpression: Expression
 		{
-			StringInterpolExpression( Token const & token ): Expression( token )
+			StringInterpolExpression( Token const & token ): Expression( token ), token_value( token )
 			{
 			}
-			~StringInterpolExpression(){}
 			ANALYZE_DUMP_DECL;
+			inline Token const & Value() const { return token_value; }
+		private:
+			Token const token_value;
 		};
 
 		struct ConditionalExpression: Expression
 		{
-			ConditionalExpression( Token const & token, std::unique_ptr<Expression> cond,
-				std::unique_ptr<Expression> lhs, std::unique_ptr<Expression> rhs )
-				: Expression( token ), conditional_expression( std::move( cond ) ),
-				lhs_expression( std::move( lhs ) ), rhs_expression( std::move( rhs ) )
+			ConditionalExpression( Token const & token, Expression const * cond,
+				Expression const * lhs, Expression const * rhs )
+				: Expression( token ), conditional_expression( cond ),
+				lhs_expression( lhs ), rhs_expression( rhs )
 			{
 			}
-			~ConditionalExpression() {}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> const conditional_expression;
-			std::unique_ptr<Expression> const lhs_expression;
-			std::unique_ptr<Expression> const rhs_expression;
+			Expression const * const conditional_expression;
+			Expression const * const lhs_expression;
+			Expression const * const rhs_expression;
 		};
 
+		// A prefix operator applied to `expr'; the token is the operator.
 		struct UnaryExpression: Expression
 		{
-			UnaryExpression( Token const & token ): Expression( token )
+			UnaryExpression( Token const & token, Expression const * expr )
+				: Expression( token ), op( token.Type() ), operand( expr )
 			{
 			}
-			virtual ~UnaryExpression(){}
-			void Analyze() const = 0;
+			ANALYZE_DUMP_DECL;
+			inline Lexer::TokenType Operator() const { return op; }
+		protected:
+			Lexer::TokenType   const op;
+			Expression const * const operand;
 		};
 
+		// The token is the operator.
 		struct BinaryExpression: Expression
 		{
-			BinaryExpression( Token const & token, std::unique_ptr<Expression> lhs,
-				std::unique_ptr<Expression> rhs )
-				: Expression( token ), lhs_expression( std::move( lhs ) ),
-				rhs_expression( std::move( rhs ) )
+			BinaryExpression( Token const & token, Expression const * lhs,
+				Expression const * rhs )
+				: Expression( token ), op( token.Type() ), lhs_expression( lhs ),
+				rhs_expression( rhs )
 			{
 			}
-			virtual ~BinaryExpression(){}
-			virtual void Analyze() const = 0;
-			virtual void Dump() const;
+			ANALYZE_DUMP_DECL;
+			inline Lexer::TokenType Operator() const { return op; }
 		private:
-			std::unique_ptr<Expression> const lhs_expression;
-			std::unique_ptr<Expression> const rhs_expression;
+			Lexer::TokenType   const op;
+			Expression const * const lhs_expression;
+			Expression const * const rhs_expression;
 		};
 
 		struct AssignmentExpression: BinaryExpression
 		{
-			AssignmentExpression( Token const & token, std::unique_ptr<Expression> lhs,
-				std::unique_ptr<Expression> rhs )
-				: BinaryExpression( token, std::move( lhs), std::move( rhs ) )
+			AssignmentExpression( Token const & token, Expression const * lhs,
+				Expression const * rhs )
+				: BinaryExpression( token, lhs, rhs )
 			{
 			}
-			~AssignmentExpression(){}
 			ANALYZE_DUMP_DECL;
 		};
 
+		// `expr++', `expr--' and, through the subclasses, the other operators written
+		// after their operand; the token is the operator.
 		struct PostfixExpression: UnaryExpression
 		{
-			PostfixExpression( Token const &token ): UnaryExpression( token )
+			PostfixExpression( Token const &token, Expression const * expr ): UnaryExpression( token, expr )
 			{
 			}
-			virtual ~PostfixExpression(){}
+			ANALYZE_DUMP_DECL;
 		};
 
 		struct SubscriptExpression: PostfixExpression
 		{
-			SubscriptExpression( Token const & token, std::unique_ptr<Expression> expr, 
-				std::unique_ptr<Expression> index )
-				: PostfixExpression( token ), expression( std::move( expr ) ),
-				index_expr( std::move( index ) )
+			SubscriptExpression( Token const & token, Expression const * expr, 
+				Expression const * index )
+				: PostfixExpression( token, expr ),
+				index_expr( index )
 			{
 			}
-			~SubscriptExpression(){}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> const expression;
-			std::unique_ptr<Expression> const index_expr;
+			Expression const * const index_expr;
 		};
 
 		struct DotExpression: PostfixExpression
 		{
-			DotExpression( Token const & token, std::unique_ptr<Expression> expr,
+			DotExpression( Token const & token, Expression const * expr,
 				Token const & id )
-				: PostfixExpression( token ), expression( std::move( expr ) ),
+				: PostfixExpression( token, expr ),
 				token_id( id )
 			{
 			}
-			~DotExpression(){}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> const expression;
-			Token	   const &		 token_id;
+			Token	   const		 token_id;
+		};
+
+		struct CallExpression: PostfixExpression
+		{
+			CallExpression( Token const & token, Expression const * callee,
+				List<Expression> args )
+				: PostfixExpression( token, callee ),
+				arguments( args )
+			{
+			}
+			ANALYZE_DUMP_DECL;
+		private:
+			List<Expression> const arguments;
 		};
     } // namespace AbstractSyntaxTree
 } //namespace MaryLang
@@ -0,0 +1,183 @@
+#include "FlatTree.hpp"
+#include "../Utils/StringInterner.hpp"
+#include <cstring>
+
+namespace MaryLang
+{
+	namespace AbstractSyntaxTree
+	{
+		wchar_t const * GetKindName( NodeKind kind )
+		{
+			switch( kind )
+			{
+			case NodeKind::None:					return L"None";
+			case NodeKind::Program:					return L"Program";
+			case NodeKind::Token:					return L"Token";
+			case NodeKind::CompoundStatement:		return L"CompoundStatement";
+			case NodeKind::CheckAmongStatement:		return L"CheckAmongStatement";
+			case NodeKind::IfStatement:				return L"IfStatement";
+			case NodeKind::WhileStatement:			return L"WhileStatement";
+			case NodeKind::DoWhileStatement:		return L"DoWhileStatement";
+			case NodeKind::ForStatement:			return L"ForStatement";
+			case NodeKind::ForInStatement:			return L"ForInStatement";
+			case NodeKind::LabelStatement:			return L"LabelStatement";
+			case NodeKind::ReturnStatement:			return L"ReturnStatement";
+			case NodeKind::ContinueStatement:		return L"ContinueStatement";
+			case NodeKind::LeaveStatement:			return L"LeaveStatement";
+			case NodeKind::ExpressionStatement:		return L"ExpressionStatement";
+			case NodeKind::DeclarationStatement:	return L"DeclarationStatement";
+			case NodeKind::IllegalStatement:		return L"IllegalStatement";
+			case NodeKind::FunctionDeclaration:		return L"FunctionDeclaration";
+			case NodeKind::ParameterList:			return L"ParameterList";
+			case NodeKind::ParameterDeclaration:	return L"ParameterDeclaration";
+			case NodeKind::VariableDeclaration:		return L"VariableDeclaration";
+			case NodeKind::VariableDeclarator:		return L"VariableDeclarator";
+			case NodeKind::ClassDeclaration:		return L"ClassDeclaration";
+			case NodeKind::EnumDeclaration:			return L"EnumDeclaration";
+			case NodeKind::Enumerator:				return L"Enumerator";
+			case NodeKind::NamespaceDeclaration:	return L"NamespaceDeclaration";
+			case NodeKind::ImportDeclaration:		return L"ImportDeclaration";
+			case NodeKind::Variable:				return L"Variable";
+			case NodeKind::Constant:				return L"Constant";
+			case NodeKind::StringLiteral:			return L"StringLiteral";
+			case NodeKind::StringInterpolation:		return L"StringInterpolation";
+			case NodeKind::IllegalExpression:		return L"IllegalExpression";
+			case NodeKind::ExpressionList:			return L"ExpressionList";
+			case NodeKind::AssignmentExpression:	return L"AssignmentExpression";
+			case NodeKind::ConditionalExpression:	return L"ConditionalExpression";
+			case NodeKind::BinaryExpression:		return L"BinaryExpression";
+			case NodeKind::UnaryExpression:			return L"UnaryExpression";
+			case NodeKind::PostfixExpression:		return L"PostfixExpression";
+			case NodeKind::SubscriptExpression:		return L"SubscriptExpression";
+			case NodeKind::DotExpression:			return L"DotExpression";
+			case NodeKind::CallExpression:			return L"CallExpression";
+			default:								return L"<unknown>";
+			}
+		}
+
+		FlatTree::FlatTree()
+			: kinds(), offsets(), values(), children_begin(), children(), tokens(), root( NoNode )
+		{
+			Clear();
+		}
+
+		void FlatTree::Clear()
+		{
+			kinds.clear();
+			offsets.clear();
+			values.clear();
+			children_begin.clear();
+			children.clear();
+			tokens.clear();
+			root = NoNode;
+			// slot 0 is NoNode: a leaf of kind None
+			kinds.push_back( NodeKind::None );
+			offsets.push_back( 0 );
+			values.push_back( 0 );
+			children_begin.push_back( 0 );
+			children_begin.push_back( 0 );
+		}
+
+		NodeIndex FlatTree::Add( NodeKind kind, std::uint32_t offset, std::uint32_t value,
+			NodeIndex const * first_child, std::uint32_t count )
+		{
+			NodeIndex const node = Size();
+			kinds.push_back( kind );
+			offsets.push_back( offset );
+			values.push_back( value );
+			children.insert( children.end(), first_child, first_child + count );
+			children_begin.push_back( static_cast<std::uint32_t>( children.size() ) );
+			return node;
+		}
+
+		NodeIndex FlatTree::AddLeaf( NodeKind kind, Token const & token )
+		{
+			std::uint32_t const index = static_cast<std::uint32_t>( tokens.size() );
+			tokens.push_back( token );
+			return Add( kind, token.Offset(), index, nullptr, 0 );
+		}
+
+		std::size_t FlatTree::BytesUsed() const
+		{
+			return kinds.size() * sizeof( NodeKind ) + offsets.size() * sizeof( std::uint32_t )
+				+ values.size() * sizeof( std::uint32_t ) + children_begin.size() * sizeof( std::uint32_t )
+				+ children.size() * sizeof( NodeIndex ) + tokens.size() * sizeof( Token );
+		}
+
+		namespace
+		{
+			template<typename T>
+			void Put( std::vector<char> & out, T const * items, std::size_t count )
+			{
+				char const * const bytes = reinterpret_cast<char const *>( items );
+				out.insert( out.end(), bytes, bytes + count * sizeof( T ) );
+			}
+
+			// Copies `count' items out of the blob; false if it is too short. `fill' is only
+			// there for types without a default constructor.
+			template<typename T>
+			bool Get( char const * & data, char const * end, std::vector<T> & items, std::size_t count, T const & fill = T() )
+			{
+				if( static_cast<std::size_t>( end - data ) / sizeof( T ) < count ) return false;
+				items.assign( count, fill );
+				if( count != 0 ) std::memcpy( items.data(), data, count * sizeof( T ) );
+				data += count * sizeof( T );
+				return true;
+			}
+
+			bool IsLeaf( NodeKind kind )
+			{
+				return kind == NodeKind::Token || ( kind >= NodeKind::Variable && kind <= NodeKind::IllegalExpression );
+			}
+		} // namespace
+
+		// Node, child and token counts and the root, then the arrays; the kinds come last
+		// so every other array stays four-byte aligned.
+		void FlatTree::Serialize( std::vector<char> & out ) const
+		{
+			std::uint32_t const header[4] = { Size(), static_cast<std::uint32_t>( children.size() ),
+				static_cast<std::uint32_t>( tokens.size() ), root };
+			out.reserve( out.size() + sizeof( header ) + BytesUsed() );
+			Put( out, header, 4 );
+			Put( out, offsets.data(), offsets.size() );
+			Put( out, values.data(), values.size() );
+			Put( out, children_begin.data(), children_begin.size() );
+			Put( out, children.data(), children.size() );
+			Put( out, tokens.data(), tokens.size() );
+			Put( out, kinds.data(), kinds.size() );
+		}
+
+		bool FlatTree::Deserialize( char const * data, std::size_t size, Support::StringRef source )
+		{
+			char const * const end = data + size;
+			std::vector<std::uint32_t> header;
+			bool valid = Get( data, end, header, 4 ) && header[0] != 0
+				&& Get( data, end, offsets, header[0] ) && Get( data, end, values, header[0] )
+				&& Get( data, end, children_begin, header[0] + std::size_t( 1 ) ) && Get( data, end, children, header[1] )
+				&& Get( data, end, tokens, header[2], Token( 0, 0, Lexer::TokenType::TK_EOF ) ) && Get( data, end, kinds, header[0] ) && data == end;
+			root = valid ? header[3] : NoNode;
+			valid = valid && root < Size() && kinds[0] == NodeKind::None
+				&& children_begin[0] == 0 && children_begin[1] == 0 && children_begin[Size()] == children.size();
+			// children come before their parent, so no walk can loop or leave the arrays
+			for( NodeIndex node = 1; valid && node < Size(); ++node ){
+				valid = static_cast<std::size_t>( kinds[node] ) < node_kind_count
+					&& children_begin[node] <= children_begin[node + 1] && children_begin[node + 1] <= children.size()
+					&& ( !IsLeaf( kinds[node] ) || values[node] < tokens.size() );
+				for( std::uint32_t i = children_begin[node]; valid && i < children_begin[node + 1]; ++i ){
+					valid = children[i] < node;
+				}
+			}
+			for( Token & token : tokens ){
+				if( !valid ) break;
+				valid = static_cast<std::size_t>( token.Type() ) < Lexer::token_type_count
+					&& token.Offset() <= source.Size() && token.Length() <= source.Size() - token.Offset();
+				if( valid && token.Type() == Lexer::TokenType::TK_IDENTIFIER ){
+					token = Token( token.Offset(), token.Length(), token.Type(),
+						Support::StringInterner::Global().Intern( Support::StringRef( source.Data() + token.Offset(), token.Length() ) ) );
+				}
+			}
+			if( !valid ) Clear();
+			return valid;
+		}
+	} // namespace AbstractSyntaxTree
+} // namespace MaryLang
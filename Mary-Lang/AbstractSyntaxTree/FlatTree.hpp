@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+#include "../Scanner/tokens.hpp"
+#include "../Utils/StringRef.hpp"
+
+namespace MaryLang
+{
+	namespace AbstractSyntaxTree
+	{
+		using Lexer::Token;
+
+		enum class NodeKind: std::uint8_t
+		{
+			None,
+			Program,
+			Token,					// a bare token the tree refers to, e.g. a name; see GetToken()
+
+			CompoundStatement,
+			CheckAmongStatement,
+			IfStatement,
+			WhileStatement,
+			DoWhileStatement,
+			ForStatement,
+			ForInStatement,
+			LabelStatement,
+			ReturnStatement,
+			ContinueStatement,
+			LeaveStatement,
+			ExpressionStatement,
+			DeclarationStatement,
+			IllegalStatement,		// where a statement should have begun but could not
+
+			FunctionDeclaration,	// a skimmed body is NoNode, and stays so once parsed
+			ParameterList,
+			ParameterDeclaration,
+			VariableDeclaration,
+			VariableDeclarator,
+			ClassDeclaration,		// the name, then the members
+			EnumDeclaration,		// the name, then the enumerators
+			Enumerator,
+			NamespaceDeclaration,
+			ImportDeclaration,		// the path, a string literal Token
+
+			// leaves: GetToken() returns their token
+			Variable,
+			Constant,
+			StringLiteral,
+			StringInterpolation,
+			IllegalExpression,
+
+			ExpressionList,
+			AssignmentExpression,	// Value() is the operator's TokenType
+			ConditionalExpression,
+			BinaryExpression,		// Value() is the operator's TokenType
+			UnaryExpression,		// Value() is the operator's TokenType
+			PostfixExpression,		// Value() is the operator's TokenType
+			SubscriptExpression,
+			DotExpression,			// the member name is a Token child
+			CallExpression,			// the callee, then the arguments
+		};
+
+		// Number of NodeKinds, for tables indexed by them; CallExpression must stay the last one.
+		static std::size_t const node_kind_count = static_cast<std::size_t>( NodeKind::CallExpression ) + 1;
+
+		wchar_t const * GetKindName( NodeKind kind );
+
+		// Index of a node in a FlatTree. Zero is the reserved "no node" slot, so a missing
+		// child (an `if' without `else', an empty statement) is simply NoNode.
+		typedef std::uint32_t NodeIndex;
+		static NodeIndex const NoNode = 0;
+
+		// Pointer nodes built while a FlatTree is being emitted remember their flat twin, so
+		// the factory can find the indices of a node's children.
+		struct FlatIndexed
+		{
+			FlatIndexed(): flat_index( NoNode ) {}
+			inline NodeIndex	FlatIndex() const { return flat_index; }
+			inline void			SetFlatIndex( NodeIndex index ) { flat_index = index; }
+		private:
+			NodeIndex			flat_index;
+		};
+
+		// The AST as a handful of parallel arrays instead of a graph of heap objects. A node
+		// is its kind, its source offset, one kind-specific value and a run of child indices
+		// in `children'. Nodes are appended after their children, so a node's children all
+		// have smaller indices and the children runs are laid out in node order: the end of
+		// one run is the start of the next and needs no storage of its own.
+		//
+		// Child order per kind is the constructor order of the matching pointer node, with
+		// optional children present as NoNode. Lists (compound bodies, class members,
+		// enumerators, expression lists, the program) simply have as many children as items;
+		// the program's are its imports, then its statements.
+		struct FlatTree
+		{
+			typedef NodeIndex const * child_iterator;
+
+			struct Children
+			{
+				child_iterator		first, last;
+				child_iterator		begin() const { return first; }
+				child_iterator		end() const { return last; }
+				std::uint32_t		Size() const { return static_cast<std::uint32_t>( last - first ); }
+				NodeIndex			operator[]( std::uint32_t i ) const { return first[i]; }
+			};
+
+			FlatTree();
+
+			NodeIndex	Add( NodeKind kind, std::uint32_t offset, std::uint32_t value,
+							NodeIndex const * children, std::uint32_t count );
+			NodeIndex	Add( NodeKind kind, std::uint32_t offset, std::uint32_t value,
+							std::initializer_list<NodeIndex> children )
+			{
+				return Add( kind, offset, value, children.begin(), static_cast<std::uint32_t>( children.size() ) );
+			}
+			// A childless node that keeps its token; `kind' is Token or one of the leaves.
+			NodeIndex	AddLeaf( NodeKind kind, Token const & token );
+			NodeIndex	AddToken( Token const & token ) { return AddLeaf( NodeKind::Token, token ); }
+			NodeIndex	AddToken( Token const * token ) { return token != nullptr ? AddToken( *token ) : NoNode; }
+			void		SetRoot( NodeIndex node ) { root = node; }
+			void		Clear();
+
+			inline NodeIndex		Root() const { return root; }
+			inline std::uint32_t	Size() const { return static_cast<std::uint32_t>( kinds.size() ); }
+			inline NodeKind			Kind( NodeIndex node ) const { return kinds[node]; }
+			inline std::uint32_t	Offset( NodeIndex node ) const { return offsets[node]; }
+			inline std::uint32_t	Value( NodeIndex node ) const { return values[node]; }
+			inline Token const &	GetToken( NodeIndex node ) const { return tokens[values[node]]; }
+			inline Children			ChildrenOf( NodeIndex node ) const
+			{
+				NodeIndex const * const base = children.data();
+				return Children{ base + children_begin[node], base + children_begin[node + 1] };
+			}
+
+			// Walks the subtree under `top' depth first without recursing, so no input is
+			// deep enough to overflow the stack. `visitor' is called as
+			//     bool Enter( NodeIndex ) -- before the children; false skips them
+			//     void Leave( NodeIndex ) -- after the children, if they were entered
+			// Missing children are not visited.
+			template<typename Visitor>
+			void Walk( NodeIndex top, Visitor && visitor ) const;
+
+			// Calls `visitor( node )' for every node of the tree in post order, which is just
+			// array order; the fastest way to look at everything.
+			template<typename Visitor>
+			void ForEach( Visitor && visitor ) const
+			{
+				for( NodeIndex node = 1; node < Size(); ++node ) visitor( node );
+			}
+
+			std::size_t BytesUsed() const;
+
+			// The arrays as one blob, in this machine's byte order, for the parse cache.
+			void Serialize( std::vector<char> & out ) const;
+			// Replaces the tree with one Serialize wrote for `source'. Identifiers are interned
+			// again, as symbols differ from run to run. False, leaving the tree empty, if the
+			// blob is damaged or does not fit `source'.
+			bool Deserialize( char const * data, std::size_t size, Support::StringRef source );
+		private:
+			std::vector<NodeKind>		kinds;
+			std::vector<std::uint32_t>	offsets;
+			std::vector<std::uint32_t>	values;
+			std::vector<std::uint32_t>	children_begin; // Size() + 1 entries
+			std::vector<NodeIndex>		children;
+			std::vector<Token>			tokens;
+			NodeIndex					root;
+		}; // struct FlatTree
+
+		template<typename Visitor>
+		void FlatTree::Walk( NodeIndex top, Visitor && visitor ) const
+		{
+			if( top == NoNode ) return;
+			// each entry is a node whose children are being visited and the next one to visit
+			std::vector<std::pair<NodeIndex, child_iterator>> stack;
+			if( !visitor.Enter( top ) ) return;
+			stack.emplace_back( top, ChildrenOf( top ).begin() );
+			while( !stack.empty() ){
+				NodeIndex const node = stack.back().first;
+				child_iterator & next = stack.back().second;
+				child_iterator const last = ChildrenOf( node ).end();
+				while( next != last && *next == NoNode ) ++next;
+				if( next == last ){
+					stack.pop_back();
+					visitor.Leave( node );
+					continue;
+				}
+				NodeIndex const child = *next++;
+				if( visitor.Enter( child ) ){
+					stack.emplace_back( child, ChildrenOf( child ).begin() );
+				}
+			}
+		}
+	} // namespace AbstractSyntaxTree
+} // namespace MaryLang
@@ -1,49 +1,50 @@
 #pragma once
 
-#include <vector>
-#include <memory>
+#include <cstdint>
 #include "../Scanner/tokens.hpp"
+#include "FlatTree.hpp"
 
 namespace MaryLang
 {
     namespace AbstractSyntaxTree
     {
+		// A node's children: a span of node pointers living in the AST arena. The factory
+		// builds one in a single allocation once all of the children are known.
         template<typename T>
         struct List
         {
-            List( ): _list() {}
-			List( std::vector<std::unique_ptr<T>> && list ): _list( std::move( list ) ) {}
-            ~List() {}
-            
-			inline void Append( std::unique_ptr<T> t )
-            {
-				_list.push_back( std::move( t ) );
-            }
-			typedef typename std::vector<std::unique_ptr<T>>::iterator        iterator;
-			typedef typename std::vector<std::unique_ptr<T>>::const_iterator  const_iterator;
-			typedef typename std::vector<std::unique_ptr<T>>::size_type       size_type;
-            
-            inline size_type    Size()  { return _list.size(); }
-            inline iterator     begin() { return _list.begin(); }
-            inline iterator     end()   { return _list.end(); }
-            
-            inline const_iterator cbegin() const { return _list.cbegin(); }
-            inline const_iterator cend() const { return _list.cend(); }
-            
+			typedef T const * const *	const_iterator;
+			typedef const_iterator		iterator;
+			typedef std::uint32_t		size_type;
+
+            List( ): elements( nullptr ), size( 0 ) {}
+			List( T const * const * elements, size_type size ): elements( elements ), size( size ) {}
+
+            inline size_type		Size() const  { return size; }
+            inline bool				Empty() const { return size == 0; }
+            inline T const *		operator[]( size_type i ) const { return elements[i]; }
+            inline const_iterator	begin() const { return elements; }
+            inline const_iterator	end() const   { return elements + size; }
+            inline const_iterator	cbegin() const { return elements; }
+            inline const_iterator	cend() const   { return elements + size; }
         private:
-			std::vector<std::unique_ptr<T>> _list;
+			T const * const *	elements;
+			size_type			size;
         }; // struct List
 
 		using Lexer::Token;
 
 		struct Printer;
-		struct Locatable
+		// Nodes remember where they start as an offset into the source; the scanner's
+		// SourceManager turns that into line:column when a diagnostic needs it.
+		struct Locatable: FlatIndexed
 		{
-			Locatable( Token const & tk ): token( tk ) {}
+			Locatable( Token const & tk ): offset( tk.Offset() ) {}
 			virtual void Dump() const = 0;
 			virtual void Print( Printer & print ) const;
+			inline std::uint32_t Offset() const { return offset; }
 		private:
-			Token const token;
+			std::uint32_t const offset;
 		};
     } // namespace AbstractSyntaxTree
 } // namespace MaryLang
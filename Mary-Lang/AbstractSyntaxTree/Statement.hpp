@@ -21,7 +21,6 @@ namespace MaryLang
 		struct Statement: Locatable
 		{
 			Statement( Lexer::Token const & token ): Locatable( token ) {}
-			virtual ~Statement()  {}
 
 			//virtual void Emit( CodeGeneration::CodeGen & cfg ) const = 0;
 			virtual void Analyze() const = 0; //all analysis should be defined in the Semantic Analyzer directory
@@ -30,225 +29,210 @@ namespace MaryLang
 
 		struct IllegalStatement: Statement
 		{
-			IllegalStatement( Lexer::Token & token ): Statement( token ) {}
-			~IllegalStatement(){}
+			IllegalStatement( Lexer::Token const & token ): Statement( token ) {}
 
 			ANALYZE_DUMP_DECL;
 		};
 
 		struct CaseOfStatement: Statement
 		{
-			CaseOfStatement( Lexer::Token const & token, std::unique_ptr<Expression> expression,
-				std::unique_ptr<Statement> statement )
+			CaseOfStatement( Lexer::Token const & token, Expression const * expression,
+				Statement const * statement )
 				: Statement( token ),
-				condition_expression( std::move( expression ) ),
-				statement_body( std::move( statement ) )
+				condition_expression( expression ),
+				statement_body( statement )
 			{
 			}
-			~CaseOfStatement() { }
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> const condition_expression;
-			std::unique_ptr<Statement>  const statement_body;
+			Expression const * const condition_expression;
+			Statement const *  const statement_body;
 		};
 
+		struct Declaration; //forward declaration
+
+		// The condition is either an expression or, for `if( var x = ... )', a declaration.
 		struct IfStatement: Statement
 		{
 			IfStatement( Lexer::Token const & token, 
-				std::unique_ptr<Expression> conditionalExpression,
-				std::unique_ptr<Expression> expr,
-				std::unique_ptr<Statement> statementBody, 
-				std::unique_ptr<Statement> elseBody = nullptr )
+				Expression const * conditionalExpression,
+				Declaration const * declaration,
+				Statement const * statementBody, 
+				Statement const * elseBody = nullptr )
 				: Statement( token ), 
-				condExpressionPart( std::move( conditionalExpression ) ), expression( std::move( expr ) ),
-				thenStatementPart( std::move( statementBody ) ), elseStatementPart( std::move( elseBody ) )
+				condExpressionPart( conditionalExpression ), condDeclarationPart( declaration ),
+				thenStatementPart( statementBody ), elseStatementPart( elseBody )
 			{
 			}
-			~IfStatement() { }
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> const condExpressionPart;
-			std::unique_ptr<Expression> const expression;
-			std::unique_ptr<Statement>  const thenStatementPart;
-			std::unique_ptr<Statement>  const elseStatementPart;
+			Expression const * const condExpressionPart;
+			Declaration const * const condDeclarationPart;
+			Statement const *  const thenStatementPart;
+			Statement const *  const elseStatementPart;
 		}; // struct IfStatement
 
 		// base class for all iterative statements
 		struct IterativeStatement: Statement
 		{
-			IterativeStatement( Lexer::Token const & token, std::unique_ptr<Statement> statement )
-				: Statement( token ), statement_body( std::move( statement ) )
+			IterativeStatement( Lexer::Token const & token, Statement const * statement )
+				: Statement( token ), statement_body( statement )
 			{
 			}
 
-			virtual ~IterativeStatement() { }
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Statement> const statement_body;
+			Statement const * const statement_body;
 		};
 
 		struct DoWhileStatement: IterativeStatement
 		{
-			DoWhileStatement( Lexer::Token const & token, std::unique_ptr<Expression> expression,
-				std::unique_ptr<Statement> statement )
-				: IterativeStatement( token, std::move( statement ) ), 
-				conditional_expression( std::move( expression ) )
+			DoWhileStatement( Lexer::Token const & token, Expression const * expression,
+				Statement const * statement )
+				: IterativeStatement( token, statement ), 
+				conditional_expression( expression )
 			{
 			}
-			~DoWhileStatement() {}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> const conditional_expression;
+			Expression const * const conditional_expression;
 		};
 
 		struct WhileStatement: IterativeStatement
 		{
-			WhileStatement( Lexer::Token const & token, std::unique_ptr<Expression> expression,
-				std::unique_ptr<Statement> statement )
-				: IterativeStatement( token, std::move( statement )  ), 
-				condition_expression( std::move( expression ) )
+			WhileStatement( Lexer::Token const & token, Expression const * expression,
+				Statement const * statement )
+				: IterativeStatement( token, statement  ), 
+				condition_expression( expression )
 			{
 			}
-			~WhileStatement(){}
 			ANALYZE_DUMP_DECL;
 		protected:
-			std::unique_ptr<Expression> const condition_expression;
+			Expression const * const condition_expression;
 		};
 
-		struct Declaration; //forward declaration
-
 		struct ForStatement: IterativeStatement
 		{
-			ForStatement( Lexer::Token const & token, std::unique_ptr<Declaration> declaration,
-				std::unique_ptr<Expression> initializer, std::unique_ptr<Expression> condition,
-				std::unique_ptr<Expression> step, std::unique_ptr<Statement> statement )
-				:   IterativeStatement( token, std::move( statement ) ),
-				initializing_declaration( std::move( declaration ) ),
-				initializing_expression( std::move( initializer ) ),
-				conditional_expression( std::move( condition ) ),
-				stepping_expression( std::move( step ) )
+			ForStatement( Lexer::Token const & token, Declaration const * declaration,
+				Expression const * initializer, Expression const * condition,
+				Expression const * step, Statement const * statement )
+				:   IterativeStatement( token, statement ),
+				initializing_declaration( declaration ),
+				initializing_expression( initializer ),
+				conditional_expression( condition ),
+				stepping_expression( step )
 			{
 			}
-			~ForStatement() { }
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Declaration> const initializing_declaration;
-			std::unique_ptr<Expression>  const initializing_expression;
-			std::unique_ptr<Expression>  const conditional_expression;
-			std::unique_ptr<Expression>  const stepping_expression;
+			Declaration const * const initializing_declaration;
+			Expression const *  const initializing_expression;
+			Expression const *  const conditional_expression;
+			Expression const *  const stepping_expression;
 		};
 
 		struct ForInStatement: IterativeStatement
 		{
-			ForInStatement( Lexer::Token const & token, std::unique_ptr<Declaration> declaration,
-				std::unique_ptr<Expression> expr, std::unique_ptr<Expression> init, 
-				std::unique_ptr<Statement> statement )
-				: IterativeStatement( token, std::move( statement ) ),
-				initializer( std::move( declaration ) ), lhs_expression( std::move( init ) ),
-				rhs_expression( std::move( expr ) )
+			ForInStatement( Lexer::Token const & token, Declaration const * declaration,
+				Expression const * expr, Expression const * init, 
+				Statement const * statement )
+				: IterativeStatement( token, statement ),
+				initializer( declaration ), lhs_expression( init ),
+				rhs_expression( expr )
 			{
 			}
-			virtual ~ForInStatement() {}
 			ANALYZE_DUMP_DECL;
 		protected:
-			std::unique_ptr<Declaration> const initializer;
-			std::unique_ptr<Expression>  const lhs_expression;
-			std::unique_ptr<Expression>  const rhs_expression;
+			Declaration const * const initializer;
+			Expression const *  const lhs_expression;
+			Expression const *  const rhs_expression;
 		};
 
 		struct LabelStatement: Statement
 		{
-			LabelStatement( Lexer::Token const & token, std::unique_ptr<Token> val )
-				:   Statement( token ), value( std::move( val ) )
+			LabelStatement( Lexer::Token const & token, Token const * val )
+				:   Statement( token ), value( val )
 			{
 			}
-			~LabelStatement() {}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Token> value;
+			Token const * value;
 		};
 
 		struct ReturnStatement: Statement
 		{
-			ReturnStatement( Lexer::Token const & token, std::unique_ptr<Expression> expr )
-				:   Statement( token ), expression( std::move( expr ) )
+			ReturnStatement( Lexer::Token const & token, Expression const * expr )
+				:   Statement( token ), expression( expr )
 			{
 			}
-			~ReturnStatement() {}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> const expression;
+			Expression const * const expression;
 		};
 
 		struct CheckAmongStatement: Statement
 		{
-			CheckAmongStatement( Lexer::Token const & token, std::unique_ptr<Expression> expr,
-				std::unique_ptr<Statement> body )
-				: Statement( token ), conditional_expression( std::move( expr ) ),
-				statement_body( std::move( body ) )
+			CheckAmongStatement( Lexer::Token const & token, Expression const * expr,
+				Statement const * body )
+				: Statement( token ), conditional_expression( expr ),
+				statement_body( body )
 			{
 			}
-			~CheckAmongStatement() {}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> const conditional_expression;
-			std::unique_ptr<Statement>  const statement_body;
+			Expression const * const conditional_expression;
+			Statement const *  const statement_body;
 		};
 		struct ContinueStatement: Statement
 		{
 			ContinueStatement( Lexer::Token const & token ): Statement( token ){}
-			~ContinueStatement() {}
 			ANALYZE_DUMP_DECL;
 		};
 
 		struct LeaveStatement: Statement
 		{
 			LeaveStatement( Lexer::Token const & token ): Statement( token ){}
-			~LeaveStatement() {}
 			ANALYZE_DUMP_DECL;
 		};
 
 		struct CompoundStatement: Statement
 		{
-			CompoundStatement( Lexer::Token const & token )
-				:   Statement( token )
+			CompoundStatement( Lexer::Token const & token, List<Statement> statements )
+				:   Statement( token ), list( statements )
 			{
 			}
-			~CompoundStatement(){}
 			ANALYZE_DUMP_DECL;
 
 			typedef List<Statement>::const_iterator const_iterator;
 			typedef List<Statement>::iterator		iterator;
 			typedef List<Statement>::size_type		size_type;
 
-			iterator begin() { return list.begin(); }
-			iterator end() { return list.end(); }
+			iterator begin() const { return list.begin(); }
+			iterator end() const { return list.end(); }
 			const_iterator cbegin() const { return list.cbegin(); }
 			const_iterator cend() const { return list.cend(); }
-			size_type Size() { return list.Size(); }
-			void Append( std::unique_ptr<Statement> statement ) { list.Append( std::move( statement ) ); }
+			size_type Size() const { return list.Size(); }
 		private:
-			List<Statement> list;
+			List<Statement> const list;
 		};
 		
 		struct ExpressionStatement: Statement
 		{
-			ExpressionStatement( Token const & token, std::unique_ptr<Expression> expr )
-				: Statement( token ), expression( std::move( expr ) ) {}
-			~ExpressionStatement() {}
+			ExpressionStatement( Token const & token, Expression const * expr )
+				: Statement( token ), expression( expr ) {}
 			ANALYZE_DUMP_DECL;
 		private:
-			std::unique_ptr<Expression> expression;
+			Expression const * expression;
 		};
 
 		struct DeclarationStatement: Statement
 		{
-			DeclarationStatement( Token const & token, std::unique_ptr<Declaration> expr )
-				: Statement( token ), expression( std::move( expr ) ) {}
-			~DeclarationStatement() {}
+			DeclarationStatement( Token const & token, Declaration const * expr )
+				: Statement( token ), expression( expr ) {}
 			ANALYZE_DUMP_DECL;
+			inline Declaration const * GetDeclaration() const { return expression; }
 		private:
-			std::unique_ptr<Declaration> expression;
+			Declaration const * expression;
 		};
 	} // namespace AbstractSyntaxTree
 }// namespace MaryLang
@@ -0,0 +1,151 @@
+#include "Corpus.hpp"
+
+namespace MaryLang
+{
+	namespace Benchmarks
+	{
+		namespace
+		{
+			// A linear congruential generator; std's distributions differ between libraries.
+			struct Random
+			{
+				explicit Random( std::uint32_t seed ): state( seed ) {}
+
+				std::uint32_t Below( std::uint32_t bound )
+				{
+					state = state * 1664525u + 1013904223u;
+					return ( state >> 8 ) % bound;
+				}
+			private:
+				std::uint32_t state;
+			};
+
+			char const * const words[] = {
+				"value", "index", "count", "buffer", "result", "element", "node", "total", "width",
+				"height", "offset", "name", "color", "parent", "child", "limit", "scale", "item"
+			};
+
+			std::string Word( Random & random )
+			{
+				return words[random.Below( sizeof( words ) / sizeof( words[0] ) )];
+			}
+
+			std::string Identifier( Random & random )
+			{
+				return Word( random ) + std::to_string( random.Below( 100 ) );
+			}
+
+			std::string Operand( Random & random )
+			{
+				return random.Below( 3 ) == 0 ? std::to_string( random.Below( 1000 ) ) : Identifier( random );
+			}
+
+			std::string Expression( Random & random, int terms )
+			{
+				char const * const operators[] = { "+", "-", "*", "/", "%", "<<", "<", "==", "&&", "|" };
+				std::string expression = Operand( random );
+				for( int i = 1; i < terms; ++i ){
+					expression += ' ';
+					expression += operators[random.Below( sizeof( operators ) / sizeof( operators[0] ) )];
+					expression += ' ' + Operand( random );
+				}
+				return expression;
+			}
+
+			void Flat( std::string & out, Random & random, std::size_t n )
+			{
+				std::string const name = "f" + std::to_string( n );
+				out += "var " + name + "_count = " + Expression( random, 3 ) + ";\n";
+				out += "function " + name + "( a, b: int ) -> int\n{\n";
+				out += "\tvar s = " + Expression( random, 4 ) + ";\n";
+				out += "\tfor( var i = 0; i < a; ++i ){\n";
+				out += "\t\tif( i % 2 == 0 ){ s += " + Identifier( random ) + "( i, b )[i]; } else { s -= "
+					+ Identifier( random ) + ".get( i ) * 3; }\n";
+				out += "\t}\n\twhile( s > b ) s = s / 2;\n\treturn s + " + Expression( random, 2 ) + ";\n}\n";
+			}
+
+			void Nested( std::string & out, Random & random, std::size_t n )
+			{
+				std::size_t const depth = 200 + random.Below( 100 );
+				out += "function nested" + std::to_string( n ) + "( a )\n{\n";
+				for( std::size_t i = 0; i < depth; ++i ){
+					out += random.Below( 2 ) == 0 ? "if( a > " + std::to_string( i ) + " ){\n" : "while( a < " + std::to_string( i ) + " ){\n";
+				}
+				out += "a = " + std::string( depth, '(' ) + Identifier( random );
+				for( std::size_t i = 0; i < depth; ++i ) out += " + 1)";
+				out += ";\n" + std::string( depth, '}' ) + "\n}\n";
+			}
+
+			void Strings( std::string & out, Random & random, std::size_t n )
+			{
+				out += "function table" + std::to_string( n ) + "( t )\n{\n";
+				for( int i = 0; i < 40; ++i ){
+					std::string const key = Identifier( random );
+					out += "\tt.add( \"" + key + "\", ";
+					if( random.Below( 2 ) == 0 ){
+						out += "\"" + Word( random ) + " #{" + Identifier( random ) + "} of #{" + Identifier( random )
+							+ "[" + std::to_string( i ) + "]} in " + Word( random ) + "\" );\n";
+					} else {
+						out += "\"the " + Word( random ) + " and the " + Word( random ) + ", \\\"quoted\\\", "
+							+ std::string( 20 + random.Below( 60 ), 'x' ) + "\" );\n";
+					}
+				}
+				out += "}\n";
+			}
+
+			void Comments( std::string & out, Random & random, std::size_t n )
+			{
+				out += "/*\n * block " + std::to_string( n ) + ": ";
+				for( int line = 0; line < 6; ++line ){
+					for( int i = 0; i < 10; ++i ) out += Word( random ) + ' ';
+					out += "\n * ";
+				}
+				out += "end of block\n */\n";
+				out += "function commented" + std::to_string( n ) + "( a ) // " + Word( random ) + " " + Word( random ) + "\n{\n";
+				for( int i = 0; i < 4; ++i ){
+					out += "\t// " + Word( random ) + " " + Word( random ) + " " + Word( random ) + " / * not a block\n";
+					out += "\ta = a + " + Operand( random ) + "; /* " + Word( random ) + " */\n";
+				}
+				out += "\treturn a;\n}\n";
+			}
+
+			void Classes( std::string & out, Random & random, std::size_t n )
+			{
+				std::string const name = "Class" + std::to_string( n );
+				out += "class " + name;
+				if( n != 0 ){
+					// wide rather than deep: most classes derive from one of the first few
+					out += " extends Class" + std::to_string( random.Below( n < 16 ? static_cast<std::uint32_t>( n ) : 16 ) );
+				}
+				out += "\n{\n";
+				for( int i = 0; i < 6; ++i ) out += "\tprotected var " + Identifier( random ) + "_" + std::to_string( i ) + ";\n";
+				out += "\tconstruct " + name + "( a, b )\n\t{\n\t\tthis.a = a;\n\t\tbase.Init( b );\n\t}\n";
+				for( int i = 0; i < 8; ++i ){
+					out += std::string( random.Below( 2 ) == 0 ? "\tpublic " : "\tprivate virtual " ) + "function m"
+						+ std::to_string( i ) + "( x ): int { return x * " + Operand( random ) + " + this." + Identifier( random ) + "; }\n";
+				}
+				out += "};\n";
+			}
+		} // namespace
+
+		std::vector<CorpusFile> GenerateCorpus( std::size_t bytes, std::uint32_t seed )
+		{
+			struct { char const * name; void ( *unit )( std::string &, Random &, std::size_t ); } const shapes[] = {
+				{ "flat", Flat },
+				{ "nested", Nested },
+				{ "strings", Strings },
+				{ "comments", Comments },
+				{ "classes", Classes },
+			};
+			std::vector<CorpusFile> corpus;
+			for( auto const & shape : shapes ){
+				Random random( seed );
+				CorpusFile file{ shape.name, std::string() };
+				file.source.reserve( bytes + 4096 );
+				for( std::size_t n = 0; file.source.size() < bytes; ++n ) shape.unit( file.source, random, n );
+				corpus.push_back( std::move( file ) );
+			}
+			return corpus;
+		}
+	} // namespace Benchmarks
+} // namespace MaryLang
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace Benchmarks
+	{
+		// A synthetic Mary program of one shape. The same name, size and seed always give
+		// the same bytes, on every platform, so numbers from different commits compare.
+		struct CorpusFile
+		{
+			std::string	name;	// also the file name, without ".mj"
+			std::string	source;
+		};
+
+		// Every shape, each about `bytes' long:
+		//   flat		many small top-level functions and variables, the common case
+		//   nested		blocks and parentheses nested hundreds deep
+		//   strings	long tables of string literals, half of them interpolated
+		//   comments	code with more comment than code, line and block
+		//   classes	a wide hierarchy of classes with many members each
+		std::vector<CorpusFile> GenerateCorpus( std::size_t bytes, std::uint32_t seed = 12345 );
+	} // namespace Benchmarks
+} // namespace MaryLang
@@ -0,0 +1,116 @@
+// Every form of operator new and delete, replaced together so that whichever form allocates,
+// its delete frees: a program replacing only some of them hands memory from the runtime's
+// allocator to free(), which sanitizers rightly report.
+
+#include "CountingAllocator.hpp"
+#include "../Utils/Statistics.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#if defined ( _WIN32 )
+#include <malloc.h>
+#endif
+
+namespace Support = MaryLang::Support;
+
+namespace
+{
+	// Per thread, so that threads allocating at once do not contend for a counter.
+	thread_local std::size_t thread_allocations = 0;
+
+	void Count( std::size_t size )
+	{
+		++thread_allocations;
+		Support::Statistics::Add( Support::Statistics::HeapAllocations );
+		Support::Statistics::Add( Support::Statistics::HeapBytes, size );
+	}
+
+	void * Allocate( std::size_t size )
+	{
+		Count( size );
+		for( ; ; ){
+			if( void * const memory = std::malloc( size != 0 ? size : 1 ) ) return memory;
+			std::new_handler const handler = std::get_new_handler();
+			if( handler == nullptr ) throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	void * AllocateOrNull( std::size_t size ) noexcept
+	{
+		try {
+			return Allocate( size );
+		} catch( std::bad_alloc const & ) {
+			return nullptr;
+		}
+	}
+}
+
+std::size_t MaryLang::Benchmarks::ThreadAllocations()
+{
+	return thread_allocations;
+}
+
+void * operator new( std::size_t size ) { return Allocate( size ); }
+void * operator new[]( std::size_t size ) { return Allocate( size ); }
+void * operator new( std::size_t size, std::nothrow_t const & ) noexcept { return AllocateOrNull( size ); }
+void * operator new[]( std::size_t size, std::nothrow_t const & ) noexcept { return AllocateOrNull( size ); }
+void operator delete( void * memory ) noexcept { std::free( memory ); }
+void operator delete[]( void * memory ) noexcept { std::free( memory ); }
+void operator delete( void * memory, std::size_t ) noexcept { std::free( memory ); }
+void operator delete[]( void * memory, std::size_t ) noexcept { std::free( memory ); }
+void operator delete( void * memory, std::nothrow_t const & ) noexcept { std::free( memory ); }
+void operator delete[]( void * memory, std::nothrow_t const & ) noexcept { std::free( memory ); }
+
+#if defined ( __cpp_aligned_new )
+// Over-aligned types, where the language has them.
+namespace
+{
+	void * AllocateAligned( std::size_t size, std::align_val_t alignment )
+	{
+		Count( size );
+		std::size_t const align = static_cast<std::size_t>( alignment );
+		for( ; ; ){
+#if defined ( _WIN32 )
+			if( void * const memory = _aligned_malloc( size != 0 ? size : 1, align ) ) return memory;
+#else
+			void * memory;
+			if( posix_memalign( &memory, std::max( align, sizeof( void * ) ), size != 0 ? size : 1 ) == 0 ) return memory;
+#endif
+			std::new_handler const handler = std::get_new_handler();
+			if( handler == nullptr ) throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	void * AllocateAlignedOrNull( std::size_t size, std::align_val_t alignment ) noexcept
+	{
+		try {
+			return AllocateAligned( size, alignment );
+		} catch( std::bad_alloc const & ) {
+			return nullptr;
+		}
+	}
+
+	void FreeAligned( void * memory ) noexcept
+	{
+#if defined ( _WIN32 )
+		_aligned_free( memory );
+#else
+		std::free( memory );
+#endif
+	}
+}
+
+void * operator new( std::size_t size, std::align_val_t alignment ) { return AllocateAligned( size, alignment ); }
+void * operator new[]( std::size_t size, std::align_val_t alignment ) { return AllocateAligned( size, alignment ); }
+void * operator new( std::size_t size, std::align_val_t alignment, std::nothrow_t const & ) noexcept { return AllocateAlignedOrNull( size, alignment ); }
+void * operator new[]( std::size_t size, std::align_val_t alignment, std::nothrow_t const & ) noexcept { return AllocateAlignedOrNull( size, alignment ); }
+void operator delete( void * memory, std::align_val_t ) noexcept { FreeAligned( memory ); }
+void operator delete[]( void * memory, std::align_val_t ) noexcept { FreeAligned( memory ); }
+void operator delete( void * memory, std::size_t, std::align_val_t ) noexcept { FreeAligned( memory ); }
+void operator delete[]( void * memory, std::size_t, std::align_val_t ) noexcept { FreeAligned( memory ); }
+void operator delete( void * memory, std::align_val_t, std::nothrow_t const & ) noexcept { FreeAligned( memory ); }
+void operator delete[]( void * memory, std::align_val_t, std::nothrow_t const & ) noexcept { FreeAligned( memory ); }
+#endif
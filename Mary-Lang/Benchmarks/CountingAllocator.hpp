@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+namespace MaryLang
+{
+	namespace Benchmarks
+	{
+		// A program linking CountingAllocator.cpp has every form of operator new and delete
+		// replaced with ones that count each allocation: into Support::Statistics, for --stats
+		// and the like, and per thread, for the calls below.
+
+		// The allocations the calling thread has made so far.
+		std::size_t ThreadAllocations();
+	} // namespace Benchmarks
+} // namespace MaryLang
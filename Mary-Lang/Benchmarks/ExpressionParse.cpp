@@ -0,0 +1,202 @@
+// Parses generated, expression-heavy programs and reports parser throughput.
+//
+//   mary-parse-bench [scale]
+//
+// Long mixed-operator chains exercise the precedence table, a very deep parenthesized
+// expression checks the expression parser needs no stack per nesting level, and calls
+// and subscripts exercise the postfix loop. A file of many functions is parsed in full and
+// with bodies skimmed, which is the cold start an outline or a symbol search pays, and
+// with bodies parsed on a thread pool.
+
+#include "../Parser/Parser.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace Lexer = MaryLang::Lexer;
+namespace AST = MaryLang::AbstractSyntaxTree;
+namespace Parser = MaryLang::Parser;
+
+namespace
+{
+	std::string Chains( std::size_t statements )
+	{
+		char const * const operators[] = { "+", "-", "*", "/", "%", "**", "<<", ">>", "<", ">=", "==",
+			"!=", "&", "^", "|", "&&", "||" };
+		std::size_t const operator_count = sizeof( operators ) / sizeof( operators[0] );
+		std::string source;
+		std::uint32_t seed = 12345;
+		for( std::size_t i = 0; i < statements; ++i ){
+			source += "var v" + std::to_string( i ) + " = a0";
+			for( int j = 1; j < 64; ++j ){
+				seed = seed * 1664525u + 1013904223u;
+				source += ' ';
+				source += operators[( seed >> 16 ) % operator_count];
+				source += ( seed >> 8 ) % 3 == 0 ? " -b" : " a";
+				source += std::to_string( j );
+			}
+			source += ";\n";
+		}
+		return source;
+	}
+
+	std::string Parentheses( std::size_t depth )
+	{
+		return "var deep = " + std::string( depth, '(' ) + "1" + std::string( depth, ')' ) + ";\n";
+	}
+
+	std::string Postfix( std::size_t statements )
+	{
+		std::string source;
+		for( std::size_t i = 0; i < statements; ++i ){
+			source += "f( a[i], g( b ).c, h[j][k] + 1 ).d[2]++ + m.n( x, y )( z ) * p[q[r]];\n";
+		}
+		return source;
+	}
+
+	std::string Functions( std::size_t functions )
+	{
+		std::string source;
+		for( std::size_t i = 0; i < functions; ++i ){
+			source += "function f" + std::to_string( i ) + "( a, b: int ) -> int\n{\n"
+				"\tvar s = 0;\n"
+				"\tfor( var i = 0; i < a; ++i ){\n"
+				"\t\tif( i % 2 == 0 ){ s += g( i, b )[i] * 3; } else { s -= h.k( i ) << 1; }\n"
+				"\t}\n"
+				"\twhile( s > b ) s = s / 2 + ( a ? b : -b );\n"
+				"\treturn s;\n}\n";
+		}
+		return source;
+	}
+
+	// `tree' as nested ( operator operand... ) with the operands' spellings.
+	std::wstring ToSExpression( AST::FlatTree const & tree, AST::NodeIndex node, Lexer::Scanner const & scanner )
+	{
+		switch( tree.Kind( node ) )
+		{
+		case AST::NodeKind::Variable:
+		case AST::NodeKind::Constant:
+			{
+				MaryLang::Support::StringRef const spelling = scanner.Spelling( tree.GetToken( node ) );
+				return std::wstring( spelling.begin(), spelling.end() );
+			}
+		case AST::NodeKind::BinaryExpression:
+		case AST::NodeKind::UnaryExpression:
+			{
+				std::wstring result = L"(";
+				result += Lexer::Token::GetName( static_cast<Lexer::TokenType>( tree.Value( node ) ) );
+				for( AST::NodeIndex const child : tree.ChildrenOf( node ) ){
+					result += L" " + ToSExpression( tree, child, scanner );
+				}
+				return result + L")";
+			}
+		default:
+			return AST::GetKindName( tree.Kind( node ) );
+		}
+	}
+
+	struct Result
+	{
+		std::size_t	errors;
+		std::size_t	nodes;
+		double		seconds;
+	};
+
+	enum class Mode { Full, Skim, Parallel };
+
+	// Skimmed function bodies are parsed on demand after the clock stops, to check that
+	// they parse as well as they would have up front. A parallel parse must leave none.
+	Result Parse( std::string const & path, Mode mode, MaryLang::Support::ThreadPool & pool )
+	{
+		auto const start = std::chrono::steady_clock::now();
+		Lexer::Scanner scanner( path.c_str() );
+		Parser::Parser parser( scanner, true );
+		parser.SkimFunctionBodies( mode == Mode::Skim );
+		std::shared_ptr<Parser::ParsedProgram> const program = mode == Mode::Parallel ? parser.Parse( pool ) : parser.Parse();
+		auto const stop = std::chrono::steady_clock::now();
+		std::size_t missing_bodies = 0;
+		for( AST::Statement const * statement : program->SourceProgram() ){
+			auto const declaration = dynamic_cast<AST::DeclarationStatement const *>( statement );
+			if( declaration == nullptr ) continue;
+			auto const function = dynamic_cast<AST::FunctionDeclaration const *>( declaration->GetDeclaration() );
+			if( function == nullptr || !function->IsBodySkimmed() ) continue;
+			if( mode == Mode::Parallel ) ++missing_bodies;
+			parser.ParseFunctionBody( *function );
+		}
+		return Result{ parser.Diagnostics().Count() + missing_bodies, program->FlatTree()->Size(),
+			std::chrono::duration<double>( stop - start ).count() };
+	}
+
+	bool Write( std::string const & path, std::string const & source )
+	{
+		std::ofstream file( path, std::ios::binary );
+		file << source;
+		return static_cast<bool>( file );
+	}
+
+	// The initializer of `var r = ...' in `source' as an s-expression.
+	std::wstring Shape( std::string const & source )
+	{
+		std::string const path = "mary-parse-bench-shape.mj";
+		if( !Write( path, source ) ) return L"<cannot write>";
+		Lexer::Scanner scanner( path.c_str() );
+		Parser::Parser parser( scanner, true );
+		std::shared_ptr<Parser::ParsedProgram> const program = parser.Parse();
+		std::remove( path.c_str() );
+		if( parser.Diagnostics().Count() != 0 ) return L"<errors>";
+
+		// Program -> DeclarationStatement -> VariableDeclaration -> VariableDeclarator( name, type, init )
+		AST::FlatTree const & tree = *program->FlatTree();
+		AST::NodeIndex node = tree.ChildrenOf( tree.Root() )[0];
+		node = tree.ChildrenOf( node )[0];
+		node = tree.ChildrenOf( node )[0];
+		return ToSExpression( tree, tree.ChildrenOf( node )[2], scanner );
+	}
+}
+
+int main( int argc, char **argv )
+{
+	std::size_t const scale = argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 20000;
+
+	struct { char const * input; wchar_t const * expected; } const shapes[] = {
+		{ "var r = 1 + 2 * 3 ** 4 ** 5 - 6;", L"(- (+ 1 (* 2 (** 3 (** 4 5)))) 6)" },
+		{ "var r = a || b && c | d ^ e & f == g < h << i;", L"(|| a (&& b (| c (^ d (& e (== f (< g (<< h i))))))))" },
+		{ "var r = -( a + b ) * !c;", L"(* (- (+ a b)) (! c))" },
+		{ "var r = ((a - b) - (c - d));", L"(- (- a b) (- c d))" },
+	};
+	for( auto const & shape : shapes ){
+		std::wstring const actual = Shape( shape.input );
+		if( actual != shape.expected ){
+			std::fprintf( stderr, "%s\n  parsed as %ls\n  expected  %ls\n", shape.input, actual.c_str(), shape.expected );
+			return 1;
+		}
+	}
+
+	std::string const functions = Functions( scale / 2 );
+	struct { char const * name; std::string source; Mode mode; } const inputs[] = {
+		{ "operator chains", Chains( scale ), Mode::Full },
+		{ "deep parentheses", Parentheses( scale * 5 ), Mode::Full },
+		{ "calls and subscripts", Postfix( scale ), Mode::Full },
+		{ "functions", functions, Mode::Full },
+		{ "functions, skimmed", functions, Mode::Skim },
+		{ "functions, parallel", functions, Mode::Parallel },
+	};
+	MaryLang::Support::ThreadPool pool;
+	int status = 0;
+	for( auto const & input : inputs ){
+		std::string const path = std::string( "mary-parse-bench-" ) + std::to_string( &input - inputs ) + ".mj";
+		if( !Write( path, input.source ) ){
+			std::fprintf( stderr, "cannot write %s\n", path.c_str() );
+			return 1;
+		}
+		Result const result = Parse( path, input.mode, pool );
+		std::remove( path.c_str() );
+		double const megabytes = input.source.size() / ( 1024.0 * 1024.0 );
+		std::printf( "%-22s %8.2f MB %8.1f MB/s %8.2f M nodes/s %zu errors\n", input.name, megabytes,
+			megabytes / result.seconds, result.nodes / result.seconds / 1e6, result.errors );
+		if( result.errors != 0 ) status = 1;
+	}
+	return status;
+}
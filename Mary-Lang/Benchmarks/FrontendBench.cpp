@@ -0,0 +1,380 @@
+// Lexes and parses a generated corpus and reports front-end throughput, as a table or as
+// JSON that can be kept and compared with another commit's.
+//
+//   mary-bench [--size MB] [--repeat N] [--seed N] [--label TEXT] [--json] [--stream] [--edits N]
+//              [--lex-all] [-j N]
+//   mary-bench --write-corpus DIR [--size MB] [--seed N]
+//
+// Each corpus file is lexed and parsed --repeat times and the fastest run counts.
+// Allocations are the calls to operator new made during one run, as CountingAllocator.cpp
+// counts them; that covers the containers but not the arena's chunks, which show up as
+// arena bytes per node instead.
+// --write-corpus only writes the .mj files, e.g. for the MaryLang driver. --stream parses
+// a statement at a time with ParseEach, releasing each; nodes and arena bytes are added
+// up over the statements, and peak RSS shows what streaming saves. --edits types a letter
+// into N identifiers of each file held in a Parser::Document, deleting it again after each,
+// and reports the latency of those 2N edits next to parsing the whole file. --lex-all also
+// lexes each file with LexAll, in chunks on N threads (one per hardware thread by default),
+// and reports its throughput next to a single Scanner's; it fails if the tokens or the
+// diagnostics differ.
+
+#include "Corpus.hpp"
+#include "CountingAllocator.hpp"
+#include "../Parser/Document.hpp"
+#include "../Parser/Parser.hpp"
+#include "../Scanner/LexAll.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+#include <windows.h>
+#include <psapi.h>
+#pragma comment( lib, "psapi.lib" )
+#else
+#include <sys/resource.h>
+#endif
+
+namespace Lexer = MaryLang::Lexer;
+namespace Parser = MaryLang::Parser;
+namespace Benchmarks = MaryLang::Benchmarks;
+
+namespace
+{
+	struct Options
+	{
+		std::size_t		megabytes;
+		unsigned int	repeat;
+		std::uint32_t	seed;
+		std::string		label;
+		std::string		corpus_directory; // non-empty: only write the corpus there
+		bool			json;
+		bool			stream;
+		unsigned int	edits;	// per file; none unless asked for
+		bool			lex_all;
+		unsigned int	jobs;	// for LexAll; zero: one per hardware thread
+	};
+
+	struct Measurement
+	{
+		double		seconds; // the fastest run
+		std::size_t	allocations;
+	};
+
+	struct Result
+	{
+		std::string	name;
+		std::size_t	bytes, tokens, nodes, arena_bytes;
+		Measurement	lex, parse, lex_all;
+		std::size_t	peak_rss_kb; // of the whole process, once this file was done
+		double		edit_median_us, edit_p99_us, reparsed_per_edit;
+	};
+
+	bool ParseOptions( int argc, char **argv, Options & options )
+	{
+		options.megabytes = 4;
+		options.repeat = 3;
+		options.seed = 12345;
+		options.json = false;
+		options.stream = false;
+		options.edits = 0;
+		options.lex_all = false;
+		options.jobs = 0;
+		for( int i = 1; i < argc; ++i ){
+			char const * const arg = argv[i];
+			char const * const value = i + 1 < argc ? argv[i + 1] : nullptr;
+			if( std::strcmp( arg, "--json" ) == 0 ){
+				options.json = true;
+				continue;
+			}
+			if( std::strcmp( arg, "--stream" ) == 0 ){
+				options.stream = true;
+				continue;
+			}
+			if( std::strcmp( arg, "--lex-all" ) == 0 ){
+				options.lex_all = true;
+				continue;
+			}
+			if( value == nullptr ) return false;
+			++i;
+			if( std::strcmp( arg, "--size" ) == 0 ) options.megabytes = std::strtoul( value, nullptr, 10 );
+			else if( std::strcmp( arg, "--repeat" ) == 0 ) options.repeat = static_cast<unsigned int>( std::strtoul( value, nullptr, 10 ) );
+			else if( std::strcmp( arg, "--seed" ) == 0 ) options.seed = static_cast<std::uint32_t>( std::strtoul( value, nullptr, 10 ) );
+			else if( std::strcmp( arg, "--label" ) == 0 ) options.label = value;
+			else if( std::strcmp( arg, "-j" ) == 0 ) options.jobs = static_cast<unsigned int>( std::strtoul( value, nullptr, 10 ) );
+			else if( std::strcmp( arg, "--edits" ) == 0 ) options.edits = static_cast<unsigned int>( std::strtoul( value, nullptr, 10 ) );
+			else if( std::strcmp( arg, "--write-corpus" ) == 0 ) options.corpus_directory = value;
+			else return false;
+		}
+		return options.megabytes != 0 && options.repeat != 0;
+	}
+
+	bool Write( std::string const & path, std::string const & source )
+	{
+		std::ofstream file( path, std::ios::binary );
+		file << source;
+		return static_cast<bool>( file );
+	}
+
+	std::size_t PeakResidentKilobytes()
+	{
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+		PROCESS_MEMORY_COUNTERS counters;
+		if( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) ) return 0;
+		return counters.PeakWorkingSetSize / 1024;
+#else
+		struct rusage usage;
+		if( getrusage( RUSAGE_SELF, &usage ) != 0 ) return 0;
+#if defined ( __APPLE__ )
+		return static_cast<std::size_t>( usage.ru_maxrss ) / 1024; // bytes there
+#else
+		return static_cast<std::size_t>( usage.ru_maxrss );
+#endif
+#endif
+	}
+
+	// Runs `run' `repeat' times, keeping the fastest time and the last run's allocations.
+	template<typename Run>
+	Measurement Measure( unsigned int repeat, Run run )
+	{
+		Measurement best{ 0.0, 0 };
+		for( unsigned int i = 0; i < repeat; ++i ){
+			std::size_t const allocated = Benchmarks::ThreadAllocations();
+			auto const start = std::chrono::steady_clock::now();
+			run();
+			double const seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+			best.allocations = Benchmarks::ThreadAllocations() - allocated;
+			if( i == 0 || seconds < best.seconds ) best.seconds = seconds;
+		}
+		return best;
+	}
+
+	// False if the file does not parse cleanly, which would make its numbers meaningless.
+	bool Run( std::string const & path, Options const & options, Result & result )
+	{
+		result.lex = Measure( options.repeat, [&]{
+			Lexer::Scanner scanner( path.c_str() );
+			std::size_t tokens = 0;
+			while( scanner.GetNextToken().Type() != Lexer::TokenType::TK_EOF ) ++tokens;
+			result.tokens = tokens + 1;
+		} );
+		std::size_t errors = 0;
+		result.parse = Measure( options.repeat, [&]{
+			Lexer::Scanner scanner( path.c_str() );
+			Parser::Parser parser( scanner, true );
+			if( options.stream ){
+				std::shared_ptr<Parser::ParsedProgram> const & program = parser.Program();
+				std::size_t nodes = 0;
+				result.arena_bytes = 0;
+				parser.ParseEach( [&]( Parser::Statement const & ){
+					nodes += program->FlatTree()->Size();
+					result.arena_bytes += program->Arena().BytesAllocated();
+				} );
+				result.nodes = nodes;
+			} else {
+				std::shared_ptr<Parser::ParsedProgram> const program = parser.Parse();
+				result.nodes = program->FlatTree()->Size();
+				result.arena_bytes = program->Arena().BytesAllocated();
+			}
+			errors = scanner.Diagnostics().ErrorCount() + parser.Diagnostics().ErrorCount();
+		} );
+		result.peak_rss_kb = PeakResidentKilobytes();
+		return errors == 0;
+	}
+
+	bool SameTokens( std::vector<Lexer::Token> const & a, std::vector<Lexer::Token> const & b )
+	{
+		return a.size() == b.size() && std::equal( a.begin(), a.end(), b.begin(), []( Lexer::Token const & x, Lexer::Token const & y ){
+			return x.Offset() == y.Offset() && x.Length() == y.Length() && x.Type() == y.Type() && x.Payload() == y.Payload();
+		} );
+	}
+
+	// False if LexAll does not come up with what a single Scanner does.
+	bool MeasureLexAll( std::string const & path, Options const & options, MaryLang::Support::ThreadPool & pool, Result & result )
+	{
+		std::vector<Lexer::Token> expected;
+		std::vector<MaryLang::Support::DiagRecord> expected_diagnostics;
+		{
+			Lexer::Scanner scanner( path.c_str() );
+			do {
+				expected.push_back( scanner.GetNextToken() );
+			} while( expected.back().Type() != Lexer::TokenType::TK_EOF );
+			expected_diagnostics.assign( scanner.Diagnostics().begin(), scanner.Diagnostics().end() );
+		}
+		bool same = true;
+		result.lex_all = Measure( options.repeat, [&]{
+			MaryLang::Support::SourceManager source;
+			source.Open( path.c_str() );
+			MaryLang::Support::Diagnostic diagnostics;
+			std::vector<Lexer::Token> const tokens = Lexer::LexAll( source, pool, diagnostics );
+			same = same && SameTokens( tokens, expected ) && diagnostics.Count() == expected_diagnostics.size()
+				&& std::equal( diagnostics.begin(), diagnostics.end(), expected_diagnostics.begin(),
+					[]( MaryLang::Support::DiagRecord const & x, MaryLang::Support::DiagRecord const & y ){
+						return x.offset == y.offset && x.id == y.id && x.argument == y.argument;
+					} );
+		} );
+		return same;
+	}
+
+	// Types a letter at the end of randomly chosen identifiers and takes it back, as someone
+	// renaming things would, timing each edit.
+	void MeasureEdits( Benchmarks::CorpusFile const & file, Options const & options, Result & result )
+	{
+		Parser::Document document( file.name, file.source );
+		std::vector<std::uint32_t> identifiers; // their ends
+		for( Lexer::Token const & token : document.Tokens() ){
+			if( token.Type() == Lexer::TokenType::TK_IDENTIFIER ) identifiers.push_back( token.Offset() + token.Length() );
+		}
+		std::vector<double> micros;
+		std::size_t reparsed = 0;
+		std::mt19937 random( options.seed );
+		for( unsigned int i = 0; i < options.edits && !identifiers.empty(); ++i ){
+			std::uint32_t const end = identifiers[random() % identifiers.size()];
+			Parser::TextEdit const edits[2] = { { end, 0, "x" }, { end, 1, "" } };
+			for( Parser::TextEdit const & edit : edits ){
+				auto const start = std::chrono::steady_clock::now();
+				document.Edit( edit );
+				micros.push_back( std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count() );
+				reparsed += document.LastEdit().statements_reparsed;
+			}
+		}
+		if( micros.empty() ) return;
+		std::sort( micros.begin(), micros.end() );
+		result.edit_median_us = micros[micros.size() / 2];
+		result.edit_p99_us = micros[std::min( micros.size() - 1, micros.size() * 99 / 100 )];
+		result.reparsed_per_edit = static_cast<double>( reparsed ) / micros.size();
+	}
+
+	double PerSecond( double amount, double seconds )
+	{
+		return seconds > 0.0 ? amount / seconds : 0.0;
+	}
+
+	void PrintTable( std::vector<Result> const & results )
+	{
+		std::printf( "%-9s %8s %9s %9s %10s %10s %9s %11s %12s %10s\n", "corpus", "MB", "lex MB/s", "M tok/s",
+			"parse MB/s", "M nodes/s", "lex a/tok", "parse a/tok", "arena B/node", "peak RSS" );
+		for( Result const & result : results ){
+			double const megabytes = result.bytes / ( 1024.0 * 1024.0 );
+			std::printf( "%-9s %8.2f %9.1f %9.2f %10.1f %10.2f %9.3f %11.3f %12.1f %7zu KB\n", result.name.c_str(), megabytes,
+				PerSecond( megabytes, result.lex.seconds ), PerSecond( result.tokens, result.lex.seconds ) / 1e6,
+				PerSecond( megabytes, result.parse.seconds ), PerSecond( result.nodes, result.parse.seconds ) / 1e6,
+				static_cast<double>( result.lex.allocations ) / result.tokens,
+				static_cast<double>( result.parse.allocations ) / result.tokens,
+				static_cast<double>( result.arena_bytes ) / ( result.nodes != 0 ? result.nodes : 1 ), result.peak_rss_kb );
+		}
+	}
+
+	void PrintLexAllTable( std::vector<Result> const & results, unsigned int jobs )
+	{
+		std::printf( "\n%-9s %9s %14s %8s\n", "corpus", "lex MB/s", "lex-all MB/s", "speedup" );
+		for( Result const & result : results ){
+			double const megabytes = result.bytes / ( 1024.0 * 1024.0 );
+			std::printf( "%-9s %9.1f %14.1f %7.2fx\n", result.name.c_str(), PerSecond( megabytes, result.lex.seconds ),
+				PerSecond( megabytes, result.lex_all.seconds ), PerSecond( result.lex.seconds, result.lex_all.seconds ) );
+		}
+		std::printf( "lex-all on %u threads\n", jobs );
+	}
+
+	void PrintEditTable( std::vector<Result> const & results )
+	{
+		std::printf( "\n%-9s %12s %12s %14s %15s\n", "corpus", "edit med us", "edit p99 us", "full parse us", "reparsed/edit" );
+		for( Result const & result : results ){
+			std::printf( "%-9s %12.1f %12.1f %14.1f %15.2f\n", result.name.c_str(), result.edit_median_us, result.edit_p99_us,
+				result.parse.seconds * 1e6, result.reparsed_per_edit );
+		}
+	}
+
+	std::string JsonString( std::string const & str )
+	{
+		std::string quoted = "\"";
+		for( char const c : str ){
+			if( c == '"' || c == '\\' ) quoted += '\\';
+			if( static_cast<unsigned char>( c ) >= 0x20 ) quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	void PrintJson( std::vector<Result> const & results, Options const & options )
+	{
+		std::printf( "{\n  \"label\": %s,\n  \"size_mb\": %zu,\n  \"seed\": %u,\n  \"repeat\": %u,\n  \"stream\": %s,\n  \"edits\": %u,\n  \"lex_all\": %s,\n  \"results\": [",
+			JsonString( options.label ).c_str(), options.megabytes, options.seed, options.repeat, options.stream ? "true" : "false",
+			options.edits, options.lex_all ? "true" : "false" );
+		for( Result const & result : results ){
+			double const megabytes = result.bytes / ( 1024.0 * 1024.0 );
+			std::printf( "%s\n    {\"corpus\": %s, \"bytes\": %zu, \"tokens\": %zu, \"nodes\": %zu,"
+				" \"lex_seconds\": %.6f, \"lex_mb_per_s\": %.2f, \"lex_tokens_per_s\": %.0f, \"lex_allocations_per_token\": %.4f,"
+				" \"parse_seconds\": %.6f, \"parse_mb_per_s\": %.2f, \"parse_nodes_per_s\": %.0f, \"parse_allocations_per_token\": %.4f,"
+				" \"arena_bytes\": %zu, \"peak_rss_kb\": %zu, \"edit_median_us\": %.2f, \"edit_p99_us\": %.2f,"
+				" \"lex_all_seconds\": %.6f, \"lex_all_mb_per_s\": %.2f}",
+				&result == &results.front() ? "" : ",", JsonString( result.name ).c_str(), result.bytes, result.tokens, result.nodes,
+				result.lex.seconds, PerSecond( megabytes, result.lex.seconds ), PerSecond( result.tokens, result.lex.seconds ),
+				static_cast<double>( result.lex.allocations ) / result.tokens,
+				result.parse.seconds, PerSecond( megabytes, result.parse.seconds ), PerSecond( result.nodes, result.parse.seconds ),
+				static_cast<double>( result.parse.allocations ) / result.tokens, result.arena_bytes, result.peak_rss_kb,
+				result.edit_median_us, result.edit_p99_us, result.lex_all.seconds, PerSecond( megabytes, result.lex_all.seconds ) );
+		}
+		std::printf( "\n  ],\n  \"peak_rss_kb\": %zu\n}\n", PeakResidentKilobytes() );
+	}
+}
+
+int main( int argc, char **argv )
+{
+	Options options;
+	if( !ParseOptions( argc, argv, options ) ){
+		std::fprintf( stderr, "usage: mary-bench [--size MB] [--repeat N] [--seed N] [--label TEXT] [--json] [--stream] [--edits N]\n"
+			"                  [--lex-all] [-j N]\n"
+			"       mary-bench --write-corpus DIR [--size MB] [--seed N]\n" );
+		return 2;
+	}
+	std::vector<Benchmarks::CorpusFile> const corpus = Benchmarks::GenerateCorpus( options.megabytes << 20, options.seed );
+
+	if( !options.corpus_directory.empty() ){
+		for( Benchmarks::CorpusFile const & file : corpus ){
+			std::string const path = options.corpus_directory + "/" + file.name + ".mj";
+			if( !Write( path, file.source ) ){
+				std::fprintf( stderr, "cannot write %s\n", path.c_str() );
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	MaryLang::Support::ThreadPool pool( options.lex_all ? options.jobs : 1 );
+	std::vector<Result> results;
+	int status = 0;
+	for( Benchmarks::CorpusFile const & file : corpus ){
+		std::string const path = "mary-bench-" + file.name + ".mj";
+		if( !Write( path, file.source ) ){
+			std::fprintf( stderr, "cannot write %s\n", path.c_str() );
+			return 1;
+		}
+		Result result = Result();
+		result.name = file.name;
+		result.bytes = file.source.size();
+		bool const clean = Run( path, options, result );
+		if( options.lex_all && !MeasureLexAll( path, options, pool, result ) ){
+			std::fprintf( stderr, "%s: LexAll disagrees with the Scanner\n", file.name.c_str() );
+			status = 1;
+		}
+		std::remove( path.c_str() );
+		if( options.edits != 0 ) MeasureEdits( file, options, result );
+		if( !clean ){
+			std::fprintf( stderr, "%s: the generated corpus has errors\n", file.name.c_str() );
+			status = 1;
+		}
+		results.push_back( result );
+	}
+	if( options.json ) PrintJson( results, options );
+	else {
+		PrintTable( results );
+		if( options.lex_all ) PrintLexAllTable( results, pool.Size() );
+		if( options.edits != 0 ) PrintEditTable( results );
+	}
+	return status;
+}
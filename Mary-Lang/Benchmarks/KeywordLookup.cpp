@@ -0,0 +1,110 @@
+// Compares ClassifyIdentifier against the hash table the scanner used to look keywords up in.
+//
+//   mary-keyword-bench [lookups]
+
+#include "../Scanner/Keywords.hpp"
+#include "../Utils/StringRef.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Lexer = MaryLang::Lexer;
+namespace Support = MaryLang::Support;
+
+namespace
+{
+	// The shift-xor hash Token::lookup_table was keyed with.
+	struct ShiftXorHash
+	{
+		std::size_t operator()( Support::StringRef const & str ) const
+		{
+			int offset = 'a' - 1;
+			std::size_t hash = 0;
+			for( char const c : str ){
+				hash = hash << 1 ^ ( c - offset );
+			}
+			return hash;
+		}
+	};
+
+	typedef std::unordered_map<Support::StringRef, Lexer::TokenType, ShiftXorHash> LookupTable;
+
+	// Roughly what identifier-heavy source looks like: one word in four is a keyword,
+	// the rest are identifiers, some of which share a keyword's length and first letter.
+	std::vector<std::string> MakeWords( std::size_t count )
+	{
+		char const * const identifiers[] = {
+			"i", "x", "value", "index", "count", "buffer", "result", "element", "container",
+			"iterator", "position", "vertices", "GetNextToken", "current_token", "document",
+			"doubled", "forward", "iffy", "variable", "strings", "classic", "returned"
+		};
+		std::size_t const identifier_count = sizeof( identifiers ) / sizeof( identifiers[0] );
+		std::size_t const keyword_count = sizeof( Lexer::keywords ) / sizeof( Lexer::keywords[0] );
+
+		std::vector<std::string> words;
+		words.reserve( count );
+		std::uint32_t seed = 12345;
+		for( std::size_t i = 0; i < count; ++i ){
+			seed = seed * 1664525u + 1013904223u;
+			if( ( seed >> 16 ) % 4 == 0 ){
+				words.push_back( Lexer::keywords[( seed >> 8 ) % keyword_count].spelling );
+			} else {
+				words.push_back( identifiers[( seed >> 8 ) % identifier_count] );
+			}
+		}
+		return words;
+	}
+
+	// `words' must hold a power of two entries.
+	template<typename Classify>
+	double Measure( std::vector<Support::StringRef> const & words, std::size_t lookups,
+		Classify classify, unsigned long & checksum )
+	{
+		std::size_t const mask = words.size() - 1;
+		auto const start = std::chrono::steady_clock::now();
+		for( std::size_t i = 0; i < lookups; ++i ){
+			checksum += static_cast<unsigned long>( classify( words[i & mask] ) );
+		}
+		auto const stop = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>( stop - start ).count() / lookups;
+	}
+}
+
+int main( int argc, char **argv )
+{
+	std::size_t const lookups = argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 50000000;
+	std::vector<std::string> const words = MakeWords( 4096 );
+	std::vector<Support::StringRef> refs;
+	for( std::string const & word : words ) refs.push_back( Support::StringRef( word.data(), word.size() ) );
+
+	LookupTable table;
+	for( Lexer::Keyword const & keyword : Lexer::keywords ){
+		table.insert( std::make_pair( Support::StringRef( keyword.spelling, keyword.length ), keyword.type ) );
+	}
+
+	for( std::string const & word : words ){
+		auto f = table.find( Support::StringRef( word.data(), word.size() ) );
+		Lexer::TokenType const expected = f == table.end() ? Lexer::TokenType::TK_IDENTIFIER : f->second;
+		if( Lexer::ClassifyIdentifier( word.data(), word.size() ) != expected ){
+			std::fprintf( stderr, "mismatch on '%s'\n", word.c_str() );
+			return 1;
+		}
+	}
+
+	unsigned long table_checksum = 0, switch_checksum = 0;
+	double const table_ns = Measure( refs, lookups, [&table]( Support::StringRef word ){
+		auto f = table.find( word );
+		return f == table.end() ? Lexer::TokenType::TK_IDENTIFIER : f->second;
+	}, table_checksum );
+	double const switch_ns = Measure( refs, lookups, []( Support::StringRef word ){
+		return Lexer::ClassifyIdentifier( word.Data(), word.Size() );
+	}, switch_checksum );
+
+	std::printf( "%-24s %8.2f ns/lookup\n", "unordered_map (old)", table_ns );
+	std::printf( "%-24s %8.2f ns/lookup\n", "ClassifyIdentifier", switch_ns );
+	std::printf( "speedup %.2fx (checksums %lu %lu)\n", table_ns / switch_ns, table_checksum, switch_checksum );
+	return table_checksum == switch_checksum ? 0 : 1;
+}
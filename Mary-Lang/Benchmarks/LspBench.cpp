@@ -0,0 +1,403 @@
+// Replays an editing session against the language server, in process, and reports the
+// latency of every kind of message it handled, as a table or as JSON.
+//
+//   mary-lsp-bench [--lines N] [--edits N] [--seed N] [--project DIR] [--write-session FILE] [--json]
+//   mary-lsp-bench --session FILE [--json]
+//
+// Without --session a project is made up first: about --lines lines (100000 by default)
+// of generated code, split into modules of a few thousand lines each in DIR
+// (mary-lsp-bench-project by default), every module importing the one before it and
+// main.mj the last, so opening main.mj loads them all. The session opens main.mj and
+// two modules, then types a letter into --edits identifiers of theirs and deletes it
+// again, asking for the definition of the identifier after each change and for the
+// outline of the file after every eighth. --write-session keeps the project and writes
+// the session, framed, to FILE, for this or for mary-lsp itself to replay; mary-lsp
+// --record records sessions from an editor the same way.
+//
+// The time of the first didOpen, which loads the project, is reported apart from the
+// rest. Server messages are serialized as they would be sent, but not written anywhere.
+
+#include "Corpus.hpp"
+#include "../LanguageServer/Server.hpp"
+#include "../Parser/Document.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+#include <direct.h>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Benchmarks = MaryLang::Benchmarks;
+namespace LanguageServer = MaryLang::LanguageServer;
+namespace Parser = MaryLang::Parser;
+namespace Lexer = MaryLang::Lexer;
+
+namespace
+{
+	// Modules are cut at the first statement past this many lines.
+	std::uint32_t const module_lines = 5000;
+
+	struct Options
+	{
+		std::uint32_t	lines;
+		unsigned int	edits;
+		std::uint32_t	seed;
+		std::string		project;		// where the generated modules go
+		std::string		session_path;	// non-empty: replay this instead
+		std::string		write_session;	// non-empty: write the generated session there
+		bool			json;
+	};
+
+	struct Project
+	{
+		std::vector<std::string>	paths;	// absolute; main.mj last
+		std::size_t					lines, bytes;
+	};
+
+	struct Latencies
+	{
+		std::vector<double>	micros;
+
+		double Percentile( unsigned int percent ) const
+		{
+			if( micros.empty() ) return 0.0;
+			return micros[std::min( micros.size() - 1, micros.size() * percent / 100 )];
+		}
+	};
+
+	bool ParseOptions( int argc, char **argv, Options & options )
+	{
+		options.lines = 100000;
+		options.edits = 500;
+		options.seed = 12345;
+		options.project = "mary-lsp-bench-project";
+		options.json = false;
+		for( int i = 1; i < argc; ++i ){
+			char const * const arg = argv[i];
+			char const * const value = i + 1 < argc ? argv[i + 1] : nullptr;
+			if( std::strcmp( arg, "--json" ) == 0 ){
+				options.json = true;
+				continue;
+			}
+			if( value == nullptr ) return false;
+			++i;
+			if( std::strcmp( arg, "--lines" ) == 0 ) options.lines = static_cast<std::uint32_t>( std::strtoul( value, nullptr, 10 ) );
+			else if( std::strcmp( arg, "--edits" ) == 0 ) options.edits = static_cast<unsigned int>( std::strtoul( value, nullptr, 10 ) );
+			else if( std::strcmp( arg, "--seed" ) == 0 ) options.seed = static_cast<std::uint32_t>( std::strtoul( value, nullptr, 10 ) );
+			else if( std::strcmp( arg, "--project" ) == 0 ) options.project = value;
+			else if( std::strcmp( arg, "--session" ) == 0 ) options.session_path = value;
+			else if( std::strcmp( arg, "--write-session" ) == 0 ) options.write_session = value;
+			else return false;
+		}
+		return options.lines != 0;
+	}
+
+	bool Write( std::string const & path, std::string const & text )
+	{
+		std::ofstream file( path, std::ios::binary );
+		file << text;
+		return static_cast<bool>( file );
+	}
+
+	std::string Read( std::string const & path )
+	{
+		std::ifstream file( path, std::ios::binary );
+		return std::string( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
+	}
+
+	// `path' made absolute, the directory created if need be; empty if it cannot be.
+	std::string MakeDirectory( std::string const & path )
+	{
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+		if( !CreateDirectoryA( path.c_str(), nullptr ) && GetLastError() != ERROR_ALREADY_EXISTS ) return std::string();
+		char full[MAX_PATH];
+		DWORD const length = GetFullPathNameA( path.c_str(), MAX_PATH, full, nullptr );
+		return length != 0 && length < MAX_PATH ? std::string( full, length ) : std::string();
+#else
+		if( mkdir( path.c_str(), 0777 ) != 0 && errno != EEXIST ) return std::string();
+		if( !path.empty() && path[0] == '/' ) return path;
+		char cwd[4096];
+		return getcwd( cwd, sizeof( cwd ) ) != nullptr ? std::string( cwd ) + "/" + path : std::string();
+#endif
+	}
+
+	std::size_t CountLines( char const * begin, char const * end )
+	{
+		return static_cast<std::size_t>( std::count( begin, end, '\n' ) );
+	}
+
+	// Cuts the generated shapes into modules at statement boundaries until there are about
+	// `options.lines' lines, and writes them out.
+	bool GenerateProject( Options const & options, Project & project )
+	{
+		std::string const directory = MakeDirectory( options.project );
+		if( directory.empty() ){
+			std::fprintf( stderr, "cannot make %s\n", options.project.c_str() );
+			return false;
+		}
+		char const * const shapes[] = { "flat", "classes", "strings", "comments" };
+		std::size_t const shape_count = sizeof( shapes ) / sizeof( shapes[0] );
+		// each shape a quarter of the lines, at a guess of the bytes a line takes at first
+		std::size_t const per_shape = ( options.lines + shape_count - 1 ) / shape_count;
+		std::size_t bytes_per_shape = per_shape * 40;
+		std::vector<Benchmarks::CorpusFile> corpus;
+		for( int attempt = 0; attempt < 4; ++attempt ){
+			corpus = Benchmarks::GenerateCorpus( bytes_per_shape, options.seed );
+			std::size_t fewest = SIZE_MAX;
+			for( Benchmarks::CorpusFile const & file : corpus ){
+				if( std::find( shapes, shapes + shape_count, file.name ) == shapes + shape_count ) continue;
+				fewest = std::min( fewest, CountLines( file.source.data(), file.source.data() + file.source.size() ) );
+			}
+			if( fewest >= per_shape ) break;
+			bytes_per_shape = bytes_per_shape * per_shape / std::max<std::size_t>( fewest, 1 ) + 4096;
+		}
+
+		project = Project{ {}, 0, 0 };
+		for( Benchmarks::CorpusFile const & file : corpus ){
+			if( std::find( shapes, shapes + shape_count, file.name ) == shapes + shape_count ) continue;
+			Parser::Document const document( file.name, file.source );
+			std::vector<Parser::Document::Segment> const & segments = document.Segments();
+			char const * const text = file.source.data();
+			std::size_t shape_lines = 0;
+			std::uint32_t begin = 0;
+			for( std::size_t i = 0; i <= segments.size() && shape_lines < per_shape; ++i ){
+				std::uint32_t const end = i < segments.size() ? segments[i].begin : static_cast<std::uint32_t>( file.source.size() );
+				std::size_t const lines = CountLines( text + begin, text + end );
+				if( lines < module_lines && i < segments.size() ) continue;
+				std::string module;
+				if( !project.paths.empty() ){
+					std::string const previous = project.paths.back();
+					module = "import \"" + previous.substr( previous.rfind( '/' ) + 1 ) + "\";\n";
+				}
+				module.append( text + begin, text + end );
+				std::string const path = directory + "/" + file.name + "_" + std::to_string( project.paths.size() ) + ".mj";
+				if( !Write( path, module ) ){
+					std::fprintf( stderr, "cannot write %s\n", path.c_str() );
+					return false;
+				}
+				project.paths.push_back( path );
+				project.lines += lines + ( module.size() != end - begin ? 1 : 0 );
+				project.bytes += module.size();
+				shape_lines += lines;
+				begin = end;
+			}
+		}
+
+		std::string const last = project.paths.back();
+		std::string const main_source = "import \"" + last.substr( last.rfind( '/' ) + 1 ) + "\";\n\n"
+			"function main( argument ) {\n\tvar total = argument;\n\treturn total;\n}\n";
+		project.paths.push_back( directory + "/main.mj" );
+		project.lines += CountLines( main_source.data(), main_source.data() + main_source.size() );
+		project.bytes += main_source.size();
+		return Write( project.paths.back(), main_source );
+	}
+
+	std::string Message( LanguageServer::JsonValue const & value )
+	{
+		std::string message;
+		value.Write( message );
+		return message;
+	}
+
+	LanguageServer::JsonValue Request( int id, char const * method, LanguageServer::JsonValue params )
+	{
+		LanguageServer::JsonValue request = LanguageServer::JsonValue::Object();
+		request.Set( "jsonrpc", "2.0" );
+		if( id != 0 ) request.Set( "id", id );
+		return std::move( request.Set( "method", method ).Set( "params", std::move( params ) ) );
+	}
+
+	LanguageServer::JsonValue TextDocument( std::string const & uri )
+	{
+		return LanguageServer::JsonValue::Object().Set( "textDocument", LanguageServer::JsonValue::Object().Set( "uri", uri ) );
+	}
+
+	LanguageServer::JsonValue Position( std::uint32_t line, std::uint32_t character )
+	{
+		return LanguageServer::JsonValue::Object().Set( "line", line ).Set( "character", character );
+	}
+
+	// What someone renaming things in the open files would send.
+	std::vector<std::string> GenerateSession( Options const & options, Project const & project )
+	{
+		typedef LanguageServer::JsonValue JsonValue;
+		std::vector<std::string> session;
+		int id = 0;
+		session.push_back( Message( Request( ++id, "initialize", JsonValue::Object().Set( "processId", JsonValue() ) ) ) );
+		session.push_back( Message( Request( 0, "initialized", JsonValue::Object() ) ) );
+
+		// main.mj first, which loads the project, then a module from the middle and the last
+		std::vector<std::size_t> const opened = { project.paths.size() - 1, ( project.paths.size() - 1 ) / 2, project.paths.size() - 2 };
+		struct OpenFile
+		{
+			std::string				uri;
+			std::int64_t			version;
+			// the identifiers, each where it ends: a line and a UTF-16 column
+			std::vector<std::pair<std::uint32_t, std::uint32_t>> identifiers;
+		};
+		std::vector<OpenFile> files;
+		for( std::size_t const index : opened ){
+			std::string const & path = project.paths[index];
+			std::string const text = Read( path );
+			OpenFile file{ LanguageServer::PathToUri( path ), 1, {} };
+			Parser::Document const document( path, text );
+			MaryLang::Support::SourceManager const & source = document.Source();
+			for( Lexer::Token const & token : document.Tokens() ){
+				if( token.Type() != Lexer::TokenType::TK_IDENTIFIER ) continue;
+				std::uint32_t const end = token.Offset() + token.Length();
+				std::uint32_t const line = source.GetPosition( end )._line_number;
+				std::uint32_t units = 0;
+				for( std::uint32_t i = source.LineOffset( line ); i < end; ++i ){
+					unsigned char const byte = static_cast<unsigned char>( source.Data()[i] );
+					if( ( byte & 0xC0 ) != 0x80 ) units += byte >= 0xF0 ? 2 : 1;
+				}
+				file.identifiers.emplace_back( line - 1, units );
+			}
+			session.push_back( Message( Request( 0, "textDocument/didOpen", JsonValue::Object().Set( "textDocument",
+				JsonValue::Object().Set( "uri", file.uri ).Set( "languageId", "mary" ).Set( "version", file.version ).Set( "text", text ) ) ) ) );
+			if( !file.identifiers.empty() ) files.push_back( std::move( file ) );
+		}
+
+		std::mt19937 random( options.seed );
+		for( unsigned int edit = 0; edit < options.edits && !files.empty(); ++edit ){
+			OpenFile & file = files[random() % files.size()];
+			std::pair<std::uint32_t, std::uint32_t> const at = file.identifiers[random() % file.identifiers.size()];
+			std::uint32_t const line = at.first, character = at.second;
+			JsonValue const inserted = JsonValue::Object().Set( "range", JsonValue::Object().Set( "start", Position( line, character ) )
+				.Set( "end", Position( line, character ) ) ).Set( "text", "x" );
+			JsonValue const deleted = JsonValue::Object().Set( "range", JsonValue::Object().Set( "start", Position( line, character ) )
+				.Set( "end", Position( line, character + 1 ) ) ).Set( "text", "" );
+			for( JsonValue const * change : { &inserted, &deleted } ){
+				session.push_back( Message( Request( 0, "textDocument/didChange", JsonValue::Object()
+					.Set( "textDocument", JsonValue::Object().Set( "uri", file.uri ).Set( "version", ++file.version ) )
+					.Set( "contentChanges", JsonValue::Array().Push( *change ) ) ) ) );
+				session.push_back( Message( Request( ++id, "textDocument/definition",
+					std::move( TextDocument( file.uri ).Set( "position", Position( line, character ) ) ) ) ) );
+			}
+			if( edit % 8 == 7 ) session.push_back( Message( Request( ++id, "textDocument/documentSymbol", TextDocument( file.uri ) ) ) );
+		}
+		session.push_back( Message( Request( ++id, "shutdown", JsonValue() ) ) );
+		session.push_back( Message( Request( 0, "exit", JsonValue() ) ) );
+		return session;
+	}
+
+	void PrintTable( std::map<std::string, Latencies> const & methods, double load_ms, std::size_t files, Latencies const & all )
+	{
+		std::printf( "project loaded in %.1f ms, %zu files resident\n\n", load_ms, files );
+		std::printf( "%-30s %7s %10s %10s %10s\n", "method", "count", "p50 us", "p99 us", "max us" );
+		for( auto const & method : methods ){
+			Latencies const & latencies = method.second;
+			std::printf( "%-30s %7zu %10.1f %10.1f %10.1f\n", method.first.c_str(), latencies.micros.size(),
+				latencies.Percentile( 50 ), latencies.Percentile( 99 ), latencies.micros.empty() ? 0.0 : latencies.micros.back() );
+		}
+		std::printf( "%-30s %7zu %10.1f %10.1f %10.1f\n", "all but the load", all.micros.size(), all.Percentile( 50 ),
+			all.Percentile( 99 ), all.micros.empty() ? 0.0 : all.micros.back() );
+	}
+
+	void PrintJson( std::map<std::string, Latencies> const & methods, double load_ms, std::size_t files, Latencies const & all,
+		Project const & project )
+	{
+		std::printf( "{\n  \"files\": %zu,\n  \"lines\": %zu,\n  \"bytes\": %zu,\n  \"load_ms\": %.3f,\n  \"p50_us\": %.2f,\n  \"p99_us\": %.2f,\n"
+			"  \"methods\": [", files, project.lines, project.bytes, load_ms, all.Percentile( 50 ), all.Percentile( 99 ) );
+		bool first = true;
+		for( auto const & method : methods ){
+			Latencies const & latencies = method.second;
+			std::printf( "%s\n    {\"method\": \"%s\", \"count\": %zu, \"p50_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f}",
+				first ? "" : ",", method.first.c_str(), latencies.micros.size(), latencies.Percentile( 50 ), latencies.Percentile( 99 ),
+				latencies.micros.empty() ? 0.0 : latencies.micros.back() );
+			first = false;
+		}
+		std::printf( "\n  ]\n}\n" );
+	}
+}
+
+int main( int argc, char **argv )
+{
+	Options options;
+	if( !ParseOptions( argc, argv, options ) ){
+		std::fprintf( stderr, "usage: mary-lsp-bench [--lines N] [--edits N] [--seed N] [--project DIR] [--write-session FILE] [--json]\n"
+			"       mary-lsp-bench --session FILE [--json]\n" );
+		return 2;
+	}
+
+	Project project{ {}, 0, 0 };
+	std::vector<std::string> session;
+	if( !options.session_path.empty() ){
+		std::FILE * const in = std::fopen( options.session_path.c_str(), "rb" );
+		if( in == nullptr ){
+			std::fprintf( stderr, "cannot read %s\n", options.session_path.c_str() );
+			return 1;
+		}
+		std::string message;
+		while( LanguageServer::ReadMessage( in, message ) ) session.push_back( message );
+		std::fclose( in );
+	} else {
+		if( !GenerateProject( options, project ) ) return 1;
+		session = GenerateSession( options, project );
+		if( !options.write_session.empty() ){
+			std::FILE * const out = std::fopen( options.write_session.c_str(), "wb" );
+			if( out == nullptr ){
+				std::fprintf( stderr, "cannot write %s\n", options.write_session.c_str() );
+				return 1;
+			}
+			for( std::string const & message : session ) LanguageServer::WriteMessage( out, message );
+			std::fclose( out );
+		}
+	}
+
+	std::size_t sent_bytes = 0;
+	LanguageServer::Server server( [&]( std::string const & message ){ sent_bytes += message.size(); } );
+	std::map<std::string, Latencies> methods;
+	Latencies all;
+	double load_ms = 0.0;
+	bool loaded = false;
+	for( std::string const & message : session ){
+		LanguageServer::JsonValue parsed;
+		LanguageServer::JsonValue::Parse( message.data(), message.size(), parsed );
+		std::string const & method = parsed["method"].AsString();
+		auto const start = std::chrono::steady_clock::now();
+		bool const running = server.Handle( message );
+		double const micros = std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count();
+		if( !loaded && method == "textDocument/didOpen" ){
+			load_ms = micros / 1000.0;
+			loaded = true;
+		} else {
+			methods[method].micros.push_back( micros );
+			all.micros.push_back( micros );
+		}
+		if( !running ) break;
+	}
+	for( auto & method : methods ) std::sort( method.second.micros.begin(), method.second.micros.end() );
+	std::sort( all.micros.begin(), all.micros.end() );
+
+	if( options.json ) PrintJson( methods, load_ms, server.FileCount(), all, project );
+	else {
+		if( project.lines != 0 ) std::printf( "project: %zu files, %zu lines, %.1f MB\n", project.paths.size(), project.lines,
+			project.bytes / ( 1024.0 * 1024.0 ) );
+		PrintTable( methods, load_ms, server.FileCount(), all );
+	}
+
+	if( options.session_path.empty() && options.write_session.empty() ){
+		for( std::string const & path : project.paths ) std::remove( path.c_str() );
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+		RemoveDirectoryA( options.project.c_str() );
+#else
+		rmdir( options.project.c_str() );
+#endif
+	}
+	return 0;
+}
@@ -0,0 +1,306 @@
+#include "Json.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace MaryLang
+{
+	namespace LanguageServer
+	{
+		namespace
+		{
+			// Nesting deeper than this is refused, so no message can overflow the stack.
+			unsigned int const max_depth = 256;
+
+			struct Reader
+			{
+				char const *	cursor;
+				char const *	end;
+
+				void SkipSpace()
+				{
+					while( cursor != end && ( *cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r' ) ) ++cursor;
+				}
+
+				bool Literal( char const * word, std::size_t length )
+				{
+					if( static_cast<std::size_t>( end - cursor ) < length || std::memcmp( cursor, word, length ) != 0 ) return false;
+					cursor += length;
+					return true;
+				}
+
+				bool Hex4( std::uint32_t & value )
+				{
+					if( end - cursor < 4 ) return false;
+					value = 0;
+					for( int i = 0; i < 4; ++i, ++cursor ){
+						char const c = *cursor;
+						value <<= 4;
+						if( c >= '0' && c <= '9' ) value |= c - '0';
+						else if( c >= 'a' && c <= 'f' ) value |= c - 'a' + 10;
+						else if( c >= 'A' && c <= 'F' ) value |= c - 'A' + 10;
+						else return false;
+					}
+					return true;
+				}
+
+				// After the opening quote.
+				bool String( std::string & out )
+				{
+					for( ; ; ){
+						char const * run = cursor;
+						while( cursor != end && *cursor != '"' && *cursor != '\\' && static_cast<unsigned char>( *cursor ) >= 0x20 ) ++cursor;
+						out.append( run, cursor );
+						if( cursor == end || static_cast<unsigned char>( *cursor ) < 0x20 ) return false;
+						if( *cursor++ == '"' ) return true;
+						if( cursor == end ) return false;
+						switch( *cursor++ )
+						{
+						case '"':	out += '"'; break;
+						case '\\':	out += '\\'; break;
+						case '/':	out += '/'; break;
+						case 'b':	out += '\b'; break;
+						case 'f':	out += '\f'; break;
+						case 'n':	out += '\n'; break;
+						case 'r':	out += '\r'; break;
+						case 't':	out += '\t'; break;
+						case 'u':
+							{
+								std::uint32_t code_point;
+								if( !Hex4( code_point ) ) return false;
+								if( code_point >= 0xD800 && code_point < 0xDC00 ){ // a surrogate pair
+									std::uint32_t low;
+									if( !Literal( "\\u", 2 ) || !Hex4( low ) || low < 0xDC00 || low >= 0xE000 ) return false;
+									code_point = 0x10000 + ( ( code_point - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+								}
+								AppendUtf8( out, code_point );
+								break;
+							}
+						default:
+							return false;
+						}
+					}
+				}
+
+				bool Value( JsonValue & value, unsigned int depth )
+				{
+					SkipSpace();
+					if( cursor == end || depth > max_depth ) return false;
+					switch( *cursor )
+					{
+					case 'n': value = JsonValue(); return Literal( "null", 4 );
+					case 't': value = JsonValue( true ); return Literal( "true", 4 );
+					case 'f': value = JsonValue( false ); return Literal( "false", 5 );
+					case '"':
+						{
+							++cursor;
+							std::string text;
+							if( !String( text ) ) return false;
+							value = JsonValue( std::move( text ) );
+							return true;
+						}
+					case '[':
+						{
+							++cursor;
+							value = JsonValue::Array();
+							SkipSpace();
+							if( cursor != end && *cursor == ']' ){
+								++cursor;
+								return true;
+							}
+							for( ; ; ){
+								JsonValue element;
+								if( !Value( element, depth + 1 ) ) return false;
+								value.Push( std::move( element ) );
+								SkipSpace();
+								if( cursor == end ) return false;
+								if( *cursor == ']' ){
+									++cursor;
+									return true;
+								}
+								if( *cursor++ != ',' ) return false;
+							}
+						}
+					case '{':
+						{
+							++cursor;
+							value = JsonValue::Object();
+							SkipSpace();
+							if( cursor != end && *cursor == '}' ){
+								++cursor;
+								return true;
+							}
+							for( ; ; ){
+								SkipSpace();
+								std::string key;
+								if( cursor == end || *cursor++ != '"' || !String( key ) ) return false;
+								SkipSpace();
+								if( cursor == end || *cursor++ != ':' ) return false;
+								JsonValue member;
+								if( !Value( member, depth + 1 ) ) return false;
+								value.Set( std::move( key ), std::move( member ) );
+								SkipSpace();
+								if( cursor == end ) return false;
+								if( *cursor == '}' ){
+									++cursor;
+									return true;
+								}
+								if( *cursor++ != ',' ) return false;
+							}
+						}
+					default:
+						{
+							// strtod wants a terminated string; numbers are short
+							char digits[64];
+							std::size_t length = 0;
+							while( cursor + length != end && length + 1 < sizeof( digits ) && std::strchr( "+-.0123456789eE", cursor[length] ) ){
+								digits[length] = cursor[length];
+								++length;
+							}
+							if( length == 0 ) return false;
+							digits[length] = '\0';
+							char * parsed;
+							double const number = std::strtod( digits, &parsed );
+							if( parsed != digits + length ) return false;
+							cursor += length;
+							value = JsonValue( number );
+							return true;
+						}
+					}
+				}
+			};
+
+			void WriteString( std::string & out, std::string const & text )
+			{
+				static char const hex[] = "0123456789abcdef";
+				out += '"';
+				char const * run = text.data();
+				char const * const end = run + text.size();
+				for( char const * c = run; c != end; ++c ){
+					unsigned char const byte = static_cast<unsigned char>( *c );
+					if( byte >= 0x20 && byte != '"' && byte != '\\' ) continue;
+					out.append( run, c );
+					run = c + 1;
+					switch( byte )
+					{
+					case '"':	out += "\\\""; break;
+					case '\\':	out += "\\\\"; break;
+					case '\n':	out += "\\n"; break;
+					case '\r':	out += "\\r"; break;
+					case '\t':	out += "\\t"; break;
+					default:
+						out += "\\u00";
+						out += hex[byte >> 4];
+						out += hex[byte & 0xF];
+					}
+				}
+				out.append( run, end );
+				out += '"';
+			}
+
+			// Lines, columns and ids are whole numbers, and many: no printf for them.
+			void WriteInteger( std::string & out, std::int64_t value )
+			{
+				char digits[24];
+				char * first = digits + sizeof( digits );
+				std::uint64_t magnitude = value < 0 ? 0 - static_cast<std::uint64_t>( value ) : static_cast<std::uint64_t>( value );
+				do {
+					*--first = static_cast<char>( '0' + magnitude % 10 );
+					magnitude /= 10;
+				} while( magnitude != 0 );
+				if( value < 0 ) *--first = '-';
+				out.append( first, digits + sizeof( digits ) );
+			}
+		} // namespace
+
+		void AppendUtf8( std::string & out, std::uint32_t code_point )
+		{
+			if( code_point < 0x80 ){
+				out += static_cast<char>( code_point );
+			} else if( code_point < 0x800 ){
+				out += static_cast<char>( 0xC0 | ( code_point >> 6 ) );
+				out += static_cast<char>( 0x80 | ( code_point & 0x3F ) );
+			} else if( code_point < 0x10000 ){
+				out += static_cast<char>( 0xE0 | ( code_point >> 12 ) );
+				out += static_cast<char>( 0x80 | ( ( code_point >> 6 ) & 0x3F ) );
+				out += static_cast<char>( 0x80 | ( code_point & 0x3F ) );
+			} else {
+				out += static_cast<char>( 0xF0 | ( code_point >> 18 ) );
+				out += static_cast<char>( 0x80 | ( ( code_point >> 12 ) & 0x3F ) );
+				out += static_cast<char>( 0x80 | ( ( code_point >> 6 ) & 0x3F ) );
+				out += static_cast<char>( 0x80 | ( code_point & 0x3F ) );
+			}
+		}
+
+		JsonValue const & JsonValue::operator[]( char const * key ) const
+		{
+			static JsonValue const none;
+			for( std::size_t i = 0; i < keys.size(); ++i ){
+				if( keys[i] == key ) return elements[i];
+			}
+			return none;
+		}
+
+		JsonValue & JsonValue::Set( std::string key, JsonValue value ) &
+		{
+			keys.push_back( std::move( key ) );
+			elements.push_back( std::move( value ) );
+			return *this;
+		}
+
+		JsonValue & JsonValue::Push( JsonValue value ) &
+		{
+			elements.push_back( std::move( value ) );
+			return *this;
+		}
+
+		bool JsonValue::Parse( char const * text, std::size_t size, JsonValue & value )
+		{
+			Reader reader{ text, text + size };
+			if( !reader.Value( value, 0 ) ) return false;
+			reader.SkipSpace();
+			return reader.cursor == reader.end;
+		}
+
+		void JsonValue::Write( std::string & out ) const
+		{
+			switch( type )
+			{
+			case Type::Null:	out += "null"; break;
+			case Type::Boolean:	out += boolean ? "true" : "false"; break;
+			case Type::Number:
+				{
+					if( std::floor( number ) == number && std::fabs( number ) < 9007199254740992.0 ){
+						WriteInteger( out, static_cast<std::int64_t>( number ) );
+					} else {
+						char digits[32];
+						std::snprintf( digits, sizeof( digits ), "%.17g", number );
+						out += digits;
+					}
+					break;
+				}
+			case Type::String:	WriteString( out, string ); break;
+			case Type::Raw:		out += string; break;
+			case Type::Array:
+				out += '[';
+				for( std::size_t i = 0; i < elements.size(); ++i ){
+					if( i != 0 ) out += ',';
+					elements[i].Write( out );
+				}
+				out += ']';
+				break;
+			case Type::Object:
+				out += '{';
+				for( std::size_t i = 0; i < elements.size(); ++i ){
+					if( i != 0 ) out += ',';
+					WriteString( out, keys[i] );
+					out += ':';
+					elements[i].Write( out );
+				}
+				out += '}';
+				break;
+			}
+		}
+	} // namespace LanguageServer
+} // namespace MaryLang
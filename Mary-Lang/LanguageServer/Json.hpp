@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace LanguageServer
+	{
+		// A JSON value, as the language server reads and writes them. An object keeps its
+		// members in order, keys beside values: messages are small, and looking a member up
+		// is a short scan.
+		struct JsonValue
+		{
+			enum class Type: std::uint8_t
+			{
+				Null,
+				Boolean,
+				Number,
+				String,
+				Array,
+				Object,
+				Raw			// JSON text written already; only ever written out
+			};
+
+			JsonValue(): type( Type::Null ), boolean( false ), number( 0.0 ), string(), keys(), elements() {}
+			JsonValue( bool value ): JsonValue() { type = Type::Boolean; boolean = value; }
+			JsonValue( double value ): JsonValue() { type = Type::Number; number = value; }
+			JsonValue( int value ): JsonValue( static_cast<double>( value ) ) {}
+			JsonValue( std::uint32_t value ): JsonValue( static_cast<double>( value ) ) {}
+			JsonValue( std::int64_t value ): JsonValue( static_cast<double>( value ) ) {}
+			JsonValue( std::string value ): JsonValue() { type = Type::String; string = std::move( value ); }
+			JsonValue( char const * value ): JsonValue( std::string( value ) ) {}
+
+			static JsonValue Array() { JsonValue value; value.type = Type::Array; return value; }
+			static JsonValue Object() { JsonValue value; value.type = Type::Object; return value; }
+			// For a result big enough that building it value by value would cost more than
+			// writing it, as a big file's outline.
+			static JsonValue Raw( std::string json ) { JsonValue value( std::move( json ) ); value.type = Type::Raw; return value; }
+
+			inline Type						GetType() const { return type; }
+			inline bool						IsNull() const { return type == Type::Null; }
+			inline bool						IsString() const { return type == Type::String; }
+			inline bool						IsNumber() const { return type == Type::Number; }
+			inline bool						IsObject() const { return type == Type::Object; }
+			inline bool						IsArray() const { return type == Type::Array; }
+			inline bool						AsBoolean() const { return type == Type::Boolean && boolean; }
+			inline double					AsNumber() const { return type == Type::Number ? number : 0.0; }
+			inline std::string const &		AsString() const { return string; }
+			// The elements of an array, or the values of an object's members.
+			inline std::vector<JsonValue> const & Elements() const { return elements; }
+
+			// The member called `key', or null if there is none or this is no object.
+			JsonValue const & operator[]( char const * key ) const;
+			// Adds a member; returns this object, so members can be chained. Chained on a
+			// temporary, the value is moved along rather than copied.
+			JsonValue & Set( std::string key, JsonValue value ) &;
+			JsonValue & Push( JsonValue value ) &;
+			JsonValue && Set( std::string key, JsonValue value ) && { return std::move( Set( std::move( key ), std::move( value ) ) ); }
+			JsonValue && Push( JsonValue value ) && { return std::move( Push( std::move( value ) ) ); }
+
+			// False if `text' is not one JSON value, with nothing but white space around it.
+			static bool Parse( char const * text, std::size_t size, JsonValue & value );
+			// Appends the value as compact JSON.
+			void Write( std::string & out ) const;
+		private:
+			Type						type;
+			bool						boolean;
+			double						number;
+			std::string					string;
+			std::vector<std::string>	keys;		// an object's, one per element
+			std::vector<JsonValue>		elements;
+		};
+
+		// Appends `code_point' encoded as UTF-8.
+		void AppendUtf8( std::string & out, std::uint32_t code_point );
+	} // namespace LanguageServer
+} // namespace MaryLang
@@ -0,0 +1,535 @@
+#include "Server.hpp"
+#include "../Parser/ModuleCache.hpp"
+#include "../Utils/DiagnosticsEngine.hpp"
+#include "../Utils/SourceBuffer.hpp"
+#include "../Utils/TimeTrace.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <future>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+namespace MaryLang
+{
+	namespace LanguageServer
+	{
+		using Lexer::Token;
+		using Lexer::TokenType;
+
+		namespace
+		{
+			// Error codes of JSON-RPC and of the protocol.
+			int const parse_error			= -32700;
+			int const invalid_request		= -32600;
+			int const method_not_found		= -32601;
+			int const internal_error		= -32603;
+			int const not_initialized		= -32002;
+
+			// Editors show no more than this many of a file's problems anyway.
+			std::size_t const max_diagnostics = 1000;
+
+			// UTF-16 code units of the character a UTF-8 sequence starting with `lead' encodes,
+			// and how many bytes that sequence has.
+			inline unsigned int Utf16Units( unsigned char lead, unsigned int & bytes )
+			{
+				if( lead < 0x80 ){ bytes = 1; return 1; }
+				if( lead < 0xE0 ){ bytes = 2; return 1; }
+				if( lead < 0xF0 ){ bytes = 3; return 1; }
+				bytes = 4;
+				return 2;
+			}
+
+			// The offset of a protocol position, a line and a column in UTF-16 code units;
+			// past the end of the line or the file, the end of it.
+			std::uint32_t OffsetAt( Support::SourceManager const & source, JsonValue const & position )
+			{
+				double const line = position["line"].AsNumber();
+				double const character = position["character"].AsNumber();
+				if( line < 0 || line >= source.LineCount() ) return source.Size();
+				std::uint32_t offset = source.LineOffset( static_cast<std::uint32_t>( line ) + 1 );
+				std::uint32_t const end = source.LineOffset( static_cast<std::uint32_t>( line ) + 2 );
+				double units = 0;
+				while( offset < end && units < character && source.Data()[offset] != '\n' ){
+					unsigned int bytes;
+					units += Utf16Units( static_cast<unsigned char>( source.Data()[offset] ), bytes );
+					offset = std::min( offset + bytes, end );
+				}
+				return offset;
+			}
+
+			// The protocol's line and column of `offset', from 0.
+			void Locate( Support::SourceManager const & source, std::uint32_t offset, std::uint32_t & line, std::uint32_t & character )
+			{
+				offset = std::min( offset, source.Size() );
+				Support::Position const position = source.GetPosition( offset );
+				line = position._line_number - 1;
+				character = 0;
+				for( std::uint32_t i = source.LineOffset( position._line_number ); i < offset; ){
+					unsigned int bytes;
+					character += Utf16Units( static_cast<unsigned char>( source.Data()[i] ), bytes );
+					i += bytes;
+				}
+			}
+
+			JsonValue PositionAt( Support::SourceManager const & source, std::uint32_t offset )
+			{
+				std::uint32_t line, character;
+				Locate( source, offset, line, character );
+				return JsonValue::Object().Set( "line", line ).Set( "character", character );
+			}
+
+			JsonValue Range( Support::SourceManager const & source, std::uint32_t begin, std::uint32_t end )
+			{
+				return JsonValue::Object().Set( "start", PositionAt( source, begin ) ).Set( "end", PositionAt( source, end ) );
+			}
+
+			// The same as Range( source, begin, end ).Write( out ), without building it first.
+			void WriteRange( std::string & out, Support::SourceManager const & source, std::uint32_t begin, std::uint32_t end )
+			{
+				std::uint32_t line, character;
+				Locate( source, begin, line, character );
+				out += "{\"start\":{\"line\":";
+				JsonValue( line ).Write( out );
+				out += ",\"character\":";
+				JsonValue( character ).Write( out );
+				Locate( source, end, line, character );
+				out += "},\"end\":{\"line\":";
+				JsonValue( line ).Write( out );
+				out += ",\"character\":";
+				JsonValue( character ).Write( out );
+				out += "}}";
+			}
+
+			std::string ToUtf8( std::wstring const & text )
+			{
+				std::string out;
+				for( wchar_t const c : text ) AppendUtf8( out, static_cast<std::uint32_t>( c ) );
+				return out;
+			}
+
+			// What the server files a document under: its path, normalized, if it has one.
+			std::string Key( std::string const & uri )
+			{
+				std::string const path = UriToPath( uri );
+				return path.empty() ? uri : Parser::ModuleCache::ResolvePath( path );
+			}
+		} // namespace
+
+		std::string UriToPath( std::string const & uri )
+		{
+			if( uri.compare( 0, 7, "file://" ) != 0 ) return std::string();
+			std::string path;
+			for( std::size_t i = 7; i < uri.size(); ++i ){
+				char const c = uri[i];
+				if( c == '%' && i + 2 < uri.size() && std::isxdigit( static_cast<unsigned char>( uri[i + 1] ) )
+					&& std::isxdigit( static_cast<unsigned char>( uri[i + 2] ) ) ){
+					path += static_cast<char>( std::stoi( uri.substr( i + 1, 2 ), nullptr, 16 ) );
+					i += 2;
+				} else {
+					path += c;
+				}
+			}
+#if defined( _WIN32 )
+			// file:///C:/dir, not /C:/dir
+			if( path.size() > 2 && path[0] == '/' && path[2] == ':' ) path.erase( 0, 1 );
+#endif
+			return path;
+		}
+
+		std::string PathToUri( std::string const & path )
+		{
+			static char const hex[] = "0123456789ABCDEF";
+			std::string uri = "file://";
+			if( path.empty() || ( path[0] != '/' && path[0] != '\\' ) ) uri += '/';
+			for( char const c : path ){
+				unsigned char const byte = static_cast<unsigned char>( c );
+				if( std::isalnum( byte ) || c == '/' || c == '-' || c == '.' || c == '_' || c == '~' || c == ':' ){
+					uri += c;
+				} else if( c == '\\' ){
+					uri += '/';
+				} else {
+					uri += '%';
+					uri += hex[byte >> 4];
+					uri += hex[byte & 0xF];
+				}
+			}
+			return uri;
+		}
+
+		bool ReadMessage( std::FILE * in, std::string & message, std::string * raw )
+		{
+			// the headers, a line each, up to an empty one
+			std::size_t length = 0;
+			bool has_length = false;
+			std::string header;
+			for( ; ; ){
+				int const c = std::getc( in );
+				if( c == EOF ) return false;
+				if( raw != nullptr ) *raw += static_cast<char>( c );
+				if( c != '\n' ){
+					header += static_cast<char>( c );
+					continue;
+				}
+				if( !header.empty() && header.back() == '\r' ) header.pop_back();
+				if( header.empty() ) break;
+				std::size_t const colon = header.find( ':' );
+				if( colon != std::string::npos && colon == 14 && std::equal( header.begin(), header.begin() + 14, "content-length",
+					[]( char a, char b ){ return std::tolower( static_cast<unsigned char>( a ) ) == b; } ) ){
+					length = static_cast<std::size_t>( std::strtoull( header.c_str() + colon + 1, nullptr, 10 ) );
+					has_length = true;
+				}
+				header.clear();
+			}
+			if( !has_length ) return false;
+			message.resize( length );
+			if( length != 0 && std::fread( &message[0], 1, length, in ) != length ) return false;
+			if( raw != nullptr ) *raw += message;
+			return true;
+		}
+
+		void WriteMessage( std::FILE * out, std::string const & message )
+		{
+			std::fprintf( out, "Content-Length: %zu\r\n\r\n", message.size() );
+			std::fwrite( message.data(), 1, message.size(), out );
+			std::fflush( out );
+		}
+
+		Server::Server( Send send, unsigned int jobs )
+			: send( std::move( send ) ), pool( jobs ), files(), initialized( false ), shut_down( false )
+		{
+		}
+
+		bool Server::Handle( std::string const & message )
+		{
+			JsonValue request;
+			if( !JsonValue::Parse( message.data(), message.size(), request ) || !request.IsObject() ){
+				Fail( JsonValue(), parse_error, "the message is no JSON object" );
+				return true;
+			}
+			std::string const & method = request["method"].AsString();
+			JsonValue const & id = request["id"];
+			JsonValue const & params = request["params"];
+			bool const is_request = !id.IsNull();
+			if( method == "exit" ) return false;
+			if( method.empty() ) return true; // a response; the server asks nothing, though
+			if( !initialized && method != "initialize" ){
+				if( is_request ) Fail( id, not_initialized, "initialize first" );
+				return true;
+			}
+			if( shut_down && is_request ){
+				Fail( id, invalid_request, "the server is shut down" );
+				return true;
+			}
+			Support::TimeScope const scope( "LSP", method );
+			try {
+				if( method == "initialize" ){
+					initialized = true;
+					Respond( id, Initialize() );
+				} else if( method == "shutdown" ){
+					shut_down = true;
+					Respond( id, JsonValue() );
+				} else if( method == "textDocument/didOpen" ){
+					DidOpen( params );
+				} else if( method == "textDocument/didChange" ){
+					DidChange( params );
+				} else if( method == "textDocument/didClose" ){
+					DidClose( params );
+				} else if( method == "textDocument/documentSymbol" ){
+					Respond( id, DocumentSymbols( params ) );
+				} else if( method == "textDocument/definition" ){
+					Respond( id, Definition( params ) );
+				} else if( is_request ){
+					Fail( id, method_not_found, "unknown method" );
+				} // other notifications, $/cancelRequest among them, need nothing done
+			} catch( std::exception const & error ) {
+				if( is_request ) Fail( id, internal_error, error.what() );
+			}
+			return true;
+		}
+
+		void Server::Respond( JsonValue const & id, JsonValue result )
+		{
+			std::string out;
+			JsonValue::Object().Set( "jsonrpc", "2.0" ).Set( "id", id ).Set( "result", std::move( result ) ).Write( out );
+			send( out );
+		}
+
+		void Server::Fail( JsonValue const & id, int code, char const * message )
+		{
+			std::string out;
+			JsonValue::Object().Set( "jsonrpc", "2.0" ).Set( "id", id )
+				.Set( "error", JsonValue::Object().Set( "code", code ).Set( "message", message ) ).Write( out );
+			send( out );
+		}
+
+		void Server::Notify( char const * method, JsonValue params )
+		{
+			std::string out;
+			JsonValue::Object().Set( "jsonrpc", "2.0" ).Set( "method", method ).Set( "params", std::move( params ) ).Write( out );
+			send( out );
+		}
+
+		JsonValue Server::Initialize()
+		{
+			JsonValue capabilities = JsonValue::Object();
+			capabilities.Set( "positionEncoding", "utf-16" );
+			capabilities.Set( "textDocumentSync", JsonValue::Object().Set( "openClose", true ).Set( "change", 2 ) ); // incremental
+			capabilities.Set( "documentSymbolProvider", true );
+			capabilities.Set( "definitionProvider", true );
+			return JsonValue::Object().Set( "capabilities", std::move( capabilities ) )
+				.Set( "serverInfo", JsonValue::Object().Set( "name", "mary-lsp" ) );
+		}
+
+		std::unique_ptr<Server::File> Server::ReadFile( std::string const & path )
+		{
+			Support::SourceBuffer buffer;
+			if( !buffer.Open( path.c_str() ) ) return nullptr;
+			std::unique_ptr<File> file( new File );
+			try {
+				file->document.reset( new Parser::Document( path, std::string( buffer.Data(), buffer.Size() ) ) );
+			} catch( std::length_error const & ) {
+				return nullptr;
+			}
+			file->index.Update( *file->document );
+			file->uri = PathToUri( path );
+			file->version = 0;
+			file->open = false;
+			ResolveImports( *file );
+			return file;
+		}
+
+		void Server::ResolveImports( File & file )
+		{
+			Support::SourceManager const & source = file.document->Source();
+			file.imports.clear();
+			for( AbstractSyntaxTree::Imports const * import : file.document->SourceImports() ){
+				Token const & path = import->Path();
+				if( path.Type() != TokenType::TK_STRLITERAL || path.Length() < 2 ) continue;
+				std::string const spelling = source.Text( path.Offset() + 1, path.Length() - 2 ).Str();
+				file.imports.emplace_back( Parser::ModuleCache::ResolvePath( spelling, source.FileName() ), import->Keyword().Offset() );
+			}
+		}
+
+		void Server::LoadImports( File & file )
+		{
+			ResolveImports( file );
+			std::unordered_set<std::string> seen;
+			std::vector<std::string> level;
+			for( auto const & import : file.imports ){
+				if( files.find( import.first ) == files.end() && seen.insert( import.first ).second ) level.push_back( import.first );
+			}
+			while( !level.empty() ){
+				std::vector<std::future<std::unique_ptr<File>>> loading;
+				for( std::string const & path : level ){
+					loading.push_back( pool.Submit( [path]{ return ReadFile( path ); } ) );
+				}
+				std::vector<std::string> next;
+				for( std::size_t i = 0; i < level.size(); ++i ){
+					std::unique_ptr<File> loaded = loading[i].get();
+					if( !loaded ) continue; // reported by the files importing it
+					for( auto const & import : loaded->imports ){
+						if( files.find( import.first ) == files.end() && seen.insert( import.first ).second ) next.push_back( import.first );
+					}
+					files.emplace( level[i], std::move( loaded ) );
+				}
+				level.swap( next );
+			}
+		}
+
+		Server::File * Server::Find( JsonValue const & text_document )
+		{
+			auto const found = files.find( Key( text_document["uri"].AsString() ) );
+			return found != files.end() ? found->second.get() : nullptr;
+		}
+
+		void Server::DidOpen( JsonValue const & params )
+		{
+			JsonValue const & text_document = params["textDocument"];
+			std::string const & uri = text_document["uri"].AsString();
+			std::string const key = Key( uri );
+			std::unique_ptr<File> & file = files[key];
+			if( !file ) file.reset( new File );
+			// what the editor has may differ from what is on disk
+			file->document.reset( new Parser::Document( key, text_document["text"].AsString() ) );
+			file->index = SymbolIndex();
+			file->index.Update( *file->document );
+			file->uri = uri;
+			file->version = static_cast<std::int64_t>( text_document["version"].AsNumber() );
+			file->open = true;
+			LoadImports( *file );
+			PublishDiagnostics( *file );
+		}
+
+		void Server::DidChange( JsonValue const & params )
+		{
+			File * const file = Find( params["textDocument"] );
+			if( file == nullptr ) return;
+			Parser::Document & document = *file->document;
+			for( JsonValue const & change : params["contentChanges"].Elements() ){
+				std::string const & text = change["text"].AsString();
+				JsonValue const & range = change["range"];
+				if( range.IsNull() ){ // the whole text
+					document.Edit( Parser::TextEdit{ 0, document.Source().Size(), text } );
+					continue;
+				}
+				std::uint32_t begin = OffsetAt( document.Source(), range["start"] );
+				std::uint32_t end = OffsetAt( document.Source(), range["end"] );
+				if( end < begin ) std::swap( begin, end );
+				document.Edit( Parser::TextEdit{ begin, end - begin, text } );
+			}
+			file->version = static_cast<std::int64_t>( params["textDocument"]["version"].AsNumber() );
+			file->index.Update( document );
+			LoadImports( *file );
+			PublishDiagnostics( *file );
+		}
+
+		void Server::DidClose( JsonValue const & params )
+		{
+			auto const found = files.find( Key( params["textDocument"]["uri"].AsString() ) );
+			if( found == files.end() ) return;
+			std::unique_ptr<File> & file = found->second;
+			file->open = false;
+			file->version = 0;
+			PublishDiagnostics( *file ); // none, now that it is closed
+			// back to what is on disk, for the files importing it
+			std::string const uri = file->uri;
+			std::unique_ptr<File> on_disk = ReadFile( found->first );
+			if( !on_disk ){
+				files.erase( found );
+				return;
+			}
+			on_disk->uri = uri;
+			file = std::move( on_disk );
+		}
+
+		void Server::PublishDiagnostics( File const & file )
+		{
+			JsonValue diagnostics = JsonValue::Array();
+			Parser::Document const & document = *file.document;
+			Support::SourceManager const & source = document.Source();
+			if( file.open ){
+				Support::Diagnostic all = document.LexerDiagnostics();
+				all.Append( document.Diagnostics() );
+				for( auto const & import : file.imports ){
+					if( files.find( import.first ) == files.end() ) all.Report( Support::DiagID::ModuleNotFound, import.second );
+				}
+				all.SortByOffset();
+				std::vector<Token> const & tokens = document.Tokens();
+				std::size_t count = 0;
+				if( !document.Failure().empty() ){
+					diagnostics.Push( JsonValue::Object().Set( "range", Range( source, 0, 0 ) ).Set( "severity", 1 )
+						.Set( "source", "mary" ).Set( "message", document.Failure() ) );
+					++count;
+				}
+				for( Support::DiagRecord const & record : all ){
+					if( count++ == max_diagnostics ) break;
+					// the token reported, if one begins there
+					std::uint32_t end = record.offset;
+					auto const token = std::partition_point( tokens.begin(), tokens.end(), [&]( Token const & token ){
+						return token.Offset() < record.offset;
+					} );
+					if( token != tokens.end() && token->Offset() == record.offset ) end += token->Length();
+					int const severity = record.kind == Support::DiagKind::Error ? 1 : record.kind == Support::DiagKind::Warning ? 2 : 3;
+					diagnostics.Push( JsonValue::Object().Set( "range", Range( source, record.offset, end ) ).Set( "severity", severity )
+						.Set( "code", ToUtf8( Support::DiagnosticsEngine::Name( record.id ) ) ).Set( "source", "mary" )
+						.Set( "message", ToUtf8( Support::DiagnosticsEngine::Message( record.id, record.argument ) ) ) );
+				}
+			}
+			JsonValue params = JsonValue::Object().Set( "uri", file.uri );
+			if( file.open ) params.Set( "version", file.version );
+			Notify( "textDocument/publishDiagnostics", std::move( params.Set( "diagnostics", std::move( diagnostics ) ) ) );
+		}
+
+		JsonValue Server::DocumentSymbols( JsonValue const & params )
+		{
+			File const * const file = Find( params["textDocument"] );
+			if( file == nullptr ) return JsonValue();
+			Support::SourceManager const & source = file->document->Source();
+			std::vector<DeclaredName> const & names = file->index.Names();
+
+			// A big file has thousands of names, so the outline is written as it goes rather
+			// than built first. Every name comes right after its parent or a sibling of its,
+			// or a child of one, so the open objects are the name's parent and its ancestors;
+			// locals are left out.
+			std::string out = "[";
+			std::vector<std::pair<std::uint32_t, bool>> open; // names whose objects are open; with children yet?
+			for( std::uint32_t i = 0; i < names.size(); ++i ){
+				DeclaredName const & name = names[i];
+				if( name.local ) continue;
+				while( !open.empty() && open.back().first != name.parent ){
+					out += open.back().second ? "]}" : "}";
+					open.pop_back();
+				}
+				if( !open.empty() ){
+					out += open.back().second ? "," : ",\"children\":[";
+					open.back().second = true;
+				} else if( out.size() != 1 ){
+					out += ',';
+				}
+				std::uint32_t const name_end = name.name_offset + name.name_length;
+				out += "{\"name\":";
+				JsonValue( source.Text( name.name_offset, name.name_length ).Str() ).Write( out );
+				out += ",\"kind\":";
+				JsonValue( static_cast<int>( name.kind ) ).Write( out );
+				out += ",\"range\":";
+				WriteRange( out, source, name.begin, std::max( name.end, name_end ) );
+				out += ",\"selectionRange\":";
+				WriteRange( out, source, name.name_offset, name_end );
+				open.emplace_back( i, false );
+			}
+			for( ; !open.empty(); open.pop_back() ) out += open.back().second ? "]}" : "}";
+			out += ']';
+			return JsonValue::Raw( std::move( out ) );
+		}
+
+		JsonValue Server::Definition( JsonValue const & params )
+		{
+			File const * const file = Find( params["textDocument"] );
+			if( file == nullptr ) return JsonValue();
+			Parser::Document const & document = *file->document;
+			std::uint32_t const offset = OffsetAt( document.Source(), params["position"] );
+
+			// the identifier the position is in, or just after
+			std::vector<Token> const & tokens = document.Tokens();
+			std::size_t i = std::partition_point( tokens.begin(), tokens.end(), [&]( Token const & token ){
+				return token.Offset() + token.Length() < offset;
+			} ) - tokens.begin();
+			if( i < tokens.size() && tokens[i].Type() != TokenType::TK_IDENTIFIER ) ++i;
+			if( i >= tokens.size() || tokens[i].Type() != TokenType::TK_IDENTIFIER || tokens[i].Offset() > offset ) return JsonValue();
+			Support::Symbol const name = tokens[i].Symbol();
+			bool const member = i != 0 && tokens[i - 1].Type() == TokenType::TK_DOT;
+
+			// A local in scope first, then what the file declares, then what it imports, nearest
+			// first, then whatever any resident file declares.
+			File const * in = file;
+			DeclaredName const * found = member ? nullptr : file->index.FindLocal( name, tokens[i].Offset() );
+			if( found == nullptr ) found = file->index.FindGlobal( name, member );
+			std::unordered_set<File const *> seen{ file };
+			std::vector<File const *> level{ file };
+			while( found == nullptr && !level.empty() ){
+				std::vector<File const *> next;
+				for( File const * importer : level ){
+					for( auto const & import : importer->imports ){
+						auto const imported = files.find( import.first );
+						if( imported == files.end() || !seen.insert( imported->second.get() ).second ) continue;
+						next.push_back( imported->second.get() );
+						if( found == nullptr && ( found = imported->second->index.FindGlobal( name, member ) ) != nullptr ){
+							in = imported->second.get();
+						}
+					}
+				}
+				level.swap( next );
+			}
+			for( auto const & resident : files ){
+				if( found != nullptr ) break;
+				if( seen.count( resident.second.get() ) != 0 ) continue;
+				if( ( found = resident.second->index.FindGlobal( name, member ) ) != nullptr ) in = resident.second.get();
+			}
+			if( found == nullptr ) return JsonValue();
+			return JsonValue::Object().Set( "uri", in->uri )
+				.Set( "range", Range( in->document->Source(), found->name_offset, found->name_offset + found->name_length ) );
+		}
+	} // namespace LanguageServer
+} // namespace MaryLang
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Json.hpp"
+#include "SymbolIndex.hpp"
+#include "../Parser/Document.hpp"
+#include "../Utils/ThreadPool.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace LanguageServer
+	{
+		// A language server over the front end, one message at a time. Every file it has seen
+		// stays resident: its Document, tokens and symbols, the interned names they share, all
+		// kept up to date edit by edit, so no request lexes or parses more than an edit touched.
+		// The files the editor opens are loaded with everything they import, transitively;
+		// imported files nobody opens are read from disk once.
+		//
+		// It answers initialize, shutdown and exit; textDocument/didOpen, didChange and
+		// didClose, publishing the diagnostics of a file after each; textDocument/documentSymbol
+		// and textDocument/definition. Positions count UTF-16 code units, as the protocol has it.
+		struct Server
+		{
+			typedef std::function<void( std::string const & )> Send;
+
+			// `send' is given every message the server sends, unframed. `jobs' threads load
+			// imported files; zero means one per hardware thread.
+			Server( Send send, unsigned int jobs = 0 );
+
+			Server( Server const & ) = delete;
+			Server & operator=( Server const & ) = delete;
+
+			// Handles one message, unframed; false once it was `exit'.
+			bool Handle( std::string const & message );
+			// What the process should exit with after `exit': 0 if shutdown came first.
+			inline int ExitCode() const { return shut_down ? 0 : 1; }
+			// How many files are resident, those open and those they import.
+			inline std::size_t FileCount() const { return files.size(); }
+		private:
+			struct File
+			{
+				std::unique_ptr<Parser::Document>	document;
+				SymbolIndex							index;
+				std::string							uri;
+				std::int64_t						version;
+				bool								open;
+				// the paths the file imports, resolved, beside where each import is
+				std::vector<std::pair<std::string, std::uint32_t>> imports;
+			};
+
+			void Respond( JsonValue const & id, JsonValue result );
+			void Fail( JsonValue const & id, int code, char const * message );
+			void Notify( char const * method, JsonValue params );
+
+			JsonValue Initialize();
+			void DidOpen( JsonValue const & params );
+			void DidChange( JsonValue const & params );
+			void DidClose( JsonValue const & params );
+			JsonValue DocumentSymbols( JsonValue const & params );
+			JsonValue Definition( JsonValue const & params );
+
+			// Null if the file cannot be read.
+			static std::unique_ptr<File> ReadFile( std::string const & path );
+			static void ResolveImports( File & file );
+			File * Find( JsonValue const & text_document );
+			// Brings `file's imports up to date and loads whichever of them, and of theirs, are
+			// not resident yet; those on the same level of the import graph at once, on the pool.
+			void LoadImports( File & file );
+			void PublishDiagnostics( File const & file );
+
+			Send					send;
+			Support::ThreadPool		pool;
+			std::unordered_map<std::string, std::unique_ptr<File>> files; // by resolved path
+			bool					initialized;
+			bool					shut_down;
+		};
+
+		// `uri' as a path, if it is a file URI; empty if not.
+		std::string UriToPath( std::string const & uri );
+		std::string PathToUri( std::string const & path );
+
+		// Reads a message framed with a Content-Length header; false at the end of `in' or on
+		// a broken frame. The frame as it came, headers and all, is appended to `raw' if given.
+		bool ReadMessage( std::FILE * in, std::string & message, std::string * raw = nullptr );
+		void WriteMessage( std::FILE * out, std::string const & message );
+	} // namespace LanguageServer
+} // namespace MaryLang
@@ -0,0 +1,268 @@
+#include "SymbolIndex.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace MaryLang
+{
+	namespace LanguageServer
+	{
+		using namespace AbstractSyntaxTree;
+		using Lexer::TokenType;
+
+		namespace
+		{
+			inline bool IsContainer( SymbolKind kind )
+			{
+				return kind == SymbolKind::Namespace || kind == SymbolKind::Class || kind == SymbolKind::Enum
+					|| kind == SymbolKind::Function || kind == SymbolKind::Method || kind == SymbolKind::Constructor;
+			}
+
+			// The first token at or past `offset'.
+			inline std::size_t FindToken( std::vector<Token> const & tokens, std::uint32_t offset )
+			{
+				return std::partition_point( tokens.begin(), tokens.end(), [&]( Token const & token ){
+					return token.Offset() < offset;
+				} ) - tokens.begin();
+			}
+
+			// Walks a statement's FlatTree for the names it declares. Expressions declare none
+			// and are not entered.
+			struct Collector
+			{
+				FlatTree const &				tree;
+				std::vector<Token> const &		tokens;		// the document's, at current offsets
+				std::int64_t					shift;		// from offsets in `tree' to those
+				std::vector<DeclaredName> &		names;
+				std::vector<bool> &				waits_for_brace; // per name: ends with the next block, not the current
+				std::vector<std::uint32_t>		containers;	// those being walked, no_parent for a nameless one
+				std::vector<SymbolKind>			container_kinds;
+				unsigned int					functions;	// being walked
+
+				// The token the node at `offset' of `tree' begins with.
+				Token const * TokenAt( std::uint32_t offset ) const
+				{
+					std::uint32_t const current = static_cast<std::uint32_t>( offset + shift );
+					std::size_t const i = FindToken( tokens, current );
+					return i < tokens.size() && tokens[i].Offset() == current ? &tokens[i] : nullptr;
+				}
+
+				Token const * NameChild( NodeIndex node, std::uint32_t i ) const
+				{
+					FlatTree::Children const children = tree.ChildrenOf( node );
+					if( i >= children.Size() || children[i] == NoNode || tree.Kind( children[i] ) != NodeKind::Token ) return nullptr;
+					Token const & name = tree.GetToken( children[i] );
+					return name.Type() == TokenType::TK_IDENTIFIER ? &name : nullptr;
+				}
+
+				bool InClass() const
+				{
+					return !container_kinds.empty() && container_kinds.back() == SymbolKind::Class;
+				}
+
+				std::uint32_t Add( std::uint32_t offset, std::uint32_t length, Support::Symbol symbol, std::uint32_t begin,
+					SymbolKind kind, bool local, bool wait )
+				{
+					std::uint32_t const parent = containers.empty() ? DeclaredName::no_parent : containers.back();
+					names.push_back( DeclaredName{ symbol, offset, length, begin, offset + length, offset + length, parent, kind, local } );
+					waits_for_brace.push_back( wait );
+					return static_cast<std::uint32_t>( names.size() - 1 );
+				}
+
+				void Open( NodeIndex node, Token const * name, SymbolKind kind )
+				{
+					std::uint32_t index = DeclaredName::no_parent;
+					if( name != nullptr ){
+						index = Add( name->Offset(), name->Length(), name->Symbol(), tree.Offset( node ), kind, functions != 0, true );
+					}
+					containers.push_back( index );
+					container_kinds.push_back( kind );
+				}
+
+				bool Enter( NodeIndex node )
+				{
+					switch( tree.Kind( node ) )
+					{
+					case NodeKind::FunctionDeclaration:
+						{
+							Token const * const keyword = TokenAt( tree.Offset( node ) );
+							SymbolKind const kind = keyword != nullptr && keyword->Type() == TokenType::TK_CONSTRUCT ? SymbolKind::Constructor
+								: InClass() ? SymbolKind::Method : SymbolKind::Function;
+							Open( node, NameChild( node, 1 ), kind );
+							++functions;
+							return true;
+						}
+					case NodeKind::ClassDeclaration:
+						Open( node, NameChild( node, 0 ), SymbolKind::Class );
+						return true;
+					case NodeKind::EnumDeclaration:
+						Open( node, NameChild( node, 0 ), SymbolKind::Enum );
+						return true;
+					case NodeKind::NamespaceDeclaration:
+						Open( node, NameChild( node, 0 ), SymbolKind::Namespace );
+						return true;
+					case NodeKind::Enumerator:
+						// the node begins with its name, which is no child of its own
+						if( Token const * const name = TokenAt( tree.Offset( node ) ) ){
+							if( name->Type() == TokenType::TK_IDENTIFIER ){
+								Add( tree.Offset( node ), name->Length(), name->Symbol(), tree.Offset( node ),
+									SymbolKind::EnumMember, functions != 0, false );
+							}
+						}
+						return false;
+					case NodeKind::VariableDeclarator:
+						if( Token const * const name = NameChild( node, 0 ) ){
+							Add( name->Offset(), name->Length(), name->Symbol(), tree.Offset( node ),
+								InClass() ? SymbolKind::Field : SymbolKind::Variable, functions != 0, false );
+						}
+						return false;
+					case NodeKind::ParameterDeclaration:
+						// in scope in the body, the block after it
+						if( Token const * const name = NameChild( node, 0 ) ){
+							Add( name->Offset(), name->Length(), name->Symbol(), tree.Offset( node ), SymbolKind::Variable, true, true );
+						}
+						return false;
+					default:
+						return tree.Kind( node ) < NodeKind::Variable && tree.Kind( node ) != NodeKind::Token;
+					}
+				}
+
+				void Leave( NodeIndex node )
+				{
+					switch( tree.Kind( node ) )
+					{
+					case NodeKind::FunctionDeclaration:
+						--functions;
+						// fall through
+					case NodeKind::ClassDeclaration:
+					case NodeKind::EnumDeclaration:
+					case NodeKind::NamespaceDeclaration:
+						containers.pop_back();
+						container_kinds.pop_back();
+						break;
+					default:
+						break;
+					}
+				}
+			};
+		} // namespace
+
+		SymbolIndex::SymbolIndex(): entries(), names()
+		{
+		}
+
+		void SymbolIndex::Collect( Parser::Document const & document, std::size_t segment, Entry & entry )
+		{
+			Parser::Document::Segment const & at = document.Segments()[segment];
+			FlatTree const * const tree = at.program->FlatTree();
+			if( tree == nullptr ) return;
+			std::int64_t const shift = at.Shift();
+			std::vector<Token> const & tokens = document.Tokens();
+			std::vector<bool> waits_for_brace;
+			Collector collector{ *tree, tokens, shift, entry.names, waits_for_brace, {}, {}, 0 };
+			tree->Walk( at.statement->FlatIndex(), collector );
+			if( entry.names.empty() ) return;
+
+			// Where the declarations end, matching braces over the statement's tokens: a class,
+			// enum, namespace or function ends with the block after its name, as does the scope
+			// of a parameter, and a local's scope with the block it is declared in.
+			std::vector<DeclaredName> & names = entry.names;
+			std::vector<std::uint32_t> order( names.size() );
+			for( std::uint32_t i = 0; i < order.size(); ++i ) order[i] = i;
+			std::stable_sort( order.begin(), order.end(), [&]( std::uint32_t a, std::uint32_t b ){
+				return names[a].name_offset < names[b].name_offset;
+			} );
+			auto const close = [&]( std::uint32_t index, std::uint32_t end ){
+				if( IsContainer( names[index].kind ) ) names[index].end = end;
+				else names[index].scope_end = end;
+			};
+			std::size_t const first = FindToken( tokens, at.begin );
+			std::size_t const last = segment + 1 < document.Segments().size()
+				? FindToken( tokens, document.Segments()[segment + 1].begin ) : tokens.size();
+			std::vector<std::vector<std::uint32_t>> blocks; // per open brace, the names it ends
+			std::vector<std::uint32_t> next_block;
+			std::size_t next = 0;
+			std::uint32_t end = at.parsed_begin;
+			for( std::size_t i = first; i < last; ++i ){
+				std::uint32_t const offset = static_cast<std::uint32_t>( tokens[i].Offset() - shift );
+				while( next < order.size() && names[order[next]].name_offset < offset ){
+					std::uint32_t const index = order[next++];
+					if( waits_for_brace[index] ) next_block.push_back( index );
+					else if( names[index].local && !blocks.empty() ) blocks.back().push_back( index );
+				}
+				end = offset + tokens[i].Length();
+				if( tokens[i].Type() == TokenType::TK_LBRACE ){
+					blocks.emplace_back();
+					blocks.back().swap( next_block );
+				} else if( tokens[i].Type() == TokenType::TK_RBRACE && !blocks.empty() ){
+					for( std::uint32_t const index : blocks.back() ) close( index, end );
+					blocks.pop_back();
+				}
+			}
+			for( std::vector<std::uint32_t> const & open : blocks ){ // left open at the end of the file
+				for( std::uint32_t const index : open ) close( index, end );
+			}
+		}
+
+		void SymbolIndex::Update( Parser::Document const & document )
+		{
+			// Reused segments keep their order, so the ones the last edit left alone are a run
+			// at the start and one at the end; what lies between is new.
+			std::vector<Parser::Document::Segment> const & segments = document.Segments();
+			std::size_t prefix = 0;
+			while( prefix < entries.size() && prefix < segments.size() && entries[prefix].statement == segments[prefix].statement ){
+				++prefix;
+			}
+			std::size_t suffix = 0;
+			while( suffix < entries.size() - prefix && suffix < segments.size() - prefix
+				&& entries[entries.size() - 1 - suffix].statement == segments[segments.size() - 1 - suffix].statement ){
+				++suffix;
+			}
+			std::vector<Entry> fresh( segments.size() - prefix - suffix );
+			for( std::size_t i = 0; i < fresh.size(); ++i ){
+				fresh[i].program = segments[prefix + i].program;
+				fresh[i].statement = segments[prefix + i].statement;
+				Collect( document, prefix + i, fresh[i] );
+			}
+			entries.erase( entries.begin() + prefix, entries.end() - suffix );
+			entries.insert( entries.begin() + prefix, std::make_move_iterator( fresh.begin() ), std::make_move_iterator( fresh.end() ) );
+
+			names.clear();
+			for( std::size_t i = 0; i < entries.size(); ++i ){
+				std::int64_t const shift = segments[i].Shift();
+				std::uint32_t const base = static_cast<std::uint32_t>( names.size() );
+				for( DeclaredName name : entries[i].names ){
+					name.name_offset = static_cast<std::uint32_t>( name.name_offset + shift );
+					name.begin = static_cast<std::uint32_t>( name.begin + shift );
+					name.end = static_cast<std::uint32_t>( name.end + shift );
+					name.scope_end = static_cast<std::uint32_t>( name.scope_end + shift );
+					if( name.parent != DeclaredName::no_parent ) name.parent += base;
+					names.push_back( name );
+				}
+			}
+		}
+
+		DeclaredName const * SymbolIndex::FindLocal( Support::Symbol name, std::uint32_t offset ) const
+		{
+			DeclaredName const * nearest = nullptr;
+			for( DeclaredName const & declared : names ){
+				if( declared.name != name || !declared.local || declared.name_offset > offset || offset >= declared.scope_end ) continue;
+				if( nearest == nullptr || declared.name_offset > nearest->name_offset ) nearest = &declared;
+			}
+			return nearest;
+		}
+
+		DeclaredName const * SymbolIndex::FindGlobal( Support::Symbol name, bool member ) const
+		{
+			if( member ){
+				for( DeclaredName const & declared : names ){
+					if( declared.name == name && !declared.local
+						&& ( declared.kind == SymbolKind::Field || declared.kind == SymbolKind::Method ) ) return &declared;
+				}
+			}
+			for( DeclaredName const & declared : names ){
+				if( declared.name == name && !declared.local ) return &declared;
+			}
+			return nullptr;
+		}
+	} // namespace LanguageServer
+} // namespace MaryLang
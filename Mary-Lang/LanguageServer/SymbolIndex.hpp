@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../Parser/Document.hpp"
+#include "../Utils/StringInterner.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace LanguageServer
+	{
+		// The kinds of declaration the index knows, numbered as the protocol numbers them.
+		enum class SymbolKind: std::uint8_t
+		{
+			Namespace	= 3,
+			Class		= 5,
+			Method		= 6,
+			Field		= 8,
+			Constructor	= 9,
+			Enum		= 10,
+			Function	= 12,
+			Variable	= 13,
+			EnumMember	= 22
+		};
+
+		// A name declared in a document, at offsets into its current text.
+		struct DeclaredName
+		{
+			static std::uint32_t const no_parent = UINT32_MAX;
+
+			Support::Symbol	name;
+			std::uint32_t	name_offset;
+			std::uint32_t	name_length;
+			std::uint32_t	begin;		// of the whole declaration, from its keyword
+			std::uint32_t	end;		// past its closing brace, or its name if it has none
+			std::uint32_t	scope_end;	// a local's: where the block declaring it closes
+			std::uint32_t	parent;		// the index of the class, function, enum or namespace holding it
+			SymbolKind		kind;
+			bool			local;		// a parameter, or declared in a function body
+		};
+
+		// Every name a Document declares, kept up to date with it edit by edit. The names of
+		// a top-level statement are collected once, when the statement is parsed, and reused
+		// for as long as the Document reuses the statement; only their offsets move.
+		struct SymbolIndex
+		{
+			SymbolIndex();
+
+			// Brings the index up to date with `document', which it was last updated with if
+			// with any. Each update drops what the document's last edit made stale.
+			void Update( Parser::Document const & document );
+
+			// In source order, every parent before its children.
+			inline std::vector<DeclaredName> const & Names() const { return names; }
+
+			// The local declaration of `name' in scope at `offset', the nearest one before it;
+			// null if there is none.
+			DeclaredName const * FindLocal( Support::Symbol name, std::uint32_t offset ) const;
+			// The first declaration of `name' outside any function; with `member', a class
+			// member comes first.
+			DeclaredName const * FindGlobal( Support::Symbol name, bool member ) const;
+		private:
+			// The names of one top-level statement, at offsets as parsed, parents counted from
+			// the first of them.
+			struct Entry
+			{
+				std::shared_ptr<AbstractSyntaxTree::ParsedProgram> program; // keeps `statement' from being reused
+				AbstractSyntaxTree::Statement const *	statement;
+				std::vector<DeclaredName>				names;
+			};
+
+			static void Collect( Parser::Document const & document, std::size_t segment, Entry & entry );
+
+			std::vector<Entry>			entries;	// one per segment of the document
+			std::vector<DeclaredName>	names;
+		};
+	} // namespace LanguageServer
+} // namespace MaryLang
@@ -1,14 +1,259 @@
-#include "Scanner/Scanner.hpp"
+// The compiler driver: lexes and parses every source it is given, and every module those
+// import, on a thread pool, then reports each file's result and a summary, imported files
+// before their importers and otherwise in the order the files were named, and all the
+// diagnostics together at the end.
+//
+//   MaryLang [-j N] [--tokens] [-ferror-limit=N] [-fdiagnostics-format=text|json|sarif]
+//            [-ftime-trace[=FILE]] [-ftime-report] [--stats] [-fparse-cache[=DIR]]
+//            <file or directory>... | -
+//
+// Directories are searched recursively for .mj files. A lone - reads the source from
+// standard input instead and parses it as it arrives, a statement at a time, so a generator
+// can pipe its output straight in; memory then stays the same however much it writes, and
+// imports are not loaded. --tokens dumps the tokens of each file instead of parsing it.
+// -ferror-limit=0 shows every error. JSON and SARIF go to standard output, and the per-file
+// lines then move to standard error.
+// -ftime-trace writes the time each phase took, per file and thread, as a Chrome trace
+// (mary-time-trace.json by default); -ftime-report prints the totals per phase. --stats
+// prints counts of tokens, nodes, bytes and allocations. -fparse-cache keeps each file's
+// parse in DIR (.mary-cache by default) and skips lexing and parsing the files whose
+// contents it has seen before.
+
+#include "Parser/ModuleCache.hpp"
+#include "Parser/ParseCache.hpp"
+#include "Parser/Parser.hpp"
+#include "Utils/DiagnosticsEngine.hpp"
+#include "Utils/SourceStream.hpp"
+#include "Utils/Statistics.hpp"
+#include "Utils/ThreadPool.hpp"
+#include "Utils/TimeTrace.hpp"
+#include "Utils/Utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #if defined ( _WIN32 ) && defined ( _MSC_VER )
 #include <io.h>
 #include <fcntl.h>
+#include <windows.h>
 #else
 #include <clocale>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 namespace Lexer = MaryLang::Lexer;
+namespace Support = MaryLang::Support;
+namespace Parser = MaryLang::Parser;
+
+namespace
+{
+	// Files at least this big have their function bodies parsed on the pool as well.
+	std::uint32_t const parallel_parse_threshold = 1 << 20;
+
+	struct Options
+	{
+		unsigned int				jobs; // zero: one per hardware thread
+		bool						dump_tokens;
+		std::size_t					error_limit; // zero: no limit
+		Support::DiagFormat			diagnostics_format;
+		std::string					time_trace; // where the trace goes; empty: no trace
+		bool						time_report;
+		bool						stats;
+		std::string					cache_directory; // empty: no parse cache
+		std::vector<std::string>	inputs;
+	};
+
+	void Usage()
+	{
+		std::wcerr << L"usage: MaryLang [-j N] [--tokens] [-ferror-limit=N] "
+			L"[-fdiagnostics-format=text|json|sarif] [-ftime-trace[=FILE]] [-ftime-report] "
+			L"[--stats] [-fparse-cache[=DIR]] <file or directory>... | -" << std::endl;
+	}
+
+	bool ParseOptions( int argc, char **argv, Options & options )
+	{
+		options.jobs = 0;
+		options.dump_tokens = false;
+		options.error_limit = 20;
+		options.diagnostics_format = Support::DiagFormat::Text;
+		options.time_report = false;
+		options.stats = false;
+		for( int i = 1; i < argc; ++i ){
+			char const * const arg = argv[i];
+			if( std::strncmp( arg, "-j", 2 ) == 0 ){
+				char const * count = arg[2] != '\0' ? arg + 2 : ( i + 1 < argc ? argv[++i] : nullptr );
+				if( count == nullptr || std::atoi( count ) < 0 ) return false;
+				options.jobs = static_cast<unsigned int>( std::atoi( count ) );
+			} else if( std::strcmp( arg, "--tokens" ) == 0 ){
+				options.dump_tokens = true;
+			} else if( std::strncmp( arg, "-ferror-limit=", 14 ) == 0 ){
+				if( std::atoi( arg + 14 ) < 0 ) return false;
+				options.error_limit = static_cast<std::size_t>( std::atoi( arg + 14 ) );
+			} else if( std::strncmp( arg, "-fdiagnostics-format=", 21 ) == 0 ){
+				char const * const format = arg + 21;
+				if( std::strcmp( format, "text" ) == 0 ) options.diagnostics_format = Support::DiagFormat::Text;
+				else if( std::strcmp( format, "json" ) == 0 ) options.diagnostics_format = Support::DiagFormat::Json;
+				else if( std::strcmp( format, "sarif" ) == 0 ) options.diagnostics_format = Support::DiagFormat::Sarif;
+				else return false;
+			} else if( std::strcmp( arg, "-ftime-trace" ) == 0 ){
+				options.time_trace = "mary-time-trace.json";
+			} else if( std::strncmp( arg, "-ftime-trace=", 13 ) == 0 && arg[13] != '\0' ){
+				options.time_trace = arg + 13;
+			} else if( std::strcmp( arg, "-ftime-report" ) == 0 ){
+				options.time_report = true;
+			} else if( std::strcmp( arg, "--stats" ) == 0 ){
+				options.stats = true;
+			} else if( std::strcmp( arg, "-fparse-cache" ) == 0 ){
+				options.cache_directory = ".mary-cache";
+			} else if( std::strncmp( arg, "-fparse-cache=", 14 ) == 0 && arg[14] != '\0' ){
+				options.cache_directory = arg + 14;
+			} else if( arg[0] == '-' && arg[1] != '\0' ){
+				return false;
+			} else {
+				options.inputs.push_back( arg );
+			}
+		}
+		// standard input goes alone
+		return options.inputs.size() == 1
+			|| ( !options.inputs.empty() && std::find( options.inputs.begin(), options.inputs.end(), "-" ) == options.inputs.end() );
+	}
+
+	bool HasSourceExtension( std::string const & name )
+	{
+		return name.size() > 3 && name.compare( name.size() - 3, 3, ".mj" ) == 0;
+	}
+
+	// Appends `path' if it is a file, or the .mj files under it, sorted, if a directory.
+	void CollectSources( std::string const & path, std::vector<std::string> & files )
+	{
+		std::vector<std::string> entries;
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+		DWORD const attributes = GetFileAttributesA( path.c_str() );
+		if( attributes == INVALID_FILE_ATTRIBUTES || !( attributes & FILE_ATTRIBUTE_DIRECTORY ) ){
+			files.push_back( path );
+			return;
+		}
+		WIN32_FIND_DATAA found;
+		HANDLE const search = FindFirstFileA( ( path + "\\*" ).c_str(), &found );
+		if( search == INVALID_HANDLE_VALUE ) return;
+		do {
+			entries.push_back( found.cFileName );
+		} while( FindNextFileA( search, &found ) );
+		FindClose( search );
+		char const separator = '\\';
+#else
+		struct stat status;
+		if( stat( path.c_str(), &status ) != 0 || !S_ISDIR( status.st_mode ) ){
+			files.push_back( path ); // a missing file is reported when it fails to open
+			return;
+		}
+		DIR * const directory = opendir( path.c_str() );
+		if( directory == nullptr ) return;
+		while( dirent const * entry = readdir( directory ) ) entries.push_back( entry->d_name );
+		closedir( directory );
+		char const separator = '/';
+#endif
+		std::sort( entries.begin(), entries.end() );
+		for( std::string const & entry : entries ){
+			if( entry == "." || entry == ".." ) continue;
+			std::string const child = path + separator + entry;
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+			bool const is_directory = ( GetFileAttributesA( child.c_str() ) & FILE_ATTRIBUTE_DIRECTORY ) != 0;
+#else
+			bool const is_directory = stat( child.c_str(), &status ) == 0 && S_ISDIR( status.st_mode );
+#endif
+			if( is_directory ) CollectSources( child, files );
+			else if( HasSourceExtension( entry ) ) files.push_back( child );
+		}
+	}
+
+	void DumpTokens( Lexer::Scanner & scanner )
+	{
+		Support::TimeScope const scope( "Lex", scanner.FileName() );
+		Lexer::Token token = scanner.GetNextToken();
+		while( token.Type() != Lexer::TokenType::TK_EOF )
+		{
+			if( token.Type() != Lexer::TokenType::TK_INVALID ){
+				Support::StringRef const spelling = scanner.Spelling( token );
+				std::wcout << L"ID: '" << Support::Utf8ToWide( spelling.Data(), spelling.Size() ) << L"', "
+					<< scanner.GetPosition( token ) << L" : " << static_cast<int>( token.Type() ) << std::endl;
+			}
+
+			scanner.Release( token.Offset() + token.Length() );
+			token = scanner.GetNextToken();
+		}
+	}
+
+	void UseBinaryStandardInput()
+	{
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+		_setmode( _fileno( stdin ), _O_BINARY ); // offsets count bytes, so no newline may be translated
+#endif
+	}
+
+	// Standard input, parsed as it arrives: the parser works on a statement while the writer
+	// is still writing the next, and its tree and its source are let go before the next one,
+	// so only the statement being parsed is held. What went wrong, if it could not be read.
+	std::string ParseStandardInput( Support::SourceStream & stream, Support::DiagnosticsEngine & diagnostics,
+		std::size_t & errors )
+	{
+		Support::TimeScope const scope( "Parse", stream.FileName() );
+		try {
+			Lexer::Scanner scanner( stream );
+			Parser::Parser parser( scanner );
+			std::size_t lexed = 0, parsed = 0; // the diagnostics added so far
+			for( bool more = true; more; ){
+				more = parser.ParseNextStatement() != nullptr;
+				// now, while the stream still has the statement's lines
+				diagnostics.Add( stream, scanner.Diagnostics(), lexed );
+				diagnostics.Add( stream, parser.Diagnostics(), parsed );
+				lexed = scanner.Diagnostics().Count();
+				parsed = parser.Diagnostics().Count();
+			}
+			errors = scanner.Diagnostics().ErrorCount() + parser.Diagnostics().ErrorCount();
+		} catch( std::exception const & e ) {
+			return e.what();
+		}
+		return stream.Failed() ? "cannot read it to the end" : "";
+	}
+
+	std::wstring Widen( std::string const & str )
+	{
+		return std::wstring( str.begin(), str.end() );
+	}
+
+	// Statistics and timings, as asked for. False if the trace file cannot be written.
+	bool WriteTimings( Options const & options )
+	{
+		if( options.stats ) Support::Statistics::Write( std::wcerr );
+		if( options.time_report ) Support::TimeTrace::WriteReport( std::wcerr );
+		if( options.time_trace.empty() ) return true;
+		std::ofstream trace( options.time_trace, std::ios::binary );
+		Support::TimeTrace::WriteChromeTrace( trace );
+		if( trace ) return true;
+		std::wcerr << L"cannot write " << Widen( options.time_trace ) << std::endl;
+		return false;
+	}
+
+	bool StandardErrorIsTerminal()
+	{
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+		return _isatty( _fileno( stderr ) ) != 0;
+#else
+		return isatty( fileno( stderr ) ) != 0;
+#endif
+	}
+}
 
 int main( int argc, char **argv )
 {
@@ -18,16 +263,127 @@ int main( int argc, char **argv )
 	std::setlocale( LC_ALL, "en_US.utf8" );
 #endif
 
-	if( argc < 2 ) return -1;
+	Options options;
+	if( !ParseOptions( argc, argv, options ) ){
+		Usage();
+		return 2;
+	}
+	if( options.time_report || !options.time_trace.empty() ) Support::TimeTrace::Enable();
+	if( options.stats ) Support::Statistics::Enable();
+	bool const standard_input = options.inputs.front() == "-";
+	std::vector<std::string> files;
+	if( standard_input ){
+		UseBinaryStandardInput();
+		options.cache_directory.clear(); // it is parsed as it comes, before it could be hashed
+	} else {
+		Support::TimeScope const scope( "Collect sources" );
+		for( std::string const & input : options.inputs ) CollectSources( input, files );
+	}
+
+	if( options.dump_tokens ){
+		try {
+			if( standard_input ){
+				Support::SourceStream stream( 0, "<stdin>" );
+				Lexer::Scanner scanner( stream );
+				DumpTokens( scanner );
+			}
+			for( std::string const & file : files ){
+				Lexer::Scanner scanner( file.c_str() );
+				DumpTokens( scanner );
+			}
+		} catch( std::exception const & e ) {
+			std::wcerr << Widen( e.what() ) << std::endl;
+			WriteTimings( options );
+			return 1;
+		}
+		return WriteTimings( options ) ? 0 : 1;
+	}
+
+	Parser::ParseCache cache;
+	if( !options.cache_directory.empty() && !cache.Open( options.cache_directory ) ){
+		std::wcerr << L"cannot use " << Widen( options.cache_directory ) << L" as the parse cache" << std::endl;
+		options.cache_directory.clear();
+	}
+	Parser::ParseCache const * const use_cache = options.cache_directory.empty() ? nullptr : &cache;
+
+	auto const start = std::chrono::steady_clock::now();
+	Support::ThreadPool pool( standard_input ? 1 : options.jobs );
+	// the driver reports and drops each tree, so the modules keep only their diagnostics
+	Parser::ModuleCache modules( pool, Parser::ModuleCache::Options{ false, parallel_parse_threshold, use_cache } );
+	modules.Load( files );
+	std::vector<Parser::Module const *> const & loaded = modules.Order();
 
-	Lexer::Scanner scanner( argv[1] );
-	Lexer::Token token = scanner.GetNextToken();
-	while( token.Type() != Lexer::TokenType::TK_EOF )
+	// Reported in dependency order, which for files importing nothing is the order they
+	// were named in, so the output does not depend on scheduling.
+	bool const structured = options.diagnostics_format != Support::DiagFormat::Text;
+	std::wostream & report = structured ? std::wcerr : std::wcout;
+	Support::DiagnosticsEngine diagnostics( Support::DiagnosticsEngine::Options{
+		options.diagnostics_format, options.error_limit, !structured && StandardErrorIsTerminal() } );
+	std::size_t total_errors = 0, failed_files = 0, cache_hits = 0;
+	double saved_milliseconds = 0.0;
+	std::uint64_t total_bytes = 0, total_lines = 0;
+	for( Parser::Module const * module : loaded ){
+		std::wstring const name = Widen( module->path );
+		if( !module->failure.empty() ){
+			std::wcerr << name << L": " << Widen( module->failure ) << std::endl;
+			++failed_files;
+			continue;
+		}
+		Support::SourceManager const & source = module->source;
+		diagnostics.Add( source, module->lexer_diagnostics );
+		diagnostics.Add( source, module->diagnostics );
+		diagnostics.Add( source, module->import_diagnostics );
+		std::size_t const errors = module->lexer_diagnostics.ErrorCount() + module->diagnostics.ErrorCount()
+			+ module->import_diagnostics.ErrorCount();
+
+		std::uint32_t const lines = module->line_count;
+		report << name << L": " << lines << L" lines, " << errors << L" errors, "
+			<< module->milliseconds << L" ms" << ( module->cached ? L", cached" : L"" ) << L'\n';
+		if( module->cached ){
+			++cache_hits;
+			saved_milliseconds += std::max( 0.0, module->parse_microseconds / 1000.0 - module->milliseconds );
+		}
+		total_errors += errors;
+		total_bytes += source.Size();
+		total_lines += lines;
+	}
+	std::size_t file_count = loaded.size();
+	if( standard_input ){
+		auto const stream_start = std::chrono::steady_clock::now();
+		Support::SourceStream stream( 0, "<stdin>" );
+		std::size_t errors = 0;
+		std::string const failure = ParseStandardInput( stream, diagnostics, errors );
+		std::wstring const name = Widen( stream.FileName() );
+		if( failure.empty() ){
+			report << name << L": " << stream.LineCount() << L" lines, " << errors << L" errors, "
+				<< std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - stream_start ).count()
+				<< L" ms\n";
+			total_errors += errors;
+			total_bytes += stream.Base() + stream.Size();
+			total_lines += stream.LineCount();
+		} else {
+			std::wcerr << name << L": " << Widen( failure ) << std::endl;
+			++failed_files;
+		}
+		++file_count;
+	}
+	report.flush();
 	{
-		if( token.Type() != Lexer::TokenType::TK_INVALID )
-			std::wcout << token << std::endl;
-		
-		token = scanner.GetNextToken();
+		Support::TimeScope const scope( "Diagnostics" );
+		diagnostics.Render( structured ? std::wcout : std::wcerr );
+	}
+
+	double const seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	report << file_count << L" files, " << total_lines << L" lines, " << total_errors << L" errors";
+	if( failed_files != 0 ) report << L", " << failed_files << L" unreadable";
+	report << L" in " << seconds * 1000 << L" ms with " << pool.Size() << L" jobs ("
+		<< total_bytes / ( 1024.0 * 1024.0 ) / seconds << L" MB/s)" << std::endl;
+	if( use_cache ){
+		std::size_t const looked_up = loaded.size() - failed_files;
+		report << L"parse cache: " << cache_hits << L" of " << looked_up << L" files hit ("
+			<< ( looked_up != 0 ? cache_hits * 100.0 / looked_up : 0.0 ) << L"%), about "
+			<< saved_milliseconds << L" ms of lexing and parsing saved" << std::endl;
 	}
-	return 0;
-}
\ No newline at end of file
+	bool const timings_written = WriteTimings( options );
+	return total_errors == 0 && failed_files == 0 && timings_written ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+// The language server: speaks the Language Server Protocol over standard input and output
+// until the editor says exit, keeping every file it has seen lexed, parsed and indexed in
+// between, so a request costs what the edit before it touched rather than a compile.
+//
+//   mary-lsp [-j N] [--record FILE] [-ftime-report]
+//
+// -j sets how many threads load imported files. --record appends every message the editor
+// sends, frames and all, to FILE: a session to replay with mary-lsp-bench. -ftime-report
+// prints where the time went, messages handled and edits made among it, on exit.
+
+#include "LanguageServer/Server.hpp"
+#include "Utils/TimeTrace.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+namespace LanguageServer = MaryLang::LanguageServer;
+namespace Support = MaryLang::Support;
+
+namespace
+{
+	void Usage()
+	{
+		std::wcerr << L"usage: mary-lsp [-j N] [--record FILE] [-ftime-report]" << std::endl;
+	}
+}
+
+int main( int argc, char **argv )
+{
+#if defined ( _WIN32 ) && defined ( _MSC_VER )
+	// the frames count bytes, so no newline may be translated
+	_setmode( _fileno( stdin ), _O_BINARY );
+	_setmode( _fileno( stdout ), _O_BINARY );
+#endif
+
+	unsigned int jobs = 0;
+	char const * record_path = nullptr;
+	bool time_report = false;
+	for( int i = 1; i < argc; ++i ){
+		char const * const arg = argv[i];
+		if( std::strncmp( arg, "-j", 2 ) == 0 ){
+			char const * count = arg[2] != '\0' ? arg + 2 : ( i + 1 < argc ? argv[++i] : nullptr );
+			if( count == nullptr || std::atoi( count ) < 0 ){
+				Usage();
+				return 2;
+			}
+			jobs = static_cast<unsigned int>( std::atoi( count ) );
+		} else if( std::strcmp( arg, "--record" ) == 0 && i + 1 < argc ){
+			record_path = argv[++i];
+		} else if( std::strcmp( arg, "-ftime-report" ) == 0 ){
+			time_report = true;
+		} else {
+			Usage();
+			return 2;
+		}
+	}
+	if( time_report ) Support::TimeTrace::Enable();
+
+	std::FILE * record = nullptr;
+	if( record_path != nullptr && ( record = std::fopen( record_path, "ab" ) ) == nullptr ){
+		std::wcerr << L"cannot write " << record_path << std::endl;
+		return 2;
+	}
+
+	LanguageServer::Server server( []( std::string const & message ){
+		LanguageServer::WriteMessage( stdout, message );
+	}, jobs );
+	std::string message, frame;
+	bool running = true;
+	while( running && LanguageServer::ReadMessage( stdin, message, record != nullptr ? &frame : nullptr ) ){
+		if( record != nullptr ){
+			std::fwrite( frame.data(), 1, frame.size(), record );
+			std::fflush( record );
+			frame.clear();
+		}
+		running = server.Handle( message );
+	}
+	if( record != nullptr ) std::fclose( record );
+	if( time_report ) Support::TimeTrace::WriteReport( std::wcerr );
+	// the editor going away without exit is as good as exit without shutdown
+	return running ? 1 : server.ExitCode();
+}
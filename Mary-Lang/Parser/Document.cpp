@@ -0,0 +1,259 @@
+#include "Document.hpp"
+#include "../Utils/TimeTrace.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace MaryLang
+{
+	namespace Parser
+	{
+		namespace
+		{
+			// How far past a token's end the scanner may look before ending it, as at `1e+'.
+			std::uint32_t const scan_lookahead = 2;
+
+			inline std::uint32_t End( Token const & token )
+			{
+				return token.Offset() + token.Length();
+			}
+
+			inline std::uint32_t Move( std::uint32_t offset, std::int64_t delta )
+			{
+				return static_cast<std::uint32_t>( offset + delta );
+			}
+
+			void AppendMoved( Support::Diagnostic & to, Support::Diagnostic const & from, std::int64_t delta )
+			{
+				for( Support::DiagRecord const & record : from ) to.Report( record.id, Move( record.offset, delta ), record.argument );
+			}
+		} // namespace
+
+		Document::Document( std::string const & name, std::string text )
+			: source(), tokens(), lexer_diagnostics(), imports_program(), import_diagnostics(), tail_diagnostics(),
+			segments(), failure(), report()
+		{
+			if( !source.Assign( name, std::move( text ) ) ) throw std::length_error( "source too big for 32-bit offsets" );
+			Rebuild();
+		}
+
+		void Document::Rebuild()
+		{
+			Support::TimeScope const scope( "Rebuild", source.FileName() );
+			tokens.clear();
+			lexer_diagnostics.Clear();
+			lexer_diagnostic_tokens.clear();
+			segments.clear();
+			failure.clear();
+			report = EditReport{ 0, 0, 0, true };
+			try {
+				Lexer::Scanner scanner( source );
+				do {
+					tokens.push_back( scanner.GetNextToken() );
+					lexer_diagnostic_tokens.resize( scanner.Diagnostics().Count(), tokens.back().Offset() );
+				} while( tokens.back().Type() != TokenType::TK_EOF );
+				lexer_diagnostics = scanner.Diagnostics();
+				report.tokens_relexed = tokens.size();
+				Reparse( 0, UINT32_MAX, 0 );
+			} catch( std::runtime_error const & error ) {
+				Fail( error.what() );
+			}
+		}
+
+		void Document::Fail( char const * what )
+		{
+			failure = what;
+			tokens.clear();
+			lexer_diagnostics.Clear();
+			lexer_diagnostic_tokens.clear();
+			segments.clear();
+			imports_program.reset();
+			import_diagnostics.Clear();
+			tail_diagnostics.Clear();
+		}
+
+		void Document::Edit( TextEdit const & edit )
+		{
+			if( edit.offset > source.Size() || edit.length > source.Size() - edit.offset ){
+				throw std::out_of_range( "edit past the end of the document" );
+			}
+			if( source.Size() - edit.length + edit.text.size() > UINT32_MAX ){
+				throw std::length_error( "source too big for 32-bit offsets" );
+			}
+			Support::TimeScope const scope( "Edit", source.FileName() );
+			if( !failure.empty() ){
+				source.Replace( edit.offset, edit.length, Support::StringRef( edit.text.data(), edit.text.size() ) );
+				Rebuild();
+				return;
+			}
+			report = EditReport{ 0, 0, 0, false };
+			std::uint32_t const edit_end = edit.offset + edit.length; // in the old text
+			std::int64_t const delta = static_cast<std::int64_t>( edit.text.size() ) - edit.length;
+
+			// The first token the edit may change is the first to end within the scanner's
+			// lookahead of it; lexing again starts where the token before that one ends.
+			std::size_t const first = std::partition_point( tokens.begin(), tokens.end(), [&]( Token const & token ){
+				return End( token ) + scan_lookahead <= edit.offset;
+			} ) - tokens.begin();
+			std::uint32_t const relex_begin = first != 0 ? End( tokens[first - 1] ) : 0;
+			// The parser peeks up to a ring's worth of tokens past a statement's end, so the
+			// statement holding the token that far back may have seen the change too.
+			std::uint32_t const damage_begin = tokens[first >= TokenRing::capacity ? first - TokenRing::capacity : 0].Offset();
+
+			source.Replace( edit.offset, edit.length, Support::StringRef( edit.text.data(), edit.text.size() ) );
+			try {
+				// Relex until a token starts where an old one past the edit started and is the
+				// same token: the scanner keeps no state between tokens, so from there on the
+				// old tokens are what it would find, only `delta' further.
+				std::vector<Token> fresh;
+				std::vector<std::uint32_t> fresh_diagnostic_tokens;
+				std::size_t kept = first; // the first old token to keep
+				Lexer::Scanner scanner( source, relex_begin );
+				for( ; ; ){
+					Token const token = scanner.GetNextToken();
+					while( kept < tokens.size() && ( tokens[kept].Offset() < edit_end || tokens[kept].Offset() + delta < token.Offset() ) ){
+						++kept;
+					}
+					if( kept < tokens.size() && tokens[kept].Offset() + delta == token.Offset()
+						&& tokens[kept].Length() == token.Length() && tokens[kept].Type() == token.Type() ){
+						break;
+					}
+					fresh.push_back( token );
+					fresh_diagnostic_tokens.resize( scanner.Diagnostics().Count(), token.Offset() );
+					if( token.Type() == TokenType::TK_EOF ){
+						kept = tokens.size();
+						break;
+					}
+				}
+				std::uint32_t const window_end = kept < tokens.size() ? tokens[kept].Offset() : UINT32_MAX; // in the old text
+
+				// the diagnostics go with their tokens
+				Support::Diagnostic diagnostics;
+				std::vector<std::uint32_t> diagnostic_tokens;
+				std::size_t i = 0;
+				for( Support::DiagRecord const & record : lexer_diagnostics ){
+					std::uint32_t const token = lexer_diagnostic_tokens[i++];
+					if( token >= relex_begin ) break;
+					diagnostics.Report( record.id, record.offset, record.argument );
+					diagnostic_tokens.push_back( token );
+				}
+				diagnostics.Append( scanner.Diagnostics(), 0, fresh_diagnostic_tokens.size() );
+				diagnostic_tokens.insert( diagnostic_tokens.end(), fresh_diagnostic_tokens.begin(), fresh_diagnostic_tokens.end() );
+				i = 0;
+				for( Support::DiagRecord const & record : lexer_diagnostics ){
+					std::uint32_t const token = lexer_diagnostic_tokens[i++];
+					if( token < window_end ) continue;
+					diagnostics.Report( record.id, Move( record.offset, delta ), record.argument );
+					diagnostic_tokens.push_back( Move( token, delta ) );
+				}
+				lexer_diagnostics = std::move( diagnostics );
+				lexer_diagnostic_tokens.swap( diagnostic_tokens );
+
+				// the fresh tokens take the place of [first, kept), and the rest moves
+				std::size_t const replaced = kept - first;
+				if( fresh.size() > replaced ){
+					tokens.insert( tokens.begin() + kept, fresh.size() - replaced, fresh.back() );
+				} else {
+					tokens.erase( tokens.begin() + first + fresh.size(), tokens.begin() + kept );
+				}
+				std::copy( fresh.begin(), fresh.end(), tokens.begin() + first );
+				if( delta != 0 ){
+					for( auto token = tokens.begin() + first + fresh.size(); token != tokens.end(); ++token ){
+						*token = Token( Move( token->Offset(), delta ), token->Length(), token->Type(), token->Payload() );
+					}
+				}
+				report.tokens_relexed = fresh.size();
+
+				std::size_t const damaged = std::partition_point( segments.begin(), segments.end(), [&]( Segment const & segment ){
+					return segment.begin <= damage_begin;
+				} ) - segments.begin();
+				Reparse( damaged != 0 ? damaged - 1 : 0, window_end, delta );
+			} catch( std::runtime_error const & error ) {
+				Fail( error.what() );
+				return;
+			}
+
+			// one parse per segment, at worst, once edits have been everywhere
+			std::size_t programs = 0;
+			for( std::size_t i = 0; i < segments.size(); ++i ){
+				if( i == 0 || segments[i].program != segments[i - 1].program ) ++programs;
+			}
+			if( programs > max_programs ){
+				Support::TimeScope const compact( "Reparse all", source.FileName() );
+				std::size_t const relexed = report.tokens_relexed;
+				Reparse( 0, UINT32_MAX, 0 );
+				report = EditReport{ relexed, segments.size(), 0, false };
+			}
+		}
+
+		void Document::Reparse( std::size_t first, std::uint32_t window_end, std::int64_t delta )
+		{
+			std::uint32_t const begin = first != 0 ? segments[first].begin : 0;
+			// the parser goes over the tokens kept, relexed where the edit was, not the text
+			Token const * const lexed = &*std::partition_point( tokens.begin(), tokens.end(), [&]( Token const & token ){
+				return token.Offset() < begin;
+			} );
+			Lexer::Scanner scanner( source, begin );
+			Parser parser( scanner, lexed, true );
+			parser.KeepStatements( true );
+			if( first == 0 ){
+				parser.ParseImports();
+				imports_program = parser.Program();
+				import_diagnostics = parser.Diagnostics();
+			} else {
+				parser.SkipImports();
+			}
+
+			// the first segment past the damage, which the parse may land on
+			std::size_t reuse = std::partition_point( segments.begin() + first, segments.end(), [&]( Segment const & segment ){
+				return segment.begin < window_end;
+			} ) - segments.begin();
+			std::vector<Segment> parsed;
+			bool at_end = false;
+			for( ; ; ){
+				std::uint32_t const next = parser.NextOffset();
+				while( reuse < segments.size() && segments[reuse].begin + delta < next ) ++reuse;
+				if( reuse < segments.size() && segments[reuse].begin + delta == next ) break;
+
+				std::size_t const mark = parser.Diagnostics().Count();
+				Statement const * const statement = parser.ParseNextStatement();
+				if( statement == nullptr ){
+					reuse = segments.size();
+					at_end = true;
+					tail_diagnostics.Clear();
+					tail_diagnostics.Append( parser.Diagnostics(), mark, parser.Diagnostics().Count() );
+					break;
+				}
+				parsed.push_back( Segment{ parser.Program(), statement, next, next, Support::Diagnostic() } );
+				parsed.back().diagnostics.Append( parser.Diagnostics(), mark, parser.Diagnostics().Count() );
+			}
+			if( !at_end && delta != 0 ){
+				Support::Diagnostic moved;
+				AppendMoved( moved, tail_diagnostics, delta );
+				tail_diagnostics = std::move( moved );
+			}
+			report.statements_reparsed = parsed.size();
+			report.statements_reused = first + ( segments.size() - reuse );
+
+			// the parsed segments take the place of [first, reuse), and the rest moves
+			for( std::size_t i = reuse; i < segments.size(); ++i ) segments[i].begin = Move( segments[i].begin, delta );
+			segments.erase( segments.begin() + first, segments.begin() + reuse );
+			segments.insert( segments.begin() + first, std::make_move_iterator( parsed.begin() ), std::make_move_iterator( parsed.end() ) );
+		}
+
+		List<Imports> const & Document::SourceImports() const
+		{
+			static List<Imports> const none;
+			return imports_program ? imports_program->SourceImports() : none;
+		}
+
+		Support::Diagnostic Document::Diagnostics() const
+		{
+			Support::Diagnostic diagnostics;
+			diagnostics.Append( import_diagnostics );
+			for( Segment const & segment : segments ) AppendMoved( diagnostics, segment.diagnostics, segment.Shift() );
+			diagnostics.Append( tail_diagnostics );
+			return diagnostics;
+		}
+	} // namespace Parser
+} // namespace MaryLang
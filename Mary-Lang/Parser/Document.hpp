@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Parser.hpp"
+#include "../Utils/Diagnostics.hpp"
+#include "../Utils/SourceManager.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace Parser
+	{
+		// Replaces `length' bytes at `offset' with `text'.
+		struct TextEdit
+		{
+			std::uint32_t	offset;
+			std::uint32_t	length;
+			std::string		text;
+		};
+
+		// A source file an editor keeps changing, its tokens and syntax tree brought up to
+		// date edit by edit rather than rebuilt. An edit is relexed from the token before it
+		// until the scanner lands on a token start the old stream had past the edit, as
+		// LexAll stitches its chunks; the tokens from there on are kept and only moved. Then
+		// the top-level statements holding the new tokens, or having peeked at them, are
+		// parsed again, from the tokens kept rather than the text, until the parser too lands
+		// where a statement past the edit began.
+		// Every other statement is reused, its whole subtree untouched.
+		//
+		// A reused statement keeps the offsets it was parsed with: its nodes' place in the
+		// current text is their offset plus the Shift() of the segment holding them.
+		struct Document
+		{
+			// A top-level statement and the parse that produced it.
+			struct Segment
+			{
+				std::shared_ptr<ParsedProgram>	program;	// shared by the segments one parse produced
+				Statement const *				statement;	// also the root of its nodes in program's FlatTree
+				std::uint32_t					begin;		// where it begins in the text now
+				std::uint32_t					parsed_begin; // and where it began when parsed
+				Support::Diagnostic				diagnostics; // the parser's, at offsets as parsed
+
+				inline std::int64_t Shift() const { return std::int64_t( begin ) - parsed_begin; }
+			};
+
+			// What the last edit did over.
+			struct EditReport
+			{
+				std::size_t		tokens_relexed;
+				std::size_t		statements_reparsed;
+				std::size_t		statements_reused;
+				bool			rebuilt;	// everything, from the text up
+			};
+
+			// Reused segments may hold on to as many programs, an arena chunk each, before the
+			// statements are all parsed again into one; a long session of edits all over a file
+			// comes to that, and then pays for a full parse once in so many edits.
+			static std::size_t const max_programs = 1024;
+
+			Document( std::string const & name, std::string text );
+
+			Document( Document const & ) = delete;
+			Document & operator=( Document const & ) = delete;
+
+			// Throws std::out_of_range if `edit' reaches past the end of the text.
+			void Edit( TextEdit const & edit );
+			// Lexes and parses the whole text anew.
+			void Rebuild();
+
+			inline Support::SourceManager const &	Source() const { return source; }
+			// Ends with TK_EOF, unless the scanner gave up; see Failure.
+			inline std::vector<Token> const &		Tokens() const { return tokens; }
+			inline std::vector<Segment> const &		Segments() const { return segments; }
+			// Always at the top of the file, so their offsets never need shifting.
+			List<Imports> const &					SourceImports() const;
+			inline Support::Diagnostic const &		LexerDiagnostics() const { return lexer_diagnostics; }
+			// The parser's, at offsets into the current text.
+			Support::Diagnostic						Diagnostics() const;
+			// Why the scanner gave up on the text, as on a comment left open; empty if it did
+			// not. There are no tokens or statements then, until an edit mends it.
+			inline std::string const &				Failure() const { return failure; }
+			inline EditReport const &				LastEdit() const { return report; }
+		private:
+			// Parses the statements from segment `first' on, the imports as well if it is the
+			// first, until it reaches a segment at or past `window_end' of the old text, which
+			// now begins `delta' later; that and the segments after it are kept.
+			void Reparse( std::size_t first, std::uint32_t window_end, std::int64_t delta );
+			void Fail( char const * what );
+
+			Support::SourceManager			source;
+			std::vector<Token>				tokens;
+			Support::Diagnostic				lexer_diagnostics;
+			// where the token each lexer diagnostic came with begins, which need not be where
+			// the diagnostic is: an open string is reported at the end of its line
+			std::vector<std::uint32_t>		lexer_diagnostic_tokens;
+			std::shared_ptr<ParsedProgram>	imports_program;
+			Support::Diagnostic				import_diagnostics;
+			Support::Diagnostic				tail_diagnostics; // after the last statement, at current offsets
+			std::vector<Segment>			segments;
+			std::string						failure;
+			EditReport						report;
+		};
+	} // namespace Parser
+} // namespace MaryLang
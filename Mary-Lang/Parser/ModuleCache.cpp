@@ -0,0 +1,397 @@
+#include "ModuleCache.hpp"
+#include "../Utils/TimeTrace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <limits>
+#include <stdexcept>
+
+namespace MaryLang
+{
+	namespace Parser
+	{
+		namespace
+		{
+			std::uint32_t const unvisited = std::numeric_limits<std::uint32_t>::max();
+
+			bool IsSeparator( char c )
+			{
+#if defined ( _WIN32 )
+				return c == '/' || c == '\\';
+#else
+				return c == '/';
+#endif
+			}
+
+			bool IsAbsolute( std::string const & path )
+			{
+#if defined ( _WIN32 )
+				if( path.size() > 1 && path[1] == ':' ) return true;
+#endif
+				return !path.empty() && IsSeparator( path[0] );
+			}
+
+			double MillisecondsSince( std::chrono::steady_clock::time_point start )
+			{
+				return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+			}
+		} // namespace
+
+		struct ModuleCache::Entry
+		{
+			struct Import
+			{
+				Entry *			entry;
+				std::uint32_t	offset; // of the import, for diagnostics
+				bool			closes_cycle; // leads back up the walk that found it
+			};
+
+			Module						module;
+			bool						fresh;	// created by the running Load
+			bool						root;	// named to Load, not only imported
+			// Alive from reading the imports to parsing the rest of the file.
+			std::unique_ptr<Scanner>	scanner;
+			std::unique_ptr<Parser>		parser;
+			std::vector<Import>			imports;
+			// Dependency order: the modules to tell when this one is parsed, and how many
+			// imports this one still waits for.
+			std::vector<Entry *>		importers;
+			std::atomic<std::size_t>	waiting;
+			std::promise<void>			parsed;
+			std::shared_future<void>	done;
+			// Tarjan's strongly connected components
+			std::uint32_t				index, low, component;
+			bool						on_stack;
+			bool						on_path; // its imports are being walked
+
+			Entry(): module(), fresh( true ), root( false ), waiting( 0 ),
+				parsed(), done( parsed.get_future().share() ),
+				index( unvisited ), low( unvisited ), component( unvisited ), on_stack( false ), on_path( false ) {}
+		};
+
+		// Tasks of one round on the pool, which the loading thread waits for.
+		struct ModuleCache::Round
+		{
+			std::mutex				lock;
+			std::condition_variable	finished;
+			std::size_t				outstanding; // guarded by `lock'
+
+			Round(): outstanding( 0 ) {}
+
+			void Add()
+			{
+				std::lock_guard<std::mutex> guard( lock );
+				++outstanding;
+			}
+			void Done()
+			{
+				std::lock_guard<std::mutex> guard( lock );
+				if( --outstanding == 0 ) finished.notify_all();
+			}
+			void Wait()
+			{
+				std::unique_lock<std::mutex> guard( lock );
+				finished.wait( guard, [this]{ return outstanding == 0; } );
+			}
+		};
+
+		ModuleCache::ModuleCache( Support::ThreadPool & pool, Options const & options )
+			: pool( pool ), options( options ), lock(), entries(), load_lock(), order() {}
+
+		ModuleCache::~ModuleCache()
+		{
+		}
+
+		std::string ModuleCache::ResolvePath( std::string const & path, std::string const & importer )
+		{
+			std::string joined = path;
+			if( !importer.empty() && !IsAbsolute( path ) ){
+				std::size_t slash = importer.size();
+				while( slash != 0 && !IsSeparator( importer[slash - 1] ) ) --slash;
+				joined = importer.substr( 0, slash ) + path;
+			}
+			// the root, "/" or "C:\", is kept as it is
+			std::size_t keep = 0;
+			if( IsAbsolute( joined ) ){
+				keep = IsSeparator( joined[0] ) ? 1 : 2;
+				if( keep == 2 && joined.size() > 2 && IsSeparator( joined[2] ) ) keep = 3;
+			}
+			// the rest split at the separators, dropping `.' and empty parts and folding `..'
+			std::vector<std::string> parts;
+			for( std::size_t begin = keep; begin <= joined.size(); ){
+				std::size_t end = begin;
+				while( end < joined.size() && !IsSeparator( joined[end] ) ) ++end;
+				std::string const part = joined.substr( begin, end - begin );
+				begin = end + 1;
+				if( part.empty() || part == "." ) continue;
+				if( part != ".." ) parts.push_back( part );
+				else if( !parts.empty() && parts.back() != ".." ) parts.pop_back();
+				else if( keep == 0 ) parts.push_back( part ); // above the root is the root
+			}
+			std::string resolved = joined.substr( 0, keep );
+			for( std::size_t i = 0; i < parts.size(); ++i ){
+				if( i != 0 ) resolved += '/';
+				resolved += parts[i];
+			}
+			return resolved;
+		}
+
+		ModuleCache::Entry & ModuleCache::Find( std::string const & path, bool & created )
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			std::unique_ptr<Entry> & entry = entries[path];
+			created = !entry;
+			if( created ){
+				entry.reset( new Entry );
+				entry->module.path = path;
+			}
+			return *entry;
+		}
+
+		// Opens the file and reads its imports, from the parse cache if it has the file: the
+		// module is then complete already. Imports not seen before are read on the pool next.
+		void ModuleCache::ReadImports( Entry & entry, Round & round )
+		{
+			Module & module = entry.module;
+			Support::TimeScope const scope( "Read imports", module.path );
+			auto const start = std::chrono::steady_clock::now();
+			module.line_count = 0;
+			module.cached = false;
+			module.parse_microseconds = 0;
+			std::vector<std::pair<std::string, std::uint32_t>> imports; // spelled as in the source
+			try {
+				if( !module.source.Open( module.path.c_str() ) ){
+					throw std::runtime_error( "unable to open source file " + module.path );
+				}
+				ParseCacheEntry cached;
+				if( options.parse_cache && options.parse_cache->Load( ParseCache::Key( module.source ), module.source, cached ) ){
+					module.cached = true;
+					module.lexer_diagnostics = cached.lexer_diagnostics;
+					module.diagnostics = cached.parser_diagnostics;
+					module.line_count = cached.line_count;
+					module.parse_microseconds = cached.parse_microseconds;
+					AbstractSyntaxTree::FlatTree const & tree = cached.tree;
+					if( tree.Root() != AbstractSyntaxTree::NoNode ){
+						for( AbstractSyntaxTree::NodeIndex const node : tree.ChildrenOf( tree.Root() ) ){
+							if( tree.Kind( node ) != AbstractSyntaxTree::NodeKind::ImportDeclaration ) continue;
+							Token const & path = tree.GetToken( tree.ChildrenOf( node )[0] );
+							imports.emplace_back( module.source.Text( path.Offset(), path.Length() ).Str(), tree.Offset( node ) );
+						}
+					}
+					if( options.keep_programs ){
+						module.program = std::make_shared<ParsedProgram>();
+						*module.program->EnableFlatTree() = std::move( cached.tree );
+					}
+				} else {
+					entry.scanner.reset( new Scanner( module.source ) );
+					entry.parser.reset( new Parser( *entry.scanner, options.keep_programs || options.parse_cache != nullptr ) );
+					for( Imports const * import : entry.parser->ParseImports() ){
+						imports.emplace_back( entry.scanner->Spelling( import->Path() ).Str(), import->Keyword().Offset() );
+					}
+				}
+			} catch( std::exception const & e ) {
+				module.failure = e.what();
+				entry.parser.reset();
+				entry.scanner.reset();
+				imports.clear();
+			}
+			module.milliseconds = MillisecondsSince( start );
+
+			for( auto const & import : imports ){
+				std::string const & spelling = import.first;
+				std::string const path = ResolvePath( spelling.size() >= 2 ? spelling.substr( 1, spelling.size() - 2 ) : spelling, module.path );
+				bool created;
+				Entry & imported = Find( path, created );
+				entry.imports.push_back( Entry::Import{ &imported, import.second, false } );
+				if( created ){
+					round.Add();
+					pool.Submit( [this, &imported, &round]{ ReadImports( imported, round ); } );
+				}
+			}
+			round.Done();
+		}
+
+		void ModuleCache::ParseModule( Entry & entry, Round & round )
+		{
+			Module & module = entry.module;
+			if( entry.parser ){
+				Support::TimeScope const scope( "Parse module", module.path );
+				auto const start = std::chrono::steady_clock::now();
+				try {
+					Parser & parser = *entry.parser;
+					if( options.parse_cache ){
+						// whole, so that the cached tree has every function body
+						parser.Parse();
+					} else if( module.source.Size() >= options.parallel_parse_bytes ){
+						parser.Parse( pool );
+					} else if( options.keep_programs ){
+						parser.Parse();
+					} else {
+						// only the diagnostics are kept, so no more than a statement need be in memory
+						parser.ParseEach( []( Statement const & ){} );
+					}
+					module.lexer_diagnostics = entry.scanner->Diagnostics();
+					module.diagnostics = parser.Diagnostics();
+					module.line_count = module.source.LineCount();
+					if( options.keep_programs ) module.program = parser.Program();
+					if( options.parse_cache ){
+						double const milliseconds = module.milliseconds + MillisecondsSince( start );
+						options.parse_cache->Store( ParseCache::Key( module.source ), module.source, *parser.Program()->FlatTree(),
+							module.lexer_diagnostics, module.diagnostics, static_cast<std::uint32_t>( milliseconds * 1000.0 ) );
+					}
+				} catch( std::exception const & e ) {
+					module.failure = e.what();
+				}
+				entry.parser.reset();
+				entry.scanner.reset();
+				module.milliseconds += MillisecondsSince( start );
+			}
+			entry.parsed.set_value();
+			for( Entry * importer : entry.importers ){
+				if( importer->waiting.fetch_sub( 1 ) == 1 ){
+					pool.Submit( [this, importer, &round]{ ParseModule( *importer, round ); } );
+				}
+			}
+			round.Done();
+		}
+
+		// Tarjan's algorithm, with an explicit stack so no import chain is too long. It
+		// finishes a component only after every component it imports, which is the order
+		// wanted; then the imports are sorted into those that wait and those within a
+		// component, which do not. Of the latter, those that lead back to a module whose
+		// imports are still being walked are the back edges: every cycle has one, and only
+		// they are reported.
+		void ModuleCache::Order( std::vector<Entry *> const & roots )
+		{
+			struct Frame
+			{
+				Entry *		entry;
+				std::size_t	next; // import to look at next
+			};
+			std::vector<Frame> frames;
+			std::vector<Entry *> stack;
+			std::vector<Entry *> finished;
+			std::uint32_t counter = 0, components = 0;
+			auto const visit = [&]( Entry * entry ){
+				entry->index = entry->low = counter++;
+				entry->on_stack = entry->on_path = true;
+				stack.push_back( entry );
+				frames.push_back( Frame{ entry, 0 } );
+			};
+			for( Entry * root : roots ){
+				if( root->index != unvisited ) continue;
+				visit( root );
+				while( !frames.empty() ){
+					Entry * const entry = frames.back().entry;
+					if( frames.back().next < entry->imports.size() ){
+						Entry::Import & import = entry->imports[frames.back().next++];
+						Entry * const imported = import.entry;
+						if( !imported->fresh ) continue; // loaded before, and done
+						if( imported->index == unvisited ) visit( imported );
+						else if( imported->on_stack ){
+							entry->low = std::min( entry->low, imported->index );
+							import.closes_cycle = imported->on_path;
+						}
+						continue;
+					}
+					entry->on_path = false;
+					frames.pop_back();
+					if( !frames.empty() ) frames.back().entry->low = std::min( frames.back().entry->low, entry->low );
+					if( entry->low != entry->index ) continue;
+					Entry * member;
+					do {
+						member = stack.back();
+						stack.pop_back();
+						member->on_stack = false;
+						member->component = components;
+						finished.push_back( member );
+					} while( member != entry );
+					++components;
+				}
+			}
+
+			for( Entry * entry : finished ){
+				Module & module = entry->module;
+				if( module.failure.empty() || entry->root ) order.push_back( &module );
+				std::vector<Entry *> waits_for;
+				for( Entry::Import const & import : entry->imports ){
+					Entry * const imported = import.entry;
+					if( !imported->module.failure.empty() ){
+						if( module.failure.empty() ) module.import_diagnostics.Report( Support::DiagID::ModuleNotFound, import.offset );
+						continue;
+					}
+					if( std::find( module.imports.begin(), module.imports.end(), &imported->module ) == module.imports.end() ){
+						module.imports.push_back( &imported->module );
+					}
+					if( !imported->fresh ) continue;
+					if( imported->component == entry->component ){
+						if( import.closes_cycle ) module.import_diagnostics.Report( Support::DiagID::ImportCycle, import.offset );
+					} else if( std::find( waits_for.begin(), waits_for.end(), imported ) == waits_for.end() ){
+						waits_for.push_back( imported );
+						imported->importers.push_back( entry );
+					}
+				}
+				entry->waiting = waits_for.size();
+			}
+		}
+
+		void ModuleCache::Load( std::vector<std::string> const & paths )
+		{
+			std::lock_guard<std::mutex> loading( load_lock );
+			std::vector<Entry *> roots;
+			{
+				Support::TimeScope const scope( "Read imports" );
+				Round round;
+				for( std::string const & path : paths ){
+					bool created;
+					Entry & entry = Find( ResolvePath( path ), created );
+					if( created ){
+						round.Add();
+						pool.Submit( [this, &entry, &round]{ ReadImports( entry, round ); } );
+					}
+					if( entry.fresh ){
+						entry.root = true;
+						roots.push_back( &entry );
+					}
+				}
+				round.Wait();
+			}
+
+			std::vector<Entry *> fresh;
+			{
+				std::lock_guard<std::mutex> guard( lock );
+				for( auto const & entry : entries ) if( entry.second->fresh ) fresh.push_back( entry.second.get() );
+			}
+			Order( roots );
+
+			Support::TimeScope const scope( "Parse modules" );
+			Round round;
+			for( std::size_t i = 0; i < fresh.size(); ++i ) round.Add();
+			for( Entry * entry : fresh ){
+				if( entry->waiting == 0 ) pool.Submit( [this, entry, &round]{ ParseModule( *entry, round ); } );
+			}
+			round.Wait();
+			for( Entry * entry : fresh ) entry->fresh = false;
+		}
+
+		Module const & ModuleCache::Get( std::string const & path )
+		{
+			std::string const resolved = ResolvePath( path );
+			Entry * entry = nullptr;
+			{
+				std::lock_guard<std::mutex> guard( lock );
+				auto const found = entries.find( resolved );
+				if( found != entries.end() ) entry = found->second.get();
+			}
+			if( entry == nullptr ){
+				Load( std::vector<std::string>( 1, resolved ) );
+				std::lock_guard<std::mutex> guard( lock );
+				entry = entries[resolved].get();
+			}
+			entry->done.wait();
+			return entry->module;
+		}
+	} // namespace Parser
+} // namespace MaryLang
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Parser.hpp"
+#include "ParseCache.hpp"
+#include "../Utils/SourceManager.hpp"
+#include "../Utils/ThreadPool.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace Parser
+	{
+		// A source file of the build and what parsing it gave. The ModuleCache that loaded it
+		// owns it, at the same address, for as long as the cache lives.
+		struct Module
+		{
+			std::string						path;	// as the cache knows it: joined and normalized
+			Support::SourceManager			source;
+			std::shared_ptr<ParsedProgram>	program; // null unless the cache keeps programs
+			Support::Diagnostic				lexer_diagnostics;
+			Support::Diagnostic				diagnostics;		// the parser's
+			Support::Diagnostic				import_diagnostics;	// missing modules and import cycles
+			std::vector<Module const *>		imports;	// those that could be read, in import order
+			std::uint32_t					line_count;
+			std::string						failure;	// why the file could not be read; nothing else is set then
+			double							milliseconds; // reading and parsing it
+			bool							cached;		// taken from the parse cache instead
+			std::uint32_t					parse_microseconds; // when cached: what parsing it took once
+		};
+
+		// Loads modules and, transitively, what they import, each file once per cache however
+		// many modules import it. Loading goes in two rounds on the pool. First every file's
+		// imports are read, the files it names then being read in turn. Then the modules are
+		// parsed in dependency order: each after the modules it imports, those independent of
+		// each other at the same time. Modules importing each other are parsed without regard
+		// to order. Of the imports between them, only those a depth-first walk of the imports
+		// finds leading back to a module it is still inside are reported: one or more per
+		// cycle, and one for two modules importing each other.
+		struct ModuleCache
+		{
+			struct Options
+			{
+				bool				keep_programs;	// false: parse a statement at a time, keep only diagnostics
+				std::uint32_t		parallel_parse_bytes; // files this big have their bodies parsed on the pool too
+				ParseCache const *	parse_cache;	// null: none
+			};
+
+			ModuleCache( Support::ThreadPool & pool, Options const & options );
+			~ModuleCache();
+
+			ModuleCache( ModuleCache const & ) = delete;
+			ModuleCache & operator=( ModuleCache const & ) = delete;
+
+			// Loads `paths' and everything they import that is not loaded yet. One Load runs at
+			// a time; call it from outside the pool.
+			void Load( std::vector<std::string> const & paths );
+			// The module at `path', loaded first if it is not known. Asked for while another
+			// thread is loading it, it is waited for rather than parsed again.
+			Module const & Get( std::string const & path );
+
+			// Every module loaded, each after the ones it imports; files named but unreadable
+			// are included, with their failure, and imported ones are not.
+			std::vector<Module const *> const & Order() const { return order; }
+
+			// `path' with `.' and `..' taken out, and relative to `importer's directory if
+			// `importer' is given and `path' is not absolute.
+			static std::string ResolvePath( std::string const & path, std::string const & importer = std::string() );
+		private:
+			struct Entry;
+			struct Round;
+
+			Entry & Find( std::string const & path, bool & created );
+			void ReadImports( Entry & entry, Round & round );
+			void ParseModule( Entry & entry, Round & round );
+			void Order( std::vector<Entry *> const & roots );
+
+			Support::ThreadPool &	pool;
+			Options const			options;
+			std::mutex				lock; // guards `entries'
+			std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+			std::mutex				load_lock; // held by Load
+			std::vector<Module const *> order;
+		};
+	} // namespace Parser
+} // namespace MaryLang
@@ -0,0 +1,255 @@
+#include "ParseCache.hpp"
+#include "../Utils/SourceBuffer.hpp"
+#include "../Utils/TimeTrace.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined ( _WIN32 )
+#include <windows.h>
+#else
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MaryLang
+{
+	namespace Parser
+	{
+		namespace
+		{
+			struct EntryHeader
+			{
+				char			magic[4];
+				std::uint32_t	version;
+				std::uint64_t	key;
+				std::uint64_t	source_digest; // Digest of the source, which the key may share with another's
+				std::uint64_t	checksum; // of the whole entry, with this field zero
+				std::uint32_t	source_size;
+				std::uint32_t	line_count;
+				std::uint32_t	parse_microseconds;
+				std::uint32_t	tree_bytes;
+				std::uint32_t	lexer_diagnostics;
+				std::uint32_t	parser_diagnostics;
+				// the sizes of the enums the payload stores, in case a build changed one
+				// without bumping the version
+				std::uint32_t	token_types;
+				std::uint32_t	node_kinds;
+				std::uint32_t	diag_ids;
+				std::uint32_t	reserved;
+			};
+
+			static_assert( sizeof( EntryHeader ) == 72, "the payload must stay eight-byte aligned" );
+
+			char const entry_magic[4] = { 'M', 'P', 'C', '\0' };
+
+			// Mixes eight bytes at a time, like the string interner's hash, for some GB/s.
+			std::uint64_t Hash( char const * data, std::size_t size, std::uint64_t seed )
+			{
+				std::uint64_t const multiplier = 0x9E3779B97F4A7C15ull;
+				std::uint64_t hash = ( seed + size ) * multiplier;
+				for( ; size >= 8; data += 8, size -= 8 ){
+					std::uint64_t word;
+					std::memcpy( &word, data, 8 );
+					hash = ( hash ^ word ) * multiplier;
+					hash ^= hash >> 29;
+				}
+				if( size != 0 ){
+					std::uint64_t word = 0;
+					std::memcpy( &word, data, size );
+					hash = ( hash ^ word ) * multiplier;
+					hash ^= hash >> 29;
+				}
+				return hash ^ ( hash >> 32 );
+			}
+
+			inline std::uint64_t Rotate( std::uint64_t value, int bits )
+			{
+				return ( value << bits ) | ( value >> ( 64 - bits ) );
+			}
+
+			// A second hash of the source, independent of Hash: other constants, another mix
+			// and finalizer. An entry is only taken for a source that matches its key, its size
+			// and this, so two sources must collide on 128 bits to be confused.
+			std::uint64_t Digest( char const * data, std::size_t size )
+			{
+				std::uint64_t const multiplier = 0xC2B2AE3D27D4EB4Full;
+				std::uint64_t hash = 0x27D4EB2F165667C5ull ^ size;
+				for( ; size >= 8; data += 8, size -= 8 ){
+					std::uint64_t word;
+					std::memcpy( &word, data, 8 );
+					hash = Rotate( hash + word * multiplier, 31 ) * 0x9FB21C651E98DF25ull;
+				}
+				if( size != 0 ){
+					std::uint64_t word = 0;
+					std::memcpy( &word, data, size );
+					hash = Rotate( hash + word * multiplier, 31 ) * 0x9FB21C651E98DF25ull;
+				}
+				hash ^= hash >> 33;
+				hash *= 0xFF51AFD7ED558CCDull;
+				return hash ^ ( hash >> 33 );
+			}
+
+			// Of a whole entry, `blob', as if its checksum were zero.
+			std::uint64_t Checksum( char const * blob, std::size_t size )
+			{
+				EntryHeader header;
+				std::memcpy( &header, blob, sizeof( header ) );
+				header.checksum = 0;
+				std::uint64_t const hash = Hash( reinterpret_cast<char const *>( &header ), sizeof( header ), ParseCache::version );
+				return Hash( blob + sizeof( header ), size - sizeof( header ), hash );
+			}
+
+			void PutDiagnostics( std::vector<char> & out, Support::Diagnostic const & diagnostics )
+			{
+				for( Support::DiagRecord const & record : diagnostics ){
+					Support::DiagRecord copy;
+					std::memset( &copy, 0, sizeof( copy ) ); // no stray padding bytes in the file
+					copy.offset = record.offset;
+					copy.argument = record.argument;
+					copy.id = record.id;
+					copy.kind = record.kind;
+					char const * const bytes = reinterpret_cast<char const *>( &copy );
+					out.insert( out.end(), bytes, bytes + sizeof( copy ) );
+				}
+			}
+
+			bool GetDiagnostics( char const * & data, std::uint32_t count, std::uint32_t source_size, Support::Diagnostic & diagnostics )
+			{
+				diagnostics.Clear();
+				for( std::uint32_t i = 0; i < count; ++i, data += sizeof( Support::DiagRecord ) ){
+					Support::DiagRecord record;
+					std::memcpy( &record, data, sizeof( record ) );
+					if( static_cast<std::size_t>( record.id ) >= Support::diag_id_count || record.offset > source_size ) return false;
+					diagnostics.Report( record.id, record.offset, record.argument );
+				}
+				return true;
+			}
+
+			// Unique among the processes and threads that might store the same entry at once.
+			std::string TemporarySuffix()
+			{
+#if defined ( _WIN32 )
+				unsigned long const process = GetCurrentProcessId();
+#else
+				unsigned long const process = static_cast<unsigned long>( getpid() );
+#endif
+				return "." + std::to_string( process ) + "." + std::to_string( std::hash<std::thread::id>()( std::this_thread::get_id() ) ) + ".tmp";
+			}
+		} // namespace
+
+		bool ParseCache::Open( std::string const & path )
+		{
+			directory = path;
+#if defined ( _WIN32 )
+			if( CreateDirectoryA( path.c_str(), nullptr ) || GetLastError() == ERROR_ALREADY_EXISTS ){
+				DWORD const attributes = GetFileAttributesA( path.c_str() );
+				return attributes != INVALID_FILE_ATTRIBUTES && ( attributes & FILE_ATTRIBUTE_DIRECTORY ) != 0;
+			}
+			return false;
+#else
+			struct stat status;
+			if( mkdir( path.c_str(), 0777 ) != 0 && errno != EEXIST ) return false;
+			return stat( path.c_str(), &status ) == 0 && S_ISDIR( status.st_mode );
+#endif
+		}
+
+		std::uint64_t ParseCache::Key( Support::SourceManager const & source )
+		{
+			return Hash( source.Data(), source.Size(), version );
+		}
+
+		std::string ParseCache::EntryPath( std::uint64_t key ) const
+		{
+			char name[24];
+			std::snprintf( name, sizeof( name ), "%016llx.mpc", static_cast<unsigned long long>( key ) );
+			return directory + "/" + name;
+		}
+
+		bool ParseCache::Load( std::uint64_t key, Support::SourceManager const & source, ParseCacheEntry & entry ) const
+		{
+			Support::TimeScope const scope( "Cache load", source.FileName() );
+			Support::SourceBuffer file;
+			EntryHeader header;
+			if( !file.Open( EntryPath( key ).c_str() ) || file.Size() < sizeof( header ) ) return false;
+			std::memcpy( &header, file.Data(), sizeof( header ) );
+			std::size_t const diagnostics_bytes =
+				( std::size_t( header.lexer_diagnostics ) + header.parser_diagnostics ) * sizeof( Support::DiagRecord );
+			if( std::memcmp( header.magic, entry_magic, sizeof( entry_magic ) ) != 0 || header.version != version
+				|| header.key != key || header.source_size != source.Size()
+				|| header.source_digest != Digest( source.Data(), source.Size() )
+				|| header.token_types != Lexer::token_type_count || header.node_kinds != AbstractSyntaxTree::node_kind_count
+				|| header.diag_ids != Support::diag_id_count
+				|| file.Size() != sizeof( header ) + std::size_t( header.tree_bytes ) + diagnostics_bytes ){
+				return false;
+			}
+			if( Checksum( file.Data(), file.Size() ) != header.checksum ) return false;
+			char const * payload = file.Data() + sizeof( header );
+
+			if( !entry.tree.Deserialize( payload, header.tree_bytes, Support::StringRef( source.Data(), source.Size() ) ) ) return false;
+			payload += header.tree_bytes;
+			if( !GetDiagnostics( payload, header.lexer_diagnostics, source.Size(), entry.lexer_diagnostics )
+				|| !GetDiagnostics( payload, header.parser_diagnostics, source.Size(), entry.parser_diagnostics ) ){
+				return false;
+			}
+			entry.line_count = header.line_count;
+			entry.parse_microseconds = header.parse_microseconds;
+			return true;
+		}
+
+		bool ParseCache::Store( std::uint64_t key, Support::SourceManager const & source, AbstractSyntaxTree::FlatTree const & tree,
+			Support::Diagnostic const & lexer_diagnostics, Support::Diagnostic const & parser_diagnostics,
+			std::uint32_t parse_microseconds ) const
+		{
+			Support::TimeScope const scope( "Cache store", source.FileName() );
+			std::vector<char> blob( sizeof( EntryHeader ) );
+			tree.Serialize( blob );
+			std::size_t const tree_bytes = blob.size() - sizeof( EntryHeader );
+			PutDiagnostics( blob, lexer_diagnostics );
+			PutDiagnostics( blob, parser_diagnostics );
+
+			EntryHeader header;
+			std::memset( &header, 0, sizeof( header ) );
+			std::memcpy( header.magic, entry_magic, sizeof( entry_magic ) );
+			header.version = version;
+			header.key = key;
+			header.source_digest = Digest( source.Data(), source.Size() );
+			header.source_size = source.Size();
+			header.line_count = source.LineCount();
+			header.parse_microseconds = parse_microseconds;
+			header.tree_bytes = static_cast<std::uint32_t>( tree_bytes );
+			header.lexer_diagnostics = static_cast<std::uint32_t>( lexer_diagnostics.Count() );
+			header.parser_diagnostics = static_cast<std::uint32_t>( parser_diagnostics.Count() );
+			header.token_types = static_cast<std::uint32_t>( Lexer::token_type_count );
+			header.node_kinds = static_cast<std::uint32_t>( AbstractSyntaxTree::node_kind_count );
+			header.diag_ids = static_cast<std::uint32_t>( Support::diag_id_count );
+			std::memcpy( blob.data(), &header, sizeof( header ) );
+			header.checksum = Checksum( blob.data(), blob.size() );
+			std::memcpy( blob.data(), &header, sizeof( header ) );
+
+			// written aside and renamed over the entry, which is atomic
+			std::string const path = EntryPath( key );
+			std::string const temporary = path + TemporarySuffix();
+			{
+				std::ofstream file( temporary, std::ios::binary | std::ios::trunc );
+				file.write( blob.data(), static_cast<std::streamsize>( blob.size() ) );
+				if( !file.flush() ){
+					file.close();
+					std::remove( temporary.c_str() );
+					return false;
+				}
+			}
+#if defined ( _WIN32 )
+			bool const renamed = MoveFileExA( temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+			bool const renamed = std::rename( temporary.c_str(), path.c_str() ) == 0;
+#endif
+			if( !renamed ) std::remove( temporary.c_str() );
+			return renamed;
+		}
+	} // namespace Parser
+} // namespace MaryLang
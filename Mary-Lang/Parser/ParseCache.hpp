@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../AbstractSyntaxTree/FlatTree.hpp"
+#include "../Utils/Diagnostics.hpp"
+#include "../Utils/SourceManager.hpp"
+#include <cstdint>
+#include <string>
+
+namespace MaryLang
+{
+	namespace Parser
+	{
+		// What a build needs of a parsed file, without lexing or parsing it again.
+		struct ParseCacheEntry
+		{
+			AbstractSyntaxTree::FlatTree	tree;
+			Support::Diagnostic				lexer_diagnostics;
+			Support::Diagnostic				parser_diagnostics;
+			std::uint32_t					line_count;
+			std::uint32_t					parse_microseconds; // what lexing and parsing took when stored
+		};
+
+		// A directory of parsed files, one per distinct source, named after a hash of the
+		// source bytes and the cache version. An entry is a header and the FlatTree's
+		// arrays as they lie in memory, followed by the diagnostics; loading maps the file
+		// and copies the arrays out, so a hit costs about as much as reading the source.
+		// The header holds a second, independent hash of the source, so a source whose key
+		// collides with another's does not get the other's tree, and a checksum of the whole
+		// entry. Anything that does not check out, from another version to a damaged file or
+		// another source, is simply a miss.
+		struct ParseCache
+		{
+			// Part of every key. Bump it whenever the parser's output changes: the tree's
+			// shape, the token types, node kinds or diagnostics, or how lines are counted.
+			static std::uint32_t const version = 5;
+
+			// Creates `directory' if need be; false if it cannot.
+			bool Open( std::string const & directory );
+
+			static std::uint64_t Key( Support::SourceManager const & source );
+			// False on a miss, leaving `entry' unspecified.
+			bool Load( std::uint64_t key, Support::SourceManager const & source, ParseCacheEntry & entry ) const;
+			// Replaces the entry at once, so readers never see half of one. False if it cannot
+			// be written, which only costs the next build the parse.
+			bool Store( std::uint64_t key, Support::SourceManager const & source, AbstractSyntaxTree::FlatTree const & tree,
+				Support::Diagnostic const & lexer_diagnostics, Support::Diagnostic const & parser_diagnostics,
+				std::uint32_t parse_microseconds ) const;
+		private:
+			std::string EntryPath( std::uint64_t key ) const;
+
+			std::string directory;
+		};
+	} // namespace Parser
+} // namespace MaryLang
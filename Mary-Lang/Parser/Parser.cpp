@@ -1,49 +1,402 @@
 #include "Parser.hpp"
-#include <cassert>
+#include "../Utils/TimeTrace.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <utility>
 
 namespace MaryLang
 {
 	namespace Parser
 	{
-		Parser::Parser( Scanner & lex ): lexer( lex ) {}
-		Parser::~Parser() {}
+		namespace
+		{
+			struct BinaryOperator
+			{
+				std::uint8_t	precedence; // 0: not a binary operator
+				bool			right_assoc;
+			};
+
+			// C++'s binary operators from loosest to tightest, with `**' above `*'.
+			// Assignment, `?:' and `,' bind looser still and have parse functions of their own.
+			constexpr BinaryOperator ClassifyBinaryOperator( TokenType tt )
+			{
+				switch( tt )
+				{
+				case TokenType::TK_LOR:		return BinaryOperator{ 1, false };
+				case TokenType::TK_LAND:	return BinaryOperator{ 2, false };
+				case TokenType::TK_OR:		return BinaryOperator{ 3, false };
+				case TokenType::TK_XOR:		return BinaryOperator{ 4, false };
+				case TokenType::TK_AND:		return BinaryOperator{ 5, false };
+				case TokenType::TK_EQL:
+				case TokenType::TK_NOTEQL:	return BinaryOperator{ 6, false };
+				case TokenType::TK_LESS:
+				case TokenType::TK_GREATER:
+				case TokenType::TK_LEQL:
+				case TokenType::TK_GEQL:	return BinaryOperator{ 7, false };
+				case TokenType::TK_LSHIFT:
+				case TokenType::TK_RSHIFT:	return BinaryOperator{ 8, false };
+				case TokenType::TK_ADD:
+				case TokenType::TK_SUB:		return BinaryOperator{ 9, false };
+				case TokenType::TK_MUL:
+				case TokenType::TK_DIV:
+				case TokenType::TK_MODULO:	return BinaryOperator{ 10, false };
+				case TokenType::TK_EXP:		return BinaryOperator{ 11, true };
+				default:					return BinaryOperator{ 0, false };
+				}
+			}
+
+			template<std::size_t... I>
+			constexpr std::array<BinaryOperator, sizeof...( I )> MakeOperatorTable( std::index_sequence<I...> )
+			{
+				return {{ ClassifyBinaryOperator( static_cast<TokenType>( I ) )... }};
+			}
+
+			// One entry per TokenType, so finding an operator's precedence is a single load.
+			constexpr std::array<BinaryOperator, token_type_count> binary_operators =
+				MakeOperatorTable( std::make_index_sequence<token_type_count>() );
+
+			static_assert( binary_operators[static_cast<std::size_t>( TokenType::TK_EXP )].right_assoc,
+				"** is right associative" );
+
+			// Frames on the operator stack that are not binary operators.
+			std::uint8_t const open_paren = 0; // looser than everything, never reduced past
+			std::uint8_t const prefix_operator = 0xFF; // tighter than every binary operator
+
+			inline BinaryOperator GetBinaryOperator( TokenType tt )
+			{
+				return binary_operators[static_cast<std::size_t>( tt )];
+			}
+
+			inline bool IsPrefixOperator( TokenType tt )
+			{
+				switch( tt )
+				{
+				case TokenType::TK_ADD:
+				case TokenType::TK_SUB:
+				case TokenType::TK_NOT:
+				case TokenType::TK_NEG:
+				case TokenType::TK_INCREMENT:
+				case TokenType::TK_DECREMENT:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			inline bool IsAssignmentOperator( TokenType tt )
+			{
+				switch( tt )
+				{
+				case TokenType::TK_ASSIGN:
+				case TokenType::TK_MULEQL:
+				case TokenType::TK_DIVEQL:
+				case TokenType::TK_MODASSIGN:
+				case TokenType::TK_ADDEQL:
+				case TokenType::TK_SUBEQL:
+				case TokenType::TK_LSASSIGN:
+				case TokenType::TK_RSASSIGN:
+				case TokenType::TK_ANDEQL:
+				case TokenType::TK_XORASSIGN:
+				case TokenType::TK_OREQL:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			// Where panic mode stops: nothing but a statement begins with these.
+			inline bool IsStatementKeyword( TokenType tt )
+			{
+				switch( tt )
+				{
+				case TokenType::TK_IF:
+				case TokenType::TK_FOR:
+				case TokenType::TK_DO:
+				case TokenType::TK_WHILE:
+				case TokenType::TK_CHECK:
+				case TokenType::TK_RETURN:
+				case TokenType::TK_CONTINUE:
+				case TokenType::TK_LEAVE:
+				case TokenType::TK_VAR:
+				case TokenType::TK_CLASS:
+				case TokenType::TK_ENUM:
+				case TokenType::TK_NAMESPACE:
+				case TokenType::TK_FUNCTION:
+				case TokenType::TK_CONSTRUCT:
+				case TokenType::TK_ISIT:
+				case TokenType::TK_IMPORT:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			// The same for class members, which may also begin with a type or a specifier.
+			inline bool IsMemberStart( TokenType tt )
+			{
+				switch( tt )
+				{
+				case TokenType::TK_VAR:
+				case TokenType::TK_CLASS:
+				case TokenType::TK_ENUM:
+				case TokenType::TK_FUNCTION:
+				case TokenType::TK_CONSTRUCT:
+				case TokenType::TK_INT:
+				case TokenType::TK_DOUBLE:
+				case TokenType::TK_STRING:
+				case TokenType::TK_BOOLEAN:
+				case TokenType::TK_PUBLIC:
+				case TokenType::TK_PRIVATE:
+				case TokenType::TK_PROTECTED:
+				case TokenType::TK_STATIC:
+				case TokenType::TK_VIRTUAL:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			// Stands in for an optional token that is not there, e.g. a missing return type.
+			inline Token NoToken( std::uint32_t offset )
+			{
+				return Token( offset, 0, TokenType::TK_INVALID );
+			}
+
+			// One level of the parser's recursion, for --stats.
+			struct Nesting
+			{
+				Nesting( std::uint32_t & current, std::uint32_t & deepest ): depth( current )
+				{
+					if( ++depth > deepest ) deepest = depth;
+				}
+				~Nesting() { --depth; }
+			private:
+				std::uint32_t & depth;
+			};
+
+			// Function bodies parsed together by one worker, and what came of them.
+			struct BodyBatch
+			{
+				std::size_t						first, last; // into BodyWork::functions
+				std::shared_ptr<ParsedProgram>	program; // owns the nodes
+				Support::Diagnostic				errors;
+				std::exception_ptr				failure;
+			};
+
+			// The bodies a parallel parse hands out. Workers and the parsing thread claim
+			// batches until none are left, so the parse finishes even when every worker of
+			// the pool is busy elsewhere; a worker that starts late just finds nothing to do.
+			struct BodyWork
+			{
+				explicit BodyWork( Support::SourceManager const & src )
+					: source( src ), functions(), batches(), next( 0 ), done( 0 ) {}
+
+				void Drain()
+				{
+					for( ; ; ){
+						std::size_t const index = next.fetch_add( 1 );
+						if( index >= batches.size() ) return;
+						BodyBatch & batch = batches[index];
+						Support::TimeScope const scope( "Parse bodies", source.FileName() );
+						try {
+							Scanner scanner( source, functions[batch.first]->BodyBegin() );
+							Parser parser( scanner );
+							for( std::size_t i = batch.first; i < batch.last; ++i ){
+								parser.ParseFunctionBody( *functions[i] );
+							}
+							batch.program = parser.Program();
+							batch.errors.Append( parser.Diagnostics() );
+						} catch( ... ) {
+							batch.failure = std::current_exception();
+						}
+						std::lock_guard<std::mutex> guard( lock );
+						if( ++done == batches.size() ) finished.notify_all();
+					}
+				}
+
+				void Wait()
+				{
+					std::unique_lock<std::mutex> guard( lock );
+					finished.wait( guard, [this]{ return done == batches.size(); } );
+				}
+
+				Support::SourceManager const &			source;
+				std::vector<FunctionDeclaration const *> functions;
+				std::vector<BodyBatch>					batches;
+				std::atomic<std::size_t>				next;
+				std::size_t								done; // guarded by `lock'
+				std::mutex								lock;
+				std::condition_variable					finished;
+			};
+		} // namespace
+
+		Parser::Parser( Scanner & lex, bool emit_flat_tree )
+			: Parser( lex, nullptr, emit_flat_tree ) {}
+		Parser::Parser( Scanner & lex, Token const * lexed, bool emit_flat_tree )
+			: tokens( lex, lexed ), program( std::make_shared<ParsedProgram>() ),
+			factory( program->Arena(), emit_flat_tree ? program->EnableFlatTree() : nullptr ), lexer( lex ),
+			diagnostics(), skim_function_bodies( false ), bodies_parsed_after( false ), imports_parsed( false ),
+			keep_statements( false ), recovering( false ), last_error( UINT32_MAX ), previous_token_end( 0 ),
+			previous_token_type( TokenType::TK_INVALID ), depth( 0 ), deepest( 0 ) {}
+		Parser::~Parser()
+		{
+			if( Support::Statistics::Shard * const stats = Support::Statistics::Local() ){
+				stats->max_parse_depth = std::max( stats->max_parse_depth, deepest );
+			}
+		}
+
+		std::shared_ptr<ParsedProgram> Parser::Parse()
+		{
+			Support::TimeScope const scope( "Parse", lexer.FileName() );
+			return ParseProgram();
+		}
+
+		std::shared_ptr<ParsedProgram> Parser::Parse( Support::ThreadPool & pool, std::size_t batch_bytes )
+		{
+			bool const skim = skim_function_bodies;
+			skim_function_bodies = true;
+			bodies_parsed_after = !skim;
+			{
+				Support::TimeScope const scope( "Skim", lexer.FileName() );
+				ParseProgram();
+			}
+			skim_function_bodies = skim;
+			bodies_parsed_after = false;
+			if( skim || skimmed_functions.empty() ) return program;
+
+			auto work = std::make_shared<BodyWork>( lexer.Source() );
+			work->functions.swap( skimmed_functions );
+			std::vector<FunctionDeclaration const *> const & functions = work->functions;
+			for( std::size_t first = 0; first < functions.size(); ){
+				std::size_t last = first;
+				std::size_t bytes = 0;
+				while( last < functions.size() && ( bytes < batch_bytes || last == first ) ){
+					bytes += functions[last]->BodyEnd() - functions[last]->BodyBegin();
+					++last;
+				}
+				work->batches.push_back( BodyBatch{ first, last, nullptr, Support::Diagnostic(), nullptr } );
+				first = last;
+			}
+
+			std::size_t const helpers = std::min<std::size_t>( pool.Size(), work->batches.size() - 1 );
+			for( std::size_t i = 0; i < helpers; ++i ){
+				pool.Submit( [work]{ work->Drain(); } );
+			}
+			work->Drain();
+			work->Wait();
+
+			// merged in source order, whichever worker got there first
+			Support::TimeScope const scope( "Merge bodies", lexer.FileName() );
+			Support::Diagnostic merged;
+			for( BodyBatch & batch : work->batches ){
+				if( batch.failure ) std::rethrow_exception( batch.failure );
+				program->Arena().Adopt( batch.program->Arena() );
+				merged.Append( batch.errors );
+			}
+			merged.Append( diagnostics );
+			merged.SortByOffset();
+			// a body left open reports the missing `}' at the end of the file, and then nothing
+			// more is reported there, as Parse() would have parsed on from that body
+			diagnostics.Clear();
+			std::uint32_t previous = UINT32_MAX;
+			for( Support::DiagRecord const & record : merged ){
+				if( record.offset == previous && record.kind == Support::DiagKind::Error ) continue;
+				if( record.kind == Support::DiagKind::Error ) previous = record.offset;
+				diagnostics.Report( record.id, record.offset, record.argument );
+			}
+			return program;
+		}
+
+		inline bool Parser::Accept( TokenType tt )
+		{
+			if( tokens.Peek().Type() != tt ) return false;
+			NextToken();
+			return true;
+		}
 
 		inline void Parser::Expect( TokenType tt )
 		{
-			assert( tt == current_token->Type() && "expecting ..." );
-			Accept( tt );
+			if( !Accept( tt ) ){
+				Report( Support::DiagID::ExpectedToken, tokens.Peek(), tt );
+			}
 		}
 
-		inline void Parser::Accept( TokenType tt )
+		bool Parser::ExpectOpeningBrace()
 		{
+			if( tokens.Peek().Type() != TokenType::TK_LBRACE ){
+				Report( Support::DiagID::ExpectedToken, tokens.Peek(), TokenType::TK_LBRACE );
+				for( ; ; NextToken() ){
+					TokenType const tt = tokens.Peek().Type();
+					if( tt == TokenType::TK_LBRACE ) break;
+					if( tt == TokenType::TK_SEMICOLON || tt == TokenType::TK_RBRACE || tt == TokenType::TK_EOF
+						|| IsStatementKeyword( tt ) ) return false;
+				}
+			}
 			NextToken();
+			recovering = false; // whatever came before, the block starts afresh
+			return true;
+		}
+
+		inline void Parser::Report( Support::DiagID id, Token const & at, TokenType expected )
+		{
+			if( recovering ) return;
+			recovering = true;
+			if( at.Offset() == last_error ) return; // what parsed on from there only stumbled on it again
+			last_error = at.Offset();
+			diagnostics.Report( id, at.Offset(), static_cast<std::uint32_t>( expected ) );
 		}
 
 		void Parser::NextToken()
 		{
-			current_token.reset( next_token.release() );
-			next_token.reset( new Token( lexer.GetNextToken() ) );
+			previous_token_end = tokens.Peek().Offset() + tokens.Peek().Length();
+			previous_token_type = tokens.Peek().Type();
+			tokens.Advance();
+		}
+
+		// Every token is skipped at most once, so a file full of errors still parses in
+		// linear time.
+		void Parser::Synchronize( std::uint32_t offset, bool members )
+		{
+			// a statement that got as far as its `;' or `}' has ended, whatever went wrong in it
+			bool const ended = previous_token_end > offset
+				&& ( previous_token_type == TokenType::TK_SEMICOLON || previous_token_type == TokenType::TK_RBRACE );
+			if( !ended ){
+				for( ; ; NextToken() ){
+					TokenType const tt = tokens.Peek().Type();
+					if( tt == TokenType::TK_SEMICOLON ){
+						NextToken();
+						break;
+					}
+					// a `}' is left to the block it closes, and a `{' opens one, never skipped
+					if( tt == TokenType::TK_EOF || tt == TokenType::TK_LBRACE || tt == TokenType::TK_RBRACE ) break;
+					if( members ? IsMemberStart( tt ) : IsStatementKeyword( tt ) ) break;
+				}
+			}
+			recovering = false;
 		}
 
+		// Loops over statements or members call this with where an iteration started, so
+		// that a token no rule wants is skipped instead of being looked at forever.
+		inline void Parser::EnsureProgress( std::uint32_t offset )
+		{
+			if( tokens.Peek().Offset() == offset && tokens.Peek().Type() != TokenType::TK_EOF ){
+				NextToken();
+			}
+		}
 
-		// To-Do. List all C++'s operator precedence rules.
 		Parser::PrecAssocPair Parser::GetPrecedence( TokenType tt )
 		{
-			switch( tt )
-			{
-			case TokenType::TK_ADD:
-			case TokenType::TK_SUB: return PrecAssocPair( 1, Associativity::LEFT_ASSOC );
-			case TokenType::TK_MUL:
-			case TokenType::TK_DIV: return PrecAssocPair( 2, Associativity::LEFT_ASSOC );
-			case TokenType::TK_EXP:	return PrecAssocPair( 3, Associativity::RIGHT_ASSOC );
-			default: return PrecAssocPair( -1, Associativity::NONE_ASSOC );
-			}
+			BinaryOperator const op = GetBinaryOperator( tt );
+			if( op.precedence == 0 ) return PrecAssocPair( -1, Associativity::NONE_ASSOC );
+			return PrecAssocPair( op.precedence, op.right_assoc ? Associativity::RIGHT_ASSOC : Associativity::LEFT_ASSOC );
 		}
 
 		std::shared_ptr<ParsedProgram> Parser::ParseProgram()
 		{
-			NextToken();
-			NextToken();
 			ParseImports();
 			ParseSourceElement();
 			Expect( TokenType::TK_EOF );
@@ -52,75 +405,178 @@ namespace MaryLang
 
 		void Parser::ParseSourceElement()
 		{
-			program.reset( new ParsedProgram );
-			while( current_token->Type() != TokenType::TK_EOF )
+			std::size_t const mark = statements.size();
+			while( tokens.Peek().Type() != TokenType::TK_EOF )
 			{
-				program->Append( ParseStatement() );
+				std::uint32_t const offset = tokens.Peek().Offset();
+				statements.push_back( ParseStatement() );
+				if( recovering ) Synchronize( offset );
+				EnsureProgress( offset );
+			}
+			List<Statement> const source_program = factory.GetList<Statement>( statements.data() + mark, statements.size() - mark );
+			statements.resize( mark );
+			program->SetSourceProgram( source_program );
+			factory.SetProgram( source_program, program->SourceImports() );
+		}
+
+		Statement const * Parser::ParseNextStatement()
+		{
+			if( !keep_statements ){
+				if( !program->SourceProgram().Empty() ){ // the statement returned before
+					program->Clear();
+					skimmed_functions.clear();
+				}
+				// and its source, which a scanner over a stream need not keep any more
+				lexer.Release( tokens.Peek().Offset() );
 			}
+			ParseImports();
+			Statement const * statement = nullptr;
+			while( statement == nullptr ){ // an empty statement, `;', is no end
+				if( tokens.Peek().Type() == TokenType::TK_EOF ) return nullptr;
+				std::uint32_t const offset = tokens.Peek().Offset();
+				statement = ParseStatement();
+				// now, so that the next call starts where a parser started there would
+				if( recovering ) Synchronize( offset );
+				EnsureProgress( offset );
+			}
+			if( keep_statements ) return statement;
+			// the program and its flat tree now are this statement alone
+			List<Statement> const source_program = factory.GetList<Statement>( &statement, 1 );
+			program->SetSourceProgram( source_program );
+			factory.SetProgram( source_program, program->SourceImports() );
+			return statement;
 		}
 
-		// To-Do -> Still contemplating on what to use:Python's import...from OR C#'s "uses" or use include...from
-		void Parser::ParseImports()
+		List<Imports> const & Parser::ParseImports()
 		{
+			if( !imports_parsed ){
+				imports_parsed = true;
+				std::vector<Imports const *> imports;
+				while( tokens.Peek().Type() == TokenType::TK_IMPORT ){
+					if( Imports const * import = ParseImport() ) imports.push_back( import );
+				}
+				program->SetSourceImports( factory.GetList<Imports>( imports ) );
+			}
+			return program->SourceImports();
+		}
 
+		// `import "path";'; null if the path is missing.
+		Imports const * Parser::ParseImport()
+		{
+			Token const token = tokens.Peek();
+			NextToken(); // consume "import"
+			Token const path = tokens.Peek();
+			Imports const * import = nullptr;
+			if( Accept( TokenType::TK_STRLITERAL ) ){
+				import = factory.GetImports( token, path );
+			} else {
+				Report( Support::DiagID::ExpectedModulePath, path );
+			}
+			Expect( TokenType::TK_SEMICOLON );
+			return import;
 		}
 
-		std::unique_ptr<Statement> Parser::ParseCompoundStatement()
+		Statement const * Parser::ParseCompoundStatement()
 		{
-			Expect( TokenType::TK_LBRACE ); // consume "{"
-			auto statement = ASTFactory::GetCompoundStatement( *current_token );
-			while( current_token->Type() != TokenType::TK_EOF && current_token->Type() != TokenType::TK_RBRACE )
-			{
-				statement->Append( ParseStatement() );
+			Token const token = tokens.Peek();
+			std::size_t const mark = statements.size();
+			if( ExpectOpeningBrace() ){ // consume "{"
+				while( tokens.Peek().Type() != TokenType::TK_EOF && tokens.Peek().Type() != TokenType::TK_RBRACE )
+				{
+					std::uint32_t const offset = tokens.Peek().Offset();
+					statements.push_back( ParseStatement() );
+					if( recovering ) Synchronize( offset );
+					EnsureProgress( offset );
+				}
+				Expect( TokenType::TK_RBRACE ); // consume "}"
 			}
-			Accept( TokenType::TK_RBRACE ); // consume "}"
-			return std::move( statement );
+			List<Statement> const body = factory.GetList<Statement>( statements.data() + mark, statements.size() - mark );
+			statements.resize( mark );
+			return factory.GetCompoundStatement( token, body );
 		}
 
-		std::unique_ptr<Statement> Parser::ParseCheckAmongStatement()
+		// Steps over a "{ ... }" by matching braces, building nothing.
+		void Parser::SkimCompoundStatement()
 		{
-			Token const token = *current_token;
+			std::size_t depth = 0;
+			do {
+				switch( tokens.Peek().Type() )
+				{
+				case TokenType::TK_LBRACE:
+					++depth;
+					break;
+				case TokenType::TK_RBRACE:
+					--depth;
+					break;
+				case TokenType::TK_EOF:
+					if( !bodies_parsed_after ){
+						Report( Support::DiagID::ExpectedToken, tokens.Peek(), TokenType::TK_RBRACE );
+					} else {
+						// a body parsed after reports this itself, if it is not recovering from an
+						// error already; either way the parse goes on recovering, as it will then
+						recovering = true;
+					}
+					return;
+				default:
+					break;
+				}
+				NextToken();
+			} while( depth != 0 );
+		}
+
+		Statement const * Parser::ParseCheckAmongStatement()
+		{
+			Token const token = tokens.Peek();
 			Expect( TokenType::TK_CHECK ); // consume "check"
 			Expect( TokenType::TK_LPAREN ); // consume "("
-			std::unique_ptr<Expression>expression = ParseExpression();
+			Expression const * expression = ParseExpression();
 			Expect( TokenType::TK_RPAREN ); //consume ")"
 			Expect( TokenType::TK_AMONG ); // consume "among"
 			auto statement_body = ParseCompoundStatement();
 
-			return ASTFactory::GetCheckAmongStatement( token, std::move( expression ), std::move( statement_body ) );
+			return factory.GetCheckAmongStatement( token, expression, statement_body );
 		}
 
-		std::unique_ptr<Statement> Parser::ParseConditionalStatement()
+		Statement const * Parser::ParseConditionalStatement()
 		{
-			Token const token ( *current_token );
+			Token const token ( tokens.Peek() );
 			Accept( TokenType::TK_IF ); // consume "if"
 			Expect( TokenType::TK_LPAREN ); // consume "("
-			std::unique_ptr<Expression> conditional_expression;
-			std::unique_ptr<Declaration> declaration;
-			if( current_token->Type() == TokenType::TK_VAR ){
-				declaration = ParseDeclarationStatement( );
+			Expression const * conditional_expression = nullptr;
+			Declaration const * declaration = nullptr;
+			if( IsDeclarationStart() ){
+				declaration = ParseVariableDeclaration();
 			} else {
 				conditional_expression = ParseExpression();
 			}
 			Expect( TokenType::TK_RPAREN );
-			std::unique_ptr<Statement> statement_body = ParseStatement();
-			std::unique_ptr<Statement> else_body = nullptr;
-			if( current_token->Type() == TokenType::TK_ELSE ){
-				Accept( TokenType::TK_ELSE );
+			Statement const * statement_body = ParseStatement();
+			Statement const * else_body = nullptr;
+			if( Accept( TokenType::TK_ELSE ) ){
 				else_body = ParseStatement();
 			}
-			return ASTFactory::GetIfStatement( token, std::move( conditional_expression ), 
-				std::move( declaration ), std::move( statement_body ), std::move( else_body ) );
+			return factory.GetIfStatement( token, conditional_expression,
+				declaration, statement_body, else_body );
 		}
 
-		inline std::unique_ptr<Statement> Parser::ParseDeclarationStatement()
+		Statement const * Parser::ParseDeclarationStatement()
 		{
-			return ASTFactory::GetDeclarationStatement( *current_token, ParseDeclaration() );
+			Token const token = tokens.Peek();
+			bool const is_variable = !( token.Type() == TokenType::TK_CLASS || token.Type() == TokenType::TK_ENUM
+				|| token.Type() == TokenType::TK_NAMESPACE || token.Type() == TokenType::TK_FUNCTION
+				|| token.Type() == TokenType::TK_CONSTRUCT );
+			Declaration const * declaration = ParseDeclaration();
+			if( is_variable ){
+				Expect( TokenType::TK_SEMICOLON );
+			} else {
+				Accept( TokenType::TK_SEMICOLON ); // "class A { };"
+			}
+			return factory.GetDeclarationStatement( token, declaration );
 		}
 
-		inline std::unique_ptr<Declaration> Parser::ParseDeclaration()
+		inline Declaration const * Parser::ParseDeclaration()
 		{
-			switch( current_token->Type() )
+			switch( tokens.Peek().Type() )
 			{
 			case TokenType::TK_CLASS:
 				return ParseClassDeclaration();
@@ -131,9 +587,30 @@ namespace MaryLang
 			}
 		}
 
-		inline std::unique_ptr<Statement> Parser::ParseIterativeStatement()
+		inline bool Parser::IsBuiltInType( TokenType tt ) const
+		{
+			switch( tt )
+			{
+			case TokenType::TK_INT:
+			case TokenType::TK_DOUBLE:
+			case TokenType::TK_STRING:
+			case TokenType::TK_BOOLEAN:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// `var ...', `int ...', or `SomeClass name ...'
+		inline bool Parser::IsDeclarationStart() const
+		{
+			return tokens.Peek().Type() == TokenType::TK_VAR || IsBuiltInType( tokens.Peek().Type() ) ||
+				( tokens.Peek().Type() == TokenType::TK_IDENTIFIER && tokens.Peek( 1 ).Type() == TokenType::TK_IDENTIFIER );
+		}
+
+		inline Statement const * Parser::ParseIterativeStatement()
 		{
-			switch( current_token->Type() )
+			switch( tokens.Peek().Type() )
 			{
 			case TokenType::TK_FOR:
 				return ParseForStatement();
@@ -144,100 +621,92 @@ namespace MaryLang
 			}
 		}
 
-		std::unique_ptr<Statement> Parser::ParseWhileStatement()
+		Statement const * Parser::ParseWhileStatement()
 		{
-			Token const token = *current_token;
+			Token const token = tokens.Peek();
 
 			Accept( TokenType::TK_WHILE );
-			if( current_token->Type() == TokenType::TK_LPAREN ){
-				Accept( current_token->Type() );
+			if( tokens.Peek().Type() == TokenType::TK_LPAREN ){
+				Accept( tokens.Peek().Type() );
 			} else {
-				error_messages->Propagate( *current_token, L"Expected an opening parenthesis before the expression" );
+				Report( Support::DiagID::ExpectedToken, tokens.Peek(), TokenType::TK_LPAREN );
 			}
-			std::unique_ptr<Expression> expression = ParseExpression();
+			Expression const * expression = ParseExpression();
 			Expect( TokenType::TK_RPAREN );
 			auto statement = ParseStatement();
 
-			return ASTFactory::GetWhileStatement( token, std::move( expression ), std::move( statement ) );
+			return factory.GetWhileStatement( token, expression, statement );
 		}
 
-		std::unique_ptr<Statement> Parser::ParseDoWhileStatement()
+		Statement const * Parser::ParseDoWhileStatement()
 		{
-			Token const token = *current_token;
+			Token const token = tokens.Peek();
 			Accept( TokenType::TK_DO );
-			std::unique_ptr<Statement> statement = ParseStatement();
+			Statement const * statement = ParseStatement();
 			Expect( TokenType::TK_WHILE );
-			if( current_token->Type() != TokenType::TK_LPAREN ){
-				error_messages->Propagate( token, L"Expected '(' before expression" );
+			if( tokens.Peek().Type() != TokenType::TK_LPAREN ){
+				Report( Support::DiagID::ExpectedToken, token, TokenType::TK_LPAREN );
 			} else {
 				Accept( TokenType::TK_LPAREN );
 			}
-			std::unique_ptr<Expression> expression = ParseExpression();
-			if( current_token->Type() != TokenType::TK_RPAREN ){
-				error_messages->Propagate( *current_token, L"Expected ')' before expression" );
+			Expression const * expression = ParseExpression();
+			if( tokens.Peek().Type() != TokenType::TK_RPAREN ){
+				Report( Support::DiagID::ExpectedToken, tokens.Peek(), TokenType::TK_RPAREN );
 			} else {
 				Accept( TokenType::TK_RPAREN );
 			}
-			Accept( TokenType::TK_SEMICOLON );
-			return ASTFactory::GetDoWhileStatement( token, std::move( expression ), std::move( statement ) );
+			Expect( TokenType::TK_SEMICOLON );
+			return factory.GetDoWhileStatement( token, expression, statement );
 		}
 
-		std::unique_ptr<Statement> Parser::ParseForStatement()
+		Statement const * Parser::ParseForStatement()
 		{
-			Token const token = *current_token;
+			Token const token = tokens.Peek();
 			Accept( TokenType::TK_FOR ); // consume "for"
-			Accept( TokenType::TK_LPAREN ); //consume "("
+			Expect( TokenType::TK_LPAREN ); //consume "("
 
-			std::unique_ptr<Declaration> declaration = nullptr;
-			std::unique_ptr<Expression> init_expression = nullptr;
-			std::unique_ptr<Expression> rhs_expression = nullptr;
-			std::unique_ptr<Expression> step = nullptr;
-			std::unique_ptr<Expression> condition = nullptr;
+			Declaration const * declaration = nullptr;
+			Expression const * init_expression = nullptr;
+			Expression const * rhs_expression = nullptr;
+			Expression const * step = nullptr;
+			Expression const * condition = nullptr;
 
-			if( IsBuiltInType( current_token->Type() ) || 
-				( current_token->Type() == TokenType::TK_IDENTIFIER && next_token->Type() == TokenType::TK_IDENTIFIER ) )
-			{
-				declaration = ParseVariableDeclaration();
-			} else {
-				if( TokenType::TK_SEMICOLON != current_token->Type() ){
-					init_expression = ParseExpression();
-				} else if( TokenType::TK_SEMICOLON == current_token->Type() ) {
-					Accept( TokenType::TK_SEMICOLON );
-				} else {
-					error_messages->Propagate( token, L"" );
-					while( current_token->Type() != TokenType::TK_SEMICOLON ) NextToken();
-				}
+			if( IsDeclarationStart() ){
+				declaration = ParseVariableDeclaration( false ); // a ':' here starts the range
+			} else if( TokenType::TK_SEMICOLON != tokens.Peek().Type() ){
+				init_expression = ParseExpression();
 			}
-			if( current_token->Type() == TokenType::TK_COLON ){ //for constructs like "for( var c : d )"
-				Accept( current_token->Type() ); // consume ":"
+			if( tokens.Peek().Type() == TokenType::TK_COLON ){ //for constructs like "for( var c : d )"
+				Accept( tokens.Peek().Type() ); // consume ":"
 				rhs_expression = ParseExpression();
 			} else {
-				Accept( TokenType::TK_SEMICOLON );
-				if( current_token->Type() != TokenType::TK_SEMICOLON ){
+				Expect( TokenType::TK_SEMICOLON );
+				if( tokens.Peek().Type() != TokenType::TK_SEMICOLON ){
 					condition = ParseExpression();
 				}
 				Expect( TokenType::TK_SEMICOLON );
-				if( current_token->Type() != TokenType::TK_RPAREN ){
+				if( tokens.Peek().Type() != TokenType::TK_RPAREN ){
 					step = ParseExpression();
 				}
 			}
-			Accept( TokenType::TK_RPAREN );
-			std::unique_ptr<Statement> statement = ParseStatement();
+			Expect( TokenType::TK_RPAREN );
+			Statement const * statement = ParseStatement();
 
-			if( rhs_expression == nullptr ){ // we have "for( : )" construct
-				return ASTFactory::GetForInStatement( token, std::move( declaration ), std::move( init_expression ),
-					std::move( rhs_expression ), std::move( statement ) );
+			if( rhs_expression != nullptr ){ // we have "for( : )" construct
+				return factory.GetForInStatement( token, declaration, init_expression,
+					rhs_expression, statement );
 			} else {
-				return ASTFactory::GetForStatement( token, std::move( declaration ), std::move( init_expression ), 
-					std::move( condition ), std::move( step ), std::move( statement ) );
+				return factory.GetForStatement( token, declaration, init_expression,
+					condition, step, statement );
 			}
 		}
 
-		std::unique_ptr<Declaration> Parser::ParseOtherDeclaration()
+		Declaration const * Parser::ParseOtherDeclaration()
 		{
-			switch( current_token->Type() )
+			switch( tokens.Peek().Type() )
 			{
 			case TokenType::TK_FUNCTION:
+			case TokenType::TK_CONSTRUCT:
 				return ParseFunctionDeclaration();
 			case TokenType::TK_NAMESPACE:
 				return ParseNamespaceDeclaration();
@@ -246,241 +715,523 @@ namespace MaryLang
 			}
 		}
 
-		std::unique_ptr<Declaration> Parser::ParseNamespaceDeclaration()
+		Declaration const * Parser::ParseNamespaceDeclaration()
 		{
-			Token const token = *current_token;
+			Token const token = tokens.Peek();
 			Accept( TokenType::TK_NAMESPACE );
-			std::unique_ptr<Token> namespace_name = nullptr;
-			if( current_token->Type() == TokenType::TK_IDENTIFIER ){
-				namespace_name.reset( new Token( *current_token ) );
+			Token const * namespace_name = nullptr;
+			if( tokens.Peek().Type() == TokenType::TK_IDENTIFIER ){
+				namespace_name = factory.GetToken( tokens.Peek() );
 				Accept( TokenType::TK_IDENTIFIER );
 			}
-			std::unique_ptr<Statement> namespace_body = ParseCompoundStatement();
-			return ASTFactory::GetNamespaceDeclaration( token, std::move( namespace_name ), std::move( namespace_body ) );
+			Statement const * namespace_body = ParseCompoundStatement();
+			return factory.GetNamespaceDeclaration( token, namespace_name, namespace_body );
+		}
+
+		// `var a [: type] [= init], ...' or `type a [= init], ...'
+		Declaration const * Parser::ParseVariableDeclaration( bool type_annotations )
+		{
+			Token const token = tokens.Peek();
+			Token const * leading_type = nullptr;
+			if( !Accept( TokenType::TK_VAR ) ){
+				leading_type = ParseTypeName();
+			}
+			std::vector<VariableDeclarator const *> declarators;
+			do {
+				Token const name = tokens.Peek();
+				Expect( TokenType::TK_IDENTIFIER );
+				Token const * type = leading_type;
+				if( type_annotations && Accept( TokenType::TK_COLON ) ){
+					type = ParseTypeName();
+				}
+				Expression const * initializer = nullptr;
+				if( Accept( TokenType::TK_ASSIGN ) ){
+					initializer = ParseAssignmentExpression();
+				}
+				declarators.push_back( factory.GetVariableDeclarator( name, type, initializer ) );
+			} while( Accept( TokenType::TK_COMMA ) );
+			return factory.GetVariableDeclaration( token, factory.GetList<VariableDeclarator>( declarators ) );
+		}
+
+		// To-Do -> qualified and template type names
+		Token const * Parser::ParseTypeName()
+		{
+			if( tokens.Peek().Type() != TokenType::TK_IDENTIFIER && !IsBuiltInType( tokens.Peek().Type() ) ){
+				Report( Support::DiagID::ExpectedTypeName, tokens.Peek() );
+				return nullptr;
+			}
+			Token const * type = factory.GetToken( tokens.Peek() );
+			NextToken();
+			return type;
 		}
 
-		std::unique_ptr<Declaration> Parser::ParseFunctionDeclaration()
+		// function [ specifier ] name( parameters ) [ -> type ] { ... }; constructors
+		// are the same with "construct" and no return type.
+		Declaration const * Parser::ParseFunctionDeclaration()
 		{
-			Token const token = *current_token;
-			Accept( TokenType::TK_FUNCTION );
-			std::unique_ptr<FunctionSpecifier> function_specifier;
-			if( current_token->Type() == TokenType::TK_LBRACKET ){
-				function_specifier = ParseFunctionSpecifier();
+			Token const token = tokens.Peek();
+			NextToken(); // consume "function" or "construct"
+			Token function_specifier = NoToken( token.Offset() );
+			if( Accept( TokenType::TK_LBRACKET ) ){
+				function_specifier = tokens.Peek();
+				NextToken();
+				Expect( TokenType::TK_RBRACKET );
 			}
-			Token const function_name = *current_token;
-			Accept( TokenType::TK_IDENTIFIER );
-			Accept( TokenType::TK_LPAREN );
-			std::unique_ptr<ParameterlistDeclaration> parameter_list = ParseParameterList();
-			Accept( TokenType::TK_RPAREN );
-			std::unique_ptr<TypeSpecifier> return_type;
-			if( current_token->Type() == TokenType::TK_ARROW ){
-				Accept( TokenType::TK_ARROW );
-				return_type = ParseTypeSpecifier();
+			Token const function_name = tokens.Peek();
+			Expect( TokenType::TK_IDENTIFIER );
+			Expect( TokenType::TK_LPAREN );
+			ParameterlistDeclaration const * parameter_list = ParseParameterList();
+			Expect( TokenType::TK_RPAREN );
+			Token return_trailing_specifier = NoToken( token.Offset() );
+			Token return_type = NoToken( token.Offset() );
+			if( tokens.Peek().Type() == TokenType::TK_ARROW || tokens.Peek().Type() == TokenType::TK_COLON ){
+				return_trailing_specifier = tokens.Peek();
+				NextToken();
+				if( Token const * type = ParseTypeName() ) return_type = *type;
 			}
 
-			std::unique_ptr<Statement> function_body = ParseCompoundStatement();
-			return ASTFactory::GetFunctionDeclaration( token, std::move( function_specifier ), function_name, std::move( parameter_list ),
-				std::move( return_type ), std::move( function_body ) );
+			std::uint32_t const body_begin = tokens.Peek().Offset();
+			Statement const * function_body = nullptr;
+			if( skim_function_bodies && tokens.Peek().Type() == TokenType::TK_LBRACE ){
+				SkimCompoundStatement();
+				recovering = false; // as the body's `{' would have had it, parsed
+			} else {
+				function_body = ParseCompoundStatement();
+			}
+			std::uint32_t const body_end = previous_token_end;
+			FunctionDeclaration * const function = factory.GetFunctionDeclaration( token, function_specifier, function_name,
+				parameter_list, return_trailing_specifier, return_type, function_body, body_begin, body_end );
+			if( function_body == nullptr ) skimmed_functions.push_back( function );
+			return function;
 		}
 
-		// To-Do -> Implement predence climbing as used in Clang.
-		std::unique_ptr<Expression> Parser::ParseBinaryExpression()
+		Statement const * Parser::ParseFunctionBody( FunctionDeclaration const & function )
 		{
+			if( !function.IsBodySkimmed() ) return function.Body();
+			// where the parse resumes, for ParseNextStatement; relexing that token is all it costs
+			std::uint32_t const resume = tokens.Peek().Offset();
+			std::uint32_t const resume_after = previous_token_end;
+			TokenType const resume_after_type = previous_token_type;
+			bool const was_recovering = recovering;
+			// the skim lexed the body and the lookahead already, and reported what was wrong
+			std::size_t const lexed = lexer.Diagnostics().Count();
+			lexer.Seek( function.BodyBegin() );
+			tokens.Reset();
+			// the flat tree is complete already; a node added now would come after its parent
+			FlatTree * const flat_tree = factory.SetFlatTree( nullptr );
+			Statement const * body = ParseCompoundStatement();
+			factory.SetFlatTree( flat_tree );
+			lexer.Seek( resume );
+			tokens.Reset();
+			lexer.Diagnostics().Truncate( lexed );
+			previous_token_end = resume_after;
+			previous_token_type = resume_after_type;
+			recovering = was_recovering;
+			function.SetBody( body );
+			return body;
+		}
 
+		ParameterlistDeclaration const * Parser::ParseParameterList()
+		{
+			Token const token = tokens.Peek();
+			std::vector<ParameterDeclaration const *> parameters;
+			if( tokens.Peek().Type() != TokenType::TK_RPAREN ){
+				do {
+					Token const name = tokens.Peek();
+					Expect( TokenType::TK_IDENTIFIER );
+					if( Accept( TokenType::TK_COLON ) ){
+						ParseTypeName(); // To-Do -> keep parameter types
+					}
+					parameters.push_back( factory.GetParameterDeclaration( name ) );
+				} while( Accept( TokenType::TK_COMMA ) );
+			}
+			return factory.GetParameterList( token, factory.GetList<ParameterDeclaration>( parameters ) );
 		}
 
-		std::unique_ptr<Expression> Parser::ParseConditionalExpression()
+		// Precedence climbing with explicit operand and operator stacks instead of one
+		// recursive call per precedence level, so neither long operator chains nor deeply
+		// parenthesized expressions use any C++ stack. Prefix operators and open
+		// parentheses wait on the operator stack with the binary operators.
+		Expression const * Parser::ParseBinaryExpression()
 		{
-			auto conditional_expression = ParseBinaryExpression();
-			if( current_token->Type() == TokenType::TK_QMARK ){
-				Token const token = *current_token;
-				Accept( TokenType::TK_QMARK );
-				auto lhs_expression = ParseExpression();
-				Accept( TokenType::TK_COLON );
-				return Support::make_unique<ConditionalExpression>( token, std::move( conditional_expression ), 
-					std::move( lhs_expression ), ParseConditionalExpression() );
+			std::size_t const operator_base = operators.size();
+			std::size_t open_parens = 0;
+
+			// Applies the operators on top of the stack that bind at least as tightly as
+			// one of `precedence' would; never goes past an open parenthesis.
+			auto reduce = [&]( std::uint8_t precedence, bool right_assoc ){
+				while( operators.size() > operator_base ){
+					PendingOperator const & top = operators.back();
+					if( top.precedence == open_paren || top.precedence < precedence ||
+						( top.precedence == precedence && right_assoc ) ) break;
+					if( top.precedence == prefix_operator ){
+						operands.back() = factory.GetUnaryExpression( top.token, operands.back() );
+					} else {
+						Expression const * rhs = operands.back();
+						operands.pop_back();
+						operands.back() = factory.GetBinaryExpression( top.token, operands.back(), rhs );
+					}
+					operators.pop_back();
+				}
+			};
+
+			bool expect_operand = true;
+			for( ; ; ){
+				TokenType const tt = tokens.Peek().Type();
+				if( expect_operand ){
+					// any prefix operators and open parentheses, then a primary
+					if( tt == TokenType::TK_LPAREN ){
+						operators.push_back( PendingOperator{ tokens.Peek(), open_paren, false } );
+						++open_parens;
+						NextToken();
+					} else if( IsPrefixOperator( tt ) ){
+						operators.push_back( PendingOperator{ tokens.Peek(), prefix_operator, true } );
+						NextToken();
+					} else {
+						operands.push_back( ParsePostfixExpression( ParsePrimaryExpression() ) );
+						expect_operand = false;
+					}
+					continue;
+				}
+
+				BinaryOperator const op = GetBinaryOperator( tt );
+				if( op.precedence != 0 ){
+					reduce( op.precedence, op.right_assoc );
+					operators.push_back( PendingOperator{ tokens.Peek(), op.precedence, op.right_assoc } );
+					NextToken();
+					expect_operand = true;
+				} else if( open_parens == 0 ){
+					break;
+				} else if( tt == TokenType::TK_RPAREN ){
+					reduce( open_paren, false );
+					operators.pop_back(); // the "("
+					--open_parens;
+					NextToken();
+					// the nested parse may grow `operands', so back() is only taken after it
+					Expression const * const inner = ParsePostfixExpression( operands.back() );
+					operands.back() = inner;
+				} else if( tt == TokenType::TK_QMARK || tt == TokenType::TK_COMMA || IsAssignmentOperator( tt ) ){
+					// what binds looser than any binary operator is parsed the usual way,
+					// then we are back inside the parentheses looking for ")"
+					reduce( open_paren, false );
+					Expression const * const inner = ParseExpression( operands.back() );
+					operands.back() = inner;
+				} else {
+					Report( Support::DiagID::ExpectedToken, tokens.Peek(), TokenType::TK_RPAREN );
+					reduce( open_paren, false );
+					operators.pop_back();
+					--open_parens;
+				}
 			}
-			return std::move( conditional_expression );
+			reduce( open_paren, false );
+			Expression const * result = operands.back();
+			operands.pop_back();
+			return result;
 		}
 
-		std::unique_ptr<Expression> Parser::ParseExpression()
+		Expression const * Parser::ParsePrimaryExpression()
 		{
-			Token const token = *current_token;
-			auto expr = ParseAssignmentExpression();
-			if( current_token->Type() != TokenType::TK_COMMA ){
-				return std::move( expr );
+			Token const token = tokens.Peek();
+			switch( token.Type() )
+			{
+			case TokenType::TK_IDENTIFIER:
+				NextToken();
+				return factory.GetVariable( token );
+			case TokenType::TK_INTLITERAL:
+			case TokenType::TK_DOUBLELITERAL:
+			case TokenType::TK_TRUE:
+			case TokenType::TK_FALSE:
+				NextToken();
+				return factory.GetConstant( token );
+			case TokenType::TK_STRLITERAL:
+				NextToken();
+				return factory.GetStringLiteral( token );
+			case TokenType::TK_STRLITINTERPOL:
+				NextToken();
+				return factory.GetStringInterpolation( token );
+			case TokenType::TK_RPAREN:
+			case TokenType::TK_RBRACKET:
+			case TokenType::TK_LBRACE:
+			case TokenType::TK_RBRACE:
+			case TokenType::TK_SEMICOLON:
+			case TokenType::TK_COMMA:
+			case TokenType::TK_EOF:
+				// leave it to whoever is waiting for it; braces are only ever blocks, as a
+				// skimmed body counts them
+				Report( Support::DiagID::ExpectedExpression, token );
+				return factory.GetIllegalExpression( token );
+			default:
+				Report( Support::DiagID::ExpectedExpression, token );
+				NextToken();
+				return factory.GetIllegalExpression( token );
 			}
-			std::vector<std::unique_ptr<Expression>> expressions;
-			expressions.push_back( std::move( expr ) );
-			while( TokenType::TK_COMMA == current_token->Type() ){
-				Accept( TokenType::TK_COMMA );
-				expressions.push_back( ParseAssignmentExpression() );
+		}
+
+		// Calls, subscripts, member accesses, `++' and `--' after an operand.
+		Expression const * Parser::ParsePostfixExpression( Expression const * expression )
+		{
+			for( ; ; ){
+				Token const token = tokens.Peek();
+				switch( token.Type() )
+				{
+				case TokenType::TK_LPAREN:
+					{
+						NextToken();
+						std::size_t const mark = operands.size();
+						if( tokens.Peek().Type() != TokenType::TK_RPAREN ){
+							do {
+								operands.push_back( ParseAssignmentExpression() );
+							} while( Accept( TokenType::TK_COMMA ) );
+						}
+						Expect( TokenType::TK_RPAREN );
+						List<Expression> const arguments = factory.GetList<Expression>( operands.data() + mark, operands.size() - mark );
+						operands.resize( mark );
+						expression = factory.GetCallExpression( token, expression, arguments );
+						break;
+					}
+				case TokenType::TK_LBRACKET:
+					{
+						NextToken();
+						Expression const * index = ParseExpression();
+						Expect( TokenType::TK_RBRACKET );
+						expression = factory.GetSubscriptExpression( token, expression, index );
+						break;
+					}
+				case TokenType::TK_DOT:
+					{
+						NextToken();
+						Token const member = tokens.Peek();
+						Expect( TokenType::TK_IDENTIFIER );
+						expression = factory.GetDotExpression( token, expression, member );
+						break;
+					}
+				case TokenType::TK_INCREMENT:
+				case TokenType::TK_DECREMENT:
+					NextToken();
+					expression = factory.GetPostfixExpression( token, expression );
+					break;
+				default:
+					return expression;
+				}
 			}
+		}
 
-			return ASTFactory::GetExpressionList( token, std::move( expressions ) );
+		// `first', when given, is an operand the caller has already parsed as far as a
+		// binary expression goes; parsing carries on from the token after it.
+		Expression const * Parser::ParseConditionalExpression( Expression const * first )
+		{
+			Nesting const nesting( depth, deepest );
+			Expression const * condition = first != nullptr ? first : ParseBinaryExpression();
+			if( tokens.Peek().Type() != TokenType::TK_QMARK ){
+				return condition;
+			}
+			// `a ? b : c ? d : e' is `a ? b : ( c ? d : e )'. The chain is read first and
+			// folded from the right, rather than recursing once per `?'.
+			std::size_t const operator_base = operators.size();
+			while( tokens.Peek().Type() == TokenType::TK_QMARK ){
+				operators.push_back( PendingOperator{ tokens.Peek(), 0, true } );
+				operands.push_back( condition );
+				NextToken();
+				operands.push_back( ParseExpression() );
+				Expect( TokenType::TK_COLON );
+				condition = ParseBinaryExpression();
+			}
+			Expression const * result = condition;
+			while( operators.size() > operator_base ){
+				Expression const * lhs_expression = operands.back();
+				operands.pop_back();
+				result = factory.GetConditionalExpression( operators.back().token, operands.back(), lhs_expression, result );
+				operands.pop_back();
+				operators.pop_back();
+			}
+			return result;
 		}
 
-		std::unique_ptr<Expression> Parser::ParseAssignmentExpression()
+		Expression const * Parser::ParseExpression( Expression const * first )
 		{
-			auto lhs_expression = ParseConditionalExpression();
+			auto expr = ParseAssignmentExpression( first );
+			if( tokens.Peek().Type() != TokenType::TK_COMMA ){
+				return expr;
+			}
+			Token const token( expr->Offset(), 0, TokenType::TK_COMMA );
+			std::size_t const mark = operands.size();
+			operands.push_back( expr );
+			while( Accept( TokenType::TK_COMMA ) ){
+				operands.push_back( ParseAssignmentExpression() );
+			}
+			List<Expression> const expressions = factory.GetList<Expression>( operands.data() + mark, operands.size() - mark );
+			operands.resize( mark );
+			return factory.GetExpressionList( token, expressions );
+		}
 
-			switch( current_token->Type() )
-			{
-			case TokenType::TK_ASSIGN:
-			case TokenType::TK_MULEQL:
-			case TokenType::TK_DIVEQL:
-			case TokenType::TK_MODASSIGN:
-			case TokenType::TK_ADDEQL:
-			case TokenType::TK_SUBEQL:
-			case TokenType::TK_LSASSIGN:
-			case TokenType::TK_RSHIFT:
-			case TokenType::TK_ANDEQL:
-			case TokenType::TK_XORASSIGN:
-			case TokenType::TK_OREQL:
-				{
-					Token const token = *current_token;
-					Accept( current_token->Type() );
-					return ASTFactory::GetAssignmentExpression( token, std::move( lhs_expression ), ParseConditionalExpression() );
-				}
-			default: return std::move( lhs_expression );
+		Expression const * Parser::ParseAssignmentExpression( Expression const * first )
+		{
+			auto lhs_expression = ParseConditionalExpression( first );
+			if( !IsAssignmentOperator( tokens.Peek().Type() ) ){
+				return lhs_expression;
+			}
+			// right associative: `a = b = c' is `a = ( b = c )', folded once read
+			std::size_t const operator_base = operators.size();
+			while( IsAssignmentOperator( tokens.Peek().Type() ) ){
+				operators.push_back( PendingOperator{ tokens.Peek(), 0, true } );
+				operands.push_back( lhs_expression );
+				NextToken();
+				lhs_expression = ParseConditionalExpression();
+			}
+			while( operators.size() > operator_base ){
+				lhs_expression = factory.GetAssignmentExpression( operators.back().token, operands.back(), lhs_expression );
+				operands.pop_back();
+				operators.pop_back();
 			}
+			return lhs_expression;
 		}
 
 		// To-Do -> How do you parse qualified ID for names?
-		std::unique_ptr<Declaration> Parser::ParseClassDeclaration()
+		Declaration const * Parser::ParseClassDeclaration()
 		{
-			Token const token = *current_token;
+			Token const token = tokens.Peek();
 			Expect( TokenType::TK_CLASS );
-			Token const class_name = *current_token;
+			Token const class_name = tokens.Peek();
 			Expect( TokenType::TK_IDENTIFIER );
-			if( current_token->Type() == TokenType::TK_EXTENDS ){
-				std::deque<Token> base_classes;
-				Accept( TokenType::TK_EXTENDS );
-				/* expect an identifier */
-				while( current_token->Type() == TokenType::TK_COMMA ){
-					// To-Do -> expect comma separated base class names
-				}
+			if( Accept( TokenType::TK_EXTENDS ) ){
+				// To-Do -> keep the base classes
+				do {
+					Expect( TokenType::TK_IDENTIFIER );
+				} while( Accept( TokenType::TK_COMMA ) );
 			}
-			Accept( TokenType::TK_LBRACE );
-
-			std::unique_ptr<ClassDeclaration> class_declaration = ASTFactory::GetClassDeclaration( token );
-
-			while( TokenType::TK_RBRACE != current_token->Type() )
-			{
-				std::unique_ptr<Token> access_specifier = nullptr;
-				switch( current_token->Type() )
+			std::vector<Declaration const *> declarations;
+			if( ExpectOpeningBrace() ){
+				while( TokenType::TK_RBRACE != tokens.Peek().Type() && TokenType::TK_EOF != tokens.Peek().Type() )
 				{
-				case TokenType::TK_PUBLIC:
-				case TokenType::TK_PRIVATE:
-				case TokenType::TK_PROTECTED:
-					access_specifier = make_unique<Token>( *current_token ); // let it fall to default case anyway
-				default:
-					class_declaration->Append( std::move( access_specifier ), ParseDeclaration() );
-					break;
+					std::uint32_t const offset = tokens.Peek().Offset();
+					// To-Do -> keep access specifiers
+					while( Accept( TokenType::TK_PUBLIC ) || Accept( TokenType::TK_PRIVATE ) || Accept( TokenType::TK_PROTECTED )
+						|| Accept( TokenType::TK_STATIC ) || Accept( TokenType::TK_VIRTUAL ) ){
+					}
+					if( tokens.Peek().Type() == TokenType::TK_LBRACE ){
+						// a block where a member should be: parsed for the errors in it, and dropped
+						Report( Support::DiagID::ExpectedTypeName, tokens.Peek() );
+						ParseCompoundStatement();
+					} else {
+						declarations.push_back( ParseDeclaration() );
+					}
+					Accept( TokenType::TK_SEMICOLON );
+					if( recovering ) Synchronize( offset, true );
+					EnsureProgress( offset );
 				}
+				Expect( TokenType::TK_RBRACE );
 			}
-			Accept( TokenType::TK_RBRACE );
-			Accept( TokenType::TK_SEMICOLON );
 
-			return std::move( class_declaration );
+			return factory.GetClassDeclaration( token, class_name, factory.GetList<Declaration>( declarations ) );
 		}
 
-		std::unique_ptr<Declaration> Parser::ParseEnumDeclaration()
+		Declaration const * Parser::ParseEnumDeclaration()
 		{
-			Token const token = *current_token;
+			Token const token = tokens.Peek();
 			Expect( TokenType::TK_ENUM );
 
-			std::unique_ptr<Token> enum_name = nullptr ;
+			Token const * enum_name = nullptr;
 
-			if( current_token->Type() == TokenType::TK_IDENTIFIER ){
-				enum_name = make_unique<Token>( *current_token );
+			if( tokens.Peek().Type() == TokenType::TK_IDENTIFIER ){
+				enum_name = factory.GetToken( tokens.Peek() );
 				Accept( TokenType::TK_IDENTIFIER );
 			}
-			Expect( TokenType::TK_LBRACE ); // consume "{"
-			std::unique_ptr<EnumDeclaration> enum_declaration = ASTFactory::GetEnumDeclaration( token, std::move( enum_name ) );
-
-			while( current_token->Type() != TokenType::TK_EOF ){
-				if( current_token->Type() == TokenType::TK_RBRACE ){
-					break;
-				}
-				if( current_token->Type() != TokenType::TK_IDENTIFIER ){
-					error_messages->Propagate( *current_token, L"Expected an identifier for enumerator" );
-					while( current_token->Type() != TokenType::TK_RBRACE ) NextToken();
-					break;
-				}
+			std::vector<Enumerator const *> enumerators;
+			if( !ExpectOpeningBrace() ){ // consume "{"
+				return factory.GetEnumDeclaration( token, enum_name, factory.GetList<Enumerator>( enumerators ) );
+			}
 
-				Token const enumerator_id = *current_token;
-				std::unique_ptr<Token> enumerator_value = nullptr;
+			while( tokens.Peek().Type() == TokenType::TK_IDENTIFIER ){
+				Token const enumerator_id = tokens.Peek();
+				Token const * enumerator_value = nullptr;
 
 				Accept( TokenType::TK_IDENTIFIER );
 
-				if( current_token->Type() == TokenType::TK_ASSIGN ){
-					Accept( TokenType::TK_ASSIGN ); // consume "="
-					if( current_token->Type() != TokenType::TK_INT ){
-						error_messages->Propagate( *current_token, L"Expects a constant integer" );
-						NextToken();
+				if( Accept( TokenType::TK_ASSIGN ) ){ // consume "="
+					if( tokens.Peek().Type() != TokenType::TK_INTLITERAL ){
+						Report( Support::DiagID::ExpectedIntegerConstant, tokens.Peek() );
 					} else {
-						enumerator_value = make_unique<Token>( *current_token );
-						Accept( TokenType::TK_INT );
+						enumerator_value = factory.GetToken( tokens.Peek() );
+						Accept( TokenType::TK_INTLITERAL );
 					}
 				}
-				enum_declaration->Append( enumerator_id, std::move( enumerator_value ) );
-				if( current_token->Type() != TokenType::TK_COMMA ) Accept( TokenType::TK_RBRACE );
-				Accept( TokenType::TK_COMMA ); //consume ","
+				enumerators.push_back( factory.GetEnumerator( enumerator_id, enumerator_value ) );
+				if( !Accept( TokenType::TK_COMMA ) ) break; //consume ","
 			}
-			return std::move( enum_declaration );
+			if( tokens.Peek().Type() != TokenType::TK_RBRACE ){
+				Report( Support::DiagID::ExpectedEnumerator, tokens.Peek() );
+				// to the "}" that closes the enum, over any block in between
+				for( std::size_t braces = 0; tokens.Peek().Type() != TokenType::TK_EOF
+					&& ( braces != 0 || tokens.Peek().Type() != TokenType::TK_RBRACE ); NextToken() ){
+					if( tokens.Peek().Type() == TokenType::TK_LBRACE ) ++braces;
+					else if( tokens.Peek().Type() == TokenType::TK_RBRACE ) --braces;
+				}
+			}
+			Expect( TokenType::TK_RBRACE );
+			return factory.GetEnumDeclaration( token, enum_name, factory.GetList<Enumerator>( enumerators ) );
 		}
 
-		std::unique_ptr<Statement> Parser::ParseJumpStatement()
+		Statement const * Parser::ParseJumpStatement()
 		{
-			auto token = *current_token;
-			switch( current_token->Type() )
+			auto token = tokens.Peek();
+			switch( tokens.Peek().Type() )
 			{
 			case TokenType::TK_CONTINUE:
 				Accept( TokenType::TK_CONTINUE );
-				Accept( TokenType::TK_SEMICOLON );
-				return ASTFactory::GetContinueStatement( token );
+				Expect( TokenType::TK_SEMICOLON );
+				return factory.GetContinueStatement( token );
 			case TokenType::TK_LEAVE:
 				Accept( TokenType::TK_LEAVE );
-				Accept( TokenType::TK_SEMICOLON );
-				return ASTFactory::GetLeaveStatement( token );
+				Expect( TokenType::TK_SEMICOLON );
+				return factory.GetLeaveStatement( token );
 			default:
-				Accept( TokenType::TK_RETURN );
-				auto expression = ParseExpression();
-				return ASTFactory::GetReturnStatement( token, std::move( expression ) );
+				{
+					Accept( TokenType::TK_RETURN );
+					Expression const * expression = nullptr;
+					if( tokens.Peek().Type() != TokenType::TK_SEMICOLON ){
+						expression = ParseExpression();
+					}
+					Expect( TokenType::TK_SEMICOLON );
+					return factory.GetReturnStatement( token, expression );
+				}
 			}
 		}
 
-		inline std::unique_ptr<Statement> Parser::ParseExpressionStatement()
+		inline Statement const * Parser::ParseExpressionStatement()
 		{
-			return ASTFactory::GetExpressionStatement( *current_token, ParseExpression() );
+			Token const token = tokens.Peek();
+			Expression const * expression = ParseExpression();
+			Expect( TokenType::TK_SEMICOLON );
+			return factory.GetExpressionStatement( token, expression );
 		}
 
-		std::unique_ptr<Statement> Parser::ParseLabelledStatement()
+		Statement const * Parser::ParseLabelledStatement()
 		{
-			auto token = *current_token;
+			auto token = tokens.Peek();
 			Accept( TokenType::TK_ISIT );
-			std::unique_ptr<Token> value = nullptr;
-			switch( current_token->Type() )
+			Token const * value = nullptr;
+			switch( tokens.Peek().Type() )
 			{
 			case TokenType::TK_TRUE:
 			case TokenType::TK_FALSE:
-			case TokenType::TK_INT:
+			case TokenType::TK_INTLITERAL:
 			case TokenType::TK_STRLITERAL:
 			case TokenType::TK_STRLITINTERPOL:
-				value = make_unique<Token>( *current_token );
+				value = factory.GetToken( tokens.Peek() );
+				NextToken();
 				break;
 			default:
-				error_messages->Propagate( *current_token, L"Invalid value supplied for label" );
-				return nullptr;
+				Report( Support::DiagID::InvalidLabelValue, tokens.Peek() );
+				return factory.GetIllegalStatement( token );
 			}
-			Accept( TokenType::TK_COLON );
-			return ASTFactory::GetLabelStatement( token, std::move( value ) );
+			Expect( TokenType::TK_COLON );
+			return factory.GetLabelStatement( token, value );
 		}
 
-		std::unique_ptr<Statement> Parser::ParseStatement()
+		Statement const * Parser::ParseStatement()
 		{
-			switch ( current_token->Type() )
+			Nesting const nesting( depth, deepest );
+			switch ( tokens.Peek().Type() )
 			{
 			case TokenType::TK_LBRACE: // compound statement
 				return ParseCompoundStatement();
@@ -503,12 +1254,35 @@ namespace MaryLang
 			case TokenType::TK_CLASS:
 			case TokenType::TK_ENUM:
 			case TokenType::TK_NAMESPACE:
-			case TokenType::TK_DECLTYPE:
 			case TokenType::TK_FUNCTION:
+			case TokenType::TK_CONSTRUCT:
 				return ParseDeclarationStatement();
 			case TokenType::TK_ISIT: // labelled statement
 				return  ParseLabelledStatement();
+			case TokenType::TK_IMPORT: // too late; parsed to go on after it, and dropped
+				Report( Support::DiagID::ImportAfterStatement, tokens.Peek() );
+				ParseImport();
+				return nullptr;
+			case TokenType::TK_RBRACE: // nothing begins with these; the brace is left to its block
+			case TokenType::TK_EOF:
+				Report( Support::DiagID::ExpectedStatement, tokens.Peek() );
+				return factory.GetIllegalStatement( tokens.Peek() );
+			case TokenType::TK_RPAREN:
+			case TokenType::TK_RBRACKET:
+			case TokenType::TK_ELSE:
+			case TokenType::TK_AMONG:
+			case TokenType::TK_EXTENDS:
+			case TokenType::TK_COLON:
+			case TokenType::TK_COMMA:
+			case TokenType::TK_ARROW:
+				{
+					Token const token = tokens.Peek();
+					Report( Support::DiagID::ExpectedStatement, token );
+					NextToken();
+					return factory.GetIllegalStatement( token );
+				}
 			default:
+				if( IsDeclarationStart() ) return ParseDeclarationStatement();
 				return ParseExpressionStatement();
 			}
 		}
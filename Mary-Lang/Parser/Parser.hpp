@@ -2,7 +2,10 @@
 
 #include "../AbstractSyntaxTree/ASTFactory.hpp"
 #include "../Scanner/Scanner.hpp"
-#include <deque>
+#include "TokenRing.hpp"
+#include "../Utils/ThreadPool.hpp"
+#include "../Utils/TimeTrace.hpp"
+#include <vector>
 
 namespace MaryLang
 {
@@ -11,31 +14,69 @@ namespace MaryLang
 		using namespace Lexer;
 		using namespace AbstractSyntaxTree;
 
-		struct Error
-		{
-			Error(): error(){}
-
-			inline void Propagate( Token const & token, wchar_t const *what )
-			{ 
-				error.push_back( std::make_pair( token, what ) ); 
-			}
-		private:
-			std::vector<std::pair<Token, wchar_t const *>> error;
-		};
-
 		struct Parser
 		{
-			Parser( Scanner & lex );
+			// With `emit_flat_tree', the parsed program also carries a FlatTree of itself.
+			Parser( Scanner & lex, bool emit_flat_tree = false );
+			// Parses `lexed', tokens `lex' scanned before and ending with TK_EOF, instead of
+			// scanning them again; `lex' only names the file then. Not for skimmed function bodies.
+			Parser( Scanner & lex, Token const * lexed, bool emit_flat_tree );
 			~Parser();
 
 			std::shared_ptr<ParsedProgram> Parse();
-		private:
-			std::unique_ptr<Token>		current_token;
-			std::unique_ptr<Token>		next_token;
-			std::deque<Token>			lookahead_tokens;
-			std::shared_ptr<ParsedProgram> program;
-			Scanner&					lexer;
-			std::unique_ptr<Error>		error_messages;
+			// Skims the file, then parses the function bodies on `pool' in batches of about
+			// `batch_bytes' of source. The program and the errors come out as Parse() would
+			// produce them, except that the FlatTree leaves function bodies out.
+			std::shared_ptr<ParsedProgram> Parse( Support::ThreadPool & pool, std::size_t batch_bytes = 64 * 1024 );
+			// Every syntax error in the file, each once: after an error the parser skips to where
+			// the next statement begins, standing in IllegalStatement and IllegalExpression
+			// nodes for what it could not parse, and reports again from there.
+			inline Support::Diagnostic const & Diagnostics() const { return diagnostics; }
+			inline std::shared_ptr<ParsedProgram> const & Program() const { return program; }
+
+			// With `skim' set, Parse only brace-matches function bodies and records where
+			// they are, which is all an outline or a symbol search needs.
+			inline void SkimFunctionBodies( bool skim ) { skim_function_bodies = skim; }
+			// The body of `function', parsed now if it was skimmed. Call after Parse, or on the
+			// statement ParseNextStatement just returned, with this parser; the nodes go to the
+			// same program, but not to its FlatTree.
+			Statement const * ParseFunctionBody( FunctionDeclaration const & function );
+
+			// The imports at the top of the file, parsed now unless they have been. Parse and
+			// ParseNextStatement start with them anyway; a module loader calls this first to
+			// learn what a file depends on before parsing the rest of it.
+			List<Imports> const & ParseImports();
+
+			// Parses the file one top-level statement at a time instead of all at once: each
+			// call returns the next statement, or null at the end of the file. The statement
+			// returned before is released first, its source too if the scanner reads a stream,
+			// so memory stays proportional to the largest statement rather than to the file.
+			// Work out where its diagnostics are before the next call, then. Meanwhile Program()
+			// and its FlatTree hold the current statement alone, and the first one the imports
+			// as well. Use either this or Parse on a parser, not both.
+			Statement const * ParseNextStatement();
+			// With `keep' set, ParseNextStatement keeps the statements it returned before, in
+			// the arena and the FlatTree alike, and the program lists none of them: for a
+			// caller that decides by itself where to stop, like a Document reparsing an edit.
+			inline void KeepStatements( bool keep ) { keep_statements = keep; }
+			// For a parser started in the middle of a file: no imports are looked for, and an
+			// import found anyway is out of place, as after any statement.
+			inline void SkipImports() { imports_parsed = true; }
+			// Where the statement ParseNextStatement parses next begins; the end of the file
+			// after the last one.
+			inline std::uint32_t NextOffset() const { return tokens.Peek().Offset(); }
+			// Calls `visit' with each top-level statement in turn; returns how many there were.
+			template<typename Visit>
+			std::size_t ParseEach( Visit visit )
+			{
+				Support::TimeScope const scope( "Parse", lexer.FileName() );
+				std::size_t count = 0;
+				while( Statement const * const statement = ParseNextStatement() ){
+					visit( *statement );
+					++count;
+				}
+				return count;
+			}
 
 			enum class Associativity
 			{
@@ -45,43 +86,94 @@ namespace MaryLang
 			};
 
 			typedef std::pair<int, Associativity> PrecAssocPair;
-			PrecAssocPair GetPrecedence( TokenType tt );
+			// Binding power of a binary operator, higher binds tighter; -1 if `tt' is none.
+			static PrecAssocPair GetPrecedence( TokenType tt );
+		private:
+			TokenRing					tokens; // Peek( 0 ) is the current token
+			std::shared_ptr<ParsedProgram> program;
+			ASTFactory					factory; // allocates in program's arena
+			Scanner&					lexer;
+			Support::Diagnostic			diagnostics;
+			bool						skim_function_bodies;
+			bool						bodies_parsed_after; // the skim is Parse( pool )'s, which parses them next
+			bool						imports_parsed;
+			bool						keep_statements;
+			bool						recovering; // from a syntax error, until Synchronize
+			std::uint32_t				last_error; // where the last syntax error was reported
+			std::uint32_t				previous_token_end; // where the last token consumed ends
+			TokenType					previous_token_type; // and what it was
+			std::uint32_t				depth, deepest; // of statements and expressions being parsed
+			std::vector<FunctionDeclaration const *> skimmed_functions; // in source order
+
+			// An operator, or an open parenthesis, waiting on ParseBinaryExpression's stack.
+			struct PendingOperator
+			{
+				Token			token;
+				std::uint8_t	precedence;
+				bool			right_assoc;
+			};
+
+			// Work stacks shared by every expression being parsed. Each parse function
+			// only touches what it pushed itself, so nested expressions can reuse them
+			// and parsing an expression allocates nothing but its nodes.
+			std::vector<PendingOperator>		operators;
+			std::vector<Expression const *>		operands;
+			std::vector<Statement const *>		statements;
 
-			void Accept( TokenType tt );
+			bool Accept( TokenType tt );
 			void Expect( TokenType tt );
+			// The `{' that opens a block. If it is missing, what stands before one is skipped;
+			// false if a statement ends or begins first. Only a `{' opens a block, so the
+			// blocks are those a skimmed body's braces make.
+			bool ExpectOpeningBrace();
+			// `expected' is the argument of ExpectedToken and ignored by the rest. After the
+			// first error nothing is reported until the parser has synchronized again, since
+			// all that follows would only be that error over again; nor is anything reported
+			// afterwards at the token it was at, which is where synchronizing may stop.
+			void Report( Support::DiagID id, Token const & at, TokenType expected = TokenType::TK_INVALID );
 			void NextToken();
+			void EnsureProgress( std::uint32_t offset );
+			// Panic mode: after an error in the statement that began at `offset', skips to where
+			// the next statement, or with `members' the next class member, can begin, and
+			// reports again from there.
+			void Synchronize( std::uint32_t offset, bool members = false );
 			void ParseSourceElement();
-			void ParseImports();
-			bool IsBuiltInType( TokenType tt );
+			Imports const * ParseImport();
+			bool IsBuiltInType( TokenType tt ) const;
+			bool IsDeclarationStart() const;
 
 			std::shared_ptr<ParsedProgram> ParseProgram();
-			std::unique_ptr<Expression> ParseAssignmentExpression();
-			std::unique_ptr<Expression> ParseExpression();
-			std::unique_ptr<Expression> ParseConditionalExpression();
-			std::unique_ptr<Expression> ParseBinaryExpression();
-
-			std::unique_ptr<Statement> ParseCompoundStatement();
-			std::unique_ptr<Statement> ParseStatement();
-			std::unique_ptr<Statement> ParseCheckAmongStatement();
-			std::unique_ptr<Statement> ParseLabelledStatement();
-			std::unique_ptr<Statement> ParseConditionalStatement();
-			std::unique_ptr<Statement> ParseJumpStatement();
-			std::unique_ptr<Statement> ParseIterativeStatement();
-			std::unique_ptr<Statement> ParseDeclarationStatement();
-			std::unique_ptr<Statement> ParseExpressionStatement();
-
-			std::unique_ptr<Statement> ParseWhileStatement();
-			std::unique_ptr<Statement> ParseForStatement();
-			std::unique_ptr<Statement> ParseDoWhileStatement();
-
-			std::unique_ptr<Declaration> ParseDeclaration();
-			std::unique_ptr<Declaration> ParseEnumDeclaration();
-			std::unique_ptr<Declaration> ParseClassDeclaration();
-			std::unique_ptr<Declaration> ParseFunctionDeclaration();
-			std::unique_ptr<Declaration> ParseOtherDeclaration();
-			std::unique_ptr<Declaration> ParseNamespaceDeclaration();
-			std::unique_ptr<Declaration> ParseVariableDeclaration();
-			std::unique_ptr<ParameterlistDeclaration> ParseParameterList();
+			Expression const * ParseAssignmentExpression( Expression const * first = nullptr );
+			Expression const * ParseExpression( Expression const * first = nullptr );
+			Expression const * ParseConditionalExpression( Expression const * first = nullptr );
+			Expression const * ParseBinaryExpression();
+			Expression const * ParsePrimaryExpression();
+			Expression const * ParsePostfixExpression( Expression const * expression );
+
+			Statement const * ParseCompoundStatement();
+			void SkimCompoundStatement();
+			Statement const * ParseStatement();
+			Statement const * ParseCheckAmongStatement();
+			Statement const * ParseLabelledStatement();
+			Statement const * ParseConditionalStatement();
+			Statement const * ParseJumpStatement();
+			Statement const * ParseIterativeStatement();
+			Statement const * ParseDeclarationStatement();
+			Statement const * ParseExpressionStatement();
+
+			Statement const * ParseWhileStatement();
+			Statement const * ParseForStatement();
+			Statement const * ParseDoWhileStatement();
+
+			Declaration const * ParseDeclaration();
+			Declaration const * ParseEnumDeclaration();
+			Declaration const * ParseClassDeclaration();
+			Declaration const * ParseFunctionDeclaration();
+			Declaration const * ParseOtherDeclaration();
+			Declaration const * ParseNamespaceDeclaration();
+			Declaration const * ParseVariableDeclaration( bool type_annotations = true );
+			ParameterlistDeclaration const * ParseParameterList();
+			Token const * ParseTypeName();
 		};
 	} // namespace Parser
-} //namespace MaryLang
\ No newline at end of file
+} //namespace MaryLang
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../Scanner/Scanner.hpp"
+#include <array>
+#include <cassert>
+#include <utility>
+
+namespace MaryLang
+{
+	namespace Parser
+	{
+		using Lexer::Token;
+
+		// The parser's view of the token stream: the current token and the few after it,
+		// scanned ahead into a fixed ring. Advancing overwrites the slot just left with the
+		// next token from the scanner, so lookahead costs no allocation and no shifting.
+		struct TokenRing
+		{
+			static std::size_t const capacity = 4; // a power of two
+
+			// With `lexed', a run of tokens ending with TK_EOF, the ring takes its tokens from
+			// there instead of the scanner, as a Document's parser does with the tokens it keeps.
+			explicit TokenRing( Lexer::Scanner & lex, Token const * lexed = nullptr )
+				: lexer( lex ), replay( lexed ), slots( Scan( std::make_index_sequence<capacity>() ) ), head( 0 ) {}
+
+			// The token `k' places after the current one; Peek( 0 ) is the current token.
+			// References are only good until the next Advance().
+			inline Token const & Peek( std::size_t k = 0 ) const
+			{
+				assert( k < capacity && "lookahead past the end of the ring" );
+				return slots[( head + k ) & ( capacity - 1 )];
+			}
+
+			// Refills the ring after the scanner was moved elsewhere with Seek. Not for a ring
+			// given its tokens.
+			void Reset()
+			{
+				assert( replay == nullptr && "a ring given its tokens cannot follow the scanner" );
+				slots = Scan( std::make_index_sequence<capacity>() );
+				head = 0;
+			}
+
+			inline void Advance()
+			{
+				slots[head] = Next();
+				head = ( head + 1 ) & ( capacity - 1 );
+			}
+		private:
+			inline Token Next()
+			{
+				if( replay == nullptr ) return lexer.GetNextToken();
+				Token const token = *replay;
+				if( token.Type() != Lexer::TokenType::TK_EOF ) ++replay; // the end repeats, as the scanner's does
+				return token;
+			}
+
+			// Braced initializers are evaluated left to right, so the slots are filled in
+			// source order.
+			template<std::size_t... I>
+			std::array<Token, capacity> Scan( std::index_sequence<I...> )
+			{
+				return {{ ( static_cast<void>( I ), Next() )... }};
+			}
+
+			Lexer::Scanner &			lexer;
+			Token const *				replay; // the next token given, if the ring was given them
+			std::array<Token, capacity>	slots;
+			std::size_t					head;
+		};
+	} // namespace Parser
+} // namespace MaryLang
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include "tokens.hpp"
+
+namespace MaryLang
+{
+	namespace Lexer
+	{
+		struct Keyword
+		{
+			char const *	spelling;
+			std::size_t		length;
+			TokenType		type;
+		};
+
+		constexpr Keyword keywords[] = {
+			{ "var", 3, TokenType::TK_VAR },			{ "private", 7, TokenType::TK_PRIVATE },
+			{ "public", 6, TokenType::TK_PUBLIC },		{ "protected", 9, TokenType::TK_PROTECTED },
+			{ "for", 3, TokenType::TK_FOR },			{ "do", 2, TokenType::TK_DO },
+			{ "while", 5, TokenType::TK_WHILE },		{ "if", 2, TokenType::TK_IF },
+			{ "isit", 4, TokenType::TK_ISIT },			{ "else", 4, TokenType::TK_ELSE },
+			{ "function", 8, TokenType::TK_FUNCTION },	{ "among", 5, TokenType::TK_AMONG },
+			{ "check", 5, TokenType::TK_CHECK },		{ "continue", 8, TokenType::TK_CONTINUE },
+			{ "leave", 5, TokenType::TK_LEAVE },		{ "int", 3, TokenType::TK_INT },
+			{ "double", 6, TokenType::TK_DOUBLE },		{ "decltype", 8, TokenType::TK_DECLTYPE },
+			{ "string", 6, TokenType::TK_STRING },		{ "boolean", 7, TokenType::TK_BOOLEAN },
+			{ "true", 4, TokenType::TK_TRUE },			{ "false", 5, TokenType::TK_FALSE },
+			{ "typeof", 6, TokenType::TK_TYPEOF },		{ "enum", 4, TokenType::TK_ENUM },
+			{ "return", 6, TokenType::TK_RETURN },		{ "class", 5, TokenType::TK_CLASS },
+			{ "extends", 7, TokenType::TK_EXTENDS },	{ "namespace", 9, TokenType::TK_NAMESPACE },
+			{ "virtual", 7, TokenType::TK_VIRTUAL },	{ "construct", 9, TokenType::TK_CONSTRUCT },
+			{ "import", 6, TokenType::TK_IMPORT },
+		};
+
+		namespace Detail
+		{
+			// `str' has already been checked to be as long as `keyword'; the first character
+			// has also been checked by the caller's switch.
+			constexpr TokenType Match( char const * str, char const * keyword, TokenType type )
+			{
+				for( std::size_t i = 1; keyword[i] != '\0'; ++i ){
+					if( str[i] != keyword[i] ) return TokenType::TK_IDENTIFIER;
+				}
+				return type;
+			}
+		} // namespace Detail
+
+		// Classifies an identifier's spelling as one of the keywords above or TK_IDENTIFIER.
+		// A switch on the length and leading characters selects at most one candidate, so
+		// there is no table to initialize, nothing to hash, and it is safe from any thread.
+		constexpr TokenType ClassifyIdentifier( char const * str, std::size_t length )
+		{
+			using Detail::Match;
+			switch( length )
+			{
+			case 2:
+				switch( str[0] ){
+				case 'd': return Match( str, "do", TokenType::TK_DO );
+				case 'i': return Match( str, "if", TokenType::TK_IF );
+				}
+				break;
+			case 3:
+				switch( str[0] ){
+				case 'v': return Match( str, "var", TokenType::TK_VAR );
+				case 'f': return Match( str, "for", TokenType::TK_FOR );
+				case 'i': return Match( str, "int", TokenType::TK_INT );
+				}
+				break;
+			case 4:
+				switch( str[0] ){
+				case 'i': return Match( str, "isit", TokenType::TK_ISIT );
+				case 't': return Match( str, "true", TokenType::TK_TRUE );
+				case 'e': return str[1] == 'l' ? Match( str, "else", TokenType::TK_ELSE )
+							  : Match( str, "enum", TokenType::TK_ENUM );
+				}
+				break;
+			case 5:
+				switch( str[0] ){
+				case 'w': return Match( str, "while", TokenType::TK_WHILE );
+				case 'a': return Match( str, "among", TokenType::TK_AMONG );
+				case 'l': return Match( str, "leave", TokenType::TK_LEAVE );
+				case 'f': return Match( str, "false", TokenType::TK_FALSE );
+				case 'c': return str[1] == 'h' ? Match( str, "check", TokenType::TK_CHECK )
+							  : Match( str, "class", TokenType::TK_CLASS );
+				}
+				break;
+			case 6:
+				switch( str[0] ){
+				case 'p': return Match( str, "public", TokenType::TK_PUBLIC );
+				case 'd': return Match( str, "double", TokenType::TK_DOUBLE );
+				case 's': return Match( str, "string", TokenType::TK_STRING );
+				case 't': return Match( str, "typeof", TokenType::TK_TYPEOF );
+				case 'r': return Match( str, "return", TokenType::TK_RETURN );
+				case 'i': return Match( str, "import", TokenType::TK_IMPORT );
+				}
+				break;
+			case 7:
+				switch( str[0] ){
+				case 'p': return Match( str, "private", TokenType::TK_PRIVATE );
+				case 'b': return Match( str, "boolean", TokenType::TK_BOOLEAN );
+				case 'e': return Match( str, "extends", TokenType::TK_EXTENDS );
+				case 'v': return Match( str, "virtual", TokenType::TK_VIRTUAL );
+				}
+				break;
+			case 8:
+				switch( str[0] ){
+				case 'f': return Match( str, "function", TokenType::TK_FUNCTION );
+				case 'c': return Match( str, "continue", TokenType::TK_CONTINUE );
+				case 'd': return Match( str, "decltype", TokenType::TK_DECLTYPE );
+				}
+				break;
+			case 9:
+				switch( str[0] ){
+				case 'p': return Match( str, "protected", TokenType::TK_PROTECTED );
+				case 'n': return Match( str, "namespace", TokenType::TK_NAMESPACE );
+				case 'c': return Match( str, "construct", TokenType::TK_CONSTRUCT );
+				}
+				break;
+			}
+			return TokenType::TK_IDENTIFIER;
+		}
+
+		namespace Detail
+		{
+			constexpr bool ClassifiesAllKeywords()
+			{
+				for( Keyword const & keyword : keywords ){
+					if( ClassifyIdentifier( keyword.spelling, keyword.length ) != keyword.type ) return false;
+				}
+				return true;
+			}
+		} // namespace Detail
+
+		static_assert( Detail::ClassifiesAllKeywords(), "ClassifyIdentifier is out of sync with the keyword list" );
+		static_assert( ClassifyIdentifier( "whale", 5 ) == TokenType::TK_IDENTIFIER, "near-miss must stay an identifier" );
+	} // namespace Lexer
+} // namespace MaryLang
@@ -0,0 +1,144 @@
+#include "LexAll.hpp"
+#include "Scanner.hpp"
+#include "../Utils/TimeTrace.hpp"
+#include <cstring>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+namespace MaryLang
+{
+	namespace Lexer
+	{
+		namespace
+		{
+			// What a worker found in [begin, end). diag_marks[i] is how many diagnostics had
+			// been recorded before tokens[i] was lexed; the last mark closes the final token.
+			struct Chunk
+			{
+				std::uint32_t				begin, end;
+				std::vector<Token>			tokens;
+				std::vector<std::size_t>	diag_marks;
+				std::unique_ptr<Scanner>	scanner; // holds the chunk's diagnostics
+			};
+
+			void LexChunk( Support::SourceManager const & source, Chunk & chunk )
+			{
+				Support::TimeScope const scope( "Lex chunk", source.FileName() );
+				chunk.scanner.reset( new Scanner( source, chunk.begin ) );
+				Scanner & scanner = *chunk.scanner;
+				chunk.tokens.reserve( ( chunk.end - chunk.begin ) / 4 );
+
+				std::size_t mark = 0;
+				try {
+					for( ; ; ){
+						mark = scanner.Diagnostics().Count();
+						Token const token = scanner.GetNextToken();
+						if( token.Offset() >= chunk.end ) break; // the next chunk's
+						chunk.diag_marks.push_back( mark );
+						chunk.tokens.push_back( token );
+						if( token.Type() == TokenType::TK_EOF ){
+							mark = scanner.Diagnostics().Count();
+							break;
+						}
+					}
+				} catch( std::runtime_error const & ) {
+					// Most likely a comment the chunk only thinks is unterminated because it
+					// started inside another one. Stitching lexes on from here by itself.
+				}
+				chunk.diag_marks.push_back( mark );
+			}
+
+			// Cuts the buffer roughly every `chunk_size' bytes, just after a newline.
+			std::vector<Chunk> MakeChunks( Support::SourceManager const & source, std::size_t chunk_size )
+			{
+				std::vector<Chunk> chunks;
+				char const * const data = source.Data();
+				std::uint32_t const size = source.Size();
+				for( std::uint32_t begin = 0; begin < size; ){
+					std::uint32_t end = size;
+					if( size - begin > chunk_size ){
+						std::size_t const nominal = begin + chunk_size;
+						char const * const newline = static_cast<char const *>(
+							std::memchr( data + nominal, '\n', size - nominal ) );
+						if( newline != nullptr ) end = static_cast<std::uint32_t>( newline + 1 - data );
+					}
+					chunks.push_back( Chunk() );
+					chunks.back().begin = begin;
+					chunks.back().end = end;
+					begin = end;
+				}
+				return chunks;
+			}
+		} // namespace
+
+		std::vector<Token> LexAll( Support::SourceManager const & source, Support::ThreadPool & pool,
+			Support::Diagnostic & diag, std::size_t chunk_size )
+		{
+			Support::TimeScope const scope( "Lex", source.FileName() );
+			std::vector<Chunk> chunks;
+			if( pool.Size() > 1 && source.Size() > chunk_size ){
+				chunks = MakeChunks( source, chunk_size );
+			}
+			std::vector<std::future<void>> lexed;
+			lexed.reserve( chunks.size() );
+			for( Chunk & chunk : chunks ){
+				lexed.push_back( pool.Submit( [&source, &chunk]{ LexChunk( source, chunk ); } ) );
+			}
+
+			std::vector<Token> tokens;
+			tokens.reserve( source.Size() / 5 );
+			Scanner sequential( source );
+			Support::Diagnostic & sequential_diag = sequential.Diagnostics();
+			std::uint32_t resume = 0; // where the last accepted token ends
+			bool done = false;
+
+			auto lex_one = [&]() -> Token {
+				sequential.Seek( resume );
+				Token const token = sequential.GetNextToken();
+				diag.Append( sequential_diag );
+				sequential_diag.Clear();
+				tokens.push_back( token );
+				resume = token.Offset() + token.Length();
+				done = token.Type() == TokenType::TK_EOF;
+				return token;
+			};
+
+			try {
+				for( std::size_t c = 0; c < chunks.size() && !done; ++c ){
+					lexed[c].get();
+					Chunk & chunk = chunks[c];
+					std::size_t const count = chunk.tokens.size();
+					std::size_t i = 0;
+					while( !done ){
+						while( i < count && chunk.tokens[i].Offset() < resume ) ++i;
+						if( i == count ) break;
+						if( chunk.tokens[i].Offset() != resume ){
+							// not in step yet: take one token from the sequential scanner and
+							// see whether the chunk found it too.
+							Token const token = lex_one();
+							while( i < count && chunk.tokens[i].Offset() < token.Offset() ) ++i;
+							if( done || i == count || chunk.tokens[i].Offset() != token.Offset() ) continue;
+							++i;
+						}
+						diag.Append( chunk.scanner->Diagnostics(), chunk.diag_marks[i], chunk.diag_marks[count] );
+						tokens.insert( tokens.end(), chunk.tokens.begin() + i, chunk.tokens.end() );
+						Token const & last = tokens.back();
+						resume = last.Offset() + last.Length();
+						done = last.Type() == TokenType::TK_EOF;
+						break;
+					}
+					std::vector<Token>().swap( chunk.tokens );
+					chunk.scanner.reset();
+				}
+				while( !done ) lex_one();
+			} catch( ... ) {
+				// the workers still refer to `chunks'
+				for( auto & result : lexed ) if( result.valid() ) result.wait();
+				throw;
+			}
+			for( auto & result : lexed ) if( result.valid() ) result.wait();
+			return tokens;
+		}
+	} // namespace Lexer
+} // namespace MaryLang
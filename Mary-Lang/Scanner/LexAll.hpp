@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "tokens.hpp"
+#include "../Utils/Diagnostics.hpp"
+#include "../Utils/SourceManager.hpp"
+#include "../Utils/ThreadPool.hpp"
+
+namespace MaryLang
+{
+	namespace Lexer
+	{
+		// Lexes all of `source' into one contiguous token array ending in TK_EOF, the same
+		// tokens and diagnostics a single Scanner would produce.
+		//
+		// The buffer is cut into chunks at line starts and each chunk is lexed on `pool'.
+		// A chunk may really start inside a block comment, so its tokens are only a guess.
+		// Stitching walks the chunks in order and lexes sequentially from the end of the
+		// accepted tokens until it reaches a token start the chunk also found. The scanner
+		// keeps no state between tokens, so everything the chunk found from there on is
+		// exactly what a sequential scan would have found. Diagnostics from the chunks are
+		// held back until their tokens are accepted, then appended to `diag'.
+		std::vector<Token> LexAll( Support::SourceManager const & source, Support::ThreadPool & pool,
+			Support::Diagnostic & diag, std::size_t chunk_size = 1 << 20 );
+	} // namespace Lexer
+} // namespace MaryLang
@@ -0,0 +1,288 @@
+#include "ScanKernels.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+#define MARY_SCAN_X86
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#endif
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#define MARY_TARGET_AVX2
+#else
+#define MARY_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#endif
+
+namespace MaryLang
+{
+	namespace Lexer
+	{
+		namespace
+		{
+			inline unsigned CountTrailingZeros( std::uint32_t mask )
+			{
+#if defined( _MSC_VER )
+				unsigned long index;
+				_BitScanForward( &index, mask );
+				return static_cast<unsigned>( index );
+#else
+				return static_cast<unsigned>( __builtin_ctz( mask ) );
+#endif
+			}
+
+			inline bool IsWhitespace( unsigned char c )
+			{
+				return c == ' ' || static_cast<unsigned>( c - '\t' ) <= static_cast<unsigned>( '\r' - '\t' );
+			}
+
+			inline bool IsIdentifierChar( unsigned char c )
+			{
+				return static_cast<unsigned>( ( c | 0x20 ) - 'a' ) < 26u
+					|| static_cast<unsigned>( c - '0' ) < 10u || c == '_';
+			}
+
+			/* portable C++ */
+			char const * ScalarSkipWhitespace( char const * p, char const * end )
+			{
+				while( p != end && IsWhitespace( *p ) ) ++p;
+				return p;
+			}
+
+			char const * ScalarFindLineEnd( char const * p, char const * end )
+			{
+				while( p != end && *p != '\n' && *p != '\0' ) ++p;
+				return p;
+			}
+
+			char const * ScalarFindBlockCommentEnd( char const * p, char const * end )
+			{
+				for( ; p != end && *p != '\0'; ++p ){
+					if( *p == '*' && p + 1 != end && p[1] == '/' ) return p;
+				}
+				return p;
+			}
+
+			char const * ScalarSkipIdentifierChars( char const * p, char const * end )
+			{
+				while( p != end && IsIdentifierChar( *p ) ) ++p;
+				return p;
+			}
+
+			char const * ScalarFindStringSpecial( char const * p, char const * end, char delimiter )
+			{
+				for( ; p != end; ++p ){
+					char const c = *p;
+					if( c == delimiter || c == '\\' || c == '#' || c == '}' || c == '\n' || c == '\0' ) return p;
+				}
+				return p;
+			}
+
+#if defined( MARY_SCAN_X86 )
+			/* SSE2, always present on x86-64 */
+			inline __m128i Sse2Load( char const * p )
+			{
+				return _mm_loadu_si128( reinterpret_cast<__m128i const *>( p ) );
+			}
+
+			// bytes of `v' in [low, low + span], as an unsigned range check.
+			inline __m128i Sse2InRange( __m128i v, char low, char span )
+			{
+				__m128i const shifted = _mm_sub_epi8( v, _mm_set1_epi8( low ) );
+				return _mm_cmpeq_epi8( _mm_min_epu8( shifted, _mm_set1_epi8( span ) ), shifted );
+			}
+
+			inline __m128i Sse2Equal( __m128i v, char c )
+			{
+				return _mm_cmpeq_epi8( v, _mm_set1_epi8( c ) );
+			}
+
+			char const * Sse2SkipWhitespace( char const * p, char const * end )
+			{
+				for( ; end - p >= 16; p += 16 ){
+					__m128i const v = Sse2Load( p );
+					__m128i const space = _mm_or_si128( Sse2Equal( v, ' ' ), Sse2InRange( v, '\t', '\r' - '\t' ) );
+					std::uint32_t const stop = ~static_cast<std::uint32_t>( _mm_movemask_epi8( space ) ) & 0xFFFFu;
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return ScalarSkipWhitespace( p, end );
+			}
+
+			char const * Sse2FindLineEnd( char const * p, char const * end )
+			{
+				for( ; end - p >= 16; p += 16 ){
+					__m128i const v = Sse2Load( p );
+					std::uint32_t const stop = _mm_movemask_epi8( _mm_or_si128( Sse2Equal( v, '\n' ), Sse2Equal( v, '\0' ) ) );
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return ScalarFindLineEnd( p, end );
+			}
+
+			char const * Sse2FindBlockCommentEnd( char const * p, char const * end )
+			{
+				for( ; end - p >= 17; p += 16 ){
+					__m128i const v = Sse2Load( p );
+					__m128i const close = _mm_and_si128( Sse2Equal( v, '*' ), Sse2Equal( Sse2Load( p + 1 ), '/' ) );
+					std::uint32_t const stop = _mm_movemask_epi8( _mm_or_si128( close, Sse2Equal( v, '\0' ) ) );
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return ScalarFindBlockCommentEnd( p, end );
+			}
+
+			char const * Sse2SkipIdentifierChars( char const * p, char const * end )
+			{
+				for( ; end - p >= 16; p += 16 ){
+					__m128i const v = Sse2Load( p );
+					__m128i const letter = Sse2InRange( _mm_or_si128( v, _mm_set1_epi8( 0x20 ) ), 'a', 25 );
+					__m128i const part = _mm_or_si128( _mm_or_si128( letter, Sse2InRange( v, '0', 9 ) ), Sse2Equal( v, '_' ) );
+					std::uint32_t const stop = ~static_cast<std::uint32_t>( _mm_movemask_epi8( part ) ) & 0xFFFFu;
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return ScalarSkipIdentifierChars( p, end );
+			}
+
+			char const * Sse2FindStringSpecial( char const * p, char const * end, char delimiter )
+			{
+				for( ; end - p >= 16; p += 16 ){
+					__m128i const v = Sse2Load( p );
+					__m128i special = _mm_or_si128( Sse2Equal( v, delimiter ), Sse2Equal( v, '\\' ) );
+					special = _mm_or_si128( special, _mm_or_si128( Sse2Equal( v, '#' ), Sse2Equal( v, '}' ) ) );
+					special = _mm_or_si128( special, _mm_or_si128( Sse2Equal( v, '\n' ), Sse2Equal( v, '\0' ) ) );
+					std::uint32_t const stop = _mm_movemask_epi8( special );
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return ScalarFindStringSpecial( p, end, delimiter );
+			}
+
+			/* AVX2, chosen at run time */
+			MARY_TARGET_AVX2 inline __m256i Avx2Load( char const * p )
+			{
+				return _mm256_loadu_si256( reinterpret_cast<__m256i const *>( p ) );
+			}
+
+			MARY_TARGET_AVX2 inline __m256i Avx2InRange( __m256i v, char low, char span )
+			{
+				__m256i const shifted = _mm256_sub_epi8( v, _mm256_set1_epi8( low ) );
+				return _mm256_cmpeq_epi8( _mm256_min_epu8( shifted, _mm256_set1_epi8( span ) ), shifted );
+			}
+
+			MARY_TARGET_AVX2 inline __m256i Avx2Equal( __m256i v, char c )
+			{
+				return _mm256_cmpeq_epi8( v, _mm256_set1_epi8( c ) );
+			}
+
+			MARY_TARGET_AVX2 char const * Avx2SkipWhitespace( char const * p, char const * end )
+			{
+				for( ; end - p >= 32; p += 32 ){
+					__m256i const v = Avx2Load( p );
+					__m256i const space = _mm256_or_si256( Avx2Equal( v, ' ' ), Avx2InRange( v, '\t', '\r' - '\t' ) );
+					std::uint32_t const stop = ~static_cast<std::uint32_t>( _mm256_movemask_epi8( space ) );
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return Sse2SkipWhitespace( p, end );
+			}
+
+			MARY_TARGET_AVX2 char const * Avx2FindLineEnd( char const * p, char const * end )
+			{
+				for( ; end - p >= 32; p += 32 ){
+					__m256i const v = Avx2Load( p );
+					std::uint32_t const stop = _mm256_movemask_epi8( _mm256_or_si256( Avx2Equal( v, '\n' ), Avx2Equal( v, '\0' ) ) );
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return Sse2FindLineEnd( p, end );
+			}
+
+			MARY_TARGET_AVX2 char const * Avx2FindBlockCommentEnd( char const * p, char const * end )
+			{
+				for( ; end - p >= 33; p += 32 ){
+					__m256i const v = Avx2Load( p );
+					__m256i const close = _mm256_and_si256( Avx2Equal( v, '*' ), Avx2Equal( Avx2Load( p + 1 ), '/' ) );
+					std::uint32_t const stop = _mm256_movemask_epi8( _mm256_or_si256( close, Avx2Equal( v, '\0' ) ) );
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return Sse2FindBlockCommentEnd( p, end );
+			}
+
+			MARY_TARGET_AVX2 char const * Avx2SkipIdentifierChars( char const * p, char const * end )
+			{
+				for( ; end - p >= 32; p += 32 ){
+					__m256i const v = Avx2Load( p );
+					__m256i const letter = Avx2InRange( _mm256_or_si256( v, _mm256_set1_epi8( 0x20 ) ), 'a', 25 );
+					__m256i const part = _mm256_or_si256( _mm256_or_si256( letter, Avx2InRange( v, '0', 9 ) ), Avx2Equal( v, '_' ) );
+					std::uint32_t const stop = ~static_cast<std::uint32_t>( _mm256_movemask_epi8( part ) );
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return Sse2SkipIdentifierChars( p, end );
+			}
+
+			MARY_TARGET_AVX2 char const * Avx2FindStringSpecial( char const * p, char const * end, char delimiter )
+			{
+				for( ; end - p >= 32; p += 32 ){
+					__m256i const v = Avx2Load( p );
+					__m256i special = _mm256_or_si256( Avx2Equal( v, delimiter ), Avx2Equal( v, '\\' ) );
+					special = _mm256_or_si256( special, _mm256_or_si256( Avx2Equal( v, '#' ), Avx2Equal( v, '}' ) ) );
+					special = _mm256_or_si256( special, _mm256_or_si256( Avx2Equal( v, '\n' ), Avx2Equal( v, '\0' ) ) );
+					std::uint32_t const stop = _mm256_movemask_epi8( special );
+					if( stop != 0 ) return p + CountTrailingZeros( stop );
+				}
+				return Sse2FindStringSpecial( p, end, delimiter );
+			}
+
+			bool CpuHasAvx2()
+			{
+#if defined( _MSC_VER )
+				int info[4];
+				__cpuid( info, 1 );
+				bool const os_saves_ymm = ( info[2] & ( 1 << 27 ) ) && ( info[2] & ( 1 << 28 ) )
+					&& ( _xgetbv( 0 ) & 6 ) == 6;
+				__cpuidex( info, 7, 0 );
+				return os_saves_ymm && ( info[1] & ( 1 << 5 ) );
+#else
+				__builtin_cpu_init();
+				return __builtin_cpu_supports( "avx2" );
+#endif
+			}
+#endif // MARY_SCAN_X86
+
+			ScanKernels const scalar_kernels = {
+				ScalarSkipWhitespace, ScalarFindLineEnd, ScalarFindBlockCommentEnd,
+				ScalarSkipIdentifierChars, ScalarFindStringSpecial, "scalar"
+			};
+
+			ScanKernels SelectKernels()
+			{
+#if defined( MARY_SCAN_X86 )
+				ScanKernels const sse2_kernels = {
+					Sse2SkipWhitespace, Sse2FindLineEnd, Sse2FindBlockCommentEnd,
+					Sse2SkipIdentifierChars, Sse2FindStringSpecial, "sse2"
+				};
+				ScanKernels const avx2_kernels = {
+					Avx2SkipWhitespace, Avx2FindLineEnd, Avx2FindBlockCommentEnd,
+					Avx2SkipIdentifierChars, Avx2FindStringSpecial, "avx2"
+				};
+				// MARY_SCAN_KERNELS=scalar|sse2 caps the choice, for benchmarking and debugging.
+				char const * const cap = std::getenv( "MARY_SCAN_KERNELS" );
+				if( cap != nullptr && std::strcmp( cap, "scalar" ) == 0 ) return scalar_kernels;
+				if( cap != nullptr && std::strcmp( cap, "sse2" ) == 0 ) return sse2_kernels;
+				return CpuHasAvx2() ? avx2_kernels : sse2_kernels;
+#else
+				return scalar_kernels;
+#endif
+			}
+		} // namespace
+
+		ScanKernels const & ScanKernels::Get()
+		{
+			static ScanKernels const kernels = SelectKernels();
+			return kernels;
+		}
+
+		ScanKernels const & ScanKernels::Scalar()
+		{
+			return scalar_kernels;
+		}
+	} // namespace Lexer
+} // namespace MaryLang
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+namespace MaryLang
+{
+	namespace Lexer
+	{
+		// Bulk byte-scanning routines for the scanner's hot loops. Each one starts at `p' and
+		// returns the first byte in [p, end) it stops on, or `end'. A NUL byte always stops a
+		// search, because the scanner treats it as the end of input.
+		struct ScanKernels
+		{
+			// the first byte that is not one of " \t\n\v\f\r".
+			char const * ( *SkipWhitespace )( char const * p, char const * end );
+			// the '\n' that ends a // comment.
+			char const * ( *FindLineEnd )( char const * p, char const * end );
+			// the '*' of the "*/" that ends a block comment.
+			char const * ( *FindBlockCommentEnd )( char const * p, char const * end );
+			// the first byte that is not [A-Za-z0-9_]; non-ASCII identifiers take the slow path.
+			char const * ( *SkipIdentifierChars )( char const * p, char const * end );
+			// the next byte a string literal body has to look at: the delimiter, '\\', '#',
+			// '}' or '\n'.
+			char const * ( *FindStringSpecial )( char const * p, char const * end, char delimiter );
+
+			char const * name;
+
+			// The best implementation this CPU supports: AVX2, SSE2 or portable C++.
+			static ScanKernels const & Get();
+			static ScanKernels const & Scalar();
+		}; // ScanKernels
+	} // namespace Lexer
+} // namespace MaryLang
@@ -1,15 +1,12 @@
 #include "Scanner.hpp"
-#include <fstream>
+#include "Keywords.hpp"
+#include <cstdlib>
 #include <cwctype>
+#include <stdexcept>
+#include <string>
+#include "../Utils/StringInterner.hpp"
 #include "../Utils/Utils.hpp"
 
-#if defined( _WIN32 )
-#include <Windows.h>
-#else
-#include <cstdlib>
-#include <clocale>
-#endif
-
 #define isHexNumber(c) ( ( c >= L'A' && c <= L'F' ) || ( c >= L'a' && c <= L'f' ) || ( c >= L'0' && c <= L'9' ))
 #define isOctalNumber(c) ( c >= L'0' && c <= L'7' )
 
@@ -18,102 +15,159 @@ namespace MaryLang
 	namespace Lexer
 	{
 		Scanner::Scanner( char const * filename )
-			:diag( true ), pos( 0, 0 ), 
-			buffer( nullptr ), current_token( '\n' ),
-			marker_position( 0 ), begin_mark( 0 ),
-			buffer_size( 0 )
+			:diag(), source( &own_source ), stream( nullptr ),
+			buffer( nullptr ), base( 0 ), current_token( '\n' ),
+			marker_position( 0 ), begin_mark( 0 ), char_position( 0 ),
+			buffer_size( 0 ), kernels( ScanKernels::Get() ), stats( Support::Statistics::Local() )
 		{
-			if( SetNewFileName( filename ) ){
-				Token::InitLookupTable();
-			} else {
-				exit( -1 );
+			if( !SetNewFileName( filename ) ){
+				throw std::runtime_error( std::string( "unable to open source file " ) + filename );
 			}
 		}
 
+		Scanner::Scanner( Support::SourceManager const & shared_source, std::uint32_t offset )
+			:diag(), source( &shared_source ), stream( nullptr ),
+			buffer( shared_source.Data() ), base( 0 ), current_token( '\0' ),
+			marker_position( 0 ), begin_mark( offset ), char_position( 0 ),
+			buffer_size( shared_source.Size() ), kernels( ScanKernels::Get() ), stats( Support::Statistics::Local() )
+		{
+			SetCurrent( offset );
+		}
+
+		Scanner::Scanner( Support::SourceStream & source_stream )
+			:diag(), source( &own_source ), stream( &source_stream ),
+			buffer( source_stream.Data() ), base( source_stream.Base() ), current_token( '\0' ),
+			marker_position( 0 ), begin_mark( 0 ), char_position( 0 ),
+			buffer_size( source_stream.Size() ), kernels( ScanKernels::Get() ), stats( Support::Statistics::Local() )
+		{
+			SetCurrent( 0 );
+		}
+
 		Scanner::~Scanner()
 		{
-			delete []buffer;
 		}
 
-		void Scanner::NextChar()
+		// Makes the character at `offset' the current one.
+		inline void Scanner::SetCurrent( std::size_t offset )
 		{
-			if( marker_position == buffer_size ) {
+			char_position = offset;
+			if( offset == buffer_size ) {
+				if( Refill() ) return SetCurrent( char_position );
 				current_token = L'\0';
-
+				marker_position = buffer_size;
 				return;
 			}
-
-			if( current_token == L'\n' ){
-				++pos._line_number;
-				pos._column_number = 1;
-			} else {
-				++pos._column_number;
+			unsigned char const c = buffer[offset];
+			current_token = c;
+			if( c < 0x80 ){
+				marker_position = offset + 1;
+				return;
 			}
-			current_token = buffer[marker_position];
-			++marker_position;
+			// Multi-byte sequences are only stepped over here. Decoding is
+			// left to identifiers and string literals, the only tokens that need the value.
+			std::size_t length = Support::Utf8SequenceLength( c );
+			if( length > buffer_size - offset ){
+				if( Refill() ) return SetCurrent( char_position ); // the rest of it may be on its way
+				length = buffer_size - offset;
+			}
+			marker_position = offset + length;
 		}
 
-		bool Scanner::SetNewFileName( char const * filename )
+		// Everything from the offset the stream still keeps moves to the front of the window,
+		// so the positions the scanner holds move with it.
+		bool Scanner::Refill()
 		{
-			char* buffer;
-			std::ifstream in( filename, std::ios_base::in | std::ios_base::binary 
-				| std::ios_base::ate );
-			if( in ) {
-				// get file size
-				in.seekg(0, std::ios::end);
-				buffer_size = (size_t)in.tellg();
-				in.seekg(0, std::ios::beg);
-				buffer = (char*)calloc(buffer_size + 1, sizeof(char));
-				in.read(buffer, buffer_size);
-				// close file
-				in.close();
-			}
-			else {
-				std::wcerr << L"Unable to open source file: " << filename << std::endl;
-				return false;
-			}
+			if( stream == nullptr || !stream->Refill() ) return false;
+			std::size_t const shift = stream->Base() - base;
+			buffer = stream->Data();
+			buffer_size = stream->Size();
+			base = stream->Base();
+			begin_mark -= shift;
+			char_position -= shift;
+			marker_position -= shift;
+			return true;
+		}
 
-			// convert unicode
-#if defined( _WIN32 ) && defined( _MSC_VER )
-			int wsize = MultiByteToWideChar( CP_UTF8, 0, buffer, -1, nullptr, 0);
-			if( !wsize ) {
-				std::wcerr << L"Unable to open source file: " << filename << std::endl;
-				return false;
-			}
-			wchar_t* wbuffer = new wchar_t[wsize];
-			int check = MultiByteToWideChar( CP_UTF8, 0, buffer, -1, wbuffer, wsize);
-			if(!check) {
-				std::wcerr << L"Unable to open source file: " << filename << std::endl;
-				return false;
-			}
-#else
-			size_t wsize = std::mbstowcs( nullptr, buffer, buffer_size);
-			if( wsize == (size_t)-1 ) {
-				free( buffer );
-				std::wcerr << L"Unable to open source file: " << filename << std::endl;
-				return false;
-			}
-			wchar_t* wbuffer = new wchar_t[wsize + 1];
-			size_t check = std::mbstowcs( wbuffer, buffer, buffer_size );
-			if( check == (size_t)-1 ) {
-				free( buffer );
-				delete[] wbuffer;
-				std::wcerr << L"Unable to open source file: " << filename << std::endl;
+		// No line or column bookkeeping happens here; the SourceManager works positions
+		// out from token offsets when something asks for one.
+		void Scanner::NextChar()
+		{
+			SetCurrent( marker_position );
+		}
+
+		inline wchar_t Scanner::PeekChar()
+		{
+			if( marker_position >= buffer_size && !Refill() ) return L'\0';
+			return static_cast<unsigned char>( buffer[marker_position] );
+		}
+
+		inline char32_t Scanner::CurrentCodePoint() const
+		{
+			if( current_token < 0x80 ) return current_token;
+			return Support::DecodeUtf8( &buffer[char_position], 
+				static_cast<unsigned>( marker_position - char_position ) );
+		}
+
+		inline Token Scanner::MakeToken( TokenType type, std::uint32_t payload ) const
+		{
+			if( stats != nullptr ) ++stats->tokens[static_cast<std::size_t>( type )];
+			return Token( static_cast<std::uint32_t>( base + begin_mark ), 
+				static_cast<std::uint32_t>( char_position - begin_mark ), type, payload );
+		}
+
+		inline bool Scanner::IsIdentifierStart() const
+		{
+			return current_token == L'_' || std::iswalpha( static_cast<wint_t>( CurrentCodePoint() ) );
+		}
+
+		inline bool Scanner::IsIdentifierPart() const
+		{
+			return current_token == L'_' || std::iswalnum( static_cast<wint_t>( CurrentCodePoint() ) );
+		}
+
+		bool Scanner::SetNewFileName( char const * filename )
+		{
+			// tokens address the source with 32-bit offsets, so larger files are refused too.
+			if( !own_source.Open( filename ) ){
 				return false;
 			}
-			wbuffer[wsize] = L'\0';
-#endif
-			free(buffer);
-			this->buffer = wbuffer;
+			source = &own_source;
+			stream = nullptr;
+			buffer = own_source.Data();
+			base = 0;
+			buffer_size = own_source.Size();
+			begin_mark = 0;
+			SetCurrent( 0 );
 			return true;
 		}
 
+		Support::StringRef Scanner::Spelling( Token const & token ) const
+		{
+			return Support::StringRef( buffer + ( token.Offset() - base ), token.Length() );
+		}
+
+		Support::Position Scanner::GetPosition( Token const & token ) const
+		{
+			return stream != nullptr ? stream->GetPosition( token.Offset() ) : source->GetPosition( token.Offset() );
+		}
+
+		void Scanner::Seek( std::uint32_t offset )
+		{
+			begin_mark = offset - base;
+			SetCurrent( offset - base );
+		}
+
+		void Scanner::Release( std::uint32_t offset )
+		{
+			if( stream != nullptr ) stream->Release( offset );
+		}
+
 		Token Scanner::GetNextToken()
 		{
 			for( ; ; )
 			{
-				if( EOF != current_token 
-					&& ( std::iswalpha( current_token ) || current_token == L'_' ) )
+				begin_mark = char_position;
+				if( IsIdentifierStart() )
 				{
 					return IdentifierOrKeywordToken();
 				} else {
@@ -121,15 +175,23 @@ namespace MaryLang
 					{
 					case L'\0':
 						marker_position = buffer_size;
-						return Token( pos, TokenType::TK_EOF );
+						return MakeToken( TokenType::TK_EOF );
 					case L' ':
 					case L'\r':
 					case L'\t':
 					case L'\n':
 					case L'\v':
 					case L'\f':
-						NextChar();
-						continue;
+						{
+							// a lone separator is the common case; only runs go through the kernel.
+							wchar_t const next = PeekChar();
+							if( next != L' ' && ( next < L'\t' || next > L'\r' ) ){
+								NextChar();
+								continue;
+							}
+							SetCurrent( kernels.SkipWhitespace( buffer + marker_position, buffer + buffer_size ) - buffer );
+							continue;
+						}
 
 					case L'0':
 					case L'1':
@@ -148,98 +210,100 @@ namespace MaryLang
 						return GetStringLiteralToken();
 					case L'.':
 						NextChar();
-						return Token( pos, TokenType::TK_DOT );
+						return MakeToken( TokenType::TK_DOT );
 					case L'+':
 						{
-							Support::Position newPos( pos );
 							NextChar();
 							switch( current_token )
 							{
-							case L'+': NextChar(); return Token( newPos, TokenType::TK_INCREMENT );
-							case L'=': NextChar(); return Token( newPos, TokenType::TK_ADDEQL );
-							default: return Token( newPos, TokenType::TK_ADD );
+							case L'+': NextChar(); return MakeToken( TokenType::TK_INCREMENT );
+							case L'=': NextChar(); return MakeToken( TokenType::TK_ADDEQL );
+							default: return MakeToken( TokenType::TK_ADD );
 							}
 						}
 					case L'-':
 						{
-							Support::Position newPos( pos );
 							NextChar();
 							switch( current_token )
 							{
-							case L'-': NextChar(); return Token( newPos, TokenType::TK_DECREMENT );
-							case L'>': NextChar(); return Token( newPos, TokenType::TK_ARROW );
-							case L'=': NextChar(); return Token( newPos, TokenType::TK_SUBEQL );
-							default: return Token( newPos, TokenType::TK_SUB );
+							case L'-': NextChar(); return MakeToken( TokenType::TK_DECREMENT );
+							case L'>': NextChar(); return MakeToken( TokenType::TK_ARROW );
+							case L'=': NextChar(); return MakeToken( TokenType::TK_SUBEQL );
+							default: return MakeToken( TokenType::TK_SUB );
 							}
 						}
 					case L'*':
 						{
-							Support::Position newPos( pos );
 							NextChar();
 							switch( current_token )
 							{
-							case L'=': NextChar(); return Token( newPos, TokenType::TK_MULEQL );
-							case L'*': NextChar(); return Token( newPos, TokenType::TK_EXP );
-							default: return Token( newPos, TokenType::TK_MUL );
+							case L'=': NextChar(); return MakeToken( TokenType::TK_MULEQL );
+							case L'*': NextChar(); return MakeToken( TokenType::TK_EXP );
+							default: return MakeToken( TokenType::TK_MUL );
 							}
 						}
 					case L'/':
 						{
-							Support::Position newPos( pos );
 							NextChar();
 							switch( current_token )
 							{
 							case L'=':
 								NextChar();
-								return Token( newPos, TokenType::TK_DIVEQL );
+								return MakeToken( TokenType::TK_DIVEQL );
 							case L'*': 
 								{
-									NextChar();
-									while( current_token != EOF && 
-										!( current_token == L'*' && buffer[ marker_position ] == L'/' )){
-											NextChar();
-									}
-									if( current_token == EOF ) {
-										throw std::runtime_error( "Unterminated comment" );
+									std::size_t from = marker_position;
+									for( ; ; ){
+										std::size_t end = kernels.FindBlockCommentEnd( buffer + from, buffer + buffer_size ) - buffer;
+										// a stream's window may end between the `*' and the `/'
+										if( end == buffer_size && end > from && buffer[end - 1] == '*' ) --end;
+										SetCurrent( end );
+										if( current_token == L'\0' ) {
+											throw std::runtime_error( "Unterminated comment" );
+										}
+										if( current_token == L'*' && PeekChar() == L'/' ) break;
+										from = marker_position;
 									}
 									NextChar();
 									NextChar();
 									continue;
 								}
 							case L'/':
-								while( current_token != L'\n' ) NextChar();
+								do { // the line may go on past a stream's window
+									SetCurrent( kernels.FindLineEnd( buffer + char_position, buffer + buffer_size ) - buffer );
+								} while( current_token != L'\n' && current_token != L'\0' );
 								continue;
 							default:
-								return Token( newPos, TokenType::TK_DIV );
+								return MakeToken( TokenType::TK_DIV );
 							}
 						}
 					case L'&':
 						NextChar();
 						switch( current_token ){
-						case L'&': NextChar(); return Token( pos, TokenType::TK_LAND );
-						case L'=': NextChar(); return Token( pos, TokenType::TK_ANDEQL );
-						default: return Token( pos, TokenType::TK_AND );
+						case L'&': NextChar(); return MakeToken( TokenType::TK_LAND );
+						case L'=': NextChar(); return MakeToken( TokenType::TK_ANDEQL );
+						default: return MakeToken( TokenType::TK_AND );
 						}
 					case L'|':
 						NextChar();
 						switch( current_token ){
-						case L'|': NextChar(); return Token( pos, TokenType::TK_LOR );
-						case L'=': NextChar(); return Token( pos, TokenType::TK_OREQL );
-						default: return Token( pos, TokenType::TK_OR );
+						case L'|': NextChar(); return MakeToken( TokenType::TK_LOR );
+						case L'=': NextChar(); return MakeToken( TokenType::TK_OREQL );
+						default: return MakeToken( TokenType::TK_OR );
 						}
 					case L'^': 
 						NextChar();
 						switch( current_token )
 						{
-						case L'=': NextChar(); return Token( pos, TokenType::TK_XORASSIGN );
-						default:   return Token( pos, TokenType::TK_XOR );
+						case L'=': NextChar(); return MakeToken( TokenType::TK_XORASSIGN );
+						default:   return MakeToken( TokenType::TK_XOR );
 						}
-					case L'~': NextChar(); return Token( pos, TokenType::TK_NEG );
+					case L'~': NextChar(); return MakeToken( TokenType::TK_NEG );
 					case L'!':
 						NextChar();
 						switch( current_token ){
-						case L'=': NextChar(); return Token( pos, TokenType::TK_NOTEQL );
-						default: return Token( pos, TokenType::TK_NOT );
+						case L'=': NextChar(); return MakeToken( TokenType::TK_NOTEQL );
+						default: return MakeToken( TokenType::TK_NOT );
 						}
 					case L'<':
 						NextChar();
@@ -248,11 +312,11 @@ namespace MaryLang
 						case L'<':
 							NextChar(); 
 							switch( current_token ){
-							case L'=': NextChar(); return Token( pos, TokenType::TK_LSASSIGN );
-							default: return Token( pos, TokenType::TK_LSHIFT );
+							case L'=': NextChar(); return MakeToken( TokenType::TK_LSASSIGN );
+							default: return MakeToken( TokenType::TK_LSHIFT );
 							}
-						case L'=': NextChar(); return Token( pos, TokenType::TK_LEQL );
-						default: return Token( pos, TokenType::TK_LESS );
+						case L'=': NextChar(); return MakeToken( TokenType::TK_LEQL );
+						default: return MakeToken( TokenType::TK_LESS );
 						}
 					case L'>':
 						NextChar();
@@ -262,56 +326,59 @@ namespace MaryLang
 							NextChar(); 
 							switch( current_token )
 							{
-							case L'=': NextChar(); return Token( pos, TokenType::TK_RSASSIGN );
-							default: return Token( pos, TokenType::TK_RSHIFT );
+							case L'=': NextChar(); return MakeToken( TokenType::TK_RSASSIGN );
+							default: return MakeToken( TokenType::TK_RSHIFT );
 							}
-						case L'=': NextChar(); return Token( pos, TokenType::TK_GEQL );
-						default: return Token( pos, TokenType::TK_GREATER );
+						case L'=': NextChar(); return MakeToken( TokenType::TK_GEQL );
+						default: return MakeToken( TokenType::TK_GREATER );
 						}
 					case L'%':
 						NextChar();
 						switch ( current_token )
 						{
-						case L'=': NextChar(); return Token( pos, TokenType::TK_MODASSIGN );
-						default: return Token( pos, TokenType::TK_MODULO );
+						case L'=': NextChar(); return MakeToken( TokenType::TK_MODASSIGN );
+						default: return MakeToken( TokenType::TK_MODULO );
 						}
 					case L'(':
-						NextChar(); return Token( pos, TokenType::TK_LPAREN );
+						NextChar(); return MakeToken( TokenType::TK_LPAREN );
 					case L')':
-						NextChar(); return Token( pos, TokenType::TK_RPAREN );
+						NextChar(); return MakeToken( TokenType::TK_RPAREN );
 					case L'[':
-						NextChar(); return Token( pos, TokenType::TK_LBRACKET );
+						NextChar(); return MakeToken( TokenType::TK_LBRACKET );
 					case L']':
-						NextChar(); return Token( pos, TokenType::TK_RBRACKET );
+						NextChar(); return MakeToken( TokenType::TK_RBRACKET );
 					case L'{':
-						NextChar(); return Token( pos, TokenType::TK_LBRACE );
+						NextChar(); return MakeToken( TokenType::TK_LBRACE );
 					case L'}':
-						NextChar(); return Token( pos, TokenType::TK_RBRACE );
+						NextChar(); return MakeToken( TokenType::TK_RBRACE );
 					case L'=':
 						NextChar();
 						switch ( current_token )
 						{
 						case L'=':
 							NextChar();
-							return Token( pos, TokenType::TK_EQL );
-						default: return Token( pos, TokenType::TK_ASSIGN );
+							return MakeToken( TokenType::TK_EQL );
+						default: return MakeToken( TokenType::TK_ASSIGN );
 						}
 					case L'@':
 						NextChar();
-						return Token( pos, TokenType::TK_AT );
+						return MakeToken( TokenType::TK_AT );
 					case L':':
 						NextChar();
-						return Token( pos, TokenType::TK_COLON );
+						return MakeToken( TokenType::TK_COLON );
 					case L';':
 						NextChar();
-						return Token( pos, TokenType::TK_SEMICOLON );
+						return MakeToken( TokenType::TK_SEMICOLON );
 					case L',':
 						NextChar();
-						return Token( pos, TokenType::TK_COMMA );
+						return MakeToken( TokenType::TK_COMMA );
+					case L'?':
+						NextChar();
+						return MakeToken( TokenType::TK_QMARK );
 					default:
 						NextChar();
-						diag.Warning( pos, L"Invalid character" );
-						return Token( pos, TokenType::TK_INVALID );
+						diag.Report( Support::DiagID::InvalidCharacter, static_cast<std::uint32_t>( base + begin_mark ) );
+						return MakeToken( TokenType::TK_INVALID );
 					}
 				}
 			}
@@ -319,34 +386,26 @@ namespace MaryLang
 
 		Token Scanner::IdentifierOrKeywordToken()
 		{
-			begin_mark = marker_position - 1;
-			Support::Position newPos = pos;
 			NextChar();
-			while( ( std::iswalnum( current_token ) || current_token == L'_' ) 
-				&& !( current_token == EOF ) )
-			{ 
+			for( ; ; ){
+				// ASCII runs are skipped in bulk.
+				SetCurrent( kernels.SkipIdentifierChars( buffer + char_position, buffer + buffer_size ) - buffer );
+				if( current_token < 0x80 ){
+					// only where a stream's window ended can the run stop short
+					if( stream == nullptr || !IsIdentifierPart() ) break;
+					continue;
+				}
+				if( !IsIdentifierPart() ) break;
 				NextChar();
 			}
-
-			if( current_token == EOF ){
-				return Token( newPos, TokenType::TK_EOF );
+			Support::StringRef const spelling( &buffer[begin_mark], char_position - begin_mark );
+			TokenType const type = ClassifyIdentifier( spelling.Data(), spelling.Size() );
+			if( type != TokenType::TK_IDENTIFIER ){
+				return MakeToken( type );
 			}
-			return IdentifierOrKeywordToken( newPos );
+			return MakeToken( type, Support::StringInterner::Global().Intern( spelling ) );
 		} // Scanner::identifierOrKeyword
 
-		Token Scanner::IdentifierOrKeywordToken( Support::Position pos )
-		{
-			auto wsize = marker_position - begin_mark;
-			wchar_t *tk = Support::Mystrndup( &buffer[begin_mark], wsize - 1 );
-			if( tk == nullptr ){
-				std::wcerr << "Allocation/Copy failed" << std::endl;
-				exit( 1 );
-			}
-			auto f = Token::lookup_table.find( tk );
-			TokenType type = ( f == Token::lookup_table.end() ) ? TokenType::TK_IDENTIFIER : f->second;
-			return Token( tk, pos, type );
-		}
-
 		Token Scanner::GetIntegerToken()
 		{
 			// gather as many digits as we can get. Are we done?
@@ -364,7 +423,7 @@ namespace MaryLang
 				NextChar();
 				// with a positiive or negative sign?
 				if( ( current_token == L'+' || current_token == L'-' )
-					&& std::iswdigit( buffer[marker_position] ) )
+					&& std::iswdigit( PeekChar() ) )
 				{
 					NextChar();
 				}
@@ -374,37 +433,29 @@ namespace MaryLang
 				NextChar();
 			}
 
-			return Token( Support::Mystrndup( 
-				&buffer[begin_mark], ( marker_position - begin_mark ) - 1 ),
-				pos, ( isDecimal ? TokenType::TK_DOUBLE : TokenType::TK_INT ) );
+			return MakeToken( isDecimal ? TokenType::TK_DOUBLELITERAL : TokenType::TK_INTLITERAL );
 		}
 
 		Token Scanner::GetNumberToken()
 		{
-			Support::Position newPos = pos;
-			begin_mark = marker_position - 1;
-			wchar_t next_char_lookahead = buffer[marker_position];
+			wchar_t next_char_lookahead = PeekChar();
 			if( current_token == L'0' && 
 				( next_char_lookahead == L'x' || next_char_lookahead == L'X' ) )
 			{
 				NextChar();
 				do {
 					NextChar();
-				} while( current_token != EOF && isHexNumber( current_token ));
+				} while( isHexNumber( current_token ));
 
-				if( marker_position == EOF ){
-					diag.Warning( newPos, L"End of file encountered" );
+				if( current_token == L'\0' ){
+					diag.Report( Support::DiagID::EndOfFileInNumber, static_cast<std::uint32_t>( base + begin_mark ) );
 				}
-				return Token( Support::Mystrndup(
-					&buffer[begin_mark], ( marker_position - begin_mark ) - 1 ), 
-					newPos, TokenType::TK_INT );
+				return MakeToken( TokenType::TK_INTLITERAL );
 			} else if( current_token == L'0' && isOctalNumber( next_char_lookahead ) ) {
 				do {
 					NextChar();
-				} while( current_token != EOF && isOctalNumber( current_token ) );
-				return Token( Support::Mystrndup( 
-					&buffer[begin_mark], ( marker_position - begin_mark ) - 1 ), 
-					newPos, TokenType::TK_INT );
+				} while( isOctalNumber( current_token ) );
+				return MakeToken( TokenType::TK_INTLITERAL );
 			} else if( current_token == L'0' && 
 				( next_char_lookahead == L'b' || next_char_lookahead == L'B' )) 
 			{
@@ -414,12 +465,10 @@ namespace MaryLang
 				} while( current_token == L'0' || current_token == L'1' );
 
 				if( std::iswdigit( current_token ) ){
-					diag.Warning( pos, L"Invalid binary digit" );
+					diag.Report( Support::DiagID::InvalidBinaryDigit, static_cast<std::uint32_t>( base + char_position ) );
 					while( std::iswdigit( current_token ) ) NextChar();
 				}
-				return Token( Support::Mystrndup( 
-					&buffer[begin_mark], ( marker_position - begin_mark ) - 1 ),
-					newPos, TokenType::TK_INT );
+				return MakeToken( TokenType::TK_INTLITERAL );
 			}
 
 			return GetIntegerToken();
@@ -428,16 +477,15 @@ namespace MaryLang
 		// TO-DO: Recongize string interpolation.
 		Token Scanner::GetStringLiteralToken()
 		{
-			Support::Position newPos ( pos );
-			std::wstring buf;
 			int const delimeter = current_token;
 			NextChar();
 
 			bool hasError = false, strInterpolOpen = false, strInterpolAvailable = false;
 			for( ; ; ){
-				if( current_token == EOF || current_token == L'\n' ){
-					diag.Error( pos, L"Expected a delimeter in string." );
-					return Token( pos, TokenType::TK_INVALID );
+				SetCurrent( kernels.FindStringSpecial( buffer + char_position, buffer + buffer_size, static_cast<char>( delimeter ) ) - buffer );
+				if( current_token == L'\0' || current_token == L'\n' ){
+					diag.Report( Support::DiagID::UnterminatedString, static_cast<std::uint32_t>( base + char_position ) );
+					return MakeToken( TokenType::TK_INVALID );
 					marker_position = buffer_size;
 				}
 
@@ -445,15 +493,13 @@ namespace MaryLang
 					NextChar();
 					break;
 				} else if( current_token == L'\\' ) {
-					wchar_t peek = buffer[marker_position];
+					wchar_t peek = PeekChar();
 					if( peek == delimeter ){
 						NextChar();
 					}
 				} else if( current_token == L'#' ){
-					buf.push_back( current_token );
 					NextChar();
 					if( current_token == L'{' ){ 
-						buf.push_back( current_token );
 						strInterpolOpen = true;
 						NextChar();
 					}
@@ -462,12 +508,9 @@ namespace MaryLang
 					strInterpolOpen = false;
 					strInterpolAvailable = true;
 				}
-				buf.push_back( current_token );
 				NextChar();
 			}
-			return Token( Support::Mystrndup( buf.c_str(), buf.size() ),
-				newPos, 
-				( strInterpolAvailable ? TokenType::TK_STRLITINTERPOL : TokenType::TK_STRLITERAL ) );
+			return MakeToken( strInterpolAvailable ? TokenType::TK_STRLITINTERPOL : TokenType::TK_STRLITERAL );
 		}
 	} // namespace Lexer
 } // namespace MaryLang
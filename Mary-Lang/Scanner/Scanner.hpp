@@ -1,7 +1,13 @@
 #pragma once
-#include "Tokens.hpp"
+#include "tokens.hpp"
+#include "ScanKernels.hpp"
 #include "../Utils/Diagnostics.hpp"
+#include "../Utils/SourceManager.hpp"
+#include "../Utils/SourceStream.hpp"
+#include "../Utils/Statistics.hpp"
+#include "../Utils/StringRef.hpp"
 #include <memory>
+#include <vector>
 
 namespace MaryLang
 {
@@ -11,23 +17,55 @@ namespace MaryLang
 		{
 		private:
 			Support::Diagnostic	diag;
-			Support::Position	pos;
-			wchar_t				*buffer;
-			wchar_t				current_token;
-			int					marker_position, begin_mark;
-			int					buffer_size;
+			Support::SourceManager own_source; // the file SetNewFileName opened, if any
+			Support::SourceManager const *source;
+			Support::SourceStream *stream; // what is scanned, if it is a stream rather than a source
+			char const			*buffer;	// the source, or the stream's window
+			std::size_t			base;		// the offset of buffer[0]
+			wchar_t				current_token; // ASCII character, or the lead byte of a multi-byte one
+			std::size_t			marker_position, begin_mark, char_position;
+			std::size_t			buffer_size;
+			ScanKernels const	&kernels;
+			Support::Statistics::Shard *stats; // null unless counting
 		private:
 			Token	GetNumberToken();
 			Token	GetIntegerToken();
 			Token	GetStringLiteralToken();
 			void	NextChar();
+			void	SetCurrent( std::size_t offset );
+			// Reads more of a stream into the window; false if there is none, or no stream.
+			bool	Refill();
+			wchar_t	PeekChar();
+			char32_t CurrentCodePoint() const;
+			bool	IsIdentifierStart() const;
+			bool	IsIdentifierPart() const;
 			Token	IdentifierOrKeywordToken();
-			Token	IdentifierOrKeywordToken( Support::Position pos );
+			Token	MakeToken( TokenType type, std::uint32_t payload = 0 ) const;
 		public:
+			// Throws std::runtime_error if the file cannot be opened.
 			Scanner( char const * filename );
+			// Scans a source someone else owns, starting at `offset', which must be the
+			// start of a character. Several scanners may share one source.
+			Scanner( Support::SourceManager const & shared_source, std::uint32_t offset = 0 );
+			// Scans `source_stream' as it arrives. A token may end up split between what one
+			// read brought and the next; the scanner reads on until it has all of it.
+			Scanner( Support::SourceStream & source_stream );
 			~Scanner();
 			Token	GetNextToken();
 			bool	SetNewFileName( char const * filename );
+			// Continues scanning from `offset'; the scanner keeps no state between tokens.
+			// Over a stream, `offset' must not have been released.
+			void	Seek( std::uint32_t offset );
+			// Nothing before `offset' will be asked about any more, so a stream may let go of
+			// it. A source stays whole anyway.
+			void	Release( std::uint32_t offset );
+
+			Support::StringRef	Spelling( Token const & token ) const;
+			Support::Position	GetPosition( Token const & token ) const;
+			// Not for a scanner over a stream, which has no SourceManager.
+			Support::SourceManager const & Source() const { return *source; }
+			std::string const &	FileName() const { return stream != nullptr ? stream->FileName() : source->FileName(); }
+			Support::Diagnostic & Diagnostics() { return diag; }
 		}; // Scanner
 	}
-} // namespace MaryLang
\ No newline at end of file
+} // namespace MaryLang
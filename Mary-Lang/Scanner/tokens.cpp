@@ -4,46 +4,52 @@ namespace MaryLang
 {
 	namespace Lexer
 	{
-		Token::LookupTable Token::lookup_table;
-		
-		void Token::InitLookupTable()
-		{
-			lookup_table.insert( std::make_pair( L"var",	TokenType::TK_VAR ) );
-			lookup_table.insert( std::make_pair( L"private", TokenType::TK_PRIVATE ) );
-			lookup_table.insert( std::make_pair( L"public",	TokenType::TK_PUBLIC ) );
-			lookup_table.insert( std::make_pair( L"protected",	TokenType::TK_PROTECTED ) );
-			lookup_table.insert( std::make_pair( L"for",	TokenType::TK_FOR ) );
-			lookup_table.insert( std::make_pair( L"do",		TokenType::TK_DO ) );
-			lookup_table.insert( std::make_pair( L"while",	TokenType::TK_WHILE ) );
-			lookup_table.insert( std::make_pair( L"if",		TokenType::TK_IF ) );
-			lookup_table.insert( std::make_pair( L"isit",	TokenType::TK_ISIT ) );
-			lookup_table.insert( std::make_pair( L"else",	TokenType::TK_ELSE ) );
-			lookup_table.insert( std::make_pair( L"function", TokenType::TK_FUNCTION ) );
-			lookup_table.insert( std::make_pair( L"among",		TokenType::TK_AMONG ) );
-			lookup_table.insert( std::make_pair( L"check",	TokenType::TK_CHECK ) );
-			lookup_table.insert( std::make_pair( L"continue", TokenType::TK_CONTINUE ) );
-			lookup_table.insert( std::make_pair( L"leave",	TokenType::TK_LEAVE ) );
-			lookup_table.insert( std::make_pair( L"int",	TokenType::TK_INT ) );
-			lookup_table.insert( std::make_pair( L"double", TokenType::TK_DOUBLE ) );
-			lookup_table.insert( std::make_pair( L"decltype", TokenType::TK_DECLTYPE ) );
-			lookup_table.insert( std::make_pair( L"string", TokenType::TK_STRING ) );
-			lookup_table.insert( std::make_pair( L"boolean", TokenType::TK_BOOLEAN ) );
-			lookup_table.insert( std::make_pair( L"true",	TokenType::TK_TRUE ) );
-			lookup_table.insert( std::make_pair( L"false",	TokenType::TK_FALSE ) );
-			lookup_table.insert( std::make_pair( L"typeof",	TokenType::TK_TYPEOF ) );
-			lookup_table.insert( std::make_pair( L"enum",	TokenType::TK_ENUM ) );
-			lookup_table.insert( std::make_pair( L"return", TokenType::TK_RETURN ) );
-			lookup_table.insert( std::make_pair( L"class",	TokenType::TK_CLASS ) );
-			lookup_table.insert( std::make_pair( L"extends", TokenType::TK_EXTENDS ) );
-			lookup_table.insert( std::make_pair( L"namespace", TokenType::TK_NAMESPACE ) );
-			lookup_table.insert( std::make_pair( L"virtual", TokenType::TK_VIRTUAL ) );
-			lookup_table.insert( std::make_pair( L"construct", TokenType::TK_CONSTRUCT ) );
-		} // Token::initLookupTable
-
-		wchar_t const* Token::GetName( TokenType tt ) const
+		wchar_t const* Token::GetName( TokenType tt )
 		{
 			switch( tt )
 			{
+			case TokenType::TK_EOF:				return L"end of file";
+			case TokenType::TK_INVALID:			return L"Invalid";
+			case TokenType::TK_IDENTIFIER:		return L"identifier";
+			case TokenType::TK_STRLITERAL:		return L"string literal";
+			case TokenType::TK_STRLITINTERPOL:	return L"interpolated string";
+			case TokenType::TK_CONSTANT:		return L"constant";
+			case TokenType::TK_INTLITERAL:		return L"integer literal";
+			case TokenType::TK_DOUBLELITERAL:	return L"floating literal";
+
+			case TokenType::TK_VAR:			return L"var";
+			case TokenType::TK_FOR:			return L"for";
+			case TokenType::TK_DO:			return L"do";
+			case TokenType::TK_WHILE:		return L"while";
+			case TokenType::TK_IF:			return L"if";
+			case TokenType::TK_ELSE:		return L"else";
+			case TokenType::TK_NAMESPACE:	return L"namespace";
+			case TokenType::TK_VIRTUAL:		return L"virtual";
+			case TokenType::TK_PRIVATE:		return L"private";
+			case TokenType::TK_PUBLIC:		return L"public";
+			case TokenType::TK_PROTECTED:	return L"protected";
+			case TokenType::TK_AMONG:		return L"among";
+			case TokenType::TK_CHECK:		return L"check";
+			case TokenType::TK_ISIT:		return L"isit";
+			case TokenType::TK_CONTINUE:	return L"continue";
+			case TokenType::TK_LEAVE:		return L"leave";
+			case TokenType::TK_FUNCTION:	return L"function";
+			case TokenType::TK_INT:			return L"int";
+			case TokenType::TK_DOUBLE:		return L"double";
+			case TokenType::TK_STRING:		return L"string";
+			case TokenType::TK_BOOLEAN:		return L"boolean";
+			case TokenType::TK_TRUE:		return L"true";
+			case TokenType::TK_FALSE:		return L"false";
+			case TokenType::TK_TYPEOF:		return L"typeof";
+			case TokenType::TK_ENUM:		return L"enum";
+			case TokenType::TK_RETURN:		return L"return";
+			case TokenType::TK_STATIC:		return L"static";
+			case TokenType::TK_CLASS:		return L"class";
+			case TokenType::TK_EXTENDS:		return L"extends";
+			case TokenType::TK_CONSTRUCT:	return L"construct";
+			case TokenType::TK_DECLTYPE:	return L"decltype";
+			case TokenType::TK_IMPORT:		return L"import";
+
 			case TokenType::TK_ADD:			return L"+";
 			case TokenType::TK_ADDEQL:		return L"+=";
 			case TokenType::TK_AND:			return L"&";
@@ -1,39 +1,11 @@
 #pragma once
 
-#include <memory>
-#include <unordered_map>
-#include "../Utils/Position.hpp"
-#include "../Utils/Utils.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 
 namespace MaryLang
 {
-	namespace Support
-	{
-		struct WStrHash 
-		{
-			std::size_t operator()( wchar_t const * const wstr ) const
-			{
-				wchar_t const *i = wstr;
-				int offset = L'a' - 1;
-				std::size_t hash = 0;
-
-				while( *i != L'\0' ){
-					hash = hash << 1 ^ ( *i - offset );
-					++i;
-				}
-				return hash;
-			}
-		};
-
-		struct WStrEqual
-		{
-			bool operator ()( wchar_t const * const previous, 
-				wchar_t const * const current ) const
-			{
-				return std::wcscmp( previous, current ) == 0;
-			}
-		};
-	} //namespace Support
 	namespace Lexer
 	{
 		enum class TokenType
@@ -45,6 +17,8 @@ namespace MaryLang
 			TK_STRLITERAL,
 			TK_STRLITINTERPOL, /* string interpolation like "I am #{name}" */
 			TK_CONSTANT,
+			TK_INTLITERAL, /* 42, 0x2A, 052, 0b101010 */
+			TK_DOUBLELITERAL, /* 4.2 */
 
 			/* Keywords */
 			TK_VAR,
@@ -78,6 +52,7 @@ namespace MaryLang
 			TK_EXTENDS,
 			TK_CONSTRUCT,
 			TK_DECLTYPE,
+			TK_IMPORT,
 
 			/* Operators */
 			TK_AT,
@@ -130,56 +105,37 @@ namespace MaryLang
 			TK_ASSIGN // =
 		}; // enum TokenType
 
+		// Number of TokenTypes, for tables indexed by them; TK_ASSIGN must stay the last one.
+		static std::size_t const token_type_count = static_cast<std::size_t>( TokenType::TK_ASSIGN ) + 1;
+
+		// A token is a typed range of the source buffer; its spelling is obtained from the
+		// scanner that produced it. For identifiers the payload is the interned Support::Symbol,
+		// so two identifiers name the same thing exactly when their payloads are equal.
 		struct Token 
 		{
-			Token( wchar_t *id, Support::Position const & pos, TokenType type )
-				:_id( id ),
-				_pos( pos ),
+			Token( std::uint32_t offset, std::uint32_t length, TokenType type, std::uint32_t payload = 0 )
+				:_offset( offset ),
+				_length( length ),
+				_payload( payload ),
 				_type( type )
 			{
 			}
 
-			Token( Support::Position pos, TokenType type )
-				: _id( nullptr ),
-				_pos( std::move( pos ) ),
-				_type( type )
-			{
-				auto c = GetName( type );
-				_id = Support::Mystrndup( c, wcslen( c ) );
-			}
-
-			Token& operator=( Token const & t )
-			{
-				if( this != &t )
-				{
-					_pos = t.Pos();
-					_type = t.Type();
-					delete [] _id;
-					_id = Support::Mystrndup( t.Id(), wcslen( t.Id() ) );
-				}
-				return *this;
-			}
-
-			~Token(){ delete[] _id; }
-
-			wchar_t const*      Id() const { return _id; }
-			Support::Position	Pos() const { return _pos; }
-			inline TokenType	Type() const { return _type; }
+			inline std::uint32_t	Offset() const { return _offset; }
+			inline std::uint32_t	Length() const { return _length; }
+			inline std::uint32_t	Payload() const { return _payload; }
+			inline std::uint32_t	Symbol() const { return _payload; }
+			inline TokenType		Type() const { return _type; }
 
-			typedef std::unordered_map< wchar_t const *, TokenType, Support::WStrHash, Support::WStrEqual> LookupTable;
-
-			static LookupTable lookup_table;
-			static void InitLookupTable();
-
-			friend std::wostream & operator<<( std::wostream & os, Token const & t )
-			{
-				return os << L"ID: '" << t.Id() << L"', " << t.Pos() << L" : " << static_cast<int>( t.Type() );
-			}
+			static wchar_t const *	GetName( TokenType tt );
 		private:
-			wchar_t const *				GetName( TokenType tt ) const;
-			wchar_t					    *_id;
-			Support::Position			_pos;
+			std::uint32_t				_offset;
+			std::uint32_t				_length;
+			std::uint32_t				_payload;
 			TokenType					_type;
 		}; // struct Token
+
+		static_assert( sizeof( Token ) == 16 && std::is_trivially_copyable<Token>::value,
+			"tokens are copied around by value and must stay small" );
 	} // namespace Lexer
 } //namespace MaryLang
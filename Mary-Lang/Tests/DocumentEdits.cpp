@@ -0,0 +1,185 @@
+// Makes random edits to a Parser::Document holding each shape of the generated corpus and,
+// after every one, checks it against a Document made fresh from the same text: the same
+// tokens, the same lexer and parser diagnostics, the same top-level statements beginning in
+// the same places, with the same trees. Incremental relexing and reparsing have to give what
+// a full parse does.
+//
+//   mary-document-test [--size KB] [--edits N] [--seed N]
+//
+// Each shape is --size kilobytes (32 by default) and gets --edits edits (400 by default).
+// The edits type and delete identifier letters, as someone would, but also drop in braces,
+// parentheses, quotes and comment delimiters that reach far past where they are made. An
+// edit that leaves a comment open, so that the scanner gives up, is undone by the next one.
+
+#include "../Benchmarks/Corpus.hpp"
+#include "../Parser/Document.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace AST = MaryLang::AbstractSyntaxTree;
+namespace Benchmarks = MaryLang::Benchmarks;
+namespace Parser = MaryLang::Parser;
+namespace Support = MaryLang::Support;
+
+namespace
+{
+	struct Options
+	{
+		std::size_t		kilobytes;
+		unsigned int	edits;
+		std::uint32_t	seed;
+	};
+
+	bool ParseOptions( int argc, char **argv, Options & options )
+	{
+		options.kilobytes = 32;
+		options.edits = 400;
+		options.seed = 12345;
+		for( int i = 1; i + 1 < argc; i += 2 ){
+			char const * const arg = argv[i];
+			unsigned long const value = std::strtoul( argv[i + 1], nullptr, 10 );
+			if( std::strcmp( arg, "--size" ) == 0 ) options.kilobytes = value;
+			else if( std::strcmp( arg, "--edits" ) == 0 ) options.edits = static_cast<unsigned int>( value );
+			else if( std::strcmp( arg, "--seed" ) == 0 ) options.seed = static_cast<std::uint32_t>( value );
+			else return false;
+		}
+		return argc % 2 == 1 && options.kilobytes != 0;
+	}
+
+	// In offset order; the order records come in is not part of the result.
+	std::vector<std::tuple<std::uint32_t, int, std::uint32_t>> Records( Support::Diagnostic const & diagnostics )
+	{
+		std::vector<std::tuple<std::uint32_t, int, std::uint32_t>> records;
+		for( Support::DiagRecord const & record : diagnostics ){
+			records.emplace_back( record.offset, static_cast<int>( record.id ), record.argument );
+		}
+		std::sort( records.begin(), records.end() );
+		return records;
+	}
+
+	// A node as it stands in the text now: its kind, offset and value, a leaf's token instead
+	// of its value, and its children, counting the missing ones, and how many are missing.
+	typedef std::tuple<int, std::int64_t, std::uint32_t, std::int64_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t> Node;
+
+	// The nodes of `segment''s statement in walk order.
+	std::vector<Node> Nodes( Parser::Document::Segment const & segment )
+	{
+		struct Collector
+		{
+			AST::FlatTree const &	tree;
+			std::int64_t			shift;
+			std::vector<Node>		nodes;
+
+			bool Enter( AST::NodeIndex node )
+			{
+				AST::NodeKind const kind = tree.Kind( node );
+				std::uint32_t value = tree.Value( node ), length = 0, payload = 0;
+				std::int64_t token_offset = 0;
+				if( kind == AST::NodeKind::Token || ( kind >= AST::NodeKind::Variable && kind <= AST::NodeKind::IllegalExpression ) ){
+					// the value only indexes the tree's own token table
+					Parser::Token const & token = tree.GetToken( node );
+					value = static_cast<std::uint32_t>( token.Type() );
+					token_offset = token.Offset() + shift;
+					length = token.Length();
+					payload = token.Payload();
+				}
+				std::uint32_t missing = 0;
+				for( AST::NodeIndex const child : tree.ChildrenOf( node ) ) missing += child == AST::NoNode;
+				nodes.emplace_back( static_cast<int>( kind ), tree.Offset( node ) + shift, value, token_offset, length, payload,
+					tree.ChildrenOf( node ).Size(), missing );
+				return true;
+			}
+			void Leave( AST::NodeIndex ) {}
+		} collector{ *segment.program->FlatTree(), segment.Shift(), std::vector<Node>() };
+		collector.tree.Walk( segment.statement->FlatIndex(), collector );
+		return collector.nodes;
+	}
+
+	// What `document' has that `fresh' has not; empty if nothing.
+	std::string Difference( Parser::Document const & document, Parser::Document const & fresh )
+	{
+		if( document.Failure() != fresh.Failure() ) return "failure: \"" + document.Failure() + "\", fresh \"" + fresh.Failure() + "\"";
+		std::vector<Parser::Token> const & tokens = document.Tokens();
+		std::vector<Parser::Token> const & fresh_tokens = fresh.Tokens();
+		if( tokens.size() != fresh_tokens.size() ) return "token count";
+		for( std::size_t i = 0; i < tokens.size(); ++i ){
+			Parser::Token const & a = tokens[i];
+			Parser::Token const & b = fresh_tokens[i];
+			if( a.Offset() != b.Offset() || a.Length() != b.Length() || a.Type() != b.Type() || a.Payload() != b.Payload() ){
+				return "token " + std::to_string( i ) + " at " + std::to_string( b.Offset() );
+			}
+		}
+		if( Records( document.LexerDiagnostics() ) != Records( fresh.LexerDiagnostics() ) ) return "lexer diagnostics";
+		if( Records( document.Diagnostics() ) != Records( fresh.Diagnostics() ) ) return "parser diagnostics";
+		std::vector<Parser::Document::Segment> const & segments = document.Segments();
+		std::vector<Parser::Document::Segment> const & fresh_segments = fresh.Segments();
+		if( segments.size() != fresh_segments.size() ) return "statement count";
+		for( std::size_t i = 0; i < segments.size(); ++i ){
+			if( segments[i].begin != fresh_segments[i].begin ) return "statement " + std::to_string( i ) + " begins elsewhere";
+			if( Nodes( segments[i] ) != Nodes( fresh_segments[i] ) ) return "statement " + std::to_string( i ) + "'s tree";
+		}
+		return std::string();
+	}
+
+	Parser::TextEdit RandomEdit( std::string const & text, std::mt19937 & random )
+	{
+		static char const * const insertions[] = { "x", "_1", " ", "\n", ";", "(", ")", "{", "}", "[", "]",
+			"\"", "'", "/*", "*/", "//", " if ", " else ", "var y = 1;", "function g(){", "class C {", "#{" };
+		std::uint32_t const size = static_cast<std::uint32_t>( text.size() );
+		std::uint32_t const offset = size != 0 ? random() % ( size + 1 ) : 0;
+		switch( random() % 4 ){
+		case 0: // delete a few bytes
+			return Parser::TextEdit{ offset, std::min<std::uint32_t>( size - offset, random() % 8 ), "" };
+		case 1: // replace them
+			return Parser::TextEdit{ offset, std::min<std::uint32_t>( size - offset, random() % 4 ),
+				insertions[random() % ( sizeof( insertions ) / sizeof( *insertions ) )] };
+		default:
+			return Parser::TextEdit{ offset, 0, insertions[random() % ( sizeof( insertions ) / sizeof( *insertions ) )] };
+		}
+	}
+}
+
+int main( int argc, char **argv )
+{
+	Options options;
+	if( !ParseOptions( argc, argv, options ) ){
+		std::fprintf( stderr, "usage: mary-document-test [--size KB] [--edits N] [--seed N]\n" );
+		return 2;
+	}
+	std::mt19937 random( options.seed );
+	int failures = 0;
+	for( Benchmarks::CorpusFile const & file : Benchmarks::GenerateCorpus( options.kilobytes << 10, options.seed ) ){
+		std::string text = file.source;
+		Parser::Document document( file.name, text );
+		std::size_t reparsed = 0, rebuilt = 0;
+		Parser::TextEdit undo{ 0, 0, "" };
+		bool failed = false, same = true;
+		for( unsigned int i = 0; i < options.edits && same; ++i ){
+			Parser::TextEdit const edit = failed ? undo : RandomEdit( text, random );
+			undo = Parser::TextEdit{ edit.offset, static_cast<std::uint32_t>( edit.text.size() ), text.substr( edit.offset, edit.length ) };
+			document.Edit( edit );
+			text.replace( edit.offset, edit.length, edit.text );
+			failed = !document.Failure().empty();
+			reparsed += document.LastEdit().statements_reparsed;
+			if( document.LastEdit().rebuilt ) ++rebuilt;
+
+			Parser::Document const fresh( file.name, text );
+			std::string const difference = Difference( document, fresh );
+			if( !difference.empty() ){
+				std::fprintf( stderr, "%s: edit %u, %u bytes at %u replaced with \"%s\": %s differs from a fresh parse\n",
+					file.name.c_str(), i, edit.length, edit.offset, edit.text.c_str(), difference.c_str() );
+				++failures;
+				same = false;
+			}
+		}
+		if( same ) std::printf( "%-9s %u edits, %.2f statements reparsed each, %zu rebuilt\n", file.name.c_str(), options.edits,
+			options.edits != 0 ? static_cast<double>( reparsed ) / options.edits : 0.0, rebuilt );
+	}
+	return failures == 0 ? 0 : 1;
+}
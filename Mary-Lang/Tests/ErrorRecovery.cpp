@@ -0,0 +1,172 @@
+// Parses each shape of the generated corpus with bytes here and there overwritten, so that it
+// is riddled with syntax errors, three ways: with Parse(), with Parse( pool ) and a statement
+// at a time with ParseEach. All three have to report the same errors, and each error once:
+// no two of the parser's at one offset, nor two of the lexer's. Panic-mode recovery has to
+// find every error in one pass, without the cascades a parser that lost its place would add.
+// Parse( pool ) runs on four threads too, with batches of a few hundred bytes, twice, and has
+// to give the same top-level statements in the same order each time, every function body
+// parsed, whichever thread got to it first.
+//
+//   mary-recovery-test [--size KB] [--seed N]
+//
+// Each shape is --size kilobytes (64 by default). The errors found are printed per shape.
+
+#include "../Benchmarks/Corpus.hpp"
+#include "../Parser/Parser.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+#include <vector>
+
+namespace Benchmarks = MaryLang::Benchmarks;
+namespace Lexer = MaryLang::Lexer;
+namespace Parser = MaryLang::Parser;
+namespace Support = MaryLang::Support;
+
+namespace
+{
+	typedef std::vector<std::tuple<std::uint32_t, int, std::uint32_t>> Records;
+
+	// What a parse found, in the order it was reported, and the top-level statements it
+	// returned, each where it begins and what it is.
+	struct Result
+	{
+		Records		lexer, parser;
+		std::vector<std::pair<std::uint32_t, std::string>> statements;
+		std::size_t	skimmed_bodies; // left unparsed
+		std::string	failure; // what the scanner threw, if it gave up
+	};
+
+	void Add( Result & result, Parser::Statement const & statement )
+	{
+		result.statements.emplace_back( statement.Offset(), typeid( statement ).name() );
+		auto const declaration = dynamic_cast<Parser::DeclarationStatement const *>( &statement );
+		auto const function = declaration != nullptr
+			? dynamic_cast<Parser::FunctionDeclaration const *>( declaration->GetDeclaration() ) : nullptr;
+		if( function != nullptr && function->IsBodySkimmed() ) ++result.skimmed_bodies;
+	}
+
+	Records ToRecords( Support::Diagnostic const & diagnostics )
+	{
+		Records records;
+		for( Support::DiagRecord const & record : diagnostics ){
+			records.emplace_back( record.offset, static_cast<int>( record.id ), record.argument );
+		}
+		return records;
+	}
+
+	enum class Mode { Whole, Pool, Each };
+
+	Result Parse( Support::SourceManager const & source, Mode mode, Support::ThreadPool & pool, std::size_t batch_bytes = 64 * 1024 )
+	{
+		Result result;
+		result.skimmed_bodies = 0;
+		Lexer::Scanner scanner( source );
+		try {
+			Parser::Parser parser( scanner );
+			std::shared_ptr<Parser::ParsedProgram> program;
+			switch( mode ){
+			case Mode::Whole: program = parser.Parse(); break;
+			case Mode::Pool: program = parser.Parse( pool, batch_bytes ); break;
+			case Mode::Each: parser.ParseEach( [&]( Parser::Statement const & statement ){ Add( result, statement ); } ); break;
+			}
+			if( program ){
+				for( Parser::Statement const * statement : program->SourceProgram() ){
+					if( statement != nullptr ) Add( result, *statement );
+				}
+			}
+			Support::Diagnostic diagnostics = parser.Diagnostics();
+			// Parse( pool ) merges what its workers found in offset order; the others are put
+			// in that order here
+			if( mode != Mode::Pool ) diagnostics.SortByOffset();
+			result.parser = ToRecords( diagnostics );
+		} catch( std::runtime_error const & error ) {
+			result.failure = error.what();
+		}
+		result.lexer = ToRecords( scanner.Diagnostics() );
+		return result;
+	}
+
+	// Where two of `records' share an offset; empty if none do.
+	std::string Repeated( Records const & records )
+	{
+		for( std::size_t i = 1; i < records.size(); ++i ){
+			if( std::get<0>( records[i] ) == std::get<0>( records[i - 1] ) ) return "at " + std::to_string( std::get<0>( records[i] ) );
+		}
+		return std::string();
+	}
+
+	// What `result' has that `expected' has not; empty if nothing.
+	std::string Difference( Result const & result, Result const & expected )
+	{
+		if( result.failure != expected.failure ) return "failure \"" + result.failure + "\", expected \"" + expected.failure + "\"";
+		if( result.lexer != expected.lexer ) return "lexer diagnostics";
+		if( result.parser != expected.parser ) return "parser diagnostics";
+		if( result.statements != expected.statements ) return "statements";
+		if( result.skimmed_bodies != 0 ) return "function bodies, " + std::to_string( result.skimmed_bodies ) + " left skimmed";
+		return std::string();
+	}
+
+	std::string Mutate( std::string source, std::mt19937 & random )
+	{
+		// no `/' or `*', which could open a comment that swallows the rest of the file
+		static char const bytes[] = "(){}[];,.=+-\"'#:?!&x0 \n";
+		for( std::size_t i = 0; i < source.size() / 200; ++i ){
+			source[random() % source.size()] = bytes[random() % ( sizeof( bytes ) - 1 )];
+		}
+		return source;
+	}
+
+	bool ParseOptions( int argc, char **argv, std::size_t & kilobytes, std::uint32_t & seed )
+	{
+		kilobytes = 64;
+		seed = 12345;
+		for( int i = 1; i + 1 < argc; i += 2 ){
+			unsigned long const value = std::strtoul( argv[i + 1], nullptr, 10 );
+			if( std::strcmp( argv[i], "--size" ) == 0 ) kilobytes = value;
+			else if( std::strcmp( argv[i], "--seed" ) == 0 ) seed = static_cast<std::uint32_t>( value );
+			else return false;
+		}
+		return argc % 2 == 1 && kilobytes != 0;
+	}
+}
+
+int main( int argc, char **argv )
+{
+	std::size_t kilobytes;
+	std::uint32_t seed;
+	if( !ParseOptions( argc, argv, kilobytes, seed ) ){
+		std::fprintf( stderr, "usage: mary-recovery-test [--size KB] [--seed N]\n" );
+		return 2;
+	}
+	std::mt19937 random( seed );
+	Support::ThreadPool pool( 2 ), wide_pool( 4 );
+	int failures = 0;
+	for( Benchmarks::CorpusFile const & file : Benchmarks::GenerateCorpus( kilobytes << 10, seed ) ){
+		Support::SourceManager source;
+		source.Assign( file.name, Mutate( file.source, random ) );
+		Result const expected = Parse( source, Mode::Whole, pool );
+		std::string problem = Repeated( expected.parser );
+		if( !problem.empty() ) problem = "Parse() reported two errors " + problem;
+		else if( !( problem = Repeated( expected.lexer ) ).empty() ) problem = "the lexer reported two errors " + problem;
+		else if( !( problem = Difference( Parse( source, Mode::Pool, pool ), expected ) ).empty() ) problem = "Parse( pool ) gave other " + problem;
+		else if( !( problem = Difference( Parse( source, Mode::Each, pool ), expected ) ).empty() ) problem = "ParseEach gave other " + problem;
+		for( int run = 0; run < 2 && problem.empty(); ++run ){
+			problem = Difference( Parse( source, Mode::Pool, wide_pool, 256 ), expected );
+			if( !problem.empty() ) problem = "Parse( pool ) on 4 threads in 256-byte batches gave other " + problem;
+		}
+		if( !problem.empty() ){
+			std::fprintf( stderr, "%s: %s\n", file.name.c_str(), problem.c_str() );
+			++failures;
+			continue;
+		}
+		std::printf( "%-9s %zu parser errors, %zu lexer errors%s\n", file.name.c_str(), expected.parser.size(), expected.lexer.size(),
+			expected.failure.empty() ? "" : ", then the scanner gave up" );
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Stores the parse of each shape of the generated corpus in a Parser::ParseCache and loads it
+// back: the tree, the diagnostics and the line count have to come back as they went in. Then
+// the entry is damaged, a byte at a time all through its header and here and there through
+// its payload, and cut short, and each time loading it has to miss. So does loading it for
+// another source of the same size under the same key, as if the two keys had collided.
+//
+//   mary-cache-test [--size KB] [--seed N]
+//
+// Each shape is --size kilobytes (16 by default), with a few errors added so that there are
+// diagnostics to store. The cache lives in mary-cache-test.tmp, which is removed afterwards.
+
+#include "../Benchmarks/Corpus.hpp"
+#include "../Parser/ParseCache.hpp"
+#include "../Parser/Parser.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if defined ( _WIN32 )
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace AST = MaryLang::AbstractSyntaxTree;
+namespace Benchmarks = MaryLang::Benchmarks;
+namespace Lexer = MaryLang::Lexer;
+namespace Parser = MaryLang::Parser;
+namespace Support = MaryLang::Support;
+
+namespace
+{
+	char const directory[] = "mary-cache-test.tmp";
+
+	std::vector<char> Bytes( AST::FlatTree const & tree )
+	{
+		std::vector<char> bytes;
+		tree.Serialize( bytes );
+		return bytes;
+	}
+
+	bool SameRecords( Support::Diagnostic const & a, Support::Diagnostic const & b )
+	{
+		if( a.Count() != b.Count() ) return false;
+		for( auto i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j ){
+			if( i->offset != j->offset || i->id != j->id || i->argument != j->argument ) return false;
+		}
+		return true;
+	}
+
+	std::vector<char> Read( std::string const & path )
+	{
+		std::ifstream file( path, std::ios::binary );
+		return std::vector<char>( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
+	}
+
+	bool Write( std::string const & path, std::vector<char> const & bytes )
+	{
+		std::ofstream file( path, std::ios::binary | std::ios::trunc );
+		file.write( bytes.data(), static_cast<std::streamsize>( bytes.size() ) );
+		return static_cast<bool>( file.flush() );
+	}
+
+	// Why storing and loading `source' went wrong; empty if it did not.
+	std::string Check( Parser::ParseCache const & cache, Support::SourceManager const & source )
+	{
+		Lexer::Scanner scanner( source );
+		Parser::Parser parser( scanner, true );
+		parser.Parse();
+		AST::FlatTree const & tree = *parser.Program()->FlatTree();
+		std::uint64_t const key = Parser::ParseCache::Key( source );
+		if( !cache.Store( key, source, tree, scanner.Diagnostics(), parser.Diagnostics(), 1234 ) ) return "cannot store";
+
+		Parser::ParseCacheEntry entry;
+		if( !cache.Load( key, source, entry ) ) return "a miss just after storing";
+		if( Bytes( entry.tree ) != Bytes( tree ) ) return "another tree";
+		if( !SameRecords( entry.lexer_diagnostics, scanner.Diagnostics() ) ) return "other lexer diagnostics";
+		if( !SameRecords( entry.parser_diagnostics, parser.Diagnostics() ) ) return "other parser diagnostics";
+		if( entry.line_count != source.LineCount() || entry.parse_microseconds != 1234 ) return "another line count or time";
+
+		// the same size, and stored under the same key
+		std::string text = source.Text( 0, source.Size() ).Str();
+		text[text.size() / 2] = text[text.size() / 2] == 'x' ? 'y' : 'x';
+		Support::SourceManager other;
+		other.Assign( source.FileName(), text );
+		if( cache.Load( key, other, entry ) ) return "a hit for another source under the same key";
+
+		char name[24];
+		std::snprintf( name, sizeof( name ), "%016llx.mpc", static_cast<unsigned long long>( key ) );
+		std::string const path = std::string( directory ) + "/" + name;
+		std::vector<char> const stored = Read( path );
+		std::vector<std::size_t> damaged;
+		for( std::size_t i = 0; i < 72 && i < stored.size(); ++i ) damaged.push_back( i ); // the header
+		for( std::size_t i = 72; i < stored.size(); i += stored.size() / 61 + 1 ) damaged.push_back( i );
+		damaged.push_back( stored.size() - 1 );
+		std::string problem;
+		for( std::size_t const at : damaged ){
+			std::vector<char> bytes = stored;
+			bytes[at] ^= 0x10;
+			if( !Write( path, bytes ) ) problem = "cannot damage the entry";
+			else if( cache.Load( key, source, entry ) ) problem = "a hit with byte " + std::to_string( at ) + " damaged";
+			if( !problem.empty() ) break;
+		}
+		if( problem.empty() ){
+			std::vector<char> const cut( stored.begin(), stored.end() - 1 );
+			if( !Write( path, cut ) ) problem = "cannot damage the entry";
+			else if( cache.Load( key, source, entry ) ) problem = "a hit with the entry cut short";
+		}
+		if( problem.empty() && ( !Write( path, stored ) || !cache.Load( key, source, entry ) ) ) problem = "a miss once mended";
+		std::remove( path.c_str() );
+		return problem;
+	}
+
+	bool ParseOptions( int argc, char **argv, std::size_t & kilobytes, std::uint32_t & seed )
+	{
+		kilobytes = 16;
+		seed = 12345;
+		for( int i = 1; i + 1 < argc; i += 2 ){
+			unsigned long const value = std::strtoul( argv[i + 1], nullptr, 10 );
+			if( std::strcmp( argv[i], "--size" ) == 0 ) kilobytes = value;
+			else if( std::strcmp( argv[i], "--seed" ) == 0 ) seed = static_cast<std::uint32_t>( value );
+			else return false;
+		}
+		return argc % 2 == 1 && kilobytes != 0;
+	}
+}
+
+int main( int argc, char **argv )
+{
+	std::size_t kilobytes;
+	std::uint32_t seed;
+	if( !ParseOptions( argc, argv, kilobytes, seed ) ){
+		std::fprintf( stderr, "usage: mary-cache-test [--size KB] [--seed N]\n" );
+		return 2;
+	}
+	Parser::ParseCache cache;
+	if( !cache.Open( directory ) ){
+		std::fprintf( stderr, "cannot make %s\n", directory );
+		return 1;
+	}
+	int failures = 0;
+	for( Benchmarks::CorpusFile const & file : Benchmarks::GenerateCorpus( kilobytes << 10, seed ) ){
+		Support::SourceManager source;
+		source.Assign( file.name, file.source + "\nvar = ;\n@\nx = \"open\n" );
+		std::string const problem = Check( cache, source );
+		if( !problem.empty() ){
+			std::fprintf( stderr, "%s: %s\n", file.name.c_str(), problem.c_str() );
+			++failures;
+		}
+	}
+#if defined ( _WIN32 )
+	_rmdir( directory );
+#else
+	rmdir( directory );
+#endif
+	std::printf( "%s\n", failures == 0 ? "every entry loaded as stored, and missed once damaged" : "entries differ" );
+	return failures == 0 ? 0 : 1;
+}
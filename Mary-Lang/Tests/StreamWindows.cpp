@@ -0,0 +1,249 @@
+// Scans and parses sources through a Support::SourceStream whose window is a handful of bytes,
+// fed through a pipe in chunks of random size, and checks the result against scanning the
+// same bytes whole: the same tokens, spellings and positions, the same lexer diagnostics,
+// ParseNextStatement's diagnostics at the same lines and columns, and as many lines, an empty
+// one after a final newline not counted. Tokens split between two reads, and split again when
+// the window refills, are what it is after.
+//
+//   mary-stream-test [--size KB] [--seed N]
+//
+// The sources are each shape of the generated corpus, --size kilobytes (16 by default),
+// the same with bytes here and there overwritten, and a few made to end tokens and UTF-8
+// characters in awkward places.
+
+#include "../Benchmarks/Corpus.hpp"
+#include "../Parser/Parser.hpp"
+#include "../Utils/DiagnosticsEngine.hpp"
+#include "../Utils/SourceStream.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined ( _WIN32 )
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Benchmarks = MaryLang::Benchmarks;
+namespace Lexer = MaryLang::Lexer;
+namespace Parser = MaryLang::Parser;
+namespace Support = MaryLang::Support;
+
+namespace
+{
+	struct Source
+	{
+		std::string	name;
+		std::string	text;
+	};
+
+	// Writes `text' to a pipe from a thread of its own, in chunks of 1 to 5 bytes or of up to
+	// 300, and reads whatever is left once the reader is done, so the writer never blocks.
+	struct Pipe
+	{
+		Pipe( std::string const & text, std::uint32_t seed )
+		{
+			int descriptors[2];
+#if defined ( _WIN32 )
+			if( _pipe( descriptors, 4096, _O_BINARY ) != 0 ) throw std::runtime_error( "no pipe" );
+#else
+			if( pipe( descriptors ) != 0 ) throw std::runtime_error( "no pipe" );
+#endif
+			read_end = descriptors[0];
+			int const write_end = descriptors[1];
+			writer = std::thread( [text, seed, write_end]{
+				std::mt19937 random( seed );
+				for( std::size_t written = 0; written < text.size(); ){
+					std::size_t const chunk = std::min<std::size_t>( text.size() - written, 1 + random() % ( random() % 2 ? 5 : 300 ) );
+#if defined ( _WIN32 )
+					int const result = _write( write_end, text.data() + written, static_cast<unsigned int>( chunk ) );
+#else
+					long const result = write( write_end, text.data() + written, chunk );
+#endif
+					if( result <= 0 ) break;
+					written += static_cast<std::size_t>( result );
+				}
+#if defined ( _WIN32 )
+				_close( write_end );
+#else
+				close( write_end );
+#endif
+			} );
+		}
+
+		~Pipe()
+		{
+			char rest[4096];
+#if defined ( _WIN32 )
+			while( _read( read_end, rest, sizeof( rest ) ) > 0 ) {}
+			_close( read_end );
+#else
+			while( read( read_end, rest, sizeof( rest ) ) > 0 ) {}
+			close( read_end );
+#endif
+			writer.join();
+		}
+
+		int			read_end;
+		std::thread	writer;
+	};
+
+	// Every token with its spelling and position, and the lexer's diagnostics at the end,
+	// as one text; releasing each token as it goes if `release'.
+	std::string Lex( Lexer::Scanner & scanner, bool release )
+	{
+		std::ostringstream out;
+		try {
+			for( ; ; ){
+				Lexer::Token const token = scanner.GetNextToken();
+				Support::Position const position = scanner.GetPosition( token );
+				out << token.Offset() << ' ' << token.Length() << ' ' << static_cast<int>( token.Type() ) << ' '
+					<< position._line_number << ':' << position._column_number << ' ' << scanner.Spelling( token ).Str() << '\n';
+				if( release ) scanner.Release( token.Offset() );
+				if( token.Type() == Lexer::TokenType::TK_EOF ) break;
+			}
+		} catch( std::exception const & e ) {
+			out << "threw " << e.what() << '\n';
+		}
+		for( Support::DiagRecord const & record : scanner.Diagnostics() ){
+			out << "lexer " << record.offset << ' ' << static_cast<int>( record.id ) << '\n';
+		}
+		return out.str();
+	}
+
+	// The diagnostics of a statement-at-a-time parse, rendered, lines and columns and all.
+	// Through `stream' a statement at a time, or, without one, the whole source at the end.
+	std::string Parse( Lexer::Scanner & scanner, Support::SourceStream const * stream )
+	{
+		Support::DiagnosticsEngine diagnostics( Support::DiagnosticsEngine::Options{ Support::DiagFormat::Json, 0, false } );
+		std::string threw;
+		try {
+			Parser::Parser parser( scanner );
+			std::size_t lexed = 0, parsed = 0;
+			for( bool more = true; more; ){
+				more = parser.ParseNextStatement() != nullptr;
+				if( stream == nullptr ) continue;
+				diagnostics.Add( *stream, scanner.Diagnostics(), lexed );
+				diagnostics.Add( *stream, parser.Diagnostics(), parsed );
+				lexed = scanner.Diagnostics().Count();
+				parsed = parser.Diagnostics().Count();
+			}
+			if( stream == nullptr ){
+				diagnostics.Add( scanner.Source(), scanner.Diagnostics() );
+				diagnostics.Add( scanner.Source(), parser.Diagnostics() );
+			}
+		} catch( std::exception const & e ) {
+			threw = e.what();
+		}
+		std::wostringstream out;
+		diagnostics.Render( out );
+		std::wstring const rendered = out.str();
+		return std::string( rendered.begin(), rendered.end() ) + threw;
+	}
+
+	std::vector<Source> Sources( std::size_t kilobytes, std::uint32_t seed )
+	{
+		std::vector<Source> sources;
+		std::mt19937 random( seed );
+		for( Benchmarks::CorpusFile const & file : Benchmarks::GenerateCorpus( kilobytes << 10, seed ) ){
+			sources.push_back( Source{ file.name, file.source } );
+			std::string mutated = file.source;
+			static char const bytes[] = "(){};\"'/*#\n\\x0\xC3\xA9";
+			for( std::size_t i = 0; i < mutated.size() / 500; ++i ){
+				mutated[random() % mutated.size()] = bytes[random() % ( sizeof( bytes ) - 1 )];
+			}
+			sources.push_back( Source{ file.name + " mutated", mutated } );
+		}
+		sources.push_back( Source{ "utf-8", "var h\xC3\xA9llo = \"w\xC3\xB6rld \xE2\x9C\x93 #{x}\";\n"
+			"/* \xC3\xBCn\xC3\xAF ** / */ // tail \xE2\x9C\x93\nint \xC3\xB1 = 0x1F + 0b102 + 1e+5 + 3.25;\n"
+			"class \xCE\xA9 { int \xCE\xB1; }\nx = y /* end */;\n\"unterminated\n" } );
+		sources.push_back( Source{ "line ends", "x = 1;\r\n\xC3\xBF = 2; @\r\n// last" } );
+		sources.push_back( Source{ "open comment", "a = b; /* open *" } );
+		sources.push_back( Source{ "empty", "" } );
+		sources.push_back( Source{ "newlines", "\n\n" } );
+		sources.push_back( Source{ "operators", "a <<= b >>= c ** d -> e != f == g && h || i ^= j %= k;\n**/" } );
+		return sources;
+	}
+
+	// The lines of `text', counted by hand.
+	std::uint32_t Lines( std::string const & text )
+	{
+		std::uint32_t const newlines = static_cast<std::uint32_t>( std::count( text.begin(), text.end(), '\n' ) );
+		return newlines + ( !text.empty() && text.back() != '\n' ? 1 : 0 );
+	}
+
+	bool ParseOptions( int argc, char **argv, std::size_t & kilobytes, std::uint32_t & seed )
+	{
+		kilobytes = 16;
+		seed = 12345;
+		for( int i = 1; i + 1 < argc; i += 2 ){
+			unsigned long const value = std::strtoul( argv[i + 1], nullptr, 10 );
+			if( std::strcmp( argv[i], "--size" ) == 0 ) kilobytes = value;
+			else if( std::strcmp( argv[i], "--seed" ) == 0 ) seed = static_cast<std::uint32_t>( value );
+			else return false;
+		}
+		return argc % 2 == 1 && kilobytes != 0;
+	}
+}
+
+int main( int argc, char **argv )
+{
+	std::size_t kilobytes;
+	std::uint32_t seed;
+	if( !ParseOptions( argc, argv, kilobytes, seed ) ){
+		std::fprintf( stderr, "usage: mary-stream-test [--size KB] [--seed N]\n" );
+		return 2;
+	}
+	int failures = 0;
+	std::size_t const windows[] = { 1, 2, 3, 5, 17, 4096 };
+	for( Source const & source : Sources( kilobytes, seed ) ){
+		Support::SourceManager whole;
+		whole.Assign( source.name, source.text );
+		std::string expected_tokens, expected_diagnostics;
+		{
+			Lexer::Scanner scanner( whole );
+			expected_tokens = Lex( scanner, false );
+			expected_tokens += "lines " + std::to_string( Lines( source.text ) ) + '\n';
+		}
+		if( whole.LineCount() != Lines( source.text ) ){
+			std::fprintf( stderr, "%s: %u lines, expected %u\n", source.name.c_str(), whole.LineCount(), Lines( source.text ) );
+			++failures;
+		}
+		{
+			Lexer::Scanner scanner( whole );
+			expected_diagnostics = Parse( scanner, nullptr );
+		}
+		for( std::size_t window : windows ){
+			std::string tokens, diagnostics;
+			{
+				Pipe pipe( source.text, seed + static_cast<std::uint32_t>( window ) );
+				Support::SourceStream stream( pipe.read_end, source.name, window );
+				Lexer::Scanner scanner( stream );
+				tokens = Lex( scanner, true );
+				tokens += "lines " + std::to_string( stream.LineCount() ) + '\n';
+			}
+			{
+				Pipe pipe( source.text, seed + 100 + static_cast<std::uint32_t>( window ) );
+				Support::SourceStream stream( pipe.read_end, source.name, window );
+				Lexer::Scanner scanner( stream );
+				diagnostics = Parse( scanner, &stream );
+			}
+			if( tokens != expected_tokens || diagnostics != expected_diagnostics ){
+				std::fprintf( stderr, "%s: through a %zu-byte window, the %s differ from scanning it whole\n", source.name.c_str(),
+					window, tokens != expected_tokens ? "tokens" : "diagnostics" );
+				++failures;
+			}
+		}
+	}
+	std::printf( "%s\n", failures == 0 ? "every window scanned and parsed as the whole source" : "windows differ" );
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Statistics.hpp"
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// A bump allocator. Memory is carved out of large chunks and is only given back all
+		// at once, by Reset or when the arena is destroyed. Destructors of objects built in
+		// it never run, so only trivially destructible types belong here.
+		struct Arena
+		{
+			explicit Arena( std::size_t chunk_size = 64 * 1024 )
+				: chunks( nullptr ), cursor( nullptr ), limit( nullptr ),
+				default_chunk_size( chunk_size ), bytes_allocated( 0 )
+			{
+			}
+
+			~Arena()
+			{
+				while( chunks != nullptr ){
+					Chunk *next = chunks->next;
+					std::free( chunks );
+					chunks = next;
+				}
+			}
+
+			Arena( Arena const & ) = delete;
+			Arena & operator=( Arena const & ) = delete;
+
+			void * Allocate( std::size_t size, std::size_t alignment = alignof( std::max_align_t ) )
+			{
+				std::uintptr_t aligned = ( reinterpret_cast<std::uintptr_t>( cursor ) + alignment - 1 ) & ~( alignment - 1 );
+				if( cursor == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>( limit ) ){
+					NewChunk( size + alignment );
+					aligned = ( reinterpret_cast<std::uintptr_t>( cursor ) + alignment - 1 ) & ~( alignment - 1 );
+				}
+				cursor = reinterpret_cast<char *>( aligned + size );
+				bytes_allocated += size;
+				return reinterpret_cast<void *>( aligned );
+			}
+
+			template<typename T, typename... Args>
+			T * New( Args &&... args )
+			{
+				static_assert( std::is_trivially_destructible<T>::value, "the arena never runs destructors" );
+				return new( Allocate( sizeof( T ), alignof( T ) ) ) T( std::forward<Args>( args )... );
+			}
+
+			// Forgets every allocation at once. The newest chunk is kept for reuse.
+			void Reset()
+			{
+				if( chunks == nullptr ) return;
+				Chunk *retired = chunks->next;
+				while( retired != nullptr ){
+					Chunk *next = retired->next;
+					std::free( retired );
+					retired = next;
+				}
+				chunks->next = nullptr;
+				cursor = reinterpret_cast<char *>( chunks + 1 );
+				limit = chunks->limit;
+				bytes_allocated = 0;
+			}
+
+			// Takes over every allocation of `other', which is left empty. Objects built in
+			// either arena stay where they are; they are simply freed with this one.
+			void Adopt( Arena & other )
+			{
+				if( other.chunks == nullptr ) return;
+				if( chunks == nullptr ){
+					chunks = other.chunks;
+					cursor = other.cursor;
+					limit = other.limit;
+				} else {
+					// behind our newest chunk, which keeps serving new allocations
+					Chunk *tail = other.chunks;
+					while( tail->next != nullptr ) tail = tail->next;
+					tail->next = chunks->next;
+					chunks->next = other.chunks;
+				}
+				bytes_allocated += other.bytes_allocated;
+				other.chunks = nullptr;
+				other.cursor = other.limit = nullptr;
+				other.bytes_allocated = 0;
+			}
+
+			inline std::size_t BytesAllocated() const { return bytes_allocated; }
+		private:
+			struct Chunk
+			{
+				Chunk *	next;
+				char *	limit;
+			};
+
+			void NewChunk( std::size_t min_size )
+			{
+				std::size_t const size = sizeof( Chunk ) + ( min_size > default_chunk_size ? min_size : default_chunk_size );
+				Chunk *chunk = static_cast<Chunk *>( std::malloc( size ) );
+				if( chunk == nullptr ) throw std::bad_alloc();
+				Statistics::Add( Statistics::ArenaChunks );
+				Statistics::Add( Statistics::ArenaBytes, size );
+				chunk->next = chunks;
+				chunk->limit = reinterpret_cast<char *>( chunk ) + size;
+				chunks = chunk;
+				cursor = reinterpret_cast<char *>( chunk + 1 );
+				limit = chunk->limit;
+			}
+
+			Chunk *				chunks;
+			char *				cursor;
+			char *				limit;
+			std::size_t const	default_chunk_size;
+			std::size_t			bytes_allocated;
+		}; // Arena
+	} // namespace Support
+} // namespace MaryLang
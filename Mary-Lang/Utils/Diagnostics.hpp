@@ -1,92 +1,139 @@
 #pragma once
 
-#include <cstdarg>
-#include <cstdio>
-#include "Position.hpp"
-
-#define DIAG_RESET       "\033[0m"
-#define DIAG_BOLD        "\033[1;37m"
-#define DIAG_NOTE        "\033[1;2;37m"
-#define DIAG_WARNING     "\033[1;35m"
-#define DIAG_ERROR       "\033[1;31m"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 namespace MaryLang
 {
 	namespace Support
 	{
-		struct Diagnostic 
+		// Every diagnostic the front end can report, as
+		//     X( id, kind, argument, message )
+		// `%0' in the message stands for the argument: a TokenType for Token, a number for Integer.
+#define MARY_DIAGNOSTICS( X ) \
+		X( InvalidCharacter,		Warning,	None,	L"invalid character" ) \
+		X( EndOfFileInNumber,		Warning,	None,	L"end of file in a hexadecimal number" ) \
+		X( InvalidBinaryDigit,		Warning,	None,	L"invalid binary digit" ) \
+		X( UnterminatedString,		Error,		None,	L"missing terminating delimiter of string" ) \
+		X( ExpectedToken,			Error,		Token,	L"expected %0" ) \
+		X( ExpectedExpression,		Error,		None,	L"expected an expression" ) \
+		X( ExpectedStatement,		Error,		None,	L"expected a statement" ) \
+		X( ExpectedTypeName,		Error,		None,	L"expected a type name" ) \
+		X( ExpectedIntegerConstant,	Error,		None,	L"expected a constant integer" ) \
+		X( ExpectedEnumerator,		Error,		None,	L"expected an identifier for enumerator" ) \
+		X( InvalidLabelValue,		Error,		None,	L"invalid value supplied for label" ) \
+		X( ExpectedModulePath,		Error,		None,	L"expected the path of a module, in quotes" ) \
+		X( ImportAfterStatement,	Error,		None,	L"imports must come before any other statement" ) \
+		X( ModuleNotFound,			Error,		None,	L"cannot open the imported module" ) \
+		X( ImportCycle,				Error,		None,	L"module imports itself through this import" )
+
+		enum class DiagKind: std::uint8_t
 		{
-			Diagnostic( const bool color ): color_(color), numErrors_( 0 )
-			{ }
+			Note,
+			Warning,
+			Error
+		};
 
-			inline void Note( Position const & pos, wchar_t const * note ) {
-				PrintPos( pos, Kind::K_Note, note );
-			}
+		enum class DiagArgument: std::uint8_t
+		{
+			None,
+			Token,
+			Integer
+		};
+
+		enum class DiagID: std::uint16_t
+		{
+#define DIAG_ENUMERATOR( id, kind, argument, message ) id,
+			MARY_DIAGNOSTICS( DIAG_ENUMERATOR )
+#undef DIAG_ENUMERATOR
+		};
 
-			inline void Warning( Position const & pos, wchar_t const * w ) {
-				PrintPos( pos, Kind::K_Warning, w );
+#define DIAG_COUNT( id, kind, argument, message ) + 1
+		static std::size_t const diag_id_count = 0 MARY_DIAGNOSTICS( DIAG_COUNT );
+#undef DIAG_COUNT
+
+		inline DiagKind GetDiagKind( DiagID id )
+		{
+			switch( id )
+			{
+#define DIAG_KIND( id, kind, argument, message ) case DiagID::id: return DiagKind::kind;
+			MARY_DIAGNOSTICS( DIAG_KIND )
+#undef DIAG_KIND
 			}
+			return DiagKind::Error;
+		}
+
+		// One reported problem. The message is only looked up, and the offset only turned
+		// into a line and column, when the record is rendered.
+		struct DiagRecord
+		{
+			std::uint32_t	offset;
+			std::uint32_t	argument;
+			DiagID			id;
+			DiagKind		kind;
+		};
+
+		static_assert( sizeof( DiagRecord ) == 12, "diagnostics are recorded by the million on bad input" );
 
-			inline void Error( wchar_t const * what )
+		// The diagnostics of one scanner or parser. Reporting appends a record and nothing
+		// else: no formatting, no output, no lock, as every instance is used by one thread at
+		// a time. A DiagnosticsEngine sorts, filters and renders them at the end.
+		struct Diagnostic
+		{
+			typedef std::vector<DiagRecord>::const_iterator const_iterator;
+
+			Diagnostic(): records(), errors( 0 ) { }
+
+			inline void Report( DiagID id, std::uint32_t offset, std::uint32_t argument = 0 )
 			{
-				if ( color_ ) std::cerr << DIAG_BOLD;
-				std::cerr << what << std::endl;
-				if ( color_ ) std::cerr << DIAG_RESET;
+				DiagKind const kind = GetDiagKind( id );
+				if( kind == DiagKind::Error ) ++errors;
+				records.push_back( DiagRecord{ offset, argument, id, kind } );
 			}
-			inline void Error( Position const & pos, wchar_t const * m ) {
-				++numErrors_;
-				PrintPos( pos, Kind::K_Error, m );
+
+			inline std::size_t		Count() const { return records.size(); }
+			inline std::size_t		ErrorCount() const { return errors; }
+			inline const_iterator	begin() const { return records.begin(); }
+			inline const_iterator	end() const { return records.end(); }
+
+			// Takes over records [first, last) of `other', e.g. those of speculative work
+			// that turned out to be right.
+			void Append( Diagnostic const & other, std::size_t first, std::size_t last )
+			{
+				for( ; first < last; ++first ){
+					if( other.records[first].kind == DiagKind::Error ) ++errors;
+					records.push_back( other.records[first] );
+				}
 			}
+			void Append( Diagnostic const & other ) { Append( other, 0, other.Count() ); }
 
-			unsigned HasError() {
-				auto tmp = numErrors_;
-				numErrors_ = 0;
-				return tmp;
+			void Clear()
+			{
+				records.clear();
+				errors = 0;
 			}
 
-		private:
-			const bool color_;
-			unsigned int numErrors_;
-
-			enum class Kind {
-				K_Note,
-				K_Warning,
-				K_Error
-			};
-
-			void PrintPos( const Position pos, const Kind kind, wchar_t const * what ) {
-				switch ( kind ) {
-				case Kind::K_Note:
-					if (color_) { std::cerr << DIAG_NOTE;    } 
-					std::wcerr << L"note: ";
-					break;
-				case Kind::K_Warning: 
-					if (color_) { std::cerr << DIAG_WARNING; } 
-					std::wcerr << L"warning: "; 
-					break;
-				case Kind::K_Error:   
-					if (color_) { std::cerr << DIAG_ERROR;   } 
-					std::wcerr << L"error: ";
-					break;
+			// Drops the records from the `count'th on, e.g. those a rescan reported again.
+			void Truncate( std::size_t count )
+			{
+				for( std::size_t i = count; i < records.size(); ++i ){
+					if( records[i].kind == DiagKind::Error ) --errors;
 				}
-				if ( color_) std::cerr << DIAG_BOLD;
-				std::wcerr << what << L" on ";
-				pos.Dump();
-				if (color_ ) std::cerr << DIAG_RESET;
-				
-				if (color_) std::cerr << DIAG_RESET;
-				std::endl( std::cerr );
+				if( count < records.size() ) records.resize( count );
+			}
+
+			// Stable, so records at the same offset stay in the order they were reported.
+			void SortByOffset()
+			{
+				std::stable_sort( records.begin(), records.end(), []( DiagRecord const & a, DiagRecord const & b ){
+					return a.offset < b.offset;
+				} );
 			}
+		private:
+			std::vector<DiagRecord>	records;
+			std::size_t				errors;
 		};
-		static void ReportError( wchar_t const * what )
-		{
-			static Diagnostic diag = true;
-			diag.Error( what );
-		}
-#undef DIAG_RESET
-#undef DIAG_BOLD
-#undef DIAG_NOTE
-#undef DIAG_WARNING
-#undef DIAG_ERROR
 	} // namespace Support
 } // namespace MaryLang
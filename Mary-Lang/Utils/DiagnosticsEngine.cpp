@@ -0,0 +1,328 @@
+#include "DiagnosticsEngine.hpp"
+#include "Utils.hpp"
+#include "../Scanner/tokens.hpp"
+#include <algorithm>
+#include <iostream>
+
+#define DIAG_RESET       L"\033[0m"
+#define DIAG_BOLD        L"\033[1;37m"
+#define DIAG_NOTE        L"\033[1;2;37m"
+#define DIAG_WARNING     L"\033[1;35m"
+#define DIAG_ERROR       L"\033[1;31m"
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		namespace
+		{
+			struct DiagInfo
+			{
+				wchar_t const *	name;
+				DiagArgument	argument;
+				wchar_t const *	message;
+			};
+
+#define DIAG_WIDE( str ) L##str
+#define DIAG_INFO( id, kind, argument, message ) { DIAG_WIDE( #id ), DiagArgument::argument, message },
+			DiagInfo const diag_info[] = {
+				MARY_DIAGNOSTICS( DIAG_INFO )
+			};
+#undef DIAG_INFO
+#undef DIAG_WIDE
+
+			std::size_t const diag_count = sizeof( diag_info ) / sizeof( diag_info[0] );
+
+			// Output is handed to the stream in pieces about this big.
+			std::size_t const batch_size = 64 * 1024;
+
+			// What a token of type `tt' looks like, quoted if it is spelled the same every time.
+			std::wstring TokenSpelling( Lexer::TokenType tt )
+			{
+				switch( tt )
+				{
+				case Lexer::TokenType::TK_EOF:			return L"end of file";
+				case Lexer::TokenType::TK_IDENTIFIER:	return L"an identifier";
+				default:								return L'\'' + std::wstring( Lexer::Token::GetName( tt ) ) + L'\'';
+				}
+			}
+
+			wchar_t const * KindName( DiagKind kind )
+			{
+				switch( kind )
+				{
+				case DiagKind::Note:	return L"note";
+				case DiagKind::Warning:	return L"warning";
+				default:				return L"error";
+				}
+			}
+
+			// File names are UTF-8, as sources are.
+			std::wstring WideName( std::string const & name )
+			{
+				return Utf8ToWide( name.data(), name.size() );
+			}
+
+			// `path' as a SARIF artifact location, percent-encoded: a file URI if the path is
+			// absolute, else a reference relative to SRCROOT, the directory the build ran in.
+			// Appends the members of the artifactLocation object.
+			void AppendArtifactLocation( std::wstring & out, std::string path )
+			{
+				static char const hex[] = "0123456789ABCDEF";
+				std::replace( path.begin(), path.end(), '\\', '/' );
+				bool const drive = path.size() >= 2 && path[1] == ':'
+					&& ( ( path[0] >= 'A' && path[0] <= 'Z' ) || ( path[0] >= 'a' && path[0] <= 'z' ) );
+				bool const absolute = drive || ( !path.empty() && path[0] == '/' );
+				out += L"\"uri\": \"";
+				std::size_t i = 0;
+				if( absolute ) out += drive ? L"file:///" : L"file://";
+				if( drive ){
+					out += static_cast<wchar_t>( path[0] );
+					out += L':';
+					i = 2;
+				}
+				for( ; i < path.size(); ++i ){
+					unsigned char const c = static_cast<unsigned char>( path[i] );
+					if( ( c >= 'A' && c <= 'Z' ) || ( c >= 'a' && c <= 'z' ) || ( c >= '0' && c <= '9' )
+						|| c == '-' || c == '.' || c == '_' || c == '~' || c == '/' ){
+						out += static_cast<wchar_t>( c );
+					} else {
+						out += L'%';
+						out += static_cast<wchar_t>( hex[c >> 4] );
+						out += static_cast<wchar_t>( hex[c & 0xF] );
+					}
+				}
+				out += absolute ? L"\"" : L"\", \"uriBaseId\": \"SRCROOT\"";
+			}
+
+			void AppendJsonString( std::wstring & out, std::wstring const & str )
+			{
+				static wchar_t const hex[] = L"0123456789abcdef";
+				out += L'"';
+				for( wchar_t const c : str ){
+					switch( c )
+					{
+					case L'"':	out += L"\\\""; break;
+					case L'\\':	out += L"\\\\"; break;
+					case L'\n':	out += L"\\n"; break;
+					case L'\t':	out += L"\\t"; break;
+					default:
+						if( c < 0x20 ){
+							out += L"\\u00";
+							out += hex[c >> 4];
+							out += hex[c & 0xF];
+						} else {
+							out += c;
+						}
+					}
+				}
+				out += L'"';
+			}
+
+			// Hands `buffer' to `out' once it is big enough, or when `last'.
+			void Flush( std::wostream & out, std::wstring & buffer, bool last = false )
+			{
+				if( buffer.size() < batch_size && !last ) return;
+				out.write( buffer.data(), static_cast<std::streamsize>( buffer.size() ) );
+				buffer.clear();
+				if( last ) out.flush();
+			}
+		} // namespace
+
+		DiagnosticsEngine::DiagnosticsEngine( Options const & opts )
+			: options( opts ), files(), entries(), errors( 0 ), warnings( 0 ) {}
+
+		template<typename Source>
+		void DiagnosticsEngine::AddEntries( Source const & source, Diagnostic const & diagnostics, std::size_t first )
+		{
+			if( diagnostics.Count() <= first ) return;
+			if( files.empty() || files.back() != source.FileName() ) files.push_back( source.FileName() );
+			std::uint32_t const file = static_cast<std::uint32_t>( files.size() - 1 );
+			for( auto record = diagnostics.begin() + first; record != diagnostics.end(); ++record ){
+				Position const position = source.GetPosition( record->offset );
+				entries.push_back( Entry{ file, record->offset, position._line_number, position._column_number,
+					record->argument, record->id, record->kind } );
+				if( record->kind == DiagKind::Error ) ++errors;
+				else if( record->kind == DiagKind::Warning ) ++warnings;
+			}
+		}
+
+		void DiagnosticsEngine::Add( SourceManager const & source, Diagnostic const & diagnostics )
+		{
+			entries.reserve( entries.size() + diagnostics.Count() );
+			AddEntries( source, diagnostics, 0 );
+		}
+
+		void DiagnosticsEngine::Add( SourceStream const & source, Diagnostic const & diagnostics, std::size_t first )
+		{
+			AddEntries( source, diagnostics, first );
+		}
+
+		// Stable, so what one file reports at one offset keeps the order it was reported in;
+		// a duplicate is only ever found among entries at the same offset.
+		void DiagnosticsEngine::SortAndDeduplicate()
+		{
+			std::stable_sort( entries.begin(), entries.end(), []( Entry const & a, Entry const & b ){
+				return a.file != b.file ? a.file < b.file : a.offset < b.offset;
+			} );
+			std::size_t kept = 0;
+			for( std::size_t i = 0; i < entries.size(); ++i ){
+				Entry const & entry = entries[i];
+				bool duplicate = false;
+				for( std::size_t j = kept; j-- > 0 && entries[j].file == entry.file && entries[j].offset == entry.offset; ){
+					if( entries[j].id == entry.id && entries[j].argument == entry.argument ){
+						duplicate = true;
+						break;
+					}
+				}
+				if( !duplicate ) entries[kept++] = entry;
+			}
+			entries.resize( kept );
+
+			errors = warnings = 0;
+			for( Entry const & entry : entries ){
+				if( entry.kind == DiagKind::Error ) ++errors;
+				else if( entry.kind == DiagKind::Warning ) ++warnings;
+			}
+		}
+
+		std::wstring DiagnosticsEngine::Message( DiagID id, std::uint32_t value )
+		{
+			DiagInfo const & info = diag_info[static_cast<std::size_t>( id )];
+			std::wstring message = info.message;
+			std::size_t const hole = message.find( L"%0" );
+			if( hole == std::wstring::npos ) return message;
+			std::wstring argument;
+			switch( info.argument )
+			{
+			case DiagArgument::Token:	argument = TokenSpelling( static_cast<Lexer::TokenType>( value ) ); break;
+			case DiagArgument::Integer:	argument = std::to_wstring( value ); break;
+			case DiagArgument::None:	break;
+			}
+			return message.replace( hole, 2, argument );
+		}
+
+		wchar_t const * DiagnosticsEngine::Name( DiagID id )
+		{
+			return diag_info[static_cast<std::size_t>( id )].name;
+		}
+
+		void DiagnosticsEngine::Render( std::wostream & out )
+		{
+			SortAndDeduplicate();
+			// everything up to and including the error that reaches the limit
+			std::size_t count = entries.size();
+			if( options.error_limit != 0 && errors > options.error_limit ){
+				std::size_t seen = 0;
+				for( count = 0; seen < options.error_limit; ++count ){
+					if( entries[count].kind == DiagKind::Error ) ++seen;
+				}
+			}
+			switch( options.format )
+			{
+			case DiagFormat::Text:	RenderText( out, count ); break;
+			case DiagFormat::Json:	RenderJson( out, count ); break;
+			case DiagFormat::Sarif:	RenderSarif( out, count ); break;
+			}
+			entries.clear();
+			files.clear();
+		}
+
+		void DiagnosticsEngine::RenderText( std::wostream & out, std::size_t count )
+		{
+			std::wstring buffer;
+			buffer.reserve( batch_size + 512 );
+			for( std::size_t i = 0; i < count; ++i ){
+				Entry const & entry = entries[i];
+				if( options.color ) buffer += DIAG_BOLD;
+				buffer += WideName( files[entry.file] );
+				buffer += L':' + std::to_wstring( entry.line ) + L':' + std::to_wstring( entry.column ) + L": ";
+				if( options.color ){
+					buffer += entry.kind == DiagKind::Error ? DIAG_ERROR : entry.kind == DiagKind::Warning ? DIAG_WARNING : DIAG_NOTE;
+				}
+				buffer += KindName( entry.kind );
+				buffer += L": ";
+				if( options.color ) buffer += DIAG_BOLD;
+				buffer += Message( entry.id, entry.argument );
+				if( options.color ) buffer += DIAG_RESET;
+				buffer += L'\n';
+				Flush( out, buffer );
+			}
+			if( count < entries.size() ){
+				if( options.color ) buffer += DIAG_ERROR;
+				buffer += L"fatal error: ";
+				if( options.color ) buffer += DIAG_BOLD;
+				buffer += L"too many errors emitted, stopping now [-ferror-limit=]";
+				if( options.color ) buffer += DIAG_RESET;
+				buffer += L'\n';
+			}
+			Flush( out, buffer, true );
+		}
+
+		void DiagnosticsEngine::RenderJson( std::wostream & out, std::size_t count )
+		{
+			std::wstring buffer;
+			buffer.reserve( batch_size + 512 );
+			buffer += L"[";
+			for( std::size_t i = 0; i < count; ++i ){
+				Entry const & entry = entries[i];
+				buffer += i == 0 ? L"\n  {\"file\": " : L",\n  {\"file\": ";
+				AppendJsonString( buffer, WideName( files[entry.file] ) );
+				buffer += L", \"line\": " + std::to_wstring( entry.line )
+					+ L", \"column\": " + std::to_wstring( entry.column )
+					+ L", \"offset\": " + std::to_wstring( entry.offset )
+					+ L", \"severity\": \"" + KindName( entry.kind )
+					+ L"\", \"code\": \"" + diag_info[static_cast<std::size_t>( entry.id )].name
+					+ L"\", \"message\": ";
+				AppendJsonString( buffer, Message( entry.id, entry.argument ) );
+				buffer += L"}";
+				Flush( out, buffer );
+			}
+			buffer += count == 0 ? L"]\n" : L"\n]\n";
+			Flush( out, buffer, true );
+		}
+
+		void DiagnosticsEngine::RenderSarif( std::wostream & out, std::size_t count )
+		{
+			std::wstring buffer;
+			buffer.reserve( batch_size + 512 );
+			buffer += L"{\n  \"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\",\n"
+				L"  \"version\": \"2.1.0\",\n"
+				L"  \"runs\": [{\n"
+				L"    \"tool\": {\"driver\": {\"name\": \"MaryLang\", \"rules\": [";
+			for( std::size_t rule = 0; rule < diag_count; ++rule ){
+				buffer += rule == 0 ? L"\n" : L",\n";
+				buffer += L"      {\"id\": \"";
+				buffer += diag_info[rule].name;
+				buffer += L"\", \"shortDescription\": {\"text\": ";
+				AppendJsonString( buffer, diag_info[rule].message );
+				buffer += L"}}";
+			}
+			buffer += L"\n    ]}},\n    \"results\": [";
+			for( std::size_t i = 0; i < count; ++i ){
+				Entry const & entry = entries[i];
+				std::size_t const rule = static_cast<std::size_t>( entry.id );
+				buffer += i == 0 ? L"\n" : L",\n";
+				buffer += L"      {\"ruleId\": \"";
+				buffer += diag_info[rule].name;
+				buffer += L"\", \"ruleIndex\": " + std::to_wstring( rule )
+					+ L", \"level\": \"" + KindName( entry.kind ) + L"\", \"message\": {\"text\": ";
+				AppendJsonString( buffer, Message( entry.id, entry.argument ) );
+				buffer += L"}, \"locations\": [{\"physicalLocation\": {\"artifactLocation\": {";
+				AppendArtifactLocation( buffer, files[entry.file] );
+				buffer += L"}, \"region\": {\"startLine\": " + std::to_wstring( entry.line )
+					+ L", \"startColumn\": " + std::to_wstring( entry.column )
+					+ L", \"byteOffset\": " + std::to_wstring( entry.offset ) + L"}}}]}";
+				Flush( out, buffer );
+			}
+			buffer += count == 0 ? L"]\n  }]\n}\n" : L"\n    ]\n  }]\n}\n";
+			Flush( out, buffer, true );
+		}
+	} // namespace Support
+} // namespace MaryLang
+
+#undef DIAG_RESET
+#undef DIAG_BOLD
+#undef DIAG_NOTE
+#undef DIAG_WARNING
+#undef DIAG_ERROR
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "Diagnostics.hpp"
+#include "SourceManager.hpp"
+#include "SourceStream.hpp"
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		enum class DiagFormat
+		{
+			Text,	// file:line:column: error: message
+			Json,	// an array of objects, one per diagnostic
+			Sarif	// SARIF 2.1.0, for code scanning in CI
+		};
+
+		// Gathers the diagnostics of every file of a build and renders them once, at the end.
+		// They come out ordered by file, in the order the files were added, then by offset.
+		// Duplicates, such as an error both a skim and a later full parse of a function
+		// found, are dropped.
+		struct DiagnosticsEngine
+		{
+			struct Options
+			{
+				DiagFormat		format;
+				std::size_t		error_limit; // stop rendering after this many errors; zero: no limit
+				bool			color;
+			};
+
+			explicit DiagnosticsEngine( Options const & options );
+
+			// Records `diagnostics' as belonging to `source'. Lines and columns are worked out
+			// here, so the source may be closed afterwards.
+			void Add( SourceManager const & source, Diagnostic const & diagnostics );
+			// Records those of `diagnostics' from the `first' on, as belonging to `source': what
+			// a statement of a stream brought, while the stream still has its lines.
+			void Add( SourceStream const & source, Diagnostic const & diagnostics, std::size_t first = 0 );
+
+			inline std::size_t ErrorCount() const { return errors; }
+			inline std::size_t WarningCount() const { return warnings; }
+
+			// Writes everything added so far to `out', in batches rather than a write per line.
+			void Render( std::wostream & out );
+
+			// What a diagnostic says and what it is called, for those who render their own,
+			// like the language server.
+			static std::wstring		Message( DiagID id, std::uint32_t argument );
+			static wchar_t const *	Name( DiagID id );
+		private:
+			struct Entry
+			{
+				std::uint32_t	file; // index into `files'
+				std::uint32_t	offset;
+				std::uint32_t	line, column;
+				std::uint32_t	argument;
+				DiagID			id;
+				DiagKind		kind;
+			};
+
+			template<typename Source>
+			void AddEntries( Source const & source, Diagnostic const & diagnostics, std::size_t first );
+			void SortAndDeduplicate();
+			void RenderText( std::wostream & out, std::size_t count );
+			void RenderJson( std::wostream & out, std::size_t count );
+			void RenderSarif( std::wostream & out, std::size_t count );
+
+			Options const				options;
+			std::vector<std::string>	files;
+			std::vector<Entry>			entries;
+			std::size_t					errors, warnings;
+		};
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,110 @@
+#include "SourceBuffer.hpp"
+
+#if defined( _WIN32 )
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MaryLang
+{
+	namespace Support
+	{
+#if defined( _WIN32 )
+		SourceBuffer::SourceBuffer()
+			: data( nullptr ), size( 0 ),
+			file_handle( INVALID_HANDLE_VALUE ), mapping_handle( nullptr )
+		{
+		}
+#else
+		SourceBuffer::SourceBuffer(): data( nullptr ), size( 0 )
+		{
+		}
+#endif
+
+		SourceBuffer::~SourceBuffer()
+		{
+			Close();
+		}
+
+#if defined( _WIN32 )
+		bool SourceBuffer::Open( char const * filename )
+		{
+			Close();
+			file_handle = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+			if( file_handle == INVALID_HANDLE_VALUE ) return false;
+
+			LARGE_INTEGER file_size;
+			if( !GetFileSizeEx( file_handle, &file_size ) ){
+				Close();
+				return false;
+			}
+			size = static_cast<std::size_t>( file_size.QuadPart );
+			if( size == 0 ) return true; // an empty file cannot be mapped
+
+			mapping_handle = CreateFileMappingA( file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+			if( mapping_handle == nullptr ){
+				Close();
+				return false;
+			}
+			data = static_cast<char const *>( MapViewOfFile( mapping_handle, FILE_MAP_READ, 0, 0, 0 ) );
+			if( data == nullptr ){
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void SourceBuffer::Close()
+		{
+			if( data != nullptr ) UnmapViewOfFile( data );
+			if( mapping_handle != nullptr ) CloseHandle( mapping_handle );
+			if( file_handle != INVALID_HANDLE_VALUE ) CloseHandle( file_handle );
+			data = nullptr;
+			size = 0;
+			mapping_handle = nullptr;
+			file_handle = INVALID_HANDLE_VALUE;
+		}
+#else
+		bool SourceBuffer::Open( char const * filename )
+		{
+			Close();
+			int const fd = open( filename, O_RDONLY );
+			if( fd == -1 ) return false;
+
+			struct stat file_status;
+			if( fstat( fd, &file_status ) == -1 || !S_ISREG( file_status.st_mode ) ){
+				close( fd );
+				return false;
+			}
+			if( file_status.st_size == 0 ){ // an empty file cannot be mapped
+				close( fd );
+				return true;
+			}
+
+			void * const mapping = mmap( nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+			close( fd ); // the mapping keeps its own reference to the file
+			if( mapping == MAP_FAILED ) return false;
+			// the scanner walks the buffer front to back, exactly once.
+			madvise( mapping, file_status.st_size, MADV_SEQUENTIAL );
+
+			data = static_cast<char const *>( mapping );
+			size = static_cast<std::size_t>( file_status.st_size );
+			return true;
+		}
+
+		void SourceBuffer::Close()
+		{
+			if( data != nullptr ){
+				munmap( const_cast<char *>( data ), size );
+			}
+			data = nullptr;
+			size = 0;
+		}
+#endif
+	} // namespace Support
+} // namespace MaryLang
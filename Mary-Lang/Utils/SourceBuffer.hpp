@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// A read-only view of a source file's UTF-8 bytes. The file is mapped into
+		// memory rather than read, so the scanner lexes the bytes in place.
+		struct SourceBuffer
+		{
+			SourceBuffer();
+			~SourceBuffer();
+
+			SourceBuffer( SourceBuffer const & ) = delete;
+			SourceBuffer & operator=( SourceBuffer const & ) = delete;
+
+			bool Open( char const * filename );
+			void Close();
+
+			inline char const *	Data() const { return data; }
+			inline std::size_t	Size() const { return size; }
+		private:
+			char const *		data;
+			std::size_t			size;
+#if defined( _WIN32 )
+			void *				file_handle;
+			void *				mapping_handle;
+#endif
+		}; // SourceBuffer
+	} // namespace Support
+} // namespace MaryLang
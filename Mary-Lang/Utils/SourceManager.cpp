@@ -0,0 +1,128 @@
+#include "SourceManager.hpp"
+#include "Statistics.hpp"
+#include "TimeTrace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		SourceManager::SourceManager()
+			: buffer(), text(), data( nullptr ), size( 0 ), file_name(), line_starts(), lines_built( false ), lines_lock()
+		{
+		}
+
+		bool SourceManager::Open( char const * filename )
+		{
+			TimeScope const scope( "Load", filename );
+			Close();
+			if( !buffer.Open( filename ) ) return false;
+			if( buffer.Size() > UINT32_MAX ){ // offsets are 32 bits wide
+				buffer.Close();
+				return false;
+			}
+			data = buffer.Data();
+			size = buffer.Size();
+			file_name = filename;
+			Statistics::Add( Statistics::SourceFiles );
+			Statistics::Add( Statistics::SourceBytes, buffer.Size() );
+			return true;
+		}
+
+		bool SourceManager::Assign( std::string const & name, std::string source_text )
+		{
+			Close();
+			if( source_text.size() > UINT32_MAX ) return false;
+			text = std::move( source_text );
+			data = text.data();
+			size = text.size();
+			file_name = name;
+			Statistics::Add( Statistics::SourceFiles );
+			Statistics::Add( Statistics::SourceBytes, text.size() );
+			return true;
+		}
+
+		void SourceManager::Replace( std::uint32_t offset, std::uint32_t length, StringRef replacement )
+		{
+			text.replace( offset, length, replacement.Data(), replacement.Size() );
+			data = text.data();
+			size = text.size();
+			if( !lines_built.load( std::memory_order_relaxed ) ) return;
+
+			// the lines that started in the replaced bytes go, those in `replacement' come,
+			// and the ones after move by the difference
+			std::int64_t const delta = static_cast<std::int64_t>( replacement.Size() ) - length;
+			auto first = std::upper_bound( line_starts.begin(), line_starts.end(), offset );
+			auto last = std::upper_bound( first, line_starts.end(), offset + length );
+			for( auto line = last; line != line_starts.end(); ++line ){
+				*line = static_cast<std::uint32_t>( *line + delta );
+			}
+			std::vector<std::uint32_t> added;
+			for( std::size_t i = 0; i < replacement.Size(); ++i ){
+				if( replacement[i] == '\n' ) added.push_back( static_cast<std::uint32_t>( offset + i + 1 ) );
+			}
+			first = line_starts.erase( first, last );
+			line_starts.insert( first, added.begin(), added.end() );
+		}
+
+		void SourceManager::Close()
+		{
+			buffer.Close();
+			text.clear();
+			data = nullptr;
+			size = 0;
+			file_name.clear();
+			line_starts.clear();
+			lines_built.store( false, std::memory_order_relaxed );
+		}
+
+		// memchr is vectorized by every C library we build against, so this runs at
+		// memory bandwidth rather than a byte per iteration.
+		void SourceManager::BuildLineTable() const
+		{
+			std::lock_guard<std::mutex> guard( lines_lock );
+			if( lines_built.load( std::memory_order_relaxed ) ) return;
+			TimeScope const scope( "Line table", file_name );
+
+			char const * const end = data + size;
+			line_starts.clear();
+			line_starts.push_back( 0 );
+			for( char const * p = data; p != end; ){
+				char const * const newline = static_cast<char const *>( std::memchr( p, '\n', end - p ) );
+				if( newline == nullptr ) break;
+				p = newline + 1;
+				line_starts.push_back( static_cast<std::uint32_t>( p - data ) );
+			}
+			lines_built.store( true, std::memory_order_release );
+		}
+
+		Position SourceManager::GetPosition( std::uint32_t offset ) const
+		{
+			if( !lines_built.load( std::memory_order_acquire ) ) BuildLineTable();
+
+			auto line = std::upper_bound( line_starts.cbegin(), line_starts.cend(), offset );
+			std::uint32_t const line_start = *--line;
+			unsigned int column = 1; // one per character, not per byte
+			for( std::uint32_t i = line_start; i < offset && i < size; ++i ){
+				if( ( static_cast<unsigned char>( data[i] ) & 0xC0 ) != 0x80 ) ++column;
+			}
+			return Position( static_cast<unsigned int>( line - line_starts.cbegin() ) + 1, column );
+		}
+
+		std::uint32_t SourceManager::LineCount() const
+		{
+			if( !lines_built.load( std::memory_order_acquire ) ) BuildLineTable();
+			// a newline that ends the last line does not begin another
+			return static_cast<std::uint32_t>( line_starts.size() - ( line_starts.back() == size ? 1 : 0 ) );
+		}
+
+		std::uint32_t SourceManager::LineOffset( std::uint32_t line ) const
+		{
+			if( !lines_built.load( std::memory_order_acquire ) ) BuildLineTable();
+			if( line == 0 ) return 0;
+			return line <= line_starts.size() ? line_starts[line - 1] : static_cast<std::uint32_t>( size );
+		}
+	} // namespace Support
+} // namespace MaryLang
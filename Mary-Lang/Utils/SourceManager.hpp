@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Position.hpp"
+#include "SourceBuffer.hpp"
+#include "StringRef.hpp"
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// Owns a source file's bytes and maps 32-bit offsets into them back to line:column.
+		// Tokens and AST nodes only remember an offset; the line-start table is built the
+		// first time a position is actually asked for, usually by a diagnostic. The bytes
+		// are a mapped file, or a string in memory that can be edited in place.
+		struct SourceManager
+		{
+			SourceManager();
+
+			SourceManager( SourceManager const & ) = delete;
+			SourceManager & operator=( SourceManager const & ) = delete;
+
+			bool Open( char const * filename );
+			// Takes `text' as the source instead of a file, e.g. an editor's unsaved buffer;
+			// `name' is what diagnostics call it. False if it is too big for 32-bit offsets.
+			bool Assign( std::string const & name, std::string text );
+			// Replaces `length' bytes at `offset' of a source given to Assign with `text',
+			// keeping the line table rather than rebuilding it. Scanners over the source have
+			// to be made anew, and nothing may read it meanwhile.
+			void Replace( std::uint32_t offset, std::uint32_t length, StringRef text );
+			void Close();
+
+			inline char const *			Data() const { return data; }
+			inline std::uint32_t		Size() const { return static_cast<std::uint32_t>( size ); }
+			inline std::string const &	FileName() const { return file_name; }
+			inline StringRef			Text( std::uint32_t offset, std::uint32_t length ) const {
+				return StringRef( data + offset, length );
+			}
+
+			// Lines and columns count from 1; a column counts characters, not bytes.
+			// Safe to call from several threads at once.
+			Position		GetPosition( std::uint32_t offset ) const;
+			// Not counting the empty line after a final newline: "a\nb\n" has two.
+			std::uint32_t	LineCount() const;
+			// Where line `line' begins; the end of the source past the last line.
+			std::uint32_t	LineOffset( std::uint32_t line ) const;
+		private:
+			void BuildLineTable() const;
+
+			SourceBuffer					buffer;
+			std::string						text;	// the source, if it was assigned rather than opened
+			char const *					data;
+			std::size_t						size;
+			std::string						file_name;
+			mutable std::vector<std::uint32_t> line_starts;
+			mutable std::atomic<bool>		lines_built;
+			mutable std::mutex				lines_lock;
+		}; // SourceManager
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,127 @@
+#include "SourceStream.hpp"
+#include "Statistics.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#if defined( _WIN32 )
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		SourceStream::SourceStream( int stream_descriptor, std::string const & name, std::size_t window_size )
+			: descriptor( stream_descriptor ), file_name( name ), window( window_size != 0 ? window_size : 1 ),
+			base( 0 ), size( 0 ), released( 0 ), line_starts(), first_line( 0 ),
+			released_line( 1 ), released_column( 1 ), at_end( false ), failed( false )
+		{
+			Statistics::Add( Statistics::SourceFiles );
+		}
+
+		bool SourceStream::Refill()
+		{
+			if( at_end ) return false;
+			if( size == window.size() ){
+				// what was released goes and the rest moves to the front, unless that would
+				// leave less than half the window free: then it grows, so that no byte is moved
+				// more than a couple of times however the reads come in
+				std::size_t const drop = released - base;
+				if( size - drop > window.size() / 2 ){
+					window.resize( window.size() * 2 );
+				} else {
+					std::memmove( window.data(), window.data() + drop, size - drop );
+					size -= drop;
+					base = released;
+					line_starts.erase( line_starts.begin(), line_starts.begin() + first_line );
+					first_line = 0;
+				}
+			}
+
+			std::size_t room = std::min<std::size_t>( window.size() - size, INT_MAX );
+			std::uint64_t const end = static_cast<std::uint64_t>( base ) + size;
+			if( end + room > UINT32_MAX ) room = static_cast<std::size_t>( UINT32_MAX - end );
+			if( room == 0 ){ // tokens could not address the rest
+				at_end = failed = true;
+				return false;
+			}
+			char * const first = window.data() + size;
+			std::size_t read_size;
+			for( ; ; ){
+#if defined( _WIN32 )
+				int const result = _read( descriptor, first, static_cast<unsigned int>( room ) );
+#else
+				ssize_t const result = read( descriptor, first, room );
+#endif
+				if( result > 0 ){
+					read_size = static_cast<std::size_t>( result );
+					break;
+				}
+				if( result == 0 ){
+					at_end = true;
+					return false;
+				}
+				if( errno != EINTR ){
+					at_end = failed = true;
+					return false;
+				}
+			}
+
+			char const * const last = first + read_size;
+			for( char const * p = first; p != last; ){
+				char const * const newline = static_cast<char const *>( std::memchr( p, '\n', last - p ) );
+				if( newline == nullptr ) break;
+				p = newline + 1;
+				line_starts.push_back( static_cast<std::uint32_t>( base + ( p - window.data() ) ) );
+			}
+			size += read_size;
+			Statistics::Add( Statistics::SourceBytes, read_size );
+			return true;
+		}
+
+		void SourceStream::Release( std::uint32_t offset )
+		{
+			offset = std::min( offset, static_cast<std::uint32_t>( base + size ) );
+			if( offset <= released ) return;
+			auto const first = line_starts.cbegin() + first_line;
+			auto const line = std::upper_bound( first, line_starts.cend(), offset );
+			if( line != first ){
+				released_line += static_cast<std::uint32_t>( line - first );
+				released_column = 1 + Characters( *( line - 1 ), offset );
+			} else {
+				released_column += Characters( released, offset );
+			}
+			first_line = line - line_starts.cbegin();
+			released = offset;
+		}
+
+		Position SourceStream::GetPosition( std::uint32_t offset ) const
+		{
+			offset = std::min( std::max( offset, released ), static_cast<std::uint32_t>( base + size ) );
+			auto const first = line_starts.cbegin() + first_line;
+			auto const line = std::upper_bound( first, line_starts.cend(), offset );
+			if( line == first ) return Position( released_line, released_column + Characters( released, offset ) );
+			return Position( released_line + static_cast<unsigned int>( line - first ), 1 + Characters( *( line - 1 ), offset ) );
+		}
+
+		std::uint32_t SourceStream::LineCount() const
+		{
+			std::uint32_t const end = static_cast<std::uint32_t>( base + size );
+			bool const empty_last = line_starts.size() != first_line ? line_starts.back() == end : released == end && released_column == 1;
+			return released_line + static_cast<std::uint32_t>( line_starts.size() - first_line ) - ( empty_last ? 1 : 0 );
+		}
+
+		std::uint32_t SourceStream::Characters( std::uint32_t first, std::uint32_t last ) const
+		{
+			std::uint32_t characters = 0;
+			for( std::uint32_t i = first - base; i < last - base; ++i ){
+				if( ( static_cast<unsigned char>( window[i] ) & 0xC0 ) != 0x80 ) ++characters;
+			}
+			return characters;
+		}
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Position.hpp"
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// A source that arrives as a stream, such as a pipe, seen through a window of it: the
+		// bytes from the first one still needed to the last one read. The scanner lexes the
+		// window in place and refills it when it runs off the end, so the parser works while
+		// the writer is still writing. Offsets count from the start of the stream, like a
+		// SourceManager's; once a reader releases what lies before an offset, the window
+		// drops it at the next refill that finds it full. It only grows if one stretch still
+		// needed is longer than it, so memory stays the same however long the stream is.
+		struct SourceStream
+		{
+			// Reads `descriptor', e.g. 0 for standard input; `name' is what diagnostics call it.
+			SourceStream( int descriptor, std::string const & name, std::size_t window_size = 64 * 1024 );
+
+			SourceStream( SourceStream const & ) = delete;
+			SourceStream & operator=( SourceStream const & ) = delete;
+
+			// Reads what the stream has ready into the window, at least a byte, waiting for it
+			// if need be. False at the end of the stream, or once it fails.
+			bool Refill();
+			// Nothing before `offset' will be asked about any more: not its bytes, nor its
+			// positions.
+			void Release( std::uint32_t offset );
+
+			// The window: bytes [Base(), Base() + Size()) of the stream.
+			inline char const *			Data() const { return window.data(); }
+			inline std::uint32_t		Base() const { return base; }
+			inline std::uint32_t		Size() const { return static_cast<std::uint32_t>( size ); }
+			inline std::size_t			WindowSize() const { return window.size(); }
+			inline std::string const &	FileName() const { return file_name; }
+			// The stream could not be read to its end: a read failed, or it went past what
+			// 32-bit offsets reach.
+			inline bool					Failed() const { return failed; }
+
+			// Lines and columns as a SourceManager counts them, for an offset not released.
+			Position		GetPosition( std::uint32_t offset ) const;
+			// The lines read so far, as a SourceManager counts them: none begins at the end.
+			std::uint32_t	LineCount() const;
+		private:
+			// Characters, not bytes, in [first, last) of the stream.
+			std::uint32_t Characters( std::uint32_t first, std::uint32_t last ) const;
+
+			int							descriptor;
+			std::string					file_name;
+			std::vector<char>			window;
+			std::uint32_t				base;		// the offset of window[0]
+			std::size_t					size;		// bytes read into the window
+			std::uint32_t				released;	// nothing before it is needed
+			// where the lines read begin, from `first_line' on; those before were released
+			std::vector<std::uint32_t>	line_starts;
+			std::size_t					first_line;
+			std::uint32_t				released_line, released_column; // the position of `released'
+			bool						at_end, failed;
+		}; // SourceStream
+	} // namespace Support
+} // namespace MaryLang
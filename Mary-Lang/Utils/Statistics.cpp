@@ -0,0 +1,112 @@
+#include "Statistics.hpp"
+#include "StringInterner.hpp"
+#include "../AbstractSyntaxTree/FlatTree.hpp"
+#include "../Scanner/tokens.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		static_assert( Lexer::token_type_count <= Statistics::max_token_types, "raise max_token_types" );
+		static_assert( AbstractSyntaxTree::node_kind_count <= Statistics::max_node_kinds, "raise max_node_kinds" );
+
+		namespace
+		{
+			// A shard and the one registered before it. They are malloc'd, so a program counting
+			// its operator new calls does not count them, and never freed: a thread may count
+			// until it ends, which can be after the report. The list's head is a plain pointer
+			// that nothing destroys, so they stay reachable to the end of the program.
+			struct ShardNode
+			{
+				Statistics::Shard	shard;
+				ShardNode *			next;
+			};
+
+			std::mutex							shards_lock;
+			ShardNode *							shards = nullptr; // guarded by `shards_lock'
+			thread_local Statistics::Shard *	current_shard = nullptr;
+
+			void WriteRows( std::wostream & out, std::vector<std::pair<std::uint64_t, std::wstring>> rows )
+			{
+				std::stable_sort( rows.begin(), rows.end(), []( std::pair<std::uint64_t, std::wstring> const & a,
+					std::pair<std::uint64_t, std::wstring> const & b ){ return a.first > b.first; } );
+				for( auto const & row : rows ) out << std::setw( 14 ) << row.first << L"  " << row.second << L'\n';
+			}
+		} // namespace
+
+		std::atomic<bool> Statistics::enabled( false );
+
+		void Statistics::Enable()
+		{
+			enabled.store( true, std::memory_order_relaxed );
+		}
+
+		Statistics::Shard * Statistics::Local()
+		{
+			if( !IsEnabled() ) return nullptr;
+			if( current_shard == nullptr ){
+				ShardNode * const node = static_cast<ShardNode *>( std::calloc( 1, sizeof( ShardNode ) ) );
+				if( node != nullptr ){
+					std::lock_guard<std::mutex> guard( shards_lock );
+					node->next = shards;
+					shards = node;
+					current_shard = &node->shard;
+				}
+			}
+			return current_shard;
+		}
+
+		void Statistics::Write( std::wostream & out )
+		{
+			Shard total;
+			std::memset( &total, 0, sizeof( total ) );
+			{
+				std::lock_guard<std::mutex> guard( shards_lock );
+				for( ShardNode const * node = shards; node != nullptr; node = node->next ){
+					Shard const * const shard = &node->shard;
+					for( std::size_t i = 0; i < counter_count; ++i ) total.counters[i] += shard->counters[i];
+					for( std::size_t i = 0; i < max_token_types; ++i ) total.tokens[i] += shard->tokens[i];
+					for( std::size_t i = 0; i < max_node_kinds; ++i ) total.nodes[i] += shard->nodes[i];
+					total.max_parse_depth = std::max( total.max_parse_depth, shard->max_parse_depth );
+				}
+			}
+			std::uint64_t tokens = 0, nodes = 0;
+			std::vector<std::pair<std::uint64_t, std::wstring>> token_rows, node_rows;
+			for( std::size_t i = 0; i < Lexer::token_type_count; ++i ){
+				tokens += total.tokens[i];
+				if( total.tokens[i] != 0 ) token_rows.emplace_back( total.tokens[i], Lexer::Token::GetName( static_cast<Lexer::TokenType>( i ) ) );
+			}
+			for( std::size_t i = 0; i < AbstractSyntaxTree::node_kind_count; ++i ){
+				nodes += total.nodes[i];
+				if( total.nodes[i] != 0 ) node_rows.emplace_back( total.nodes[i], AbstractSyntaxTree::GetKindName( static_cast<AbstractSyntaxTree::NodeKind>( i ) ) );
+			}
+			std::uint64_t const identifiers = total.tokens[static_cast<std::size_t>( Lexer::TokenType::TK_IDENTIFIER )];
+
+			out << L"===--- Statistics ---===\n";
+			out << std::setw( 14 ) << total.counters[SourceFiles] << L"  source files\n"
+				<< std::setw( 14 ) << total.counters[SourceBytes] << L"  source bytes\n"
+				<< std::setw( 14 ) << tokens << L"  tokens lexed, counting those lexed twice\n"
+				<< std::setw( 14 ) << identifiers << L"  identifiers\n"
+				<< std::setw( 14 ) << StringInterner::Global().Size() << L"  unique identifiers\n"
+				<< std::setw( 14 ) << nodes << L"  syntax tree nodes\n"
+				<< std::setw( 14 ) << total.max_parse_depth << L"  deepest parser recursion\n"
+				<< std::setw( 14 ) << total.counters[HeapAllocations] << L"  heap allocations\n"
+				<< std::setw( 14 ) << total.counters[HeapBytes] << L"  heap bytes allocated\n"
+				<< std::setw( 14 ) << total.counters[ArenaChunks] << L"  arena chunks\n"
+				<< std::setw( 14 ) << total.counters[ArenaBytes] << L"  arena bytes reserved\n";
+			out << L"===--- Tokens by type ---===\n";
+			WriteRows( out, std::move( token_rows ) );
+			out << L"===--- Nodes by kind ---===\n";
+			WriteRows( out, std::move( node_rows ) );
+			out.flush();
+		}
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// Counters for what a build went through: tokens, nodes, bytes, allocations. Every
+		// thread counts into a shard of its own with plain increments; the shards are only
+		// added up when the numbers are written, after the work is done.
+		//
+		// Counting is off until Enable. Hot paths fetch their shard once, when a scanner or
+		// a parser is made, and skip counting while it is null.
+		struct Statistics
+		{
+			enum Counter
+			{
+				SourceFiles,
+				SourceBytes,
+				HeapAllocations,	// calls to operator new, if the program reports them
+				HeapBytes,
+				ArenaChunks,
+				ArenaBytes,
+				counter_count
+			};
+
+			// Upper bounds of TokenType and NodeKind, which Utils does not know.
+			static std::size_t const max_token_types = 128;
+			static std::size_t const max_node_kinds = 64;
+
+			struct Shard
+			{
+				std::uint64_t	counters[counter_count];
+				std::uint64_t	tokens[max_token_types];	// by TokenType
+				std::uint64_t	nodes[max_node_kinds];		// by NodeKind
+				std::uint32_t	max_parse_depth;
+			};
+
+			static void Enable();
+			static inline bool IsEnabled() { return enabled.load( std::memory_order_relaxed ); }
+
+			// The running thread's shard; null while counting is off.
+			static Shard * Local();
+
+			static inline void Add( Counter counter, std::uint64_t amount = 1 )
+			{
+				if( !IsEnabled() ) return;
+				if( Shard * const shard = Local() ) shard->counters[counter] += amount;
+			}
+
+			// Every shard added up, as a report like -ftime-report's.
+			static void Write( std::wostream & out );
+		private:
+			static std::atomic<bool> enabled;
+		};
+	} // namespace Support
+} // namespace MaryLang
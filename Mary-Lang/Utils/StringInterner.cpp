@@ -0,0 +1,180 @@
+#include "StringInterner.hpp"
+#include <cstring>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		namespace
+		{
+			std::uint32_t const initial_table_size = 4096;
+
+			inline unsigned HighestBit( std::uint32_t value )
+			{
+#if defined( _MSC_VER )
+				unsigned long index;
+				_BitScanReverse( &index, value );
+				return static_cast<unsigned>( index );
+#else
+				return 31u - static_cast<unsigned>( __builtin_clz( value ) );
+#endif
+			}
+		}
+
+		StringInterner::StringInterner()
+			: table( nullptr ), count( 0 ), writer_lock(), strings()
+		{
+			for( auto & segment : segments ) segment.store( nullptr, std::memory_order_relaxed );
+
+			Table *initial = new Table;
+			initial->mask = initial_table_size - 1;
+			initial->retired = nullptr;
+			initial->slots = new std::atomic<Symbol>[initial_table_size]();
+			table.store( initial, std::memory_order_release );
+		}
+
+		StringInterner::~StringInterner()
+		{
+			for( Table *t = table.load( std::memory_order_relaxed ); t != nullptr; ){
+				Table *retired = t->retired;
+				delete []t->slots;
+				delete t;
+				t = retired;
+			}
+			for( auto & segment : segments ) delete []segment.load( std::memory_order_relaxed );
+		}
+
+		StringInterner & StringInterner::Global()
+		{
+			static StringInterner interner;
+			return interner;
+		}
+
+		// Mixes eight bytes at a time; identifiers are short, so this is mostly one or two rounds.
+		std::uint32_t StringInterner::Hash( StringRef str )
+		{
+			std::uint64_t const multiplier = 0x9E3779B97F4A7C15ull;
+			std::uint64_t hash = str.Size() * multiplier;
+			char const *p = str.Data();
+			std::size_t remaining = str.Size();
+			for( ; remaining >= 8; p += 8, remaining -= 8 ){
+				std::uint64_t word;
+				std::memcpy( &word, p, 8 );
+				hash = ( hash ^ word ) * multiplier;
+				hash ^= hash >> 29;
+			}
+			if( remaining != 0 ){
+				std::uint64_t word = 0;
+				std::memcpy( &word, p, remaining );
+				hash = ( hash ^ word ) * multiplier;
+				hash ^= hash >> 29;
+			}
+			return static_cast<std::uint32_t>( hash >> 32 );
+		}
+
+		StringInterner::Entry const & StringInterner::GetEntry( Symbol symbol ) const
+		{
+			std::uint32_t const index = symbol - 1;
+			if( index < ( 1u << first_segment_bits ) ){
+				return segments[0].load( std::memory_order_acquire )[index];
+			}
+			unsigned const bit = HighestBit( index );
+			return segments[bit - first_segment_bits + 1].load( std::memory_order_acquire )[index - ( 1u << bit )];
+		}
+
+		Symbol StringInterner::Probe( Table const * t, StringRef str, std::uint32_t hash ) const
+		{
+			for( std::uint32_t i = hash & t->mask; ; i = ( i + 1 ) & t->mask ){
+				Symbol const symbol = t->slots[i].load( std::memory_order_acquire );
+				if( symbol == 0 ) return 0;
+				Entry const & entry = GetEntry( symbol );
+				if( entry.hash == hash && entry.size == str.Size()
+					&& std::memcmp( entry.data, str.Data(), str.Size() ) == 0 )
+				{
+					return symbol;
+				}
+			}
+		}
+
+		void StringInterner::Insert( Table * t, Symbol symbol, std::uint32_t hash )
+		{
+			std::uint32_t i = hash & t->mask;
+			while( t->slots[i].load( std::memory_order_relaxed ) != 0 ) i = ( i + 1 ) & t->mask;
+			t->slots[i].store( symbol, std::memory_order_release );
+		}
+
+		void StringInterner::Grow()
+		{
+			Table *old_table = table.load( std::memory_order_relaxed );
+			std::uint32_t const size = ( old_table->mask + 1 ) * 2;
+			Table *new_table = new Table;
+			new_table->mask = size - 1;
+			new_table->retired = old_table;
+			new_table->slots = new std::atomic<Symbol>[size]();
+			for( std::uint32_t i = 0; i <= old_table->mask; ++i ){
+				Symbol const symbol = old_table->slots[i].load( std::memory_order_relaxed );
+				if( symbol != 0 ) Insert( new_table, symbol, GetEntry( symbol ).hash );
+			}
+			table.store( new_table, std::memory_order_release );
+		}
+
+		Symbol StringInterner::Find( StringRef str ) const
+		{
+			return Probe( table.load( std::memory_order_acquire ), str, Hash( str ) );
+		}
+
+		Symbol StringInterner::Intern( StringRef str )
+		{
+			std::uint32_t const hash = Hash( str );
+			Symbol symbol = Probe( table.load( std::memory_order_acquire ), str, hash );
+			if( symbol != 0 ) return symbol;
+
+			std::lock_guard<std::mutex> guard( writer_lock );
+			// another scanner may have interned it while we waited for the lock.
+			symbol = Probe( table.load( std::memory_order_relaxed ), str, hash );
+			if( symbol != 0 ) return symbol;
+
+			std::uint32_t const index = count.load( std::memory_order_relaxed );
+			unsigned segment = 0;
+			std::uint32_t offset = index;
+			if( index >= ( 1u << first_segment_bits ) ){
+				unsigned const bit = HighestBit( index );
+				segment = bit - first_segment_bits + 1;
+				offset = index - ( 1u << bit );
+			}
+			Entry *entries = segments[segment].load( std::memory_order_relaxed );
+			if( entries == nullptr ){
+				entries = new Entry[ segment == 0 ? ( 1u << first_segment_bits ) : ( 1u << ( segment + first_segment_bits - 1 ) ) ];
+				segments[segment].store( entries, std::memory_order_release );
+			}
+
+			char *data = static_cast<char *>( strings.Allocate( str.Size() + 1, 1 ) );
+			std::memcpy( data, str.Data(), str.Size() );
+			data[str.Size()] = '\0';
+			entries[offset].data = data;
+			entries[offset].size = static_cast<std::uint32_t>( str.Size() );
+			entries[offset].hash = hash;
+
+			symbol = index + 1;
+			Table *current = table.load( std::memory_order_relaxed );
+			if( symbol * 2 > current->mask + 1 ){ // keep the load factor under a half
+				Grow();
+				current = table.load( std::memory_order_relaxed );
+			}
+			Insert( current, symbol, hash );
+			count.store( symbol, std::memory_order_release );
+			return symbol;
+		}
+
+		StringRef StringInterner::Lookup( Symbol symbol ) const
+		{
+			if( symbol == 0 ) return StringRef();
+			Entry const & entry = GetEntry( symbol );
+			return StringRef( entry.data, entry.size );
+		}
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "Arena.hpp"
+#include "StringRef.hpp"
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// Dense identifier of an interned string. Equal strings always get the same symbol,
+		// so names compare in O(1). Zero is never handed out and means "no symbol".
+		typedef std::uint32_t Symbol;
+
+		// A process-wide string table shared by every scanner. Finding a string that is
+		// already interned and mapping a symbol back to its text never take a lock; only
+		// the first occurrence of a string does.
+		struct StringInterner
+		{
+			StringInterner();
+			~StringInterner();
+
+			StringInterner( StringInterner const & ) = delete;
+			StringInterner & operator=( StringInterner const & ) = delete;
+
+			static StringInterner & Global();
+
+			Symbol		Intern( StringRef str );
+			Symbol		Find( StringRef str ) const;
+			StringRef	Lookup( Symbol symbol ) const;
+			std::size_t	Size() const { return count.load( std::memory_order_acquire ); }
+		private:
+			struct Entry
+			{
+				char const *	data;
+				std::uint32_t	size;
+				std::uint32_t	hash;
+			};
+
+			// Open-addressed table of symbols. It is never resized in place: a bigger one is
+			// published instead, and old ones are kept alive for readers still probing them.
+			struct Table
+			{
+				std::uint32_t				mask;
+				Table *						retired;
+				std::atomic<Symbol> *		slots;
+			};
+
+			static std::uint32_t Hash( StringRef str );
+			Entry const & GetEntry( Symbol symbol ) const;
+			Symbol	Probe( Table const * table, StringRef str, std::uint32_t hash ) const;
+			void	Insert( Table * table, Symbol symbol, std::uint32_t hash );
+			void	Grow();
+
+			// entries live in segments of doubling size, so they never move once published.
+			static unsigned const		first_segment_bits = 10;
+			static unsigned const		max_segments = 22;
+
+			std::atomic<Entry *>		segments[max_segments];
+			std::atomic<Table *>		table;
+			std::atomic<std::uint32_t>	count;
+			std::mutex					writer_lock;
+			Arena						strings;
+		}; // StringInterner
+	} // namespace Support
+} // namespace MaryLang
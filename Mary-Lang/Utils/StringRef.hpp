@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// A non-owning view of UTF-8 bytes, e.g. a token's spelling inside the source buffer.
+		struct StringRef
+		{
+			StringRef(): _data( nullptr ), _size( 0 ) {}
+			StringRef( char const * data, std::size_t size ): _data( data ), _size( size ) {}
+			StringRef( char const * str ): _data( str ), _size( std::strlen( str ) ) {}
+
+			inline char const *	Data() const { return _data; }
+			inline std::size_t	Size() const { return _size; }
+			inline bool			Empty() const { return _size == 0; }
+			inline char const *	begin() const { return _data; }
+			inline char const *	end() const { return _data + _size; }
+			inline char			operator[]( std::size_t i ) const { return _data[i]; }
+
+			std::string			Str() const { return std::string( _data, _size ); }
+
+			friend inline bool operator==( StringRef const & a, StringRef const & b )
+			{
+				return a._size == b._size && ( a._size == 0 || std::memcmp( a._data, b._data, a._size ) == 0 );
+			}
+			friend inline bool operator!=( StringRef const & a, StringRef const & b )
+			{
+				return !( a == b );
+			}
+		private:
+			char const *	_data;
+			std::size_t		_size;
+		}; // StringRef
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,96 @@
+#include "ThreadPool.hpp"
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		namespace
+		{
+			// Which pool, if any, the running thread works for, and its queue there.
+			thread_local ThreadPool const *	current_pool = nullptr;
+			thread_local std::size_t		current_queue = 0;
+		}
+
+		ThreadPool::ThreadPool( unsigned int threads )
+			: queues(), workers(), next_queue( 0 ), pending( 0 ), sleep_lock(), wake(), stopping( false )
+		{
+			if( threads == 0 ) threads = std::thread::hardware_concurrency();
+			if( threads == 0 ) threads = 1;
+			queues.reserve( threads );
+			for( unsigned int i = 0; i < threads; ++i ) queues.emplace_back( new Queue );
+			workers.reserve( threads );
+			for( unsigned int i = 0; i < threads; ++i ){
+				workers.emplace_back( [this, i]{ WorkerLoop( i ); } );
+			}
+		}
+
+		// Tasks already queued still run before the workers exit.
+		ThreadPool::~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> guard( sleep_lock );
+				stopping = true;
+			}
+			wake.notify_all();
+			for( std::thread & worker : workers ) worker.join();
+		}
+
+		void ThreadPool::Enqueue( std::function<void()> task )
+		{
+			std::size_t const target = current_pool == this ? current_queue : next_queue++ % queues.size();
+			{
+				// counted under the sleep lock so a worker about to sleep cannot miss it, and
+				// before the push so that taking the task never brings the count below zero
+				std::lock_guard<std::mutex> guard( sleep_lock );
+				++pending;
+			}
+			{
+				std::lock_guard<std::mutex> guard( queues[target]->lock );
+				queues[target]->tasks.push_back( std::move( task ) );
+			}
+			wake.notify_one();
+		}
+
+		// The newest task of our own queue, or else the oldest of someone else's.
+		bool ThreadPool::TakeTask( std::size_t self, std::function<void()> & task )
+		{
+			{
+				Queue & own = *queues[self];
+				std::lock_guard<std::mutex> guard( own.lock );
+				if( !own.tasks.empty() ){
+					task = std::move( own.tasks.back() );
+					own.tasks.pop_back();
+					--pending;
+					return true;
+				}
+			}
+			for( std::size_t i = 1; i < queues.size(); ++i ){
+				Queue & victim = *queues[( self + i ) % queues.size()];
+				std::lock_guard<std::mutex> guard( victim.lock );
+				if( !victim.tasks.empty() ){
+					task = std::move( victim.tasks.front() );
+					victim.tasks.pop_front();
+					--pending;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void ThreadPool::WorkerLoop( std::size_t self )
+		{
+			current_pool = this;
+			current_queue = self;
+			for( ; ; ){
+				std::function<void()> task;
+				if( TakeTask( self, task ) ){
+					task();
+					continue;
+				}
+				std::unique_lock<std::mutex> guard( sleep_lock );
+				wake.wait( guard, [this]{ return stopping || pending != 0; } );
+				if( stopping && pending == 0 ) return;
+			}
+		}
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// A fixed set of worker threads, each with a queue of its own. A task submitted from
+		// a worker goes to that worker's queue and is taken back newest first, which keeps
+		// nested work (a file's function bodies, say) close to the data it came from. Tasks
+		// submitted from outside are dealt round robin. A worker whose queue is empty steals
+		// the oldest task of another before going to sleep.
+		//
+		// Submit hands back a future for the task's result; an exception thrown by the task
+		// comes out of future::get().
+		struct ThreadPool
+		{
+			// zero means one thread per hardware thread.
+			explicit ThreadPool( unsigned int threads = 0 );
+			~ThreadPool();
+
+			ThreadPool( ThreadPool const & ) = delete;
+			ThreadPool & operator=( ThreadPool const & ) = delete;
+
+			template<typename F>
+			std::future<typename std::result_of<F()>::type> Submit( F task )
+			{
+				typedef typename std::result_of<F()>::type Result;
+				auto packaged = std::make_shared<std::packaged_task<Result()>>( std::move( task ) );
+				std::future<Result> result = packaged->get_future();
+				Enqueue( [packaged]{ ( *packaged )(); } );
+				return result;
+			}
+
+			inline unsigned int Size() const { return static_cast<unsigned int>( workers.size() ); }
+		private:
+			struct Queue
+			{
+				std::deque<std::function<void()>>	tasks;
+				std::mutex							lock;
+			};
+
+			void Enqueue( std::function<void()> task );
+			bool TakeTask( std::size_t self, std::function<void()> & task );
+			void WorkerLoop( std::size_t self );
+
+			std::vector<std::unique_ptr<Queue>>	queues; // one per worker
+			std::vector<std::thread>			workers;
+			std::atomic<std::size_t>			next_queue; // for tasks from outside the pool
+			std::atomic<std::size_t>			pending; // tasks queued and not yet taken
+			std::mutex							sleep_lock;
+			std::condition_variable				wake;
+			bool								stopping; // guarded by `sleep_lock'
+		}; // ThreadPool
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,154 @@
+#include "TimeTrace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		namespace
+		{
+			struct Event
+			{
+				char const *	name;
+				std::string		detail;
+				std::int64_t	start, end;
+			};
+
+			// The events of one thread, which alone appends to them.
+			struct ThreadEvents
+			{
+				std::uint32_t		id;
+				std::vector<Event>	events;
+			};
+
+			std::chrono::steady_clock::time_point	epoch;
+			std::mutex								threads_lock;
+			std::vector<std::unique_ptr<ThreadEvents>> threads; // guarded by `threads_lock'
+			thread_local ThreadEvents *				current_thread = nullptr;
+
+			ThreadEvents & CurrentThread()
+			{
+				if( current_thread == nullptr ){
+					std::lock_guard<std::mutex> guard( threads_lock );
+					threads.emplace_back( new ThreadEvents{ static_cast<std::uint32_t>( threads.size() ), std::vector<Event>() } );
+					current_thread = threads.back().get();
+				}
+				return *current_thread;
+			}
+
+			std::string JsonString( std::string const & str )
+			{
+				std::string quoted = "\"";
+				for( char const c : str ){
+					if( c == '"' || c == '\\' ){
+						quoted += '\\';
+						quoted += c;
+					} else if( static_cast<unsigned char>( c ) < 0x20 ){
+						char escaped[8];
+						std::snprintf( escaped, sizeof( escaped ), "\\u%04x", c );
+						quoted += escaped;
+					} else {
+						quoted += c;
+					}
+				}
+				return quoted + '"';
+			}
+		} // namespace
+
+		std::atomic<bool> TimeTrace::enabled( false );
+
+		void TimeTrace::Enable()
+		{
+			epoch = std::chrono::steady_clock::now();
+			CurrentThread(); // the thread that turns tracing on is listed first, as main
+			enabled.store( true, std::memory_order_relaxed );
+		}
+
+		std::int64_t TimeTrace::Now()
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - epoch ).count();
+		}
+
+		void TimeTrace::Record( char const * name, std::string && detail, std::int64_t start, std::int64_t end )
+		{
+			CurrentThread().events.push_back( Event{ name, std::move( detail ), start, end } );
+		}
+
+		// "X" events carry their own duration, so nesting needs no matching begin and end.
+		void TimeTrace::WriteChromeTrace( std::ostream & out )
+		{
+			std::lock_guard<std::mutex> guard( threads_lock );
+			out << "{\"traceEvents\": [";
+			char const * separator = "\n";
+			for( std::unique_ptr<ThreadEvents> const & thread : threads ){
+				out << separator << "{\"ph\": \"M\", \"pid\": 1, \"tid\": " << thread->id
+					<< ", \"name\": \"thread_name\", \"args\": {\"name\": \""
+					<< ( thread->id == 0 ? "main" : "thread " + std::to_string( thread->id ) ) << "\"}}";
+				separator = ",\n";
+				for( Event const & event : thread->events ){
+					out << separator << "{\"ph\": \"X\", \"pid\": 1, \"tid\": " << thread->id
+						<< ", \"ts\": " << event.start << ", \"dur\": " << event.end - event.start
+						<< ", \"name\": " << JsonString( event.name );
+					if( !event.detail.empty() ) out << ", \"args\": {\"detail\": " << JsonString( event.detail ) << "}";
+					out << "}";
+				}
+			}
+			out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+			out.flush();
+		}
+
+		void TimeTrace::WriteReport( std::wostream & out )
+		{
+			struct Total
+			{
+				std::int64_t	microseconds;
+				std::size_t		count;
+			};
+			std::map<std::string, Total> totals;
+			std::int64_t first = 0, last = 0;
+			bool any = false;
+			{
+				std::lock_guard<std::mutex> guard( threads_lock );
+				for( std::unique_ptr<ThreadEvents> const & thread : threads ){
+					for( Event const & event : thread->events ){
+						Total & total = totals[event.name];
+						total.microseconds += event.end - event.start;
+						++total.count;
+						first = any ? std::min( first, event.start ) : event.start;
+						last = any ? std::max( last, event.end ) : event.end;
+						any = true;
+					}
+				}
+			}
+			std::vector<std::pair<std::string, Total>> phases( totals.begin(), totals.end() );
+			std::stable_sort( phases.begin(), phases.end(), []( std::pair<std::string, Total> const & a, std::pair<std::string, Total> const & b ){
+				return a.second.microseconds > b.second.microseconds;
+			} );
+
+			double const wall = ( last - first ) / 1000.0;
+			std::ios_base::fmtflags const flags = out.flags();
+			std::streamsize const precision = out.precision();
+			out << L"===--- Time report: " << std::fixed << std::setprecision( 3 ) << wall << L" ms wall clock ---===\n"
+				<< std::setw( 14 ) << L"total (ms)" << std::setw( 10 ) << L"of wall" << std::setw( 10 ) << L"count"
+				<< std::setw( 14 ) << L"average (ms)" << L"  phase\n";
+			for( auto const & phase : phases ){
+				double const total = phase.second.microseconds / 1000.0;
+				out << std::setw( 14 ) << total
+					<< std::setw( 9 ) << std::setprecision( 1 ) << ( wall > 0.0 ? total * 100.0 / wall : 0.0 ) << L'%'
+					<< std::setw( 10 ) << phase.second.count
+					<< std::setw( 14 ) << std::setprecision( 3 ) << total / phase.second.count
+					<< L"  " << std::wstring( phase.first.begin(), phase.first.end() ) << L'\n';
+			}
+			out.flags( flags );
+			out.precision( precision );
+			out.flush();
+		}
+	} // namespace Support
+} // namespace MaryLang
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace MaryLang
+{
+	namespace Support
+	{
+		// Records how long the phases of a build take, per thread, for a Chrome trace
+		// (chrome://tracing, Perfetto) and for a summary of where the time went.
+		//
+		// Recording is off until Enable; a TimeScope then costs a branch and nothing else.
+		// Each thread appends to a buffer of its own, so scopes on the pool never contend.
+		struct TimeTrace
+		{
+			// Scopes opened from now on are recorded.
+			static void Enable();
+			static inline bool IsEnabled() { return enabled.load( std::memory_order_relaxed ); }
+
+			// Call these once the work is done: a scope still open on another thread is not
+			// written, and one closing meanwhile is a data race.
+			static void WriteChromeTrace( std::ostream & out );
+			// Total and count per phase name. Nested phases are part of their parents' time.
+			static void WriteReport( std::wostream & out );
+
+			// Microseconds since Enable.
+			static std::int64_t Now();
+		private:
+			friend struct TimeScope;
+			static void Record( char const * name, std::string && detail, std::int64_t start, std::int64_t end );
+
+			static std::atomic<bool> enabled;
+		};
+
+		// Times the enclosing block as phase `name', a string literal. `detail', e.g. the
+		// file being worked on, is shown with each occurrence in the trace.
+		struct TimeScope
+		{
+			explicit TimeScope( char const * phase )
+				: name( TimeTrace::IsEnabled() ? phase : nullptr ), detail(), start( name ? TimeTrace::Now() : 0 ) {}
+			TimeScope( char const * phase, std::string const & what )
+				: name( TimeTrace::IsEnabled() ? phase : nullptr ), detail( name ? what : std::string() ),
+				start( name ? TimeTrace::Now() : 0 ) {}
+			~TimeScope()
+			{
+				if( name ) TimeTrace::Record( name, std::move( detail ), start, TimeTrace::Now() );
+			}
+
+			TimeScope( TimeScope const & ) = delete;
+			TimeScope & operator=( TimeScope const & ) = delete;
+		private:
+			char const *	name; // null when not recording
+			std::string		detail;
+			std::int64_t	start;
+		};
+	} // namespace Support
+} // namespace MaryLang
@@ -2,26 +2,70 @@
 
 #include <cwctype>
 #include <cwchar>
+#include <string>
 
 namespace MaryLang
 {
 	namespace Support
 	{
-		static wchar_t* Mystrndup( wchar_t const *str, size_t n )
+		// Number of bytes in the UTF-8 sequence introduced by `lead'. Stray continuation
+		// bytes and invalid leads count as a single byte so that they surface as one
+		// invalid character.
+		static unsigned Utf8SequenceLength( unsigned char lead )
 		{
-			wchar_t *dup = new wchar_t[ n + 1 ];
-#if defined( _WIN32 ) && defined ( _MSC_VER )
-			int s = wcsncpy_s( dup, n + 1, str, n );
-			if( s != 0 ) {
-				delete []dup;
-				dup = nullptr;
+			if( lead < 0xC2 ) return 1;
+			if( lead < 0xE0 ) return 2;
+			if( lead < 0xF0 ) return 3;
+			if( lead < 0xF5 ) return 4;
+			return 1;
+		}
+
+		// Decodes the `length' bytes sequence at `str', as measured by Utf8SequenceLength.
+		// Malformed sequences decode to U+FFFD.
+		static char32_t DecodeUtf8( char const *str, unsigned length )
+		{
+			unsigned char const *s = reinterpret_cast<unsigned char const *>( str );
+			if( length != Utf8SequenceLength( s[0] ) ) return 0xFFFD; // truncated by end of input
+			char32_t code_point;
+			switch( length )
+			{
+			case 1: return s[0] < 0x80 ? s[0] : 0xFFFD;
+			case 2: code_point = s[0] & 0x1F; break;
+			case 3: code_point = s[0] & 0x0F; break;
+			default: code_point = s[0] & 0x07; break;
+			}
+			for( unsigned i = 1; i < length; ++i ){
+				if( ( s[i] & 0xC0 ) != 0x80 ) return 0xFFFD;
+				code_point = ( code_point << 6 ) | ( s[i] & 0x3F );
+			}
+			return code_point;
+		}
+
+		static void AppendCodePoint( std::wstring & str, char32_t code_point )
+		{
+#if defined( _WIN32 )
+			if( code_point > 0xFFFF ){ // UTF-16 needs a surrogate pair
+				code_point -= 0x10000;
+				str.push_back( static_cast<wchar_t>( 0xD800 + ( code_point >> 10 ) ) );
+				str.push_back( static_cast<wchar_t>( 0xDC00 + ( code_point & 0x3FF ) ) );
+				return;
 			}
-			return dup;
-#else
-			std::wcsncpy( dup, str, n );
-			dup[n] = '\0';
-			return dup;
 #endif
+			str.push_back( static_cast<wchar_t>( code_point ) );
+		}
+
+		// Widens a UTF-8 byte range, e.g. a token's spelling, for the wide output streams.
+		static std::wstring Utf8ToWide( char const *str, size_t n )
+		{
+			std::wstring wide;
+			wide.reserve( n );
+			for( char const *end = str + n; str < end; ){
+				unsigned length = Utf8SequenceLength( static_cast<unsigned char>( *str ) );
+				if( length > static_cast<size_t>( end - str ) ) length = static_cast<unsigned>( end - str );
+				AppendCodePoint( wide, DecodeUtf8( str, length ) );
+				str += length;
+			}
+			return wide;
 		}
 	} // namespace Support
 }//namespace MaryLang
\ No newline at end of file